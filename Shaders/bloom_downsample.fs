@@ -0,0 +1,151 @@
+#version 410
+
+
+//******************************************************************************
+//**********  Fragment shader inputs/ouputs  ***********************************
+//******************************************************************************
+
+
+// Fragment color output(s)
+// ------------------------
+layout ( location = 0 ) out vec4 FragColor;
+
+
+// Fragment input uniforms
+// -----------------------
+#ifdef MULTISAMPLE
+uniform sampler2DMS uTexture;
+#else
+uniform sampler2D uTexture;
+#endif
+uniform vec2      uSourceTexelSize;
+
+// First level only, brightness extraction from the HDR frame, always on for the multi sampled variant
+uniform bool  uPrefilter;
+uniform float uThreshold;
+uniform float uKnee;
+
+
+// Fragment inputs from vertex shader
+// ----------------------------------
+in vec2 oUV;
+
+
+//******************************************************************************
+//**********  Fragment shader functions  ***************************************
+//******************************************************************************
+
+
+// Luminance weighted average, keeps isolated very bright texels from flickering
+// ------------------------------------------------------------------------------
+vec3 KarisAverage( vec3 iA,
+                   vec3 iB,
+                   vec3 iC,
+                   vec3 iD )
+{
+  vec4 weights = 1.0 / ( 1.0 + vec4( dot( iA, vec3( 0.2126, 0.7152, 0.0722 ) ),
+                                     dot( iB, vec3( 0.2126, 0.7152, 0.0722 ) ),
+                                     dot( iC, vec3( 0.2126, 0.7152, 0.0722 ) ),
+                                     dot( iD, vec3( 0.2126, 0.7152, 0.0722 ) ) ) );
+
+  return ( iA * weights.x + iB * weights.y + iC * weights.z + iD * weights.w ) / ( weights.x + weights.y + weights.z + weights.w );
+}
+
+
+// Quadratic soft knee around the threshold instead of a hard cut
+// ---------------------------------------------------------------
+vec3 SoftThreshold( vec3 iColor )
+{
+  float brightness = dot( iColor, vec3( 0.2126, 0.7152, 0.0722 ) );
+  float soft       = clamp( brightness - uThreshold + uKnee, 0.0, 2.0 * uKnee );
+  soft             = ( soft * soft ) / ( 4.0 * uKnee + 0.0001 );
+
+  return iColor * ( max( soft, brightness - uThreshold ) / max( brightness, 0.0001 ) );
+}
+
+
+#ifdef MULTISAMPLE
+
+// First sample of the 4x4 texels footprint, same boxes weighting as the 13 taps below
+// -----------------------------------------------------------------------------------
+vec3 FetchFirstSample( ivec2 iTexel )
+{
+  return texelFetch( uTexture, clamp( iTexel, ivec2( 0 ), textureSize( uTexture ) - 1 ), 0 ).rgb;
+}
+
+void main()
+{
+  ivec2 origin = ivec2( gl_FragCoord.xy ) * 2 - 1;
+
+  vec3 texels[ 16 ];
+  for( int y = 0; y < 4; y++ )
+  {
+    for( int x = 0; x < 4; x++ )
+    {
+      texels[ y * 4 + x ] = FetchFirstSample( origin + ivec2( x, y ) );
+    }
+  }
+
+  // Center box then the four corner boxes
+  vec3 color_result = KarisAverage( texels[ 5 ], texels[ 6 ], texels[ 9 ], texels[ 10 ] ) * 0.5;
+  color_result += KarisAverage( texels[ 0 ],  texels[ 1 ],  texels[ 4 ],  texels[ 5 ] )  * 0.125;
+  color_result += KarisAverage( texels[ 2 ],  texels[ 3 ],  texels[ 6 ],  texels[ 7 ] )  * 0.125;
+  color_result += KarisAverage( texels[ 8 ],  texels[ 9 ],  texels[ 12 ], texels[ 13 ] ) * 0.125;
+  color_result += KarisAverage( texels[ 10 ], texels[ 11 ], texels[ 14 ], texels[ 15 ] ) * 0.125;
+
+  FragColor = vec4( max( SoftThreshold( color_result ), vec3( 0.0 ) ), 1.0 );
+}
+
+#else
+
+// Main function
+// -------------
+void main()
+{
+  // 13 bilinear taps over a 4x4 source texels footprint
+  //  a . b . c
+  //  . j . k .
+  //  d . e . f
+  //  . l . m .
+  //  g . h . i
+  vec2 texel = uSourceTexelSize;
+
+  vec3 a = texture( uTexture, oUV + texel * vec2( -2.0,  2.0 ) ).rgb;
+  vec3 b = texture( uTexture, oUV + texel * vec2(  0.0,  2.0 ) ).rgb;
+  vec3 c = texture( uTexture, oUV + texel * vec2(  2.0,  2.0 ) ).rgb;
+  vec3 d = texture( uTexture, oUV + texel * vec2( -2.0,  0.0 ) ).rgb;
+  vec3 e = texture( uTexture, oUV                              ).rgb;
+  vec3 f = texture( uTexture, oUV + texel * vec2(  2.0,  0.0 ) ).rgb;
+  vec3 g = texture( uTexture, oUV + texel * vec2( -2.0, -2.0 ) ).rgb;
+  vec3 h = texture( uTexture, oUV + texel * vec2(  0.0, -2.0 ) ).rgb;
+  vec3 i = texture( uTexture, oUV + texel * vec2(  2.0, -2.0 ) ).rgb;
+  vec3 j = texture( uTexture, oUV + texel * vec2( -1.0,  1.0 ) ).rgb;
+  vec3 k = texture( uTexture, oUV + texel * vec2(  1.0,  1.0 ) ).rgb;
+  vec3 l = texture( uTexture, oUV + texel * vec2( -1.0, -1.0 ) ).rgb;
+  vec3 m = texture( uTexture, oUV + texel * vec2(  1.0, -1.0 ) ).rgb;
+
+  vec3 color_result;
+
+  if( uPrefilter )
+  {
+    // Five overlapping boxes, each one averaged by luminance before the threshold
+    color_result  = KarisAverage( j, k, l, m ) * 0.5;
+    color_result += KarisAverage( a, b, d, e ) * 0.125;
+    color_result += KarisAverage( b, c, e, f ) * 0.125;
+    color_result += KarisAverage( d, e, g, h ) * 0.125;
+    color_result += KarisAverage( e, f, h, i ) * 0.125;
+
+    color_result = SoftThreshold( color_result );
+  }
+  else
+  {
+    color_result  = e * 0.125;
+    color_result += ( a + c + g + i ) * 0.03125;
+    color_result += ( b + d + f + h ) * 0.0625;
+    color_result += ( j + k + l + m ) * 0.125;
+  }
+
+  FragColor = vec4( max( color_result, vec3( 0.0 ) ), 1.0 );
+}
+
+#endif
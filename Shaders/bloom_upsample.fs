@@ -0,0 +1,48 @@
+#version 410
+
+
+//******************************************************************************
+//**********  Fragment shader inputs/ouputs  ***********************************
+//******************************************************************************
+
+
+// Fragment color output(s)
+// ------------------------
+layout ( location = 0 ) out vec4 FragColor;
+
+
+// Fragment input uniforms
+// -----------------------
+uniform sampler2D uTexture;
+uniform vec2      uSourceTexelSize;
+uniform float     uRadius;
+
+
+// Fragment inputs from vertex shader
+// ----------------------------------
+in vec2 oUV;
+
+
+//******************************************************************************
+//**********  Fragment shader functions  ***************************************
+//******************************************************************************
+
+void main()
+{
+  // 3x3 tent filter over the smaller level, additively blended over the larger one
+  vec2 texel = uSourceTexelSize * uRadius;
+
+  vec3 color_result  = texture( uTexture, oUV ).rgb * 4.0;
+
+  color_result += texture( uTexture, oUV + texel * vec2(  0.0,  1.0 ) ).rgb * 2.0;
+  color_result += texture( uTexture, oUV + texel * vec2( -1.0,  0.0 ) ).rgb * 2.0;
+  color_result += texture( uTexture, oUV + texel * vec2(  1.0,  0.0 ) ).rgb * 2.0;
+  color_result += texture( uTexture, oUV + texel * vec2(  0.0, -1.0 ) ).rgb * 2.0;
+
+  color_result += texture( uTexture, oUV + texel * vec2( -1.0,  1.0 ) ).rgb;
+  color_result += texture( uTexture, oUV + texel * vec2(  1.0,  1.0 ) ).rgb;
+  color_result += texture( uTexture, oUV + texel * vec2( -1.0, -1.0 ) ).rgb;
+  color_result += texture( uTexture, oUV + texel * vec2(  1.0, -1.0 ) ).rgb;
+
+  FragColor = vec4( color_result * ( 1.0 / 16.0 ), 1.0 );
+}
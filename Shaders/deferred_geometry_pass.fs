@@ -1,4 +1,17 @@
-#version 330 
+#version 410
+
+#define ZERO 0.00390625
+
+// Shadow bias stored in 8 bits over [ 0, SHADOW_BIAS_RANGE ], 0 when not receiving shadows
+#define SHADOW_BIAS_RANGE 0.05
+
+struct Material
+{
+  vec3  _albedo;
+  float _metalness;
+  float _roughness;
+  float _ao;
+};
 
 
 //******************************************************************************
@@ -8,31 +21,63 @@
 
 // Fragment color output(s)
 // ------------------------
-layout( location = 0 ) out vec4 PositionAndBloom;
-layout( location = 1 ) out vec4 NormalAndBloomBrightness;
-layout( location = 2 ) out vec3 Albedo;
-layout( location = 3 ) out vec3 RougnessAndMetalnessAndAO;
+layout( location = 0 ) out vec2 NormalOctahedral;
+layout( location = 1 ) out vec4 AlbedoAndShadowBias;
+layout( location = 2 ) out vec4 RougnessMetalnessAO;
+layout( location = 3 ) out vec4 AmbientAndEmissive;
 
 
 // Fragment input uniforms
 // -----------------------
-uniform sampler2D uTextureDiffuse1; 
-uniform sampler2D uTextureSpecular1;
-uniform sampler2D uTextureNormal1; 
-uniform sampler2D uTextureHeight1; 
-uniform sampler2D uTextureAO1; 
-uniform sampler2D uTextureRoughness1; 
-uniform sampler2D uTextureMetalness1;
 
-uniform float uBloom;
-uniform float uBloomBrightness;
+// View uniforms
+uniform vec3 uViewPos;
 
+// IBL uniforms
+uniform bool  uIBL;
+uniform float uMaxMipLevel;
+uniform bool  uParallaxCubemap;
+uniform vec3  uCubemapPos;
 
-// Fragment inputs from vertex shader 
-// ----------------------------------
-in vec2 oUV;
+// Opacity uniforms
+uniform bool  uOpacityMap;
+uniform float uOpacityDiscard;
+uniform float uAlpha;
+
+// Normal mapping uniforms
+uniform bool uNormalMap;
+
+// Shadow uniforms
+uniform bool  uReceivShadow;
+uniform float uShadowBias;
+
+// Emissive uniform(s)
+uniform bool  uEmissive;
+uniform float uEmissiveFactor;
+
+// Scene object ID uniform
+uniform float uID;
+
+// Textures uniforms
+uniform sampler2D   uTextureAlbedo1;
+uniform sampler2D   uTextureNormal1;
+uniform sampler2D   uTextureAO1;
+uniform sampler2D   uTextureRoughness1;
+uniform sampler2D   uTextureMetalness1;
+uniform sampler2D   uTextureOpacity1;
+uniform sampler2D   uTextureEmissive1;
+
+uniform samplerCube uIrradianceCubeMap;
+uniform samplerCube uPreFilterCubeMap;
+uniform sampler2D   uPreBrdfLUT;
+
+
+// Fragment inputs from vertex or tessellation evaluation shader
+// -------------------------------------------------------------
 in vec3 oFragPos;
-flat in vec3 oTBN[ 3 ];
+in vec3 oNormal;
+in vec2 oUV;
+in vec3 oTBN[ 3 ];
 
 
 //******************************************************************************
@@ -42,13 +87,9 @@ flat in vec3 oTBN[ 3 ];
 
 // Normal mapping function
 // -----------------------
-vec3 NormalMappingCalculation( vec2 iUV )                                                                     
-{      
+vec3 NormalMappingCalculation( vec2 iUV )
+{
   vec3 res_normal;
-      
-  // Get normal vector
-  res_normal = texture( uTextureNormal1, iUV ).rgb;
-  res_normal = normalize( res_normal * 2.0 - 1.0 );   
 
   // Get TBN matrix
   mat3 TBN;
@@ -56,36 +97,141 @@ vec3 NormalMappingCalculation( vec2 iUV )
   TBN[ 1 ] = oTBN[ 1 ];
   TBN[ 2 ] = oTBN[ 2 ];
 
+  res_normal = texture( uTextureNormal1, iUV ).rgb;
+  res_normal = normalize( res_normal * 2.0 - 1.0 );
+
   return normalize( res_normal * TBN );
 }
 
-void main()
-{ 
 
-  // G Buffer drawing
-  // ----------------
-  
-  // Draw G buffer position
-  PositionAndBloom.rgb = oFragPos;
+// Octahedral normal encoding, [ 0, 1 ] range to fit an unorm RG16 target
+// ----------------------------------------------------------------------
+vec2 OctahedralWrap( vec2 iDirection )
+{
+  return ( 1.0 - abs( iDirection.yx ) ) * vec2( iDirection.x >= 0.0 ? 1.0 : -1.0, iDirection.y >= 0.0 ? 1.0 : -1.0 );
+}
 
-  // Draw Bloom bool info
-  PositionAndBloom.a = uBloom;
+vec2 OctahedralEncode( vec3 iNormal )
+{
+  vec3 normal = iNormal / ( abs( iNormal.x ) + abs( iNormal.y ) + abs( iNormal.z ) );
+  normal.xy = ( normal.z >= 0.0 ) ? normal.xy : OctahedralWrap( normal.xy );
 
-  // Draw G buffer normal
-  NormalAndBloomBrightness.rgb = NormalMappingCalculation( oUV );
+  return normal.xy * 0.5 + 0.5;
+}
 
-  // Draw BloomBrightness info
-  NormalAndBloomBrightness.a = uBloomBrightness;
-  
-  // Draw G buffer albedo
-  Albedo = pow( texture( uTextureDiffuse1, oUV ).rgb, vec3( 2.2 ) );
 
-  // Draw G buffer roughness
-  RougnessAndMetalnessAndAO.r = texture( uTextureRoughness1, oUV ).r;
+// PBR IBL ambient, same as the forward shader, needs the object own cubemaps so done here
+// ---------------------------------------------------------------------------------------
+vec3 FresnelSchlickRoughness( float iCosTheta,
+                              vec3  iF0,
+                              float iRoughness )
+{
+  return iF0 + ( max( vec3( 1.0 - iRoughness ), iF0 ) - iF0 ) * pow( 1.0 - iCosTheta, 5.0 );
+}
 
-  // Draw G buffer metalness
-  RougnessAndMetalnessAndAO.g = texture( uTextureMetalness1, oUV ).r;   
+vec3 IBLAmbientReflectance( float    iNormalDotViewDir,
+                            Material iMaterial,
+                            vec3     iF0,
+                            vec3     iNormal,
+                            vec3     iViewDir )
+{
+  // Diffuse irradiance
+  vec3 kS = FresnelSchlickRoughness( iNormalDotViewDir, iF0, iMaterial._roughness );
+  vec3 kD = ( 1.0 - kS ) * ( 1.0 - iMaterial._metalness );
+  vec3 diffuse = ( texture( uIrradianceCubeMap, iNormal ).rgb * iMaterial._albedo ) * kD;
+
+  // Specular reflection direction, parallax corrected inside the room box
+  vec3 reflect_dir;
+  if( uParallaxCubemap )
+  {
+    vec3 reflect_dir_WS = reflect( oFragPos - uViewPos, iNormal );
+    vec3 pos  = vec3( -8.0 * 0.5, 0.0, -8.0 * 0.5 ) + vec3( uCubemapPos.x, 0.0, uCubemapPos.z );
+    vec3 bmax = vec3( 8.0, 8.0 / 3.0, 8.0 ) + pos;
+    vec3 bmin = pos;
+
+    vec3 furthest_plane = max( ( bmax - oFragPos ) / reflect_dir_WS, ( bmin - oFragPos ) / reflect_dir_WS );
+    float distance = min( min( furthest_plane.x, furthest_plane.y ), furthest_plane.z );
+    reflect_dir = ( oFragPos + reflect_dir_WS * distance ) - uCubemapPos;
+  }
+  else
+  {
+    reflect_dir = reflect( -iViewDir, iNormal );
+  }
+
+  vec3 prefiltered_color = textureLod( uPreFilterCubeMap, reflect_dir, iMaterial._roughness * uMaxMipLevel ).rgb;
+  vec2 brdf = texture( uPreBrdfLUT, vec2( iNormalDotViewDir, iMaterial._roughness ) ).rg;
+  vec3 specular = prefiltered_color * ( ( kS * brdf.x ) + brdf.y );
+
+  return ( diffuse + specular ) * iMaterial._ao;
+}
 
-  // Draw G buffer AO
-  RougnessAndMetalnessAndAO.b = texture( uTextureAO1, oUV ).r;
+
+// Main function
+// -------------
+void main()
+{
+  // Only opaque parts go through the G-buffer, transparent ones are forward rendered after the lighting
+  float opacity = uOpacityMap ? texture( uTextureOpacity1, oUV ).r : uAlpha;
+  if( uOpacityDiscard == 1.0 && opacity < 1.0f )
+  {
+    discard;
+  }
+  if( uOpacityDiscard == 2.0 && opacity == 1.0f )
+  {
+    discard;
+  }
+
+  // Get fragment normal, inversed for double sided mesh
+  vec3 normal = uNormalMap ? NormalMappingCalculation( oUV ) : normalize( oNormal );
+  if( !gl_FrontFacing )
+  {
+    normal *= -1.0;
+  }
+
+  // Get material inputs data
+  vec4 albedo_texel = texture( uTextureAlbedo1, oUV );
+
+  Material material;
+  material._albedo    = pow( albedo_texel.rgb, vec3( 2.2 ) );
+  material._metalness = texture( uTextureMetalness1, oUV ).r;
+  material._roughness = texture( uTextureRoughness1, oUV ).r;
+  material._ao        = texture( uTextureAO1, oUV ).r;
+
+  if( uID == 7.0 )
+  {
+    material._roughness = 1.0 - texture( uTextureMetalness1, oUV ).a;
+    material._ao        = 1.0;
+  }
+
+
+  // G Buffer drawing, position is rebuilt from depth in the lighting pass
+  // ---------------------------------------------------------------------
+  NormalOctahedral = OctahedralEncode( normal );
+
+  // sRGB texels go as is in the sRGB target and come back linear when sampled
+  AlbedoAndShadowBias.rgb = albedo_texel.rgb;
+  AlbedoAndShadowBias.a   = uReceivShadow ? clamp( uShadowBias / SHADOW_BIAS_RANGE, 1.0 / 255.0, 1.0 ) : 0.0;
+
+  RougnessMetalnessAO = vec4( material._roughness, material._metalness, material._ao, 0.0 );
+
+
+  // Lighting target starts with the ambient and emissive terms, lights are added over it
+  // ------------------------------------------------------------------------------------
+  vec3 view_dir = normalize( uViewPos - oFragPos );
+  float N_dot_V = clamp( dot( normal, view_dir ), ZERO, 1.0 );
+  vec3 F0 = mix( vec3( 0.04 ), material._albedo, material._metalness );
+
+  vec3 ambient = vec3( 0.0 );
+  if( uIBL )
+  {
+    ambient = clamp( IBLAmbientReflectance( N_dot_V, material, F0, normal, view_dir ), ZERO, 1.0 );
+  }
+
+  vec3 emissive = vec3( 0.0 );
+  if( uEmissive )
+  {
+    emissive = texture( uTextureEmissive1, oUV ).rgb * uEmissiveFactor;
+  }
+
+  AmbientAndEmissive = vec4( ambient + emissive, 1.0 );
 }
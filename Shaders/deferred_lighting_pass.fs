@@ -1,7 +1,10 @@
-#version 330 
+#version 410
 
 #define PI 3.14159265358979323846264338
 
+// Shadow bias stored in 8 bits over [ 0, SHADOW_BIAS_RANGE ], 0 when not receiving shadows
+#define SHADOW_BIAS_RANGE 0.05
+
 
 //******************************************************************************
 //**********  Fragment shader inputs/ouputs  ***********************************
@@ -11,22 +14,29 @@
 // Fragment color output(s)
 // ------------------------
 layout ( location = 0 ) out vec4 FragColor;
-layout ( location = 1 ) out vec4 FragColorBrightness;
 
 
 // Fragment input uniforms
 // -----------------------
-uniform sampler2D   uGbufferPositionAndBloom;
-uniform sampler2D   uGbufferNormalAndBloomBrightness;
+uniform sampler2D   uGbufferNormal;
 uniform sampler2D   uGbufferAlbedo;
 uniform sampler2D   uGbufferRougnessMetalnessAO;
-uniform samplerCube uIrradianceCubeMap;
+uniform sampler2D   uGbufferDepth;
+
+uniform mat4  uInverseViewProjectionMatrix;
 
 uniform vec3  uViewPos;
-uniform vec3  uLightPos;
-uniform vec3  uLightColor;
-uniform float uLightIntensity;
-uniform float uLightMaxDistance;
+
+// Light texels : ( position, range ) and ( radiance, shadow slot code = tier * 16 + layer or -1 )
+uniform samplerBuffer uLightsBuffer;
+uniform int           uLightIndex;
+
+// Shadow atlas tiers, one cubemap array per slot resolution
+uniform samplerCubeArray uShadowAtlas0;
+uniform samplerCubeArray uShadowAtlas1;
+uniform samplerCubeArray uShadowAtlas2;
+uniform samplerCubeArray uShadowAtlas3;
+uniform float            uShadowFar;
 
 uniform vec2 uScreenSize;
 
@@ -36,6 +46,88 @@ uniform vec2 uScreenSize;
 //******************************************************************************
 
 
+// G-buffer decoding functions
+// ---------------------------
+vec3 OctahedralDecode( vec2 iEncoded )
+{
+  vec2 encoded = iEncoded * 2.0 - 1.0;
+  vec3 normal  = vec3( encoded, 1.0 - abs( encoded.x ) - abs( encoded.y ) );
+  float fold   = clamp( -normal.z, 0.0, 1.0 );
+  normal.xy   += vec2( normal.x >= 0.0 ? -fold : fold, normal.y >= 0.0 ? -fold : fold );
+
+  return normalize( normal );
+}
+
+vec3 WorldPositionFromDepth( vec2  iScreenSpaceUV,
+                             float iDepth )
+{
+  vec4 world_pos = uInverseViewProjectionMatrix * vec4( vec3( iScreenSpaceUV, iDepth ) * 2.0 - 1.0, 1.0 );
+
+  return world_pos.xyz / world_pos.w;
+}
+
+
+// Omnidirectional shadow functions, same PCF as the forward shader
+// ----------------------------------------------------------------
+vec3 PCF_offset_directions[ 20 ] = vec3[]
+(
+  vec3( 1, 1,  1 ), vec3(  1, -1,  1 ), vec3( -1, -1,  1 ), vec3( -1, 1,  1 ), 
+  vec3( 1, 1, -1 ), vec3(  1, -1, -1 ), vec3( -1, -1, -1 ), vec3( -1, 1, -1 ),
+  vec3( 1, 1,  0 ), vec3(  1, -1,  0 ), vec3( -1, -1,  0 ), vec3( -1, 1,  0 ),
+  vec3( 1, 0,  1 ), vec3( -1,  0,  1 ), vec3(  1,  0, -1 ), vec3( -1, 0, -1 ),
+  vec3( 0, 1,  1 ), vec3(  0, -1,  1 ), vec3(  0, -1, -1 ), vec3(  0, 1, -1 )
+);
+
+float ShadowAtlasSampling( int  iShadowCode,
+                           vec3 iDirection )
+{
+  int  tier        = iShadowCode >> 4;
+  vec4 coordinates = vec4( iDirection, float( iShadowCode & 15 ) );
+
+  if( tier == 0 )
+  {
+    return texture( uShadowAtlas0, coordinates ).r;
+  }
+  if( tier == 1 )
+  {
+    return texture( uShadowAtlas1, coordinates ).r;
+  }
+  if( tier == 2 )
+  {
+    return texture( uShadowAtlas2, coordinates ).r;
+  }
+  return texture( uShadowAtlas3, coordinates ).r;
+}
+
+float ShadowCalculation( int   iShadowCode,
+                         vec3  iLightPos,
+                         vec3  iFragPos,
+                         float iShadowBias )
+{
+  // Light without shadow slot or surface not receiving shadows
+  if( iShadowCode < 0 || iShadowBias <= 0.0 )
+  {
+    return 1.0;
+  }
+
+  vec3  frag_to_light      = iFragPos - iLightPos;
+  float frag_depth         = length( frag_to_light );
+  float sample_disk_radius = ( 1.0 + ( ( length( uViewPos - iFragPos ) / uShadowFar ) * 30.0 ) ) / 500.0;
+
+  float shadow = 0.0;
+  for( int sample_it = 0; sample_it < 20; sample_it++ )
+  {
+    float closest_depth = ShadowAtlasSampling( iShadowCode, frag_to_light + PCF_offset_directions[ sample_it ] * sample_disk_radius ) * uShadowFar;
+    if( ( frag_depth - iShadowBias ) > closest_depth )
+    {
+      shadow += 1.0;
+    }
+  }
+
+  return 1.0 - ( shadow / 20.0 );
+}
+
+
 // PBR lighting functions
 // ----------------------
 float DistributionGGX( vec3 iNormal,
@@ -85,13 +177,6 @@ vec3 FresnelSchlick( float iCosTheta,
   return iF0 + ( 1.0 - iF0 ) * pow( 1.0 - iCosTheta, 5.0 );
 }
 
-vec3 FresnelSchlickRoughness( float iCosTheta,
-                              vec3 iF0,
-                              float iRoughness )
-{
-  return iF0 + ( max( vec3( 1.0 - iRoughness), iF0 ) - iF0 ) * pow( 1.0 - iCosTheta, 5.0 );
-}
-
 vec3 ReflectanceEquationCalculation( vec3  iFragPos,
                                      vec3  iViewDir,
                                      vec3  iNormal,
@@ -99,7 +184,8 @@ vec3 ReflectanceEquationCalculation( vec3  iFragPos,
                                      float iMaxNormalDotViewDir,
                                      vec3  iAlbedo,
                                      float iRoughness,
-                                     float iMetalness )
+                                     float iMetalness,
+                                     float iShadowBias )
 { 
 
   // Pre calculation optimisation
@@ -111,16 +197,20 @@ vec3 ReflectanceEquationCalculation( vec3  iFragPos,
   // Calculate per-light radiance
   // ----------------------------
   
+  // Get light data from the lights buffer
+  vec4 position_and_range  = texelFetch( uLightsBuffer, uLightIndex * 2 );
+  vec4 radiance_and_shadow = texelFetch( uLightsBuffer, uLightIndex * 2 + 1 );
+
   // Get light direction
-  vec3 light_dir = uLightPos - iFragPos;
+  vec3 light_dir = position_and_range.xyz - iFragPos;
 
   // Get light -> frag distance
   float distance = length( light_dir );
 
-  // Get attenuation value
-  float attenuation = 1.0 / ( distance * distance );
-  attenuation *= ( -distance / uLightMaxDistance ) + 1.0;
-  vec3 light_radiance = ( uLightColor * uLightIntensity ) * ( max( attenuation, 0.0 ) );
+  // Get attenuation value, inverse square windowed to reach zero at the light range
+  float window = clamp( 1.0 - pow( distance / position_and_range.w, 4.0 ), 0.0, 1.0 );
+  float attenuation = ( window * window ) / ( distance * distance );
+  vec3 light_radiance = radiance_and_shadow.rgb * attenuation;
   
 
   // Cook-Torrance BRDF ( specular )
@@ -161,34 +251,22 @@ vec3 ReflectanceEquationCalculation( vec3  iFragPos,
 
   // Final light influence
   // ---------------------
-  return ( ( kD * ( albedo_by_PI ) ) + light_specular ) * light_radiance * normal_dot_light_dir;  // already multiplied the specular by the Fresnel ( kS )
-}
+  float shadow_factor = ShadowCalculation( int( radiance_and_shadow.a ), position_and_range.xyz, iFragPos, iShadowBias );
 
-vec3 IndirectIrradianceCalculation( float iMaxNormalDotViewDir,
-                                    vec3  iF0,
-                                    vec3  iNormal,
-                                    vec3  iAlbedo,
-                                    vec3  iRoughnessMetalnessAO )
-{
-  vec3 kS = FresnelSchlickRoughness( iMaxNormalDotViewDir, iF0, iRoughnessMetalnessAO.r );
-  vec3 kD = 1.0 - kS;
-  kD *= ( 1.0 - iRoughnessMetalnessAO.g );   
-  vec3 irradiance = texture( uIrradianceCubeMap, iNormal ).rgb;
-  vec3 diffuse = irradiance * iAlbedo;
-  vec3 ambient = ( kD * diffuse ) * iRoughnessMetalnessAO.b; 
-
-  return ambient;
+  return shadow_factor * ( ( kD * ( albedo_by_PI ) ) + light_specular ) * light_radiance * normal_dot_light_dir;  // already multiplied the specular by the Fresnel ( kS )
 }
 
 vec3 PBRLightingCalculation( vec3 iFragPos,
                              vec3 iNormal,
-                             vec2 iScreenSpaceUV )
+                             vec3 iRoughnessMetalnessAO,
+                             ivec2 iPixel )
 { 
-  // Get Albedo from G-buffer
-  vec3 albedo = texture( uGbufferAlbedo, iScreenSpaceUV ).rgb;
+  // Get Albedo from G-buffer, linear once fetched from the sRGB target, and the receiver shadow bias
+  vec4 albedo_and_shadow_bias = texelFetch( uGbufferAlbedo, iPixel, 0 );
+  vec3 albedo = albedo_and_shadow_bias.rgb;
 
   // Get roughness and metalness and AO data from G-buffer
-  vec3 roughness_metalness_AO = texture( uGbufferRougnessMetalnessAO, iScreenSpaceUV ).rgb;
+  vec3 roughness_metalness_AO = iRoughnessMetalnessAO;
   
   // Get camera view direction vector
   vec3 view_dir = normalize( uViewPos - iFragPos );
@@ -212,23 +290,13 @@ vec3 PBRLightingCalculation( vec3 iFragPos,
                                                             max_dot_N_V,
                                                             albedo,
                                                             roughness_metalness_AO.r,
-                                                            roughness_metalness_AO.g );
-
-
-  // IBL calculation part
-  // --------------------
-   
-  // Compute indirect irradiance
-  vec3 diffuse_IBL = IndirectIrradianceCalculation( max_dot_N_V,
-                                                    F0,
-                                                    iNormal,
-                                                    albedo,
-                                                    roughness_metalness_AO );
-  
+                                                            roughness_metalness_AO.g,
+                                                            albedo_and_shadow_bias.a * SHADOW_BIAS_RANGE );
+
 
-  // Return fragment final PBR lighting 
-  // ----------------------------------
-  return /*diffuse_IBL +*/ lights_reflectance;
+  // Return fragment light contribution, the IBL ambient was written by the geometry pass
+  // ------------------------------------------------------------------------------------
+  return lights_reflectance * roughness_metalness_AO.b;
 }
 
 
@@ -236,39 +304,32 @@ vec3 PBRLightingCalculation( vec3 iFragPos,
 // -------------
 void main()
 { 
+  // G-buffer texels fetched by pixel, the frame may only cover a corner of the targets with dynamic resolution
+  ivec2 pixel          = ivec2( gl_FragCoord.xy );
   vec2 screen_space_UV = gl_FragCoord.xy / uScreenSize;
 
-  // Get frag normal from G-buffer => discard if it's not a deferred render fragment
-  vec4 normal_and_bloombrightness = texture( uGbufferNormalAndBloomBrightness, screen_space_UV );
-  if( normal_and_bloombrightness.rgb == vec3( 0.0 ) )
+  // Get frag depth from G-buffer => discard if it's not a deferred render fragment
+  float depth = texelFetch( uGbufferDepth, pixel, 0 ).r;
+  if( depth >= 1.0 )
   {
     discard;
   }
 
-  // Get frag position from G-buffer
-  vec4 frag_pos_and_bloom = texture( uGbufferPositionAndBloom, screen_space_UV );
+  // Rebuild frag position from depth and decode its normal
+  vec3 frag_pos = WorldPositionFromDepth( screen_space_UV, depth );
+  vec3 normal   = OctahedralDecode( texelFetch( uGbufferNormal, pixel, 0 ).rg );
+
+  // Get PBR terms
+  vec3 roughness_metalness_AO = texelFetch( uGbufferRougnessMetalnessAO, pixel, 0 ).rgb;
 
   // PBR lighting calculation 
-  vec3 PBR_lighting_result = PBRLightingCalculation( frag_pos_and_bloom.rgb,
-                                                     normal_and_bloombrightness.rgb,
-                                                     screen_space_UV ); 
+  vec3 PBR_lighting_result = PBRLightingCalculation( frag_pos,
+                                                     normal,
+                                                     roughness_metalness_AO,
+                                                     pixel ); 
 
 
   // Main out color
   // --------------
   FragColor = vec4( PBR_lighting_result, 1.0 );
-
-
-  // Second out color => draw only brightest fragments
-  // -------------------------------------------------
-  vec3 bright_color = vec3( 0.0, 0.0, 0.0 );
-  if( frag_pos_and_bloom.a == 1.0 )
-  {
-    float brightness = dot( PBR_lighting_result, vec3( 0.2126, 0.7152, 0.0722 ) );
-    if( brightness > normal_and_bloombrightness.a )
-    {
-      bright_color = PBR_lighting_result;
-    }
-  }
-  FragColorBrightness = vec4( bright_color, 1.0 );
 }
@@ -0,0 +1,37 @@
+#version 330
+
+
+//******************************************************************************
+//**********  Fragment shader inputs/ouputs  ***********************************
+//******************************************************************************
+
+
+// Fragment input uniforms
+// -----------------------
+
+// Opacity uniforms, same alpha test as the shading pass opaque parts
+uniform bool  uOpacityMap;
+uniform float uAlpha;
+
+uniform sampler2D uTextureOpacity1;
+
+
+// Fragment inputs from vertex or tessellation evaluation shader
+// -------------------------------------------------------------
+in vec2 oUV;
+
+
+//******************************************************************************
+//**********  Fragment shader functions  ***************************************
+//******************************************************************************
+
+void main()
+{   
+  float opacity = uOpacityMap ? texture( uTextureOpacity1, oUV ).r : uAlpha;
+
+  // Only fully opaque fragments lay depth, the shading pass tests them with GL_EQUAL
+  if( opacity < 1.0f )
+  {
+    discard;
+  }
+}
@@ -0,0 +1,32 @@
+#version 330
+
+
+//******************************************************************************
+//**********  Vertex shader inputs/ouputs  *************************************
+//******************************************************************************
+
+
+// Vertex input attributes, position only stream
+// ---------------------------------------------
+layout ( location = 0 ) in vec3 _position;
+
+
+// Vertex input uniforms
+// ---------------------
+uniform mat4 uModelMatrix;
+uniform mat4 uProjectionMatrix;
+uniform mat4 uViewMatrix;
+
+
+// Same expression as the shading vertex shader, invariant to match its depth
+invariant gl_Position;
+
+
+//******************************************************************************
+//**********  Vertex shader functions  *****************************************
+//******************************************************************************
+
+void main()
+{
+	gl_Position = uProjectionMatrix * uViewMatrix * uModelMatrix * vec4( _position, 1.0 );
+}
@@ -1,9 +1,24 @@
 #version 410
 
-#define MAX_NB_LIGHTS 25
 #define PI 3.14159265358979323846264338
 #define ZERO 0.00390625
 
+// Shadow lookups filtering : 0 PCF, 1 hardware compare Poisson disk, 2 blurred exponential moments
+#ifndef SHADOW_FILTER_MODE
+#define SHADOW_FILTER_MODE 0
+#endif
+#define EVSM_EXPONENT 40.0
+
+// Per object lights list size, injected from the MAX_OBJECT_LIGHTS of scene.hpp
+#ifndef MAX_OBJECT_LIGHTS
+#error MAX_OBJECT_LIGHTS has to be defined by the application
+#endif
+
+// Scene lights upper bound, injected from the MAX_NB_LIGHTS of scene.hpp
+#ifndef MAX_NB_LIGHTS
+#error MAX_NB_LIGHTS has to be defined by the application
+#endif
+
 struct Material
 {    
   vec3  _albedo;
@@ -21,49 +36,86 @@ struct Material
 // Fragment color output(s)
 // ------------------------
 layout ( location = 0 ) out vec4 FragColor;
-layout ( location = 1 ) out vec4 FragColorBrightness;
 
 
 // Fragment input uniforms
 // -----------------------
 
-// Point lights uniforms
-uniform int   uLightCount;
-uniform vec3  uLightPos[ MAX_NB_LIGHTS ];
-uniform vec3  uLightColor[ MAX_NB_LIGHTS ];
-uniform float uLightIntensity[ MAX_NB_LIGHTS ];
+// Point lights uniforms, lights and clusters lists are packed in one texture buffer
+uniform int           uLightCount;
+uniform float         uLightIntensityScale;
+uniform samplerBuffer uLightsBuffer;
+
+// Clustered lighting uniforms
+uniform bool  uClusteredLighting;
+uniform ivec3 uClusterGrid;
+uniform vec2  uClusterTileSize;
+uniform float uClusterSliceScale;
+uniform float uClusterSliceBias;
+uniform int   uClusterOffset;
+uniform int   uClusterIndexOffset;
+uniform mat4  uViewMatrix;
+
+// Object lights list uniforms, strongest lights reaching the drawn object
+uniform bool uObjectLightsList;
+uniform int  uObjectLightCount;
+uniform int  uObjectLights[ MAX_OBJECT_LIGHTS ];
 
 // View uniforms
 uniform vec3 uViewPos;
 
-// Bloom uniforms
-uniform bool  uBloom;
-uniform float uBloomBrightness;
+// Features switches, replaced by constants in the specialized permutations so their dead branches fold away
+#ifdef PERMUTATION_IBL
+#define uIBL PERMUTATION_IBL
+#else
+uniform bool uIBL;
+#endif
+
+#ifdef PERMUTATION_PARALLAX_CUBEMAP
+#define uParallaxCubemap PERMUTATION_PARALLAX_CUBEMAP
+#else
+uniform bool uParallaxCubemap;
+#endif
+
+#ifdef PERMUTATION_OPACITY_MAP
+#define uOpacityMap PERMUTATION_OPACITY_MAP
+#else
+uniform bool uOpacityMap;
+#endif
+
+#ifdef PERMUTATION_NORMAL_MAP
+#define uNormalMap PERMUTATION_NORMAL_MAP
+#else
+uniform bool uNormalMap;
+#endif
+
+#ifdef PERMUTATION_RECEIV_SHADOW
+#define uReceivShadow PERMUTATION_RECEIV_SHADOW
+#else
+uniform bool uReceivShadow;
+#endif
+
+#ifdef PERMUTATION_EMISSIVE
+#define uEmissive PERMUTATION_EMISSIVE
+#else
+uniform bool uEmissive;
+#endif
 
 // IBL uniforms
-uniform bool  uIBL;
 uniform float uMaxMipLevel;
-uniform bool  uParallaxCubemap;
 uniform vec3  uCubemapPos;
-uniform bool  uIsWall;
 
 // Opacity uniforms
-uniform bool  uOpacityMap;
 uniform float uOpacityDiscard;
 uniform float uAlpha;
 
-// Normal mapping uniforms
-uniform bool uNormalMap;
-
 // Shadow uniforms
-uniform bool  uReceivShadow;
 uniform float uShadowFar;
 uniform int   uLightSourceIt;
 uniform float uShadowBias;
 uniform float uShadowDarkness;
 
 // Emissive uniform(s)
-uniform bool  uEmissive;
 uniform float uEmissiveFactor;
 
 // Scene object ID uniform
@@ -83,7 +135,18 @@ uniform samplerCube uIrradianceCubeMap;
 uniform samplerCube uPreFilterCubeMap;
 uniform sampler2D   uPreBrdfLUT;
 
-uniform samplerCube uDepthCubeMap;
+// Shadow atlas tiers, one cubemap array per slot resolution, moments tiers in the moments mode
+#if SHADOW_FILTER_MODE == 1
+uniform samplerCubeArrayShadow uShadowAtlas0;
+uniform samplerCubeArrayShadow uShadowAtlas1;
+uniform samplerCubeArrayShadow uShadowAtlas2;
+uniform samplerCubeArrayShadow uShadowAtlas3;
+#else
+uniform samplerCubeArray uShadowAtlas0;
+uniform samplerCubeArray uShadowAtlas1;
+uniform samplerCubeArray uShadowAtlas2;
+uniform samplerCubeArray uShadowAtlas3;
+#endif
 
 
 // Fragment inputs from vertex shader 
@@ -99,6 +162,59 @@ in vec3 oTBN[ 3 ];
 //******************************************************************************
 
 
+// Light texels : ( position, range ) and ( radiance, shadow slot code = tier * 16 + layer or -1 )
+vec3 LightPosition( int iLightIt )
+{
+  return texelFetch( uLightsBuffer, iLightIt * 2 ).xyz;
+}
+
+float LightRange( int iLightIt )
+{
+  return texelFetch( uLightsBuffer, iLightIt * 2 ).w;
+}
+
+vec4 LightRadianceAndShadow( int iLightIt )
+{
+  return texelFetch( uLightsBuffer, iLightIt * 2 + 1 );
+}
+
+// Fragment lights list ( first index, light count ) : its cluster, the object list or every light
+ivec2 FragmentLightsList()
+{
+  if( uObjectLightsList )
+  {
+    return ivec2( 0, uObjectLightCount );
+  }
+  if( !uClusteredLighting )
+  {
+    return ivec2( 0, uLightCount );
+  }
+
+  float view_depth = -( uViewMatrix * vec4( oFragPos, 1.0 ) ).z;
+  int slice = int( log( max( view_depth, 0.0001 ) ) * uClusterSliceScale - uClusterSliceBias );
+  ivec2 tile = ivec2( gl_FragCoord.xy / uClusterTileSize );
+
+  ivec3 cluster = clamp( ivec3( tile, slice ), ivec3( 0 ), uClusterGrid - 1 );
+  vec4 record = texelFetch( uLightsBuffer, uClusterOffset + cluster.x + ( cluster.y * uClusterGrid.x ) + ( cluster.z * uClusterGrid.x * uClusterGrid.y ) );
+
+  return ivec2( record.xy );
+}
+
+// Light index in the fragment list, clusters indices are packed 4 per texel
+int FragmentLightIndex( int iListIt )
+{
+  if( uObjectLightsList )
+  {
+    return uObjectLights[ iListIt ];
+  }
+  if( !uClusteredLighting )
+  {
+    return iListIt;
+  }
+  return int( texelFetch( uLightsBuffer, uClusterIndexOffset + ( iListIt >> 2 ) )[ iListIt & 3 ] );
+}
+
+
 // Normal mapping function
 vec3 NormalMappingCalculation( vec2 iUV )                                                                     
 {      
@@ -116,6 +232,127 @@ vec3 NormalMappingCalculation( vec2 iUV )
   return ( res_normal * TBN );
 }
 
+#if SHADOW_FILTER_MODE == 1
+
+// Poisson disk taps, each one is a bilinear 2x2 hardware comparison
+vec2 Poisson_disk[ 8 ] = vec2[]
+(
+  vec2( -0.326212, -0.405805 ), vec2( -0.840144, -0.073580 ), vec2( -0.695914,  0.457137 ), vec2( -0.203345,  0.620716 ),
+  vec2(  0.962340, -0.194983 ), vec2(  0.473434, -0.480026 ), vec2(  0.519456,  0.767022 ), vec2(  0.185461, -0.893124 )
+);
+
+// Shadow atlas slot comparison, fraction of the 2x2 texels lit
+float ShadowAtlasCompare( int   iShadowCode,
+                          vec3  iDirection,
+                          float iDepth )
+{
+  int  tier        = iShadowCode >> 4;
+  vec4 coordinates = vec4( iDirection, float( iShadowCode & 15 ) );
+
+  if( tier == 0 )
+  {
+    return texture( uShadowAtlas0, coordinates, iDepth );
+  }
+  if( tier == 1 )
+  {
+    return texture( uShadowAtlas1, coordinates, iDepth );
+  }
+  if( tier == 2 )
+  {
+    return texture( uShadowAtlas2, coordinates, iDepth );
+  }
+  return texture( uShadowAtlas3, coordinates, iDepth );
+}
+
+// Omnidirectional shadow mapping calculation
+float ShadowMappingCalcualtion( int iLightIt )
+{
+  // Light without shadow slot
+  int shadow_code = int( LightRadianceAndShadow( iLightIt ).w );
+  if( shadow_code < 0 )
+  {
+    return 1.0;
+  }
+
+  vec3  frag_to_light = oFragPos - LightPosition( iLightIt );
+  float frag_depth    = length( frag_to_light );
+
+  // Same world space spread as the PCF preset offsets
+  float frag_view_distance = length( uViewPos - oFragPos );
+  float sample_disk_radius = ( 1.0 + ( ( frag_view_distance / uShadowFar ) * 30.0 ) ) / 500.0 * 1.4;
+
+  // Disk plane facing the light, rotated per pixel by interleaved gradient noise
+  vec3 axis      = frag_to_light / frag_depth;
+  vec3 tangent   = normalize( cross( axis, abs( axis.y ) < 0.99 ? vec3( 0.0, 1.0, 0.0 ) : vec3( 1.0, 0.0, 0.0 ) ) );
+  vec3 bitangent = cross( axis, tangent );
+
+  float angle    = 2.0 * PI * fract( 52.9829189 * fract( dot( gl_FragCoord.xy, vec2( 0.06711056, 0.00583715 ) ) ) );
+  mat2  rotation = mat2( cos( angle ), sin( angle ), -sin( angle ), cos( angle ) );
+
+  float compare_depth = ( frag_depth - uShadowBias ) / uShadowFar;
+  float lit           = 0.0;
+  for( int sample_it = 0; sample_it < 8; sample_it++ )
+  {
+    vec2 offset = rotation * Poisson_disk[ sample_it ] * sample_disk_radius;
+    lit += ShadowAtlasCompare( shadow_code, frag_to_light + tangent * offset.x + bitangent * offset.y, compare_depth );
+  }
+
+  return ( 1.0 - ( ( 1.0 - lit / 8.0 ) * uShadowDarkness ) );
+}
+
+#elif SHADOW_FILTER_MODE == 2
+
+// Moments tiers sampling, blurred and linearly filtered
+vec2 ShadowMomentsSampling( int  iShadowCode,
+                            vec3 iDirection )
+{
+  int  tier        = iShadowCode >> 4;
+  vec4 coordinates = vec4( iDirection, float( iShadowCode & 15 ) );
+
+  if( tier == 0 )
+  {
+    return texture( uShadowAtlas0, coordinates ).rg;
+  }
+  if( tier == 1 )
+  {
+    return texture( uShadowAtlas1, coordinates ).rg;
+  }
+  if( tier == 2 )
+  {
+    return texture( uShadowAtlas2, coordinates ).rg;
+  }
+  return texture( uShadowAtlas3, coordinates ).rg;
+}
+
+// Omnidirectional shadow mapping calculation, exponential variance one tap
+float ShadowMappingCalcualtion( int iLightIt )
+{
+  // Light without shadow slot
+  int shadow_code = int( LightRadianceAndShadow( iLightIt ).w );
+  if( shadow_code < 0 )
+  {
+    return 1.0;
+  }
+
+  vec3  frag_to_light = oFragPos - LightPosition( iLightIt );
+  float frag_depth    = clamp( ( length( frag_to_light ) - uShadowBias ) / uShadowFar, 0.0, 1.0 );
+  vec2  moments       = ShadowMomentsSampling( shadow_code, frag_to_light );
+
+  // Chebyshev upper bound on the warped depth, variance floor of about half a millimeter
+  float warped_depth = exp( EVSM_EXPONENT * frag_depth );
+  float min_variance = EVSM_EXPONENT * warped_depth * ( 0.0005 / uShadowFar );
+  float variance     = max( moments.y - moments.x * moments.x, min_variance * min_variance );
+  float difference   = warped_depth - moments.x;
+  float lit          = ( difference <= 0.0 ) ? 1.0 : variance / ( variance + difference * difference );
+
+  // Light bleeding reduction, low tail cut
+  lit = clamp( ( lit - 0.2 ) / 0.8, 0.0, 1.0 );
+
+  return ( 1.0 - ( ( 1.0 - lit ) * uShadowDarkness ) );
+}
+
+#else
+
 // PCF preset offset directions use to sample the depth cubemap
 vec3 PCF_offset_directions[ 20 ] = vec3[]
 (
@@ -126,11 +363,40 @@ vec3 PCF_offset_directions[ 20 ] = vec3[]
   vec3( 0, 1,  1 ), vec3(  0, -1,  1 ), vec3(  0, -1, -1 ), vec3(  0, 1, -1 )
 );
 
+// Shadow atlas slot sampling
+float ShadowAtlasSampling( int  iShadowCode,
+                           vec3 iDirection )
+{
+  int  tier        = iShadowCode >> 4;
+  vec4 coordinates = vec4( iDirection, float( iShadowCode & 15 ) );
+
+  if( tier == 0 )
+  {
+    return texture( uShadowAtlas0, coordinates ).r;
+  }
+  if( tier == 1 )
+  {
+    return texture( uShadowAtlas1, coordinates ).r;
+  }
+  if( tier == 2 )
+  {
+    return texture( uShadowAtlas2, coordinates ).r;
+  }
+  return texture( uShadowAtlas3, coordinates ).r;
+}
+
 // Omnidirectional shadow mapping calculation
-float ShadowMappingCalcualtion( vec3 iViewToFrag )
+float ShadowMappingCalcualtion( int iLightIt )
 {
+  // Light without shadow slot
+  int shadow_code = int( LightRadianceAndShadow( iLightIt ).w );
+  if( shadow_code < 0 )
+  {
+    return 1.0;
+  }
+
   // Get vector between fragment position and light position
-  vec3 frag_to_light = oFragPos - uLightPos[ uLightSourceIt ];
+  vec3 frag_to_light = oFragPos - LightPosition( iLightIt );
 
   // Get depht of the current fragment
   float frag_depth = length( frag_to_light );
@@ -139,7 +405,7 @@ float ShadowMappingCalcualtion( vec3 iViewToFrag )
   int samples_count = 20;  
 
   // Get distance from ViewPos to FragPos
-  float frag_view_distance = length( iViewToFrag );
+  float frag_view_distance = length( uViewPos - oFragPos );
 
   // Set radius of the disk use to scale PCF offset directions
   float sample_disk_radius = ( 1.0 + ( ( frag_view_distance / uShadowFar ) * 30.0 ) ) / 500.0;
@@ -151,7 +417,7 @@ float ShadowMappingCalcualtion( vec3 iViewToFrag )
   for( int sample_it = 0; sample_it < samples_count; sample_it ++ ) 
   { 
     // Get closest depth with corresponding direction offset from the preset offset array 
-    float closest_depth = texture( uDepthCubeMap, frag_to_light + PCF_offset_directions[ sample_it ] * sample_disk_radius ).r;
+    float closest_depth = ShadowAtlasSampling( shadow_code, frag_to_light + PCF_offset_directions[ sample_it ] * sample_disk_radius );
 
     // Undo mapping [ 0 ; 1 ]
     closest_depth *= uShadowFar;
@@ -165,9 +431,10 @@ float ShadowMappingCalcualtion( vec3 iViewToFrag )
   shadow /= float( samples_count );
 
   return ( 1.0 - ( shadow * uShadowDarkness ) );
-  //return texture( uDepthCubeMap, frag_to_light ).r;
 }
 
+#endif
+
 // Cook torrance D function
 float DistributionGGX( vec3  iNormal,
                        vec3  iHalfway,
@@ -243,26 +510,37 @@ vec3 PointLightReflectance( vec2     iUV,
   vec3 albedo_by_PI = iMaterial._albedo / PI;
 
 
-  // Compute equation to each scene light
-  // ------------------------------------
+  // Compute equation to each light reaching the fragment
+  // -----------------------------------------------------
   vec3 Lo = vec3( 0.0 );
-  for( int i = 0; i < uLightCount; i++ ) 
+  // Constant trip count bound, the list size itself stays a uniform
+  ivec2 lights_list = FragmentLightsList();
+  for( int list_it = 0; list_it < MAX_NB_LIGHTS; list_it++ ) 
   {
+    if( list_it >= lights_list.y )
+    {
+      break;
+    }
+
+    int i = FragmentLightIndex( lights_list.x + list_it );
+    vec4 radiance_and_shadow = LightRadianceAndShadow( i );
+
 
     // Calculate per-light radiance
     // ----------------------------
     
     // Get light direction
-    vec3 light_dir = uLightPos[ i ] - oFragPos;
+    vec3 light_dir = LightPosition( i ) - oFragPos;
 
     // Get light -> frag distance
     float distance = length( light_dir );
 
-    // Get attenuation value
-    float attenuation = 1.0 / ( distance * distance );
+    // Get attenuation value, inverse square windowed to reach zero at the light range
+    float window = clamp( 1.0 - pow( distance / LightRange( i ), 4.0 ), 0.0, 1.0 );
+    float attenuation = ( window * window ) / ( distance * distance );
     
     // Get light radiance value
-    vec3 light_radiance = ( uLightColor[ i ] * uLightIntensity[ i ] ) * attenuation;
+    vec3 light_radiance = radiance_and_shadow.rgb * uLightIntensityScale * attenuation;
 
 
     // Cook-Torrance BRDF ( specular )
@@ -305,12 +583,16 @@ vec3 PointLightReflectance( vec2     iUV,
     // Final point light influence
     // ---------------------------
 
-    // shadow influence
+    // shadow influence, lights without atlas slot reuse the main shadow softened
     float shadow_factor = 1.0;
     if( i == uLightSourceIt )
     {
       shadow_factor = iShadowFactor;
     } 
+    else if( uReceivShadow && radiance_and_shadow.a >= 0.0 )
+    {
+      shadow_factor = ShadowMappingCalcualtion( i );
+    }
     else
     {
       shadow_factor = min( iShadowFactor + 0.25, 1.0 );
@@ -523,9 +805,9 @@ void main()
 
   // Omnidirectional shadow mapping calculation
   float shadow_factor = 1.0;
-  if( uReceivShadow )
+  if( uReceivShadow && uLightSourceIt >= 0 )
   {
-    shadow_factor = ShadowMappingCalcualtion( view_to_frag );
+    shadow_factor = ShadowMappingCalcualtion( uLightSourceIt );
   }
 
   // PBR lighting calculation 
@@ -552,16 +834,4 @@ void main()
 
   // Main out color
   FragColor = vec4( final_color, opacity );
-
-  // Second out color => draw only brightest fragments
-  vec3 bright_color = vec3( 0.0 );
-  if( uBloom )
-  {
-    float brightness = dot( final_color, vec3( 0.2126, 0.7152, 0.0722 ) );
-    if( brightness > uBloomBrightness )
-    {
-      bright_color = final_color;
-    }
-  }
-  FragColorBrightness = vec4( bright_color, opacity );
 }
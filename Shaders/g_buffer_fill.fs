@@ -0,0 +1,34 @@
+#version 330 core
+
+
+//******************************************************************************
+//**********  Fragment shader inputs/ouputs  ***********************************
+//******************************************************************************
+
+
+// Fragment color output(s), one per G-buffer target
+// -------------------------------------------------
+layout( location = 0 ) out vec4 Target0;
+layout( location = 1 ) out vec4 Target1;
+layout( location = 2 ) out vec4 Target2;
+layout( location = 3 ) out vec4 Target3;
+
+
+// Fragment inputs from vertex shader 
+// ----------------------------------
+in vec2 oUV;
+
+
+//******************************************************************************
+//**********  Fragment shader functions  ***************************************
+//******************************************************************************
+
+void main()
+{
+  // Varying values so nothing gets compressed as a flat clear
+  Target0 = vec4( oUV, 1.0 - oUV );
+  Target1 = vec4( oUV.yx, oUV );
+  Target2 = vec4( 1.0 - oUV, oUV.yx );
+  Target3 = vec4( oUV, oUV.x * oUV.y, 1.0 );
+  gl_FragDepth = oUV.x;
+}
@@ -0,0 +1,31 @@
+#version 330
+
+
+//******************************************************************************
+//**********  Fragment shader inputs/ouputs  ***********************************
+//******************************************************************************
+
+
+// Fragment color output(s)
+// ------------------------
+layout ( location = 0 ) out vec2 MotionVector;
+
+
+// Fragment inputs from vertex shader
+// ----------------------------------
+in vec4 oCurrentPosition;
+in vec4 oPreviousPosition;
+
+
+//******************************************************************************
+//**********  Fragment shader functions  ***************************************
+//******************************************************************************
+
+void main()
+{
+  // Screen space motion in UV units, from the previous frame position to the current one
+  vec2 current_UV  = ( oCurrentPosition.xy / oCurrentPosition.w ) * 0.5 + 0.5;
+  vec2 previous_UV = ( oPreviousPosition.xy / oPreviousPosition.w ) * 0.5 + 0.5;
+
+  MotionVector = current_UV - previous_UV;
+}
@@ -0,0 +1,46 @@
+#version 330
+
+
+//******************************************************************************
+//**********  Vertex shader inputs/ouputs  *************************************
+//******************************************************************************
+
+
+// Vertex input attributes, position only stream
+// ---------------------------------------------
+layout ( location = 0 ) in vec3 _position;
+
+
+// Vertex input uniforms
+// ---------------------
+uniform mat4 uModelMatrix;
+uniform mat4 uPreviousModelMatrix;
+uniform mat4 uProjectionMatrix;
+uniform mat4 uViewMatrix;
+
+// Without the sub-pixel jitter, only the real motion is kept
+uniform mat4 uViewProjectionMatrix;
+uniform mat4 uPreviousViewProjectionMatrix;
+
+
+// Vertex shader outputs
+// ---------------------
+out vec4 oCurrentPosition;
+out vec4 oPreviousPosition;
+
+
+// Same expression as the shading vertex shader, invariant to match its depth
+invariant gl_Position;
+
+
+//******************************************************************************
+//**********  Vertex shader functions  *****************************************
+//******************************************************************************
+
+void main()
+{
+  oCurrentPosition  = uViewProjectionMatrix * uModelMatrix * vec4( _position, 1.0 );
+  oPreviousPosition = uPreviousViewProjectionMatrix * uPreviousModelMatrix * vec4( _position, 1.0 );
+
+  gl_Position = uProjectionMatrix * uViewMatrix * uModelMatrix * vec4( _position, 1.0 );
+}
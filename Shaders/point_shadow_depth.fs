@@ -6,8 +6,8 @@
 //******************************************************************************
 
 
-// Fragment inputs from geometry shader 
-// ------------------------------------
+// Fragment inputs from vertex shader 
+// ----------------------------------
 in vec4 oFragPos;
 
 
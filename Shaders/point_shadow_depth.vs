@@ -14,6 +14,12 @@ layout ( location = 0 ) in vec3 _position;
 // Vertex input uniforms
 // ---------------------
 uniform mat4 uModelMatrix;
+uniform mat4 uShadowTransformMatrix;
+
+
+// Vertex shader outputs to fragment shader
+// ----------------------------------------
+out vec4 oFragPos;
 
 
 //******************************************************************************
@@ -22,6 +28,7 @@ uniform mat4 uModelMatrix;
 
 void main()
 {
-	gl_Position = uModelMatrix * vec4( _position, 1.0 );
+	oFragPos    = uModelMatrix * vec4( _position, 1.0 );
+	gl_Position = uShadowTransformMatrix * oFragPos;
 }
 
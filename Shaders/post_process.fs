@@ -13,14 +13,20 @@ layout ( location = 0 ) out vec4 FragColor;
 
 // Fragment input uniforms
 // -----------------------
+#ifdef MULTISAMPLE
+uniform sampler2DMS uBaseColorTexture;
+uniform int uSampleCount;
+#else
 uniform sampler2D uBaseColorTexture;
-uniform sampler2D uBloomBrightnessTexture;
+#endif
+uniform sampler2D uBloomTexture;
 uniform bool uBloom;
+uniform float uBloomStrength;
 uniform float uExposure;
 uniform float uEnd;
 
 
-// Fragment inputs from vertex shader 
+// Fragment inputs from vertex shader
 // ----------------------------------
 in vec2 oUV;
 
@@ -30,22 +36,34 @@ in vec2 oUV;
 //******************************************************************************
 
 void main()
-{             
+{
   const float gamma = 2.2;
 
-  vec3 hdr_base_color = texture( uBaseColorTexture, oUV ).rgb;      
-
+  // Bloom additive blending, first mip holds the sum of every level
+  vec3 bloom_color = vec3( 0.0 );
   if( uBloom )
   {
-    // Bloom additive blending
-    vec3 bloom_color = texture( uBloomBrightnessTexture, oUV ).rgb;
-    hdr_base_color += bloom_color; 
+    bloom_color = texture( uBloomTexture, oUV ).rgb * uBloomStrength;
+  }
+
+#ifdef MULTISAMPLE
+  // Resolve after tone mapping each sample, bright edges keep their anti-aliasing
+  ivec2 texel = ivec2( gl_FragCoord.xy );
+  vec3 color_result = vec3( 0.0 );
+  for( int i = 0; i < uSampleCount; i++ )
+  {
+    vec3 hdr_base_color = texelFetch( uBaseColorTexture, texel, i ).rgb + bloom_color;
+    color_result += vec3( 1.0 ) - exp( -hdr_base_color * uExposure );
   }
+  color_result /= float( uSampleCount );
+#else
+  vec3 hdr_base_color = texture( uBaseColorTexture, oUV ).rgb + bloom_color;
 
   // Tone mapping post process
   vec3 color_result = vec3( 1.0 ) - exp( -hdr_base_color * uExposure );
+#endif
 
-  // Gamma correction post process       
+  // Gamma correction post process
   color_result = pow( color_result, vec3( 1.0 / gamma ) ) * uEnd;
 
   // Main out color
@@ -0,0 +1,55 @@
+#version 410 core
+
+// Exponential warp, exp( 2 * c ) must stay under the 32 bits float range
+#define EVSM_EXPONENT 40.0
+
+
+//******************************************************************************
+//**********  Fragment shader inputs/ouputs  ***********************************
+//******************************************************************************
+
+
+// Fragment color output(s)
+// ------------------------
+layout ( location = 0 ) out vec2 Moments;
+
+
+// Fragment input uniforms
+// -----------------------
+uniform samplerCubeArray uShadowAtlas;
+uniform int              uFace;
+uniform float            uLayer;
+uniform float            uMomentsRes;
+
+
+//******************************************************************************
+//**********  Fragment shader functions  ***************************************
+//******************************************************************************
+
+// Cube face texel coordinates [ -1, 1 ] to sampling direction
+vec3 FaceDirection( vec2 iUV )
+{
+  if( uFace == 0 ) return vec3(  1.0,    -iUV.y, -iUV.x );
+  if( uFace == 1 ) return vec3( -1.0,    -iUV.y,  iUV.x );
+  if( uFace == 2 ) return vec3(  iUV.x,  1.0,     iUV.y );
+  if( uFace == 3 ) return vec3(  iUV.x, -1.0,    -iUV.y );
+  if( uFace == 4 ) return vec3(  iUV.x, -iUV.y,   1.0   );
+  return                  vec3( -iUV.x, -iUV.y,  -1.0   );
+}
+
+void main()
+{
+  // Moments texel covers 2x2 depth texels, warped moments are averaged as they filter linearly
+  vec2 moments = vec2( 0.0 );
+  for( int sample_it = 0; sample_it < 4; sample_it++ )
+  {
+    vec2 offset = vec2( float( sample_it & 1 ), float( sample_it >> 1 ) ) * 0.5 + 0.25;
+    vec2 uv     = ( ( floor( gl_FragCoord.xy ) + offset ) / uMomentsRes ) * 2.0 - 1.0;
+
+    float depth  = texture( uShadowAtlas, vec4( FaceDirection( uv ), uLayer ) ).r;
+    float warped = exp( EVSM_EXPONENT * depth );
+    moments += vec2( warped, warped * warped );
+  }
+
+  Moments = moments * 0.25;
+}
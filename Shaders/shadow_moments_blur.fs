@@ -0,0 +1,40 @@
+#version 410 core
+
+
+//******************************************************************************
+//**********  Fragment shader inputs/ouputs  ***********************************
+//******************************************************************************
+
+
+// Fragment color output(s)
+// ------------------------
+layout ( location = 0 ) out vec2 Moments;
+
+
+// Fragment input uniforms
+// -----------------------
+uniform sampler2D uMoments;
+uniform ivec2     uDirection;
+uniform int       uMomentsRes;
+
+
+//******************************************************************************
+//**********  Fragment shader functions  ***************************************
+//******************************************************************************
+
+// Binomial 7 taps weights, texels fetched in the face region only
+float weight[ 4 ] = float[] ( 20.0 / 64.0, 15.0 / 64.0, 6.0 / 64.0, 1.0 / 64.0 );
+
+void main()
+{
+  ivec2 coordinates = ivec2( gl_FragCoord.xy );
+  vec2  moments     = texelFetch( uMoments, coordinates, 0 ).rg * weight[ 0 ];
+
+  for( int tap_it = 1; tap_it < 4; tap_it++ )
+  {
+    moments += texelFetch( uMoments, clamp( coordinates + uDirection * tap_it, ivec2( 0 ), ivec2( uMomentsRes - 1 ) ), 0 ).rg * weight[ tap_it ];
+    moments += texelFetch( uMoments, clamp( coordinates - uDirection * tap_it, ivec2( 0 ), ivec2( uMomentsRes - 1 ) ), 0 ).rg * weight[ tap_it ];
+  }
+
+  Moments = moments;
+}
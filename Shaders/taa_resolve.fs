@@ -0,0 +1,198 @@
+#version 410
+
+
+//******************************************************************************
+//**********  Fragment shader inputs/ouputs  ***********************************
+//******************************************************************************
+
+
+// Fragment color output(s)
+// ------------------------
+layout ( location = 0 ) out vec4 FragColor;
+
+
+// Fragment input uniforms
+// -----------------------
+uniform sampler2D uCurrentTexture;
+uniform sampler2D uHistoryTexture;
+uniform sampler2D uDepthTexture;
+uniform sampler2D uMotionVectorsTexture;
+
+// Jittered current matrix inverse to rebuild positions, previous one without jitter
+uniform mat4 uInverseViewProjectionMatrix;
+uniform mat4 uPreviousViewProjectionMatrix;
+
+// Current sub-pixel offset in UV units
+uniform vec2  uJitter;
+
+// Rendered sub-rectangle of the window sized targets
+uniform ivec2 uRenderSize;
+
+uniform bool  uHistoryValid;
+uniform float uBlendFactor;
+
+
+// Fragment inputs from vertex shader
+// ----------------------------------
+in vec2 oUV;
+
+
+//******************************************************************************
+//**********  Fragment shader functions  ***************************************
+//******************************************************************************
+
+
+// Neighbourhood box computed in YCoCg, tighter around the luma axis than in RGB
+// -----------------------------------------------------------------------------
+vec3 RGBToYCoCg( vec3 iColor )
+{
+  return vec3(  0.25 * iColor.r + 0.5 * iColor.g + 0.25 * iColor.b,
+                0.5  * iColor.r                  - 0.5  * iColor.b,
+               -0.25 * iColor.r + 0.5 * iColor.g - 0.25 * iColor.b );
+}
+
+vec3 YCoCgToRGB( vec3 iColor )
+{
+  return vec3( iColor.x + iColor.y - iColor.z,
+               iColor.x            + iColor.z,
+               iColor.x - iColor.y - iColor.z );
+}
+
+
+// History clipped toward the box center, keeps its hue unlike a per channel clamp
+// --------------------------------------------------------------------------------
+vec3 ClipToBox( vec3 iBoxMin,
+                vec3 iBoxMax,
+                vec3 iHistory )
+{
+  vec3 center  = 0.5 * ( iBoxMax + iBoxMin );
+  vec3 extents = 0.5 * ( iBoxMax - iBoxMin ) + 0.0001;
+  vec3 offset  = iHistory - center;
+  vec3 units   = abs( offset / extents );
+  float unit   = max( units.x, max( units.y, units.z ) );
+
+  return ( unit > 1.0 ) ? center + offset / unit : iHistory;
+}
+
+
+// Catmull-Rom history filtering from 5 bilinear taps, stays sharp over many frames
+// ---------------------------------------------------------------------------------
+vec3 HistorySample( vec2 iUV )
+{
+  vec2 texture_size = vec2( textureSize( uHistoryTexture, 0 ) );
+  vec2 render_size  = vec2( uRenderSize );
+
+  vec2 position = iUV * render_size;
+  vec2 center   = floor( position - 0.5 ) + 0.5;
+  vec2 f        = position - center;
+
+  vec2 w0  = f * ( -0.5 + f * ( 1.0 - 0.5 * f ) );
+  vec2 w1  = 1.0 + f * f * ( -2.5 + 1.5 * f );
+  vec2 w2  = f * ( 0.5 + f * ( 2.0 - 1.5 * f ) );
+  vec2 w3  = f * f * ( -0.5 + 0.5 * f );
+  vec2 w12 = w1 + w2;
+
+  // Taps kept inside the rendered sub-rectangle, then to the window sized texture UVs
+  vec2 tap0  = clamp( center - 1.0,      vec2( 0.5 ), render_size - 0.5 ) / texture_size;
+  vec2 tap12 = clamp( center + w2 / w12, vec2( 0.5 ), render_size - 0.5 ) / texture_size;
+  vec2 tap3  = clamp( center + 2.0,      vec2( 0.5 ), render_size - 0.5 ) / texture_size;
+
+  vec3 color_result = vec3( 0.0 );
+  color_result += textureLod( uHistoryTexture, vec2( tap12.x, tap0.y  ), 0.0 ).rgb * w12.x * w0.y;
+  color_result += textureLod( uHistoryTexture, vec2( tap0.x,  tap12.y ), 0.0 ).rgb * w0.x  * w12.y;
+  color_result += textureLod( uHistoryTexture, vec2( tap12.x, tap12.y ), 0.0 ).rgb * w12.x * w12.y;
+  color_result += textureLod( uHistoryTexture, vec2( tap3.x,  tap12.y ), 0.0 ).rgb * w3.x  * w12.y;
+  color_result += textureLod( uHistoryTexture, vec2( tap12.x, tap3.y  ), 0.0 ).rgb * w12.x * w3.y;
+
+  float weight_sum = w12.x * w0.y + w0.x * w12.y + w12.x * w12.y + w3.x * w12.y + w12.x * w3.y;
+
+  return max( color_result / weight_sum, vec3( 0.0 ) );
+}
+
+
+// Main function
+// -------------
+void main()
+{
+  ivec2 pixel     = ivec2( gl_FragCoord.xy );
+  vec2  pixel_UV  = ( vec2( pixel ) + 0.5 ) / vec2( uRenderSize );
+  vec3  current   = texelFetch( uCurrentTexture, pixel, 0 ).rgb;
+
+  if( !uHistoryValid )
+  {
+    FragColor = vec4( current, 1.0 );
+    return;
+  }
+
+
+  // 3x3 neighbourhood, color statistics and closest depth for the motion
+  // ---------------------------------------------------------------------
+  vec3  moment1       = vec3( 0.0 );
+  vec3  moment2       = vec3( 0.0 );
+  vec3  box_min       = vec3( 1.0e10 );
+  vec3  box_max       = vec3( -1.0e10 );
+  float closest_depth = 1.0;
+  ivec2 closest_pixel = pixel;
+
+  for( int y = -1; y <= 1; y++ )
+  {
+    for( int x = -1; x <= 1; x++ )
+    {
+      ivec2 neighbour = clamp( pixel + ivec2( x, y ), ivec2( 0 ), uRenderSize - 1 );
+      vec3  color     = RGBToYCoCg( texelFetch( uCurrentTexture, neighbour, 0 ).rgb );
+
+      moment1 += color;
+      moment2 += color * color;
+      box_min  = min( box_min, color );
+      box_max  = max( box_max, color );
+
+      // Edges take the foreground motion, silhouettes don't trail behind moving objects
+      float depth = texelFetch( uDepthTexture, neighbour, 0 ).r;
+      if( depth < closest_depth )
+      {
+        closest_depth = depth;
+        closest_pixel = neighbour;
+      }
+    }
+  }
+
+
+  // Reprojection, doors motion when written, else camera only motion rebuilt from depth
+  // ------------------------------------------------------------------------------------
+  vec2 motion = texelFetch( uMotionVectorsTexture, closest_pixel, 0 ).rg;
+  if( motion == vec2( 0.0 ) )
+  {
+    vec2 closest_UV       = ( vec2( closest_pixel ) + 0.5 ) / vec2( uRenderSize );
+    vec4 world_position   = uInverseViewProjectionMatrix * vec4( vec3( closest_UV, closest_depth ) * 2.0 - 1.0, 1.0 );
+    vec4 previous_position = uPreviousViewProjectionMatrix * vec4( world_position.xyz / world_position.w, 1.0 );
+
+    motion = ( closest_UV - uJitter ) - ( ( previous_position.xy / previous_position.w ) * 0.5 + 0.5 );
+  }
+
+  vec2 history_UV = pixel_UV - uJitter - motion;
+  if( any( lessThan( history_UV, vec2( 0.0 ) ) ) || any( greaterThan( history_UV, vec2( 1.0 ) ) ) )
+  {
+    FragColor = vec4( current, 1.0 );
+    return;
+  }
+
+
+  // History rectification, min max box tightened by the neighbourhood variance
+  // ---------------------------------------------------------------------------
+  vec3 mean     = moment1 / 9.0;
+  vec3 variance = sqrt( max( moment2 / 9.0 - mean * mean, vec3( 0.0 ) ) );
+  box_min = max( box_min, mean - variance );
+  box_max = min( box_max, mean + variance );
+
+  vec3 history = YCoCgToRGB( ClipToBox( box_min, box_max, RGBToYCoCg( HistorySample( history_UV ) ) ) );
+
+
+  // Exponential accumulation, luma weighted so a single HDR highlight doesn't flicker
+  // ----------------------------------------------------------------------------------
+  float current_weight = uBlendFactor / ( 1.0 + dot( current, vec3( 0.2126, 0.7152, 0.0722 ) ) );
+  float history_weight = ( 1.0 - uBlendFactor ) / ( 1.0 + dot( history, vec3( 0.2126, 0.7152, 0.0722 ) ) );
+
+  vec3 color_result = ( current * current_weight + history * history_weight ) / ( current_weight + history_weight );
+
+  FragColor = vec4( color_result, 1.0 );
+}
@@ -1,5 +1,10 @@
 #version 410 core
 
+// Tessellation levels modes, same values as the scene ones
+#define TESSELLATION_DISTANCE_BANDS        0
+#define TESSELLATION_SCREEN_SPACE          1
+#define TESSELLATION_SCREEN_SPACE_CULLED   2
+
 
 // Output patch structure
 struct OutputPatch                                                                              
@@ -36,6 +41,16 @@ layout ( vertices = 1 ) out;
 uniform vec3  uViewPos;  
 uniform float uTessellationFactor;    
 
+// Shared with the evaluation shader
+uniform mat4  uProjectionMatrix;
+uniform mat4  uViewMatrix;
+uniform float uDisplacementFactor;
+
+// Screen space levels, targeted edge length in pixels at a tessellation factor of 1
+uniform int   uTessellationMode;
+uniform vec2  uViewportSize;
+uniform float uTessellationEdgePixels;
+
 
 // Attributes of the input Control Points from the vertex shader                                                                  
 // -------------------------------------------------------------
@@ -92,6 +107,79 @@ float GetTessellationLevel( float iDistance0,
 }  
 
 
+// Screen space level, edge bounding sphere projected size, both patches sharing the edge get the same level
+// ---------------------------------------------------------------------------------------------------------
+float GetScreenSpaceTessellationLevel( vec3 iPosition0,
+                                       vec3 iPosition1 )
+{
+  vec3  center   = ( iPosition0 + iPosition1 ) * 0.5;
+  float diameter = distance( iPosition0, iPosition1 );
+
+  float pixels = ( diameter * uProjectionMatrix[ 1 ][ 1 ] * uViewportSize.y * 0.5 ) / max( distance( uViewPos, center ), 0.0001 );
+
+  return clamp( ( pixels * uTessellationFactor ) / uTessellationEdgePixels, 1.0, float( gl_MaxTessGenLevel ) );
+}
+
+
+// Patch outside the frustum or seen from behind, displaced surface bound included
+// --------------------------------------------------------------------------------
+bool PatchCulled()
+{
+  // Bezier control points hull contains the surface, displacement moves it along the normals by at most the factor
+  vec3 control_points[ 10 ] = vec3[ 10 ]( oPatch._frag_pos_B030, oPatch._frag_pos_B021, oPatch._frag_pos_B012, oPatch._frag_pos_B003, oPatch._frag_pos_B102,
+                                          oPatch._frag_pos_B201, oPatch._frag_pos_B300, oPatch._frag_pos_B210, oPatch._frag_pos_B120, oPatch._frag_pos_B111 );
+
+  vec3 center = vec3( 0.0 );
+  for( int it = 0; it < 10; it++ )
+  {
+    center += control_points[ it ];
+  }
+  center /= 10.0;
+
+  float radius = 0.0;
+  for( int it = 0; it < 10; it++ )
+  {
+    radius = max( radius, distance( center, control_points[ it ] ) );
+  }
+  radius += abs( uDisplacementFactor );
+
+  // Frustum planes from the view projection rows
+  mat4 view_projection = uProjectionMatrix * uViewMatrix;
+  vec4 row3 = vec4( view_projection[ 0 ][ 3 ], view_projection[ 1 ][ 3 ], view_projection[ 2 ][ 3 ], view_projection[ 3 ][ 3 ] );
+  for( int axis = 0; axis < 3; axis++ )
+  {
+    vec4 row = vec4( view_projection[ 0 ][ axis ], view_projection[ 1 ][ axis ], view_projection[ 2 ][ axis ], view_projection[ 3 ][ axis ] );
+    for( float side = -1.0; side <= 1.0; side += 2.0 )
+    {
+      vec4 plane = row3 + row * side;
+      plane /= length( plane.xyz );
+      if( dot( plane.xyz, center ) + plane.w < -radius )
+      {
+        return true;
+      }
+    }
+  }
+
+  // Displacement goes toward the visible side, a viewer under every corner base plane only sees the displaced surface from behind
+  if( uDisplacementFactor == 0.0 )
+  {
+    return false;
+  }
+
+  vec3 corners[ 3 ] = vec3[ 3 ]( oPatch._frag_pos_B030, oPatch._frag_pos_B003, oPatch._frag_pos_B300 );
+  for( int it = 0; it < 3; it++ )
+  {
+    vec3 outward = oPatch._normal[ it ] * sign( uDisplacementFactor );
+    if( dot( outward, uViewPos - corners[ it ] ) >= 0.0 )
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
 // Function used to generate control midpoint define by th nearest vertex and its normal
 // -------------------------------------------------------------------------------------
 vec3 ProjectToPlane( vec3 iPoint, 
@@ -203,6 +291,26 @@ void main()
 	// Set all control points position 
 	GenControlPointsPosition();
 
+	// Culled patches are discarded before the primitive generator
+	if( uTessellationMode == TESSELLATION_SCREEN_SPACE_CULLED && PatchCulled() )
+	{
+		gl_TessLevelOuter[ 0 ] = 0.0;
+		gl_TessLevelOuter[ 1 ] = 0.0;
+		gl_TessLevelOuter[ 2 ] = 0.0;
+		gl_TessLevelInner[ 0 ] = 0.0;
+		return;
+	}
+
+	// Screen space levels, inner as dense as the densest edge
+	if( uTessellationMode != TESSELLATION_DISTANCE_BANDS )
+	{
+		gl_TessLevelOuter[ 0 ] = GetScreenSpaceTessellationLevel( oPatch._frag_pos_B003, oPatch._frag_pos_B300 );
+		gl_TessLevelOuter[ 1 ] = GetScreenSpaceTessellationLevel( oPatch._frag_pos_B300, oPatch._frag_pos_B030 );
+		gl_TessLevelOuter[ 2 ] = GetScreenSpaceTessellationLevel( oPatch._frag_pos_B030, oPatch._frag_pos_B003 );
+		gl_TessLevelInner[ 0 ] = max( gl_TessLevelOuter[ 0 ], max( gl_TessLevelOuter[ 1 ], gl_TessLevelOuter[ 2 ] ) );
+		return;
+	}
+
 	// Calculate the distance from the view position to the three control points                       
 	float ViewToVertexDistance0 = distance( uViewPos,
 																					oPatch._frag_pos_B030 );                     
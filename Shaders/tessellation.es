@@ -51,6 +51,9 @@ out vec3 oNormal;
 out vec2 oUV;
 out vec3 oTBN[ 3 ];
 
+// Same depth in the depth pre-pass and the GL_EQUAL shading pass
+invariant gl_Position;
+
 
 //******************************************************************************
 //**********  Evaluation shader functions  *************************************
@@ -0,0 +1,126 @@
+#version 410
+
+// Lanczos like lobes shape, clipped after the first negative lobe
+#define LOBE_WINDOW 4.0
+
+
+//******************************************************************************
+//**********  Fragment shader inputs/ouputs  ***********************************
+//******************************************************************************
+
+
+// Fragment color output(s)
+// ------------------------
+layout ( location = 0 ) out vec4 FragColor;
+
+
+// Fragment input uniforms
+// -----------------------
+uniform sampler2D uTexture;
+uniform ivec2     uRenderSize;
+
+
+// Fragment inputs from vertex shader
+// ----------------------------------
+in vec2 oUV;
+
+
+//******************************************************************************
+//**********  Fragment shader functions  ***************************************
+//******************************************************************************
+
+
+// Texel fetch clamped to the rendered sub-rectangle of the source target
+// -----------------------------------------------------------------------
+vec3 FetchRendered( ivec2 iTexel )
+{
+  return texelFetch( uTexture, clamp( iTexel, ivec2( 0 ), uRenderSize - 1 ), 0 ).rgb;
+}
+
+float Luma( vec3 iColor )
+{
+  return dot( iColor, vec3( 0.2126, 0.7152, 0.0722 ) );
+}
+
+
+// Polynomial approximation of a windowed sinc, iDistance2 is the squared tap distance
+// ------------------------------------------------------------------------------------
+float LobeWeight( float iDistance2 )
+{
+  float distance2 = min( iDistance2, LOBE_WINDOW );
+  float base      = 0.4 * distance2 - 1.0;
+  float window    = 0.25 * distance2 - 1.0;
+
+  return ( ( 25.0 / 16.0 ) * base * base - ( 25.0 / 16.0 - 1.0 ) ) * ( window * window );
+}
+
+
+// Main function
+// -------------
+void main()
+{
+  // Output pixel center in source texel space, the 4x4 footprint starts one texel before
+  vec2  source   = oUV * vec2( uRenderSize ) - 0.5;
+  ivec2 origin   = ivec2( floor( source ) ) - 1;
+  vec2  fraction = source - floor( source );
+
+  vec3 texels[ 16 ];
+  for( int y = 0; y < 4; y++ )
+  {
+    for( int x = 0; x < 4; x++ )
+    {
+      texels[ y * 4 + x ] = FetchRendered( origin + ivec2( x, y ) );
+    }
+  }
+
+  // Edge direction from the central 2x2 luma gradients, bilinearly mixed at the output position
+  //  0  1  2  3
+  //  4  5  6  7
+  //  8  9 10 11
+  // 12 13 14 15
+  float l5  = Luma( texels[ 5 ] );
+  float l6  = Luma( texels[ 6 ] );
+  float l9  = Luma( texels[ 9 ] );
+  float l10 = Luma( texels[ 10 ] );
+
+  vec2 gradient = vec2( mix( l6 - l5, l10 - l9, fraction.y ),
+                        mix( l9 - l5, l10 - l6, fraction.x ) );
+
+  float gradient_length = length( gradient );
+  float luma_max        = max( max( l5, l6 ), max( l9, l10 ) );
+  float edge            = clamp( gradient_length / ( luma_max + 0.05 ), 0.0, 1.0 );
+
+  // Across axis follows the gradient, kernel gets sharper across edges and wider along them
+  vec2 across = gradient_length > 0.0001 ? gradient / gradient_length : vec2( 1.0, 0.0 );
+  vec2 along  = vec2( -across.y, across.x );
+  vec2 scale  = vec2( 1.0 + 0.5 * edge, 1.0 / ( 1.0 + edge ) );
+
+  vec3  color_result = vec3( 0.0 );
+  float weight_sum   = 0.0;
+  for( int y = 0; y < 4; y++ )
+  {
+    for( int x = 0; x < 4; x++ )
+    {
+      // 12 taps, the footprint corners are outside the lobes
+      if( ( x == 0 || x == 3 ) && ( y == 0 || y == 3 ) )
+      {
+        continue;
+      }
+
+      vec2 offset  = vec2( x - 1, y - 1 ) - fraction;
+      vec2 rotated = vec2( dot( offset, across ), dot( offset, along ) ) * scale;
+      float weight = LobeWeight( dot( rotated, rotated ) );
+
+      color_result += texels[ y * 4 + x ] * weight;
+      weight_sum   += weight;
+    }
+  }
+
+  color_result /= max( weight_sum, 0.0001 );
+
+  // Negative lobes ringing removal, stays inside the central texels range
+  vec3 color_min = min( min( texels[ 5 ], texels[ 6 ] ), min( texels[ 9 ], texels[ 10 ] ) );
+  vec3 color_max = max( max( texels[ 5 ], texels[ 6 ] ), max( texels[ 9 ], texels[ 10 ] ) );
+
+  FragColor = vec4( max( clamp( color_result, color_min, color_max ), vec3( 0.0 ) ), 1.0 );
+}
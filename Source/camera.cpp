@@ -32,7 +32,8 @@ Camera::Camera( glm::vec3 iPosition,
   _yaw        = iYaw;
   _pitch      = iPitch;
 
-  _projection_matrix = glm::perspective( iFov, iWidth / iHeight, iNear, iFar );
+  _projection_matrix            = glm::perspective( iFov, iWidth / iHeight, iNear, iFar );
+  _unjittered_projection_matrix = _projection_matrix;
 
   _move_speed = iMoveSpeed;
 
@@ -638,7 +639,14 @@ void Camera::FrontUpdate()
 
 void Camera::SetProjectionMatrix( glm::mat4 * iProjectionMatrix )
 {
-  _projection_matrix = *iProjectionMatrix;
+  _projection_matrix            = *iProjectionMatrix;
+  _unjittered_projection_matrix = *iProjectionMatrix;
+}
+
+void Camera::SetProjectionJitter( glm::vec2 iJitter )
+{
+  // Offset in NDC applied after the projection, every pass rasterizes with the same sub-pixel shift
+  _projection_matrix = glm::translate( glm::mat4(), glm::vec3( iJitter.x, iJitter.y, 0.0f ) ) * _unjittered_projection_matrix;
 }
 
 void Camera::UpdateViewMatrix()
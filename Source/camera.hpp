@@ -58,6 +58,8 @@ class Camera
 
     void SetProjectionMatrix( glm::mat4 * iProjectionMatrix );
 
+    void SetProjectionJitter( glm::vec2 iJitter );
+
     void UpdateViewMatrix();
 
     void DemoScript( float iDeltaTime );
@@ -86,6 +88,9 @@ class Camera
     glm::mat4 _projection_matrix;
     glm::mat4 _view_matrix;
 
+    // Projection without the temporal anti-aliasing sub-pixel offset
+    glm::mat4 _unjittered_projection_matrix;
+
     float _move_speed; 
 
     int _Z_state;
@@ -20,9 +20,10 @@ Mesh::Mesh( vector< Vertex > 			 iVertices,
   this->_name            = iMeshName;  
   this->_opacity_map     = iOpacityMap;
   this->SetupMesh();
+  this->ComputeBoundingSphere();
 }
 
-void Mesh::Draw( Shader    iShader,
+void Mesh::Draw( Shader &  iShader,
                  int       iModelID,
                  int       iMeshNumber,
                  glm::mat4 iModelMatrix,
@@ -35,11 +36,12 @@ void Mesh::Draw( Shader    iShader,
   glUniform1f( glGetUniformLocation( iShader._program, "uOpacityDiscard" ), iOpacityDiscard );
 
 
-  // Mesh corresponding texture binding
-  // ----------------------------------
+  // Mesh corresponding texture binding, material units 0 to 6 in one multi-bind, missing maps unbound
+  // ---------------------------------------------------------------------------------------------------
+  unsigned int material_textures[ 7 ] = { 0, 0, 0, 0, 0, 0, 0 };
   for( unsigned int i = 0; i < this->_textures.size(); i++ )
   {
-    int n; 
+    int n = -1; 
     string name = this->_textures[ i ]._type;
 
     // generate texture string uniform
@@ -78,14 +80,22 @@ void Mesh::Draw( Shader    iShader,
       n = 11;
     }
     
-    glActiveTexture( GL_TEXTURE0 + n );
-    glBindTexture( GL_TEXTURE_2D, this->_textures[ i ]._id );
+    if( n >= 0 && n < 7 )
+    {
+      material_textures[ n ] = this->_textures[ i ]._id;
+    }
+    else if( n >= 0 )
+    {
+      StateCache::ActiveTexture( GL_TEXTURE0 + n );
+      StateCache::BindTexture( GL_TEXTURE_2D, this->_textures[ i ]._id );
+    }
   }
+  StateCache::BindTextures( 0, 7, material_textures, GL_TEXTURE_2D );
 
 
   // Mesh Drawing
   // ------------
-	glBindVertexArray( this->_VAO );
+	StateCache::BindVertexArray( this->_VAO );
 	
 	// Perform mesh local transform
 	glm::mat4 model_matrix;
@@ -101,81 +111,122 @@ void Mesh::Draw( Shader    iShader,
 	// Draw only transparent mesh part
 	if( iOpacityDiscard == 2.0 )
   {
-		glEnable( GL_BLEND );
-		glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+		StateCache::Enable( GL_BLEND );
+		StateCache::BlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
 
     ( iHeightMap == true ) ? glDrawElements( GL_PATCHES, this->_indices.size(), GL_UNSIGNED_INT, 0 ) : glDrawElements( GL_TRIANGLES, this->_indices.size(), GL_UNSIGNED_INT, 0 );
 
-		glDisable( GL_BLEND );
+		StateCache::Disable( GL_BLEND );
   }
   else
   {
     ( iHeightMap == true ) ? glDrawElements( GL_PATCHES, this->_indices.size(), GL_UNSIGNED_INT, 0 ) : glDrawElements( GL_TRIANGLES, this->_indices.size(), GL_UNSIGNED_INT, 0 );
   }
 	
-	glBindVertexArray( 0 );
-
-  // Unbind all used textures
-  for( unsigned int i = 0; i < this->_textures.size(); i++ )
-  {
-    glActiveTexture( GL_TEXTURE0 + i );
-    glBindTexture( GL_TEXTURE_2D, 0 );
-  }
+	StateCache::BindVertexArray( 0 );
 }
 
-void Mesh::DrawDepth( Shader    iShader,
+void Mesh::DrawDepth( Shader &  iShader,
+                      int       iModelID,
                       glm::mat4 iModelMatrix )
 {
 
-  // Mesh Drawing
-  // ------------
-  glBindVertexArray( this->_VAO );
+  // Mesh Drawing, positions only
+  // ----------------------------
+  StateCache::BindVertexArray( this->_depth_VAO );
   
   // Perform mesh local transform
   glm::mat4 model_matrix;
   model_matrix = iModelMatrix * _local_transform;
+
+  if( iModelID == 4 )
+  {
+    model_matrix = iModelMatrix;
+  }
   glUniformMatrix4fv( glGetUniformLocation( iShader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
 
   // Draw
   glDrawElements( GL_TRIANGLES, this->_indices.size(), GL_UNSIGNED_INT, 0 );
   
-  glBindVertexArray( 0 );
+  StateCache::BindVertexArray( 0 );
 }
 
-void Mesh::SetupMesh()
+void Mesh::DrawMotionVectors( Shader &  iShader,
+                              int       iModelID,
+                              glm::mat4 iModelMatrix,
+                              glm::mat4 iPreviousModelMatrix )
 {
-  glGenVertexArrays( 1, &this->_VAO );
-  glGenBuffers( 1, &this->_VBO );
-  glGenBuffers( 1, &this->_EBO );
 
-  glBindVertexArray( this->_VAO );
- 
-  glBindBuffer( GL_ARRAY_BUFFER, this->_VBO );
-  glBufferData( GL_ARRAY_BUFFER, this->_vertices.size() * sizeof(Vertex), &this->_vertices[ 0 ], GL_STATIC_DRAW );  
+  // Mesh Drawing, positions only, current and previous frame transforms
+  // --------------------------------------------------------------------
+  StateCache::BindVertexArray( this->_depth_VAO );
+  
+  // Perform mesh local transform
+  glm::mat4 model_matrix          = iModelMatrix * _local_transform;
+  glm::mat4 previous_model_matrix = iPreviousModelMatrix * _local_transform;
 
-  glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, this->_EBO );
-  glBufferData( GL_ELEMENT_ARRAY_BUFFER, this->_indices.size() * sizeof( unsigned int ), &this->_indices[ 0 ], GL_STATIC_DRAW );
+  if( iModelID == 4 )
+  {
+    model_matrix          = iModelMatrix;
+    previous_model_matrix = iPreviousModelMatrix;
+  }
+  glUniformMatrix4fv( glGetUniformLocation( iShader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
+  glUniformMatrix4fv( glGetUniformLocation( iShader._program, "uPreviousModelMatrix" ), 1, GL_FALSE, glm::value_ptr( previous_model_matrix ) );
 
-  // Vertex Positions
-  glEnableVertexAttribArray( 0 );   
-  glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof( Vertex ), ( GLvoid* )0 );
-  
-  // Vertex Normals
-  glEnableVertexAttribArray( 1 );   
-  glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, sizeof( Vertex ), ( GLvoid* )offsetof( Vertex, _normal ) );
-  
-  // Vertex UVs
-  glEnableVertexAttribArray( 2 );   
-  glVertexAttribPointer( 2, 2, GL_FLOAT, GL_FALSE, sizeof( Vertex ), ( GLvoid* )offsetof( Vertex, _uv ) );
+  // Draw
+  glDrawElements( GL_TRIANGLES, this->_indices.size(), GL_UNSIGNED_INT, 0 );
   
-  // Vertex Tangent
-  glEnableVertexAttribArray( 3 );   
-  glVertexAttribPointer( 3, 3, GL_FLOAT, GL_FALSE, sizeof( Vertex ), ( GLvoid* )offsetof( Vertex, _tangent ) );
-
-  // Vertex Bi Tangent
-  glEnableVertexAttribArray( 4 );   
-  glVertexAttribPointer( 4, 3, GL_FLOAT, GL_FALSE, sizeof( Vertex ), ( GLvoid* )offsetof( Vertex, _bi_tangent ) );
-  glBindVertexArray( 0 );
+  StateCache::BindVertexArray( 0 );
+}
+
+void Mesh::ComputeBoundingSphere()
+{
+  _bounding_sphere_center = glm::vec3( 0.0 );
+  _bounding_sphere_radius = 0.0;
+
+  if( _vertices.empty() )
+  {
+    return;
+  }
+
+  // Sphere centered on the vertices AABB
+  glm::vec3 min_corner = _vertices[ 0 ]._position;
+  glm::vec3 max_corner = _vertices[ 0 ]._position;
+  for( unsigned int i = 1; i < _vertices.size(); i++ )
+  {
+    min_corner = glm::min( min_corner, _vertices[ i ]._position );
+    max_corner = glm::max( max_corner, _vertices[ i ]._position );
+  }
+  _bounding_sphere_center = ( min_corner + max_corner ) * 0.5f;
+
+  for( unsigned int i = 0; i < _vertices.size(); i++ )
+  {
+    _bounding_sphere_radius = glm::max( _bounding_sphere_radius, glm::length( _vertices[ i ]._position - _bounding_sphere_center ) );
+  }
+}
+
+void Mesh::SetupMesh()
+{
+  Toolbox * toolbox = Model::GetToolbox();
+
+  // Vertex positions, normals, UVs, tangents and bi tangents, packed floats
+  const int vertex_attributes[ 5 ] = { 3, 3, 2, 3, 3 };
+  this->_VBO = toolbox->CreateStaticBuffer( this->_vertices.size() * sizeof( Vertex ), &this->_vertices[ 0 ] );
+  this->_EBO = toolbox->CreateStaticBuffer( this->_indices.size() * sizeof( unsigned int ), &this->_indices[ 0 ] );
+  this->_VAO = toolbox->CreateStaticVAO( this->_VBO, this->_EBO, 5, vertex_attributes );
+
+
+  // Position only stream for depth passes
+  // -------------------------------------
+  vector< glm::vec3 > positions( this->_vertices.size() );
+  for( unsigned int i = 0; i < this->_vertices.size(); i++ )
+  {
+    positions[ i ] = this->_vertices[ i ]._position;
+  }
+
+  const int depth_attributes[ 1 ] = { 3 };
+  this->_depth_VBO = toolbox->CreateStaticBuffer( positions.size() * sizeof( glm::vec3 ), &positions[ 0 ] );
+  this->_depth_VAO = toolbox->CreateStaticVAO( this->_depth_VBO, this->_EBO, 1, depth_attributes );
 }
 
 
@@ -198,10 +249,19 @@ Model::Model( string  iPath,
   _height_map = iHeightMap;
 
   LoadModel( iPath );
+  ComputeBoundingSphere();
 }
 
-void Model::Draw( Shader    iShader,
+void Model::Draw( Shader &  iShader,
 									glm::mat4 iModelMatrix )
+{ 
+  DrawParts( iShader, iModelMatrix, true, true );
+}
+
+void Model::DrawParts( Shader &  iShader,
+                       glm::mat4 iModelMatrix,
+                       bool      iOpaqueParts,
+                       bool      iTransparentParts )
 { 
   glm::mat4 * model_matrix;
   glm::mat4 rotation_matrix;
@@ -226,7 +286,7 @@ void Model::Draw( Shader    iShader,
   }
 
 	// Draw non transparent model parts
-  for( unsigned int i = 0; i < this->_meshes.size(); i++ )
+  for( unsigned int i = 0; iOpaqueParts && i < this->_meshes.size(); i++ )
   {  
     model_matrix = &iModelMatrix;
 
@@ -282,8 +342,13 @@ void Model::Draw( Shader    iShader,
     											   1.0 );
   }
 
-	// Draw transparent model parts
-  for( int i = this->_meshes.size() - 1; i >= 0.0; --i )
+	// Draw transparent model parts, not in the depth pre-pass so tested against it
+  if( iTransparentParts && _scene->_depth_prepass_shading )
+  {
+    StateCache::DepthFunc( GL_LESS );
+  }
+
+  for( int i = this->_meshes.size() - 1; iTransparentParts && i >= 0.0; --i )
   {	
     model_matrix = &iModelMatrix;
 
@@ -327,12 +392,18 @@ void Model::Draw( Shader    iShader,
 	    											   2.0 );
 	  }
   }
+
+  if( iTransparentParts && _scene->_depth_prepass_shading )
+  {
+    StateCache::DepthFunc( GL_EQUAL );
+  }
 }
 
-void Model::DrawDepth( Shader    iShader,
-                       glm::mat4 iModelMatrix )
+unsigned int Model::DrawDepth( Shader &  iShader,
+                               glm::mat4 iModelMatrix )
 {
   
+  unsigned int triangle_count = 0;
   glm::mat4 * model_matrix;
   glm::mat4 rotation_matrix;
   glm::mat4 rotation_matrix1;
@@ -385,8 +456,242 @@ void Model::DrawDepth( Shader    iShader,
     }
 
     this->_meshes[ i ].DrawDepth( iShader,
+                                  this->_model_id,
                                   *model_matrix );
+    triangle_count += this->_meshes[ i ]._indices.size() / 3;
   }
+
+  return triangle_count;
+}
+
+void Model::DrawDepthPrePass( Shader &  iShader,
+                              Shader &  iAlphaTestShader,
+                              glm::mat4 iModelMatrix,
+                              bool      iPlainMeshes )
+{
+  glm::mat4 * model_matrix;
+  glm::mat4 rotation_matrix;
+  glm::mat4 rotation_matrix1;
+  glm::mat4 rotation_matrix2;
+  glm::mat4 translation_matrix1;
+  glm::mat4 translation_matrix2;
+
+  // Set revolving door rotations
+  if( _model_id == 3 )
+  { 
+    rotation_matrix  = iModelMatrix * _scene->_door_rotation_matrix;
+    rotation_matrix1 = iModelMatrix * _scene->_door1_rotation_matrix;
+    rotation_matrix2 = iModelMatrix * _scene->_door2_rotation_matrix;
+  }
+
+  // Set simple door translations
+  if( _model_id == 4 )
+  { 
+    translation_matrix1 = iModelMatrix * _scene->_door_translation_matrix1;
+    translation_matrix2 = iModelMatrix * _scene->_door_translation_matrix2;
+  }
+
+  // Plain meshes first from their position stream, alpha tested ones need their UVs
+  for( unsigned int pass_it = 0; pass_it < 2; pass_it++ )
+  {
+    bool alpha_tested = ( pass_it == 1 );
+    ( alpha_tested ) ? iAlphaTestShader.Use() : iShader.Use();
+
+    for( unsigned int i = 0; i < this->_meshes.size(); i++ )
+    {  
+      if( this->_meshes[ i ]._opacity_map != alpha_tested || ( !alpha_tested && !iPlainMeshes ) )
+      {
+        continue;
+      }
+
+      model_matrix = &iModelMatrix;
+
+      // Perform revolving door rotations
+      if( _model_id == 3 )
+      {
+        if( i > 14 && i < 18 )
+        {
+          model_matrix = &rotation_matrix;
+        }
+
+        if( i > 2 && i < 9 )
+        {
+          model_matrix = &rotation_matrix1;
+        }
+
+        if( i > 8 && i < 15 )
+        {
+          model_matrix = &rotation_matrix2;
+        }
+      }
+
+      // Perform simple door translations
+      if( _model_id == 4 )
+      {
+        if( i == 4 )
+        {
+          model_matrix = &translation_matrix1;
+        }
+
+        if( i == 5 )
+        {
+          model_matrix = &translation_matrix2;
+        }
+      }
+
+      if( alpha_tested )
+      {
+        this->_meshes[ i ].Draw( iAlphaTestShader,
+                                 this->_model_id,
+                                 i,
+                                 *model_matrix,
+                                 false,
+                                 false,
+                                 1.0 );
+      }
+      else
+      {
+        this->_meshes[ i ].DrawDepth( iShader,
+                                      this->_model_id,
+                                      *model_matrix );
+      }
+    }
+  }
+}
+
+void Model::DrawMotionVectors( Shader &  iShader,
+                               glm::mat4 iModelMatrix )
+{
+  // Doors parts matrices at this frame and at the previous one
+  glm::mat4 parts_matrices[ 2 ][ 5 ];
+  for( unsigned int frame_it = 0; frame_it < 2; frame_it++ )
+  {
+    bool previous = ( frame_it == 1 );
+    parts_matrices[ frame_it ][ 0 ] = iModelMatrix * ( previous ? _scene->_previous_door_rotation_matrix     : _scene->_door_rotation_matrix );
+    parts_matrices[ frame_it ][ 1 ] = iModelMatrix * ( previous ? _scene->_previous_door1_rotation_matrix    : _scene->_door1_rotation_matrix );
+    parts_matrices[ frame_it ][ 2 ] = iModelMatrix * ( previous ? _scene->_previous_door2_rotation_matrix    : _scene->_door2_rotation_matrix );
+    parts_matrices[ frame_it ][ 3 ] = iModelMatrix * ( previous ? _scene->_previous_door_translation_matrix1 : _scene->_door_translation_matrix1 );
+    parts_matrices[ frame_it ][ 4 ] = iModelMatrix * ( previous ? _scene->_previous_door_translation_matrix2 : _scene->_door_translation_matrix2 );
+  }
+
+  for( unsigned int i = 0; i < this->_meshes.size(); i++ )
+  { 
+    glm::mat4 * model_matrix          = &iModelMatrix;
+    glm::mat4 * previous_model_matrix = &iModelMatrix;
+
+    // Perform revolving door rotations, glass parts are not in the depth buffer
+    if( _model_id == 3 )
+    {
+      if( this->_meshes[ i ]._opacity_map )
+      {
+        continue;
+      }
+
+      if( i > 14 && i < 18 )
+      {
+        model_matrix          = &parts_matrices[ 0 ][ 0 ];
+        previous_model_matrix = &parts_matrices[ 1 ][ 0 ];
+      }
+
+      if( i > 2 && i < 9 )
+      {
+        model_matrix          = &parts_matrices[ 0 ][ 1 ];
+        previous_model_matrix = &parts_matrices[ 1 ][ 1 ];
+      }
+
+      if( i > 8 && i < 15 )
+      {
+        model_matrix          = &parts_matrices[ 0 ][ 2 ];
+        previous_model_matrix = &parts_matrices[ 1 ][ 2 ];
+      }
+    }
+
+    // Perform simple door translations
+    if( _model_id == 4 )
+    {
+      if( i == 4 )
+      {
+        model_matrix          = &parts_matrices[ 0 ][ 3 ];
+        previous_model_matrix = &parts_matrices[ 1 ][ 3 ];
+      }
+
+      if( i == 5 )
+      {
+        model_matrix          = &parts_matrices[ 0 ][ 4 ];
+        previous_model_matrix = &parts_matrices[ 1 ][ 4 ];
+      }
+    }
+
+    this->_meshes[ i ].DrawMotionVectors( iShader,
+                                          this->_model_id,
+                                          *model_matrix,
+                                          *previous_model_matrix );
+  }
+}
+
+void Model::ComputeBoundingSphere()
+{
+  bool empty = true;
+
+  _bounding_sphere_center = glm::vec3( 0.0 );
+  _bounding_sphere_radius = 0.0;
+
+  for( unsigned int i = 0; i < _meshes.size(); i++ )
+  {
+    if( _meshes[ i ]._vertices.empty() )
+    {
+      continue;
+    }
+
+    // Mesh sphere in model space
+    glm::mat4 local_transform = _meshes[ i ]._local_transform;
+    glm::vec3 center          = glm::vec3( local_transform * glm::vec4( _meshes[ i ]._bounding_sphere_center, 1.0 ) );
+    float     scale           = glm::max( glm::length( glm::vec3( local_transform[ 0 ] ) ), 
+                                          glm::max( glm::length( glm::vec3( local_transform[ 1 ] ) ), glm::length( glm::vec3( local_transform[ 2 ] ) ) ) );
+    float     radius          = _meshes[ i ]._bounding_sphere_radius * scale;
+
+    if( empty )
+    {
+      _bounding_sphere_center = center;
+      _bounding_sphere_radius = radius;
+      empty = false;
+      continue;
+    }
+
+    // Merge with the current model sphere
+    float distance = glm::length( center - _bounding_sphere_center );
+    if( distance + radius <= _bounding_sphere_radius )
+    {
+      continue;
+    }
+    if( distance + _bounding_sphere_radius <= radius )
+    {
+      _bounding_sphere_center = center;
+      _bounding_sphere_radius = radius;
+      continue;
+    }
+    float new_radius = ( distance + radius + _bounding_sphere_radius ) * 0.5f;
+    _bounding_sphere_center += ( center - _bounding_sphere_center ) * ( ( new_radius - _bounding_sphere_radius ) / distance );
+    _bounding_sphere_radius = new_radius;
+  }
+
+  // Revolving door wings turn around the model Z axis : keep the sphere valid for any angle
+  if( _model_id == 3 )
+  {
+    _bounding_sphere_radius += glm::length( glm::vec2( _bounding_sphere_center ) );
+    _bounding_sphere_center  = glm::vec3( 0.0, 0.0, _bounding_sphere_center.z );
+  }
+}
+
+void Model::WorldBoundingSphere( glm::mat4   iModelMatrix,
+                                 glm::vec3 * oCenter,
+                                 float *     oRadius )
+{
+  float scale = glm::max( glm::length( glm::vec3( iModelMatrix[ 0 ] ) ), 
+                          glm::max( glm::length( glm::vec3( iModelMatrix[ 1 ] ) ), glm::length( glm::vec3( iModelMatrix[ 2 ] ) ) ) );
+
+  *oCenter = glm::vec3( iModelMatrix * glm::vec4( _bounding_sphere_center, 1.0 ) );
+  *oRadius = _bounding_sphere_radius * scale;
 }
 
 void Model::PrintInfos()
@@ -2384,7 +2689,6 @@ unsigned int Model::TextureFromFile( string iTexturePath,
   SDL_Surface * t = NULL;
 
   unsigned int textureID;
-  glGenTextures( 1, &textureID );
   t = IMG_Load( iTexturePath.c_str() );
 	  
   if( !t )
@@ -2397,18 +2701,14 @@ unsigned int Model::TextureFromFile( string iTexturePath,
     //std::cout << "Texture : " << iTexturePath << " => Loaded" << std::endl;
   }
   
-  glBindTexture( GL_TEXTURE_2D, textureID );
-  
-  glTexImage2D( GL_TEXTURE_2D, 0, iInternalFormat, t->w, t->h, 0, iFormat, GL_UNSIGNED_BYTE, t->pixels );
- 
-  glGenerateMipmap( GL_TEXTURE_2D );    
-  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
-  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
-  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
-  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, aniso ); // anisotropie
-
-  glBindTexture( GL_TEXTURE_2D, 0 );
+  // Same mipmapped, repeated and anisotropic setup as the materials textures
+  textureID = _toolbox->CreateTextureFromData( t,
+                                               iInternalFormat,
+                                               iFormat,
+                                               true,
+                                               true,
+                                               aniso );
+
   SDL_FreeSurface( t );
   return textureID;
 }
@@ -76,7 +76,7 @@ class Mesh
           aiString          iMeshName,
           bool              iOpacityMap );
 
-    void Draw( Shader    iShader,
+    void Draw( Shader &  iShader,
                int       iModelID,
                int       iMeshNumber,
                glm::mat4 iModelMatrix,
@@ -84,9 +84,17 @@ class Mesh
                bool      iHeightMap,
                float     iOpacityDiscard );
 
-   void DrawDepth( Shader    iShader,
+   void DrawDepth( Shader &  iShader,
+                   int       iModelID,
                    glm::mat4 iModelMatrix ); 
 
+    void DrawMotionVectors( Shader &  iShader,
+                            int       iModelID,
+                            glm::mat4 iModelMatrix,
+                            glm::mat4 iPreviousModelMatrix );
+
+    void ComputeBoundingSphere();
+
     
     // Class members
     // -------------
@@ -97,11 +105,18 @@ class Mesh
     aiString          _name;
     bool              _opacity_map;
 
+    // Bounding sphere in mesh vertices space
+    glm::vec3         _bounding_sphere_center;
+    float             _bounding_sphere_radius;
+
 
   private:
   
     unsigned int _VAO, _VBO, _EBO;
 
+    // Tightly packed positions sharing the EBO, 12 bytes per vertex against 56 for shading
+    unsigned int _depth_VAO, _depth_VBO;
+
     void SetupMesh();
     
 };
@@ -128,11 +143,30 @@ class Model
            bool    iNormalMap,
            bool    iHeightMap );
 
-    void Draw( Shader    iShader,
+    void Draw( Shader &  iShader,
                glm::mat4 iModelMatrix );   
 
-    void DrawDepth( Shader    iShader,
-                    glm::mat4 iModelMatrix );   
+    void DrawParts( Shader &  iShader,
+                    glm::mat4 iModelMatrix,
+                    bool      iOpaqueParts,
+                    bool      iTransparentParts );
+
+    unsigned int DrawDepth( Shader &  iShader,
+                            glm::mat4 iModelMatrix );   
+
+    void DrawDepthPrePass( Shader &  iShader,
+                           Shader &  iAlphaTestShader,
+                           glm::mat4 iModelMatrix,
+                           bool      iPlainMeshes );
+
+    void DrawMotionVectors( Shader &  iShader,
+                            glm::mat4 iModelMatrix );
+
+    void ComputeBoundingSphere();
+
+    void WorldBoundingSphere( glm::mat4   iModelMatrix,
+                              glm::vec3 * oCenter,
+                              float *     oRadius );
 
     void PrintInfos();
 
@@ -181,6 +215,10 @@ class Model
 
     bool _normal_map;
     bool _height_map;
+
+    // Bounding sphere in model space
+    glm::vec3 _bounding_sphere_center;
+    float     _bounding_sphere_radius;
     
 
   private:
@@ -0,0 +1,391 @@
+#include "light_grid.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+
+//******************************************************************************
+//**********  Class LightGrid  *************************************************
+//******************************************************************************
+
+LightGrid::LightGrid()
+{
+  _light_count            = 0;
+  _cluster_offset         = 0;
+  _index_offset           = 0;
+  _slice_scale            = 0.0;
+  _slice_bias             = 0.0;
+  _index_count            = 0;
+  _occupied_cluster_count = 0;
+  _build_time             = 0.0;
+  _bounds_near            = 0.0;
+  _bounds_far             = 0.0;
+
+  _clusters_min.resize( LIGHT_GRID_X * LIGHT_GRID_Y * LIGHT_GRID_Z );
+  _clusters_max.resize( LIGHT_GRID_X * LIGHT_GRID_Y * LIGHT_GRID_Z );
+  _clusters_lights.resize( LIGHT_GRID_X * LIGHT_GRID_Y * LIGHT_GRID_Z );
+
+  // GL 4.1 guarantees 65536 texels, clusters and lights must fit with some room for indices
+  glGetIntegerv( GL_MAX_TEXTURE_BUFFER_SIZE, &_max_texels );
+
+  glGenBuffers( 1, &_buffer );
+  glBindBuffer( GL_TEXTURE_BUFFER, _buffer );
+  glBufferData( GL_TEXTURE_BUFFER, sizeof( glm::vec4 ), NULL, GL_STREAM_DRAW );
+
+  glGenTextures( 1, &_buffer_texture );
+  StateCache::BindTexture( GL_TEXTURE_BUFFER, _buffer_texture );
+  glTexBuffer( GL_TEXTURE_BUFFER, GL_RGBA32F, _buffer );
+
+  StateCache::BindTexture( GL_TEXTURE_BUFFER, 0 );
+  glBindBuffer( GL_TEXTURE_BUFFER, 0 );
+
+  // Up to 4 threads with this one, slices workers waiting for the frames with many lights
+  _work_generation = 0;
+  _work_step       = 1;
+  _work_pending    = 0;
+  _workers_quit    = false;
+
+  unsigned int worker_count = glm::min( std::thread::hardware_concurrency(), ( unsigned int )4 );
+  for( unsigned int worker_it = 1; worker_it < worker_count; worker_it++ )
+  {
+    _workers.push_back( std::thread( &LightGrid::WorkerLoop, this, worker_it ) );
+  }
+}
+
+LightGrid::~LightGrid()
+{
+  {
+    std::unique_lock< std::mutex > lock( _workers_mutex );
+    _workers_quit = true;
+  }
+  _work_ready.notify_all();
+
+  for( unsigned int worker_it = 0; worker_it < _workers.size(); worker_it++ )
+  {
+    _workers[ worker_it ].join();
+  }
+
+  StateCache::DeleteTextures( 1, &_buffer_texture );
+  glDeleteBuffers( 1, &_buffer );
+}
+
+void LightGrid::WorkerLoop( unsigned int iWorker )
+{
+  unsigned int generation = 0;
+
+  while( true )
+  {
+    std::unique_lock< std::mutex > lock( _workers_mutex );
+    while( !_workers_quit && _work_generation == generation )
+    {
+      _work_ready.wait( lock );
+    }
+    if( _workers_quit )
+    {
+      return;
+    }
+
+    // Workers past this frame step sit it out
+    generation = _work_generation;
+    unsigned int step = _work_step;
+    if( iWorker >= step )
+    {
+      continue;
+    }
+    lock.unlock();
+
+    ClustersSlicesAssignment( iWorker, step );
+
+    lock.lock();
+    _work_pending--;
+    if( _work_pending == 0 )
+    {
+      _work_done.notify_one();
+    }
+  }
+}
+
+void LightGrid::ClustersBoundsUpdate( glm::mat4 iProjectionMatrix,
+                                      float     iNear,
+                                      float     iFar )
+{
+  // Bounds only depend on the projection, rebuilt on resize or fov change
+  if( iProjectionMatrix == _bounds_projection && iNear == _bounds_near && iFar == _bounds_far )
+  {
+    return;
+  }
+  _bounds_projection = iProjectionMatrix;
+  _bounds_near       = iNear;
+  _bounds_far        = iFar;
+
+  // Exponential slices, view depth of slice k is near * ( far / near ) ^ ( k / Z )
+  _slice_scale = ( float )LIGHT_GRID_Z / log( iFar / iNear );
+  _slice_bias  = _slice_scale * log( iNear );
+
+  for( unsigned int z = 0; z < LIGHT_GRID_Z; z++ )
+  {
+    float slice_near = iNear * pow( iFar / iNear, ( float )z / LIGHT_GRID_Z );
+    float slice_far  = iNear * pow( iFar / iNear, ( float )( z + 1 ) / LIGHT_GRID_Z );
+
+    for( unsigned int y = 0; y < LIGHT_GRID_Y; y++ )
+    {
+      float ndc_y0 = -1.0 + 2.0 * ( float )y / LIGHT_GRID_Y;
+      float ndc_y1 = -1.0 + 2.0 * ( float )( y + 1 ) / LIGHT_GRID_Y;
+
+      for( unsigned int x = 0; x < LIGHT_GRID_X; x++ )
+      {
+        float ndc_x0 = -1.0 + 2.0 * ( float )x / LIGHT_GRID_X;
+        float ndc_x1 = -1.0 + 2.0 * ( float )( x + 1 ) / LIGHT_GRID_X;
+
+        // Tile corners on both slice planes, the view space AABB encloses the 8 points
+        glm::vec3 bound_min( 1e30 );
+        glm::vec3 bound_max( -1e30 );
+        float depths[ 2 ] = { slice_near, slice_far };
+        for( unsigned int depth_it = 0; depth_it < 2; depth_it++ )
+        {
+          float depth = depths[ depth_it ];
+          float xs[ 2 ] = { ndc_x0 * depth / iProjectionMatrix[ 0 ][ 0 ], ndc_x1 * depth / iProjectionMatrix[ 0 ][ 0 ] };
+          float ys[ 2 ] = { ndc_y0 * depth / iProjectionMatrix[ 1 ][ 1 ], ndc_y1 * depth / iProjectionMatrix[ 1 ][ 1 ] };
+          for( unsigned int corner_it = 0; corner_it < 4; corner_it++ )
+          {
+            glm::vec3 corner( xs[ corner_it & 1 ], ys[ corner_it >> 1 ], -depth );
+            bound_min = glm::min( bound_min, corner );
+            bound_max = glm::max( bound_max, corner );
+          }
+        }
+
+        unsigned int cluster_it = x + ( y * LIGHT_GRID_X ) + ( z * LIGHT_GRID_X * LIGHT_GRID_Y );
+        _clusters_min[ cluster_it ] = bound_min;
+        _clusters_max[ cluster_it ] = bound_max;
+      }
+    }
+  }
+}
+
+void LightGrid::ClustersSlicesAssignment( unsigned int iFirstSlice,
+                                          unsigned int iSliceStep )
+{
+  unsigned int light_count = _light_count;
+
+  // Slice candidates in SoA layout, padded to 4 with never hit spheres
+  std::vector< float >        candidates_x;
+  std::vector< float >        candidates_y;
+  std::vector< float >        candidates_z;
+  std::vector< float >        candidates_radius2;
+  std::vector< unsigned int > candidates_id;
+
+  for( unsigned int z = iFirstSlice; z < LIGHT_GRID_Z; z += iSliceStep )
+  {
+    unsigned int first_cluster = z * LIGHT_GRID_X * LIGHT_GRID_Y;
+    float slice_min_z = _clusters_min[ first_cluster ].z;
+    float slice_max_z = _clusters_max[ first_cluster ].z;
+
+    candidates_x.clear();
+    candidates_y.clear();
+    candidates_z.clear();
+    candidates_radius2.clear();
+    candidates_id.clear();
+
+    // Keep lights overlapping the slice depth range
+    for( unsigned int light_it = 0; light_it < light_count; light_it++ )
+    {
+      float radius = sqrt( _lights_radius2[ light_it ] );
+      if( ( _lights_z[ light_it ] + radius ) < slice_min_z || ( _lights_z[ light_it ] - radius ) > slice_max_z )
+      {
+        continue;
+      }
+      candidates_x.push_back( _lights_x[ light_it ] );
+      candidates_y.push_back( _lights_y[ light_it ] );
+      candidates_z.push_back( _lights_z[ light_it ] );
+      candidates_radius2.push_back( _lights_radius2[ light_it ] );
+      candidates_id.push_back( light_it );
+    }
+
+    while( candidates_id.size() % 4 != 0 )
+    {
+      candidates_x.push_back( 1e30 );
+      candidates_y.push_back( 1e30 );
+      candidates_z.push_back( 1e30 );
+      candidates_radius2.push_back( -1.0 );
+      candidates_id.push_back( 0 );
+    }
+
+    for( unsigned int cluster_it = first_cluster; cluster_it < first_cluster + LIGHT_GRID_X * LIGHT_GRID_Y; cluster_it++ )
+    {
+      std::vector< unsigned int > * cluster_lights = &_clusters_lights[ cluster_it ];
+      cluster_lights->clear();
+
+      glm::vec3 bound_min = _clusters_min[ cluster_it ];
+      glm::vec3 bound_max = _clusters_max[ cluster_it ];
+
+#ifdef __SSE__
+      // Sphere against AABB, 4 lights at a time : squared distance from center to box under squared radius
+      __m128 zero  = _mm_setzero_ps();
+      __m128 min_x = _mm_set1_ps( bound_min.x );
+      __m128 min_y = _mm_set1_ps( bound_min.y );
+      __m128 min_z = _mm_set1_ps( bound_min.z );
+      __m128 max_x = _mm_set1_ps( bound_max.x );
+      __m128 max_y = _mm_set1_ps( bound_max.y );
+      __m128 max_z = _mm_set1_ps( bound_max.z );
+
+      for( unsigned int light_it = 0; light_it < candidates_id.size(); light_it += 4 )
+      {
+        __m128 x = _mm_loadu_ps( &candidates_x[ light_it ] );
+        __m128 y = _mm_loadu_ps( &candidates_y[ light_it ] );
+        __m128 z = _mm_loadu_ps( &candidates_z[ light_it ] );
+
+        __m128 dx = _mm_add_ps( _mm_max_ps( _mm_sub_ps( min_x, x ), zero ), _mm_max_ps( _mm_sub_ps( x, max_x ), zero ) );
+        __m128 dy = _mm_add_ps( _mm_max_ps( _mm_sub_ps( min_y, y ), zero ), _mm_max_ps( _mm_sub_ps( y, max_y ), zero ) );
+        __m128 dz = _mm_add_ps( _mm_max_ps( _mm_sub_ps( min_z, z ), zero ), _mm_max_ps( _mm_sub_ps( z, max_z ), zero ) );
+        __m128 distance2 = _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ), _mm_mul_ps( dz, dz ) );
+
+        int hits = _mm_movemask_ps( _mm_cmple_ps( distance2, _mm_loadu_ps( &candidates_radius2[ light_it ] ) ) );
+        for( unsigned int lane_it = 0; hits != 0; lane_it++, hits >>= 1 )
+        {
+          if( hits & 1 )
+          {
+            cluster_lights->push_back( candidates_id[ light_it + lane_it ] );
+          }
+        }
+      }
+#else
+      for( unsigned int light_it = 0; light_it < candidates_id.size(); light_it++ )
+      {
+        glm::vec3 center( candidates_x[ light_it ], candidates_y[ light_it ], candidates_z[ light_it ] );
+        glm::vec3 delta = glm::max( bound_min - center, glm::vec3( 0.0 ) ) + glm::max( center - bound_max, glm::vec3( 0.0 ) );
+        if( glm::dot( delta, delta ) <= candidates_radius2[ light_it ] )
+        {
+          cluster_lights->push_back( candidates_id[ light_it ] );
+        }
+      }
+#endif
+    }
+  }
+}
+
+void LightGrid::Update( std::vector< PointLight > * iLights,
+                        std::vector< float > *      iShadowCodes,
+                        glm::mat4                   iViewMatrix,
+                        glm::mat4                   iProjectionMatrix,
+                        float                       iNear,
+                        float                       iFar,
+                        bool                        iClustered )
+{
+  std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+  _light_count = iLights->size();
+  _buffer_data.clear();
+
+
+  // Lights texels : ( position, range ) and ( radiance, shadow slot code )
+  // ---------------------------------------------------------------------
+  for( unsigned int light_it = 0; light_it < iLights->size(); light_it++ )
+  {
+    PointLight * light = &( *iLights )[ light_it ];
+    _buffer_data.push_back( glm::vec4( light->_position, light->_max_lighting_distance ) );
+    _buffer_data.push_back( glm::vec4( light->_color * light->_intensity, ( *iShadowCodes )[ light_it ] ) );
+  }
+  _cluster_offset = _buffer_data.size();
+  _index_offset   = _buffer_data.size();
+  _index_count            = 0;
+  _occupied_cluster_count = 0;
+
+
+  // Clusters lights lists
+  // ---------------------
+  if( iClustered )
+  {
+    ClustersBoundsUpdate( iProjectionMatrix, iNear, iFar );
+
+    _lights_x.resize( _light_count );
+    _lights_y.resize( _light_count );
+    _lights_z.resize( _light_count );
+    _lights_radius2.resize( _light_count );
+    for( int light_it = 0; light_it < _light_count; light_it++ )
+    {
+      PointLight * light = &( *iLights )[ light_it ];
+      glm::vec4 view_position = iViewMatrix * glm::vec4( light->_position, 1.0 );
+      _lights_x[ light_it ]       = view_position.x;
+      _lights_y[ light_it ]       = view_position.y;
+      _lights_z[ light_it ]       = view_position.z;
+      _lights_radius2[ light_it ] = light->_max_lighting_distance * light->_max_lighting_distance;
+    }
+
+    // Slices are interleaved between workers to balance near and far slices, few lights stay on this thread
+    unsigned int worker_count = ( _light_count < 64 ) ? 1 : _workers.size() + 1;
+
+    if( worker_count > 1 )
+    {
+      std::unique_lock< std::mutex > lock( _workers_mutex );
+      _work_step    = worker_count;
+      _work_pending = worker_count - 1;
+      _work_generation++;
+      lock.unlock();
+      _work_ready.notify_all();
+    }
+
+    ClustersSlicesAssignment( 0, worker_count );
+
+    if( worker_count > 1 )
+    {
+      std::unique_lock< std::mutex > lock( _workers_mutex );
+      while( _work_pending > 0 )
+      {
+        _work_done.wait( lock );
+      }
+    }
+
+    // Pack ( offset, count ) per cluster then 4 indices per texel, truncated to the texture buffer size
+    unsigned int cluster_count = LIGHT_GRID_X * LIGHT_GRID_Y * LIGHT_GRID_Z;
+    _index_offset = _cluster_offset + cluster_count;
+    int index_capacity = ( _max_texels - _index_offset ) * 4;
+
+    std::vector< float > indices;
+    for( unsigned int cluster_it = 0; cluster_it < cluster_count; cluster_it++ )
+    {
+      std::vector< unsigned int > * cluster_lights = &_clusters_lights[ cluster_it ];
+      unsigned int count = glm::min( ( int )cluster_lights->size(), glm::max( index_capacity - ( int )indices.size(), 0 ) );
+      if( count < cluster_lights->size() )
+      {
+        static bool truncation_reported = false;
+        if( !truncation_reported )
+        {
+          std::cout << "ERROR::LIGHT_GRID::LIGHTS_INDICES_TRUNCATED" << std::endl;
+          truncation_reported = true;
+        }
+      }
+
+      _buffer_data.push_back( glm::vec4( ( float )indices.size(), ( float )count, 0.0, 0.0 ) );
+      indices.insert( indices.end(), cluster_lights->begin(), cluster_lights->begin() + count );
+      _occupied_cluster_count += ( count > 0 ) ? 1 : 0;
+    }
+    _index_count = indices.size();
+
+    while( indices.size() % 4 != 0 )
+    {
+      indices.push_back( 0.0 );
+    }
+    for( unsigned int index_it = 0; index_it < indices.size(); index_it += 4 )
+    {
+      _buffer_data.push_back( glm::vec4( indices[ index_it ], indices[ index_it + 1 ], indices[ index_it + 2 ], indices[ index_it + 3 ] ) );
+    }
+  }
+
+
+  // Upload, orphaning the previous frame storage
+  // --------------------------------------------
+  glBindBuffer( GL_TEXTURE_BUFFER, _buffer );
+  glBufferData( GL_TEXTURE_BUFFER, glm::max( ( int )_buffer_data.size(), 1 ) * sizeof( glm::vec4 ), NULL, GL_STREAM_DRAW );
+  if( _buffer_data.size() > 0 )
+  {
+    glBufferSubData( GL_TEXTURE_BUFFER, 0, _buffer_data.size() * sizeof( glm::vec4 ), &_buffer_data[ 0 ] );
+  }
+  glBindBuffer( GL_TEXTURE_BUFFER, 0 );
+
+  _build_time = std::chrono::duration< double, std::milli >( std::chrono::high_resolution_clock::now() - start ).count();
+}
@@ -0,0 +1,111 @@
+#ifndef LIGHT_GRID_H
+#define LIGHT_GRID_H
+
+#include "point_light.hpp"
+#include "state_cache.hpp"
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+#define LIGHT_GRID_X 16
+#define LIGHT_GRID_Y 9
+#define LIGHT_GRID_Z 24
+
+
+//******************************************************************************
+//**********  Class LightGrid  *************************************************
+//******************************************************************************
+
+class LightGrid
+{
+
+  public:
+
+
+    // LightGrid functions
+    // -------------------
+
+    LightGrid();
+
+    ~LightGrid();
+
+    void Update( std::vector< PointLight > * iLights,
+                 std::vector< float > *      iShadowCodes,
+                 glm::mat4                   iViewMatrix,
+                 glm::mat4                   iProjectionMatrix,
+                 float                       iNear,
+                 float                       iFar,
+                 bool                        iClustered );
+
+    void ClustersBoundsUpdate( glm::mat4 iProjectionMatrix,
+                               float     iNear,
+                               float     iFar );
+
+    void ClustersSlicesAssignment( unsigned int iFirstSlice,
+                                   unsigned int iSliceStep );
+
+    void WorkerLoop( unsigned int iWorker );
+
+
+    // LightGrid class members
+    // -----------------------
+
+    // Lights, clusters ( offset, count ) and lights indices packed in one RGBA32F texture buffer
+    unsigned int _buffer;
+    unsigned int _buffer_texture;
+    int          _max_texels;
+
+    int          _light_count;
+    int          _cluster_offset;
+    int          _index_offset;
+
+    // Froxels depth slicing : slice = log( view_depth ) * scale - bias
+    float        _slice_scale;
+    float        _slice_bias;
+
+    // Stats
+    unsigned int _index_count;
+    unsigned int _occupied_cluster_count;
+    double       _build_time;
+
+
+  private:
+
+    // Clusters view space AABBs and the projection they were built for
+    std::vector< glm::vec3 > _clusters_min;
+    std::vector< glm::vec3 > _clusters_max;
+    glm::mat4                _bounds_projection;
+    float                    _bounds_near;
+    float                    _bounds_far;
+
+    // View space lights spheres in SoA layout
+    std::vector< float >     _lights_x;
+    std::vector< float >     _lights_y;
+    std::vector< float >     _lights_z;
+    std::vector< float >     _lights_radius2;
+
+    std::vector< std::vector< unsigned int > > _clusters_lights;
+    std::vector< glm::vec4 >                   _buffer_data;
+
+    // Slices workers started once, woken each frame by a new work generation
+    std::vector< std::thread > _workers;
+    std::mutex                 _workers_mutex;
+    std::condition_variable    _work_ready;
+    std::condition_variable    _work_done;
+    unsigned int               _work_generation;
+    unsigned int               _work_step;
+    unsigned int               _work_pending;
+    bool                       _workers_quit;
+};
+
+#endif  // LIGHT_GRID_H
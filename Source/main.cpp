@@ -42,8 +42,19 @@ void Loop()
     
     window->Draw();
 
+    StateCache::FrameEnd();
+
     window->_toolbox->PrintFPS();
 
+    scene->PrintShadowPassInfos();
+    scene->PrintForwardLightingInfos();
+    scene->PrintDeferredLightingInfos();
+    scene->PrintPostProcessInfos();
+    scene->PrintDynamicResolutionInfos();
+    scene->PrintAntiAliasingInfos();
+    scene->PrintTessellationInfos();
+    scene->PrintStateCacheInfos();
+
     SDL_GL_SwapWindow( window->_SDL_window );
   }
 }
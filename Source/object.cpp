@@ -7,6 +7,8 @@
 
 Object::Object()
 {
+  _PVS_id             = 0;
+  _baked_displacement = false;
 }
 
 Object::Object( int       iID,
@@ -21,8 +23,6 @@ Object::Object( int       iID,
                 bool      iReceivShadow,
                 float     iShadowDarkness,
                 float     iShadowBias,
-                bool      iBloom,
-                float     iBloomBrightness,
                 bool      iOpacityMap,
                 bool      iNormalMap,
                 bool      iHeightMap,
@@ -46,8 +46,6 @@ Object::Object( int       iID,
   _receiv_shadow       = iReceivShadow;
   _shadow_darkness     = iShadowDarkness;
   _shadow_bias         = iShadowBias;
-  _bloom               = iBloom;
-  _bloom_brightness    = iBloomBrightness;
   _opacity_map         = iOpacityMap;
   _normal_map          = iNormalMap;
   _height_map          = iHeightMap;
@@ -58,6 +56,8 @@ Object::Object( int       iID,
   _emissive_factor     = iEmissiveFactor;
   _parallax_cubemap    = iParallaxCubemap;
   _IBL                 = iIBL;
+  _PVS_id              = 0;
+  _baked_displacement  = false;
 }
 
 void Object::Set( Object iSourceObject )
@@ -74,8 +74,6 @@ void Object::Set( Object iSourceObject )
   _receiv_shadow       = iSourceObject._receiv_shadow;      
   _shadow_darkness     = iSourceObject._shadow_darkness;
   _shadow_bias         = iSourceObject._shadow_bias;     
-  _bloom               = iSourceObject._bloom;               
-  _bloom_brightness    = iSourceObject._bloom_brightness;    
   _opacity_map         = iSourceObject._opacity_map;         
   _normal_map          = iSourceObject._normal_map;          
   _height_map          = iSourceObject._height_map;          
@@ -86,6 +84,12 @@ void Object::Set( Object iSourceObject )
   _emissive_factor     = iSourceObject._emissive_factor; 
   _parallax_cubemap    = iSourceObject._parallax_cubemap;
   _IBL                 = iSourceObject._IBL;
+  _PVS_id              = iSourceObject._PVS_id;
+  _baked_displacement  = iSourceObject._baked_displacement;
+
+  _displacement_lods_VAO = iSourceObject._displacement_lods_VAO;
+  _displacement_lods_VBO = iSourceObject._displacement_lods_VBO;
+  _displacement_lods_IBO = iSourceObject._displacement_lods_IBO;
 }
 
 
@@ -31,8 +31,6 @@ class Object
             bool      iReceivShadow,
             float     iShadowDarkness,
             float     iShadowBias,
-            bool      iBloom,
-            float     iBloomBrightness,
             bool      iOpacityMap,
             bool      iNormalMap,
             bool      iHeightMap,
@@ -62,8 +60,6 @@ class Object
     bool                        _receiv_shadow;
     float                       _shadow_darkness;
     float                       _shadow_bias;
-    bool                        _bloom;
-    float                       _bloom_brightness;
     bool                        _opacity_map;
     bool                        _normal_map;
     bool                        _height_map;
@@ -75,6 +71,16 @@ class Object
     std::vector< unsigned int > _IBL_cubemaps;
     bool                        _parallax_cubemap;
     bool                        _IBL;
+    unsigned int                _PVS_id;
+
+    // Pre-displaced plane chunks, one VAO per chunk and LOD, drawn instead of the tessellated patches when enabled
+    bool                        _baked_displacement;
+    std::vector< unsigned int > _displacement_lods_VAO;
+    std::vector< unsigned int > _displacement_lods_VBO;
+    std::vector< unsigned int > _displacement_lods_IBO;
+
+    // Strongest lights reaching the object, rebuilt every frame
+    std::vector< unsigned int > _lights_list;
 };
 
 #endif  // OBJECT_H
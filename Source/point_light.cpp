@@ -1,11 +1,14 @@
 #include "point_light.hpp"
 
+#include <cmath>
+
 
 //******************************************************************************
 //**********  Class PointLight  ************************************************
 //******************************************************************************
 
 float PointLight::_intensity_multiplier; 
+float PointLight::_radiance_cutoff = 0.5;
 
 PointLight::PointLight( glm::vec3 iPosition,
                         glm::vec3 iColor,
@@ -16,6 +19,7 @@ PointLight::PointLight( glm::vec3 iPosition,
   _color                 = iColor;
   _intensity             = iIntensity;
   _max_lighting_distance = iMaxLightingDistance;
+  _casts_shadow          = true;
 }
 
 void PointLight::SetLightsMultiplier( float iMultiplier )
@@ -26,4 +30,16 @@ void PointLight::SetLightsMultiplier( float iMultiplier )
 float PointLight::GetLightsMultiplier()
 {
   return _intensity_multiplier;
+}
+
+void PointLight::SetLightsCutoff( float iCutoff )
+{
+  _radiance_cutoff = iCutoff;
+}
+
+void PointLight::UpdateBoundingSphereScale()
+{
+  // Range where the unwindowed inverse square radiance of the brightest channel drops under the cutoff
+  float peak_radiance = glm::max( glm::max( _color.r, _color.g ), _color.b ) * _intensity;
+  _max_lighting_distance = std::sqrt( peak_radiance / _radiance_cutoff );
 }
\ No newline at end of file
@@ -28,6 +28,8 @@ class PointLight
 
     static float GetLightsMultiplier();
 
+    static void SetLightsCutoff( float iCutoff );
+
     void UpdateBoundingSphereScale();
 
 
@@ -38,11 +40,13 @@ class PointLight
     glm::vec3 _color;
     float     _intensity;
     float     _max_lighting_distance;
+    bool      _casts_shadow;
 
 
   private:
 
     static float _intensity_multiplier;
+    static float _radiance_cutoff;
 
 };
 
@@ -0,0 +1,301 @@
+#include "render_graph.hpp"
+
+#include <stdio.h>
+
+
+//******************************************************************************
+//**********  Class RenderGraph  ***********************************************
+//******************************************************************************
+
+RenderGraph::RenderGraph( bool iImmutableStorage )
+{
+  _immutable_storage = iImmutableStorage;
+
+  _memory           = 0.0;
+  _unaliased_memory = 0.0;
+  _peak_memory      = 0.0;
+  _compile_count    = 0;
+}
+
+void RenderGraph::Clear()
+{
+  // Pooled textures stay, the next compile takes them back when the descriptions still match
+  _targets.clear();
+  _passes.clear();
+}
+
+int RenderGraph::CreateTarget( std::string      iName,
+                               RenderTargetDesc iDesc )
+{
+  RenderTarget target;
+  target._name       = iName;
+  target._desc       = iDesc;
+  target._first_pass = -1;
+  target._last_pass  = -1;
+  target._pooled     = -1;
+
+  _targets.push_back( target );
+
+  return _targets.size() - 1;
+}
+
+void RenderGraph::AddPass( std::string        iName,
+                           std::vector< int > iInputs,
+                           std::vector< int > iOutputs )
+{
+  RenderPass pass;
+  pass._name    = iName;
+  pass._inputs  = iInputs;
+  pass._outputs = iOutputs;
+
+  _passes.push_back( pass );
+}
+
+void RenderGraph::Compile()
+{
+  // Targets lifetimes, from the first pass using them to the last one, in declaration order
+  // ---------------------------------------------------------------------------------------
+  for( unsigned int target_it = 0; target_it < _targets.size(); target_it++ )
+  {
+    _targets[ target_it ]._first_pass = -1;
+    _targets[ target_it ]._last_pass  = -1;
+    _targets[ target_it ]._pooled     = -1;
+  }
+
+  for( unsigned int pass_it = 0; pass_it < _passes.size(); pass_it++ )
+  {
+    std::vector< int > used( _passes[ pass_it ]._inputs );
+    used.insert( used.end(), _passes[ pass_it ]._outputs.begin(), _passes[ pass_it ]._outputs.end() );
+
+    for( unsigned int used_it = 0; used_it < used.size(); used_it++ )
+    {
+      RenderTarget * target = &_targets[ used[ used_it ] ];
+      target->_first_pass = ( target->_first_pass < 0 ) ? pass_it : target->_first_pass;
+      target->_last_pass  = pass_it;
+    }
+  }
+
+
+  // Targets placed in first use order, each one on a matching texture no longer in use
+  // -----------------------------------------------------------------------------------
+  for( unsigned int pool_it = 0; pool_it < _pool.size(); pool_it++ )
+  {
+    _pool[ pool_it ]._busy_until = -1;
+    _pool[ pool_it ]._used       = false;
+  }
+
+  _unaliased_memory = 0.0;
+  for( unsigned int pass_it = 0; pass_it < _passes.size(); pass_it++ )
+  {
+    for( unsigned int target_it = 0; target_it < _targets.size(); target_it++ )
+    {
+      RenderTarget * target = &_targets[ target_it ];
+      if( target->_first_pass != ( int )pass_it )
+      {
+        continue;
+      }
+
+      // Strictly before, a pass reading a target never writes the one aliased over it
+      for( unsigned int pool_it = 0; pool_it < _pool.size(); pool_it++ )
+      {
+        if( _pool[ pool_it ]._busy_until < ( int )pass_it && SameDesc( _pool[ pool_it ]._desc, target->_desc ) )
+        {
+          target->_pooled = pool_it;
+          break;
+        }
+      }
+
+      if( target->_pooled < 0 )
+      {
+        PooledTexture pooled;
+        pooled._desc = target->_desc;
+        pooled._id   = CreateTexture( target->_desc );
+        _pool.push_back( pooled );
+        target->_pooled = _pool.size() - 1;
+      }
+
+      _pool[ target->_pooled ]._busy_until = target->_last_pass;
+      _pool[ target->_pooled ]._used       = true;
+      _unaliased_memory += TargetBytes( target->_desc );
+    }
+  }
+
+
+  // Textures left out belong to an older size or to disabled passes
+  // ---------------------------------------------------------------
+  std::vector< PooledTexture > pool;
+  std::vector< int >           pool_remap( _pool.size(), -1 );
+  _memory = 0.0;
+
+  for( unsigned int pool_it = 0; pool_it < _pool.size(); pool_it++ )
+  {
+    if( !_pool[ pool_it ]._used )
+    {
+      StateCache::DeleteTextures( 1, &_pool[ pool_it ]._id );
+      continue;
+    }
+
+    pool_remap[ pool_it ] = pool.size();
+    pool.push_back( _pool[ pool_it ] );
+    _memory += TargetBytes( _pool[ pool_it ]._desc );
+  }
+  _pool = pool;
+
+  for( unsigned int target_it = 0; target_it < _targets.size(); target_it++ )
+  {
+    if( _targets[ target_it ]._pooled >= 0 )
+    {
+      _targets[ target_it ]._pooled = pool_remap[ _targets[ target_it ]._pooled ];
+    }
+  }
+
+  _peak_memory = ( _memory > _peak_memory ) ? _memory : _peak_memory;
+  _compile_count++;
+}
+
+unsigned int RenderGraph::Texture( int iTarget )
+{
+  // Targets no pass uses get no texture
+  if( iTarget < 0 || _targets[ iTarget ]._pooled < 0 )
+  {
+    return 0;
+  }
+
+  return _pool[ _targets[ iTarget ]._pooled ]._id;
+}
+
+void RenderGraph::PrintTargets()
+{
+  for( unsigned int pass_it = 0; pass_it < _passes.size(); pass_it++ )
+  {
+    fprintf( stderr, "%s%s", ( pass_it == 0 ) ? "Passes : " : " -> ", _passes[ pass_it ]._name.c_str() );
+  }
+  fprintf( stderr, "\n" );
+
+  for( unsigned int target_it = 0; target_it < _targets.size(); target_it++ )
+  {
+    RenderTarget * target = &_targets[ target_it ];
+    if( target->_pooled < 0 )
+    {
+      continue;
+    }
+
+    fprintf( stderr, "%-22s %5ux%-5u x%u %6.1f MB, passes %d to %d, texture %u\n",
+             target->_name.c_str(),
+             target->_desc._width,
+             target->_desc._height,
+             ( target->_desc._samples > 0 ) ? target->_desc._samples : 1,
+             TargetBytes( target->_desc ) / ( 1024.0 * 1024.0 ),
+             target->_first_pass,
+             target->_last_pass,
+             _pool[ target->_pooled ]._id );
+  }
+}
+
+void RenderGraph::Release()
+{
+  for( unsigned int pool_it = 0; pool_it < _pool.size(); pool_it++ )
+  {
+    StateCache::DeleteTextures( 1, &_pool[ pool_it ]._id );
+  }
+
+  _pool.clear();
+  Clear();
+  _memory = 0.0;
+}
+
+RenderTargetDesc RenderGraph::TargetDesc( GLenum       iInternalFormat,
+                                         unsigned int iWidth,
+                                         unsigned int iHeight,
+                                         unsigned int iSamples,
+                                         GLenum       iFilter )
+{
+  RenderTargetDesc desc;
+  desc._internal_format = iInternalFormat;
+  desc._width           = iWidth;
+  desc._height          = iHeight;
+  desc._samples         = iSamples;
+  desc._filter          = iFilter;
+
+  return desc;
+}
+
+double RenderGraph::TargetBytes( RenderTargetDesc iDesc )
+{
+  // RGB16F padded to 8 bytes like the drivers store it, every other used format fits 4 bytes
+  double texel_bytes = 4.0;
+  if( iDesc._internal_format == GL_RGB16F || iDesc._internal_format == GL_RGBA16F )
+  {
+    texel_bytes = 8.0;
+  }
+
+  return texel_bytes * iDesc._width * iDesc._height * ( ( iDesc._samples > 0 ) ? iDesc._samples : 1 );
+}
+
+bool RenderGraph::SameDesc( RenderTargetDesc iA,
+                            RenderTargetDesc iB )
+{
+  return iA._internal_format == iB._internal_format &&
+         iA._width           == iB._width           &&
+         iA._height          == iB._height          &&
+         iA._samples         == iB._samples         &&
+         iA._filter          == iB._filter;
+}
+
+unsigned int RenderGraph::CreateTexture( RenderTargetDesc iDesc )
+{
+  unsigned int result_id;
+  GLenum       target = ( iDesc._samples > 0 ) ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+
+  // Never re-specified, a new size means new textures
+  if( _immutable_storage )
+  {
+    glCreateTextures( target, 1, &result_id );
+    if( iDesc._samples > 0 )
+    {
+      glTextureStorage2DMultisample( result_id, iDesc._samples, iDesc._internal_format, iDesc._width, iDesc._height, GL_TRUE );
+      return result_id;
+    }
+
+    glTextureStorage2D( result_id, 1, iDesc._internal_format, iDesc._width, iDesc._height );
+    glTextureParameteri( result_id, GL_TEXTURE_MIN_FILTER, iDesc._filter );
+    glTextureParameteri( result_id, GL_TEXTURE_MAG_FILTER, iDesc._filter );
+    glTextureParameteri( result_id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+    glTextureParameteri( result_id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+    return result_id;
+  }
+
+  glGenTextures( 1, &result_id );
+  StateCache::BindTexture( target, result_id );
+
+  if( iDesc._samples > 0 )
+  {
+    glTexImage2DMultisample( target, iDesc._samples, iDesc._internal_format, iDesc._width, iDesc._height, GL_TRUE );
+  }
+  else
+  {
+    // Nothing uploaded, any color transfer format fits the color internal formats
+    GLenum format = GL_RGBA;
+    GLenum type   = GL_FLOAT;
+    if( iDesc._internal_format == GL_DEPTH_COMPONENT24 )
+    {
+      format = GL_DEPTH_COMPONENT;
+      type   = GL_UNSIGNED_INT;
+    }
+    if( iDesc._internal_format == GL_DEPTH24_STENCIL8 )
+    {
+      format = GL_DEPTH_STENCIL;
+      type   = GL_UNSIGNED_INT_24_8;
+    }
+
+    glTexImage2D( target, 0, iDesc._internal_format, iDesc._width, iDesc._height, 0, format, type, NULL );
+    glTexParameteri( target, GL_TEXTURE_MIN_FILTER, iDesc._filter );
+    glTexParameteri( target, GL_TEXTURE_MAG_FILTER, iDesc._filter );
+    glTexParameteri( target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+    glTexParameteri( target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+  }
+
+  StateCache::BindTexture( target, 0 );
+
+  return result_id;
+}
@@ -0,0 +1,150 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include "state_cache.hpp"
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+//******************************************************************************
+//**********  Class RenderTargetDesc  ******************************************
+//******************************************************************************
+
+// Transient targets with equal descriptions can share one pooled texture
+class RenderTargetDesc
+{
+  public:
+
+    GLenum       _internal_format;
+    unsigned int _width;
+    unsigned int _height;
+    unsigned int _samples;  // 0 => GL_TEXTURE_2D, else GL_TEXTURE_2D_MULTISAMPLE
+    GLenum       _filter;
+};
+
+
+//******************************************************************************
+//**********  Class RenderTarget  **********************************************
+//******************************************************************************
+
+class RenderTarget
+{
+  public:
+
+    std::string      _name;
+    RenderTargetDesc _desc;
+
+    // Passes range using it, -1 while no pass does
+    int              _first_pass;
+    int              _last_pass;
+
+    // Pool entry backing it once compiled
+    int              _pooled;
+};
+
+
+//******************************************************************************
+//**********  Class RenderPass  ************************************************
+//******************************************************************************
+
+class RenderPass
+{
+  public:
+
+    std::string        _name;
+    std::vector< int > _inputs;
+    std::vector< int > _outputs;
+};
+
+
+//******************************************************************************
+//**********  Class PooledTexture  *********************************************
+//******************************************************************************
+
+class PooledTexture
+{
+  public:
+
+    RenderTargetDesc _desc;
+    unsigned int     _id;
+
+    // Last pass of the target currently aliased on it, -1 while free for the whole frame
+    int              _busy_until;
+    bool             _used;
+};
+
+
+//******************************************************************************
+//**********  Class RenderGraph  ***********************************************
+//******************************************************************************
+
+// Frame passes with the transient targets they read and write. Compiling assigns pooled
+// textures to the targets, one texture serves several targets whose lifetimes don't overlap.
+class RenderGraph
+{
+
+  public:
+
+
+    // RenderGraph functions
+    // ---------------------
+
+    RenderGraph( bool iImmutableStorage );
+
+    void Clear();
+
+    int CreateTarget( std::string      iName,
+                      RenderTargetDesc iDesc );
+
+    void AddPass( std::string        iName,
+                  std::vector< int > iInputs,
+                  std::vector< int > iOutputs );
+
+    void Compile();
+
+    unsigned int Texture( int iTarget );
+
+    void PrintTargets();
+
+    void Release();
+
+    static RenderTargetDesc TargetDesc( GLenum       iInternalFormat,
+                                        unsigned int iWidth,
+                                        unsigned int iHeight,
+                                        unsigned int iSamples,
+                                        GLenum       iFilter );
+
+    static double TargetBytes( RenderTargetDesc iDesc );
+
+
+    // RenderGraph class members
+    // -------------------------
+
+    // Pooled textures bytes against one texture per target, largest pool since launch
+    double       _memory;
+    double       _unaliased_memory;
+    double       _peak_memory;
+    unsigned int _compile_count;
+
+
+  private:
+
+    static bool SameDesc( RenderTargetDesc iA,
+                          RenderTargetDesc iB );
+
+    unsigned int CreateTexture( RenderTargetDesc iDesc );
+
+    bool                         _immutable_storage;
+    std::vector< RenderTarget >  _targets;
+    std::vector< RenderPass >    _passes;
+    std::vector< PooledTexture > _pool;
+
+};
+
+#endif  // RENDER_GRAPH_H
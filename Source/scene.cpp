@@ -15,6 +15,9 @@ Scene::Scene( Window * iParentWindow )
   _pipeline_type = FORWARD_RENDERING;
   //_pipeline_type = DEFERRED_RENDERING;
 
+  // G-buffer FBO created when deferred is first used, its textures come from the frame graph
+  _g_buffer_FBO = 0;
+
 
   // Scene effects settings
   // ----------------------
@@ -30,9 +33,50 @@ Scene::Scene( Window * iParentWindow )
 
   // Init bloom parameters
   _bloom              = true;
-  _blur_downsample    = 1.0;
-  _blur_pass_count    = 6;
-  _blur_offset_factor = 1.8;
+  _bloom_threshold    = 0.4;
+  _bloom_knee         = 0.2;
+  _bloom_radius       = 1.0;
+
+  // Init post process parameters
+  _compute_post_process      = false;
+  _post_process_query_it     = 0;
+  _post_process_time         = 0.0;
+  _post_process_time_samples = 0;
+  _post_process_targets_width  = 0;
+  _post_process_targets_height = 0;
+
+  // Init frame graph, built before the first frame
+  _frame_graph_features = 0;
+  _frame_graph_width    = 0;
+  _frame_graph_height   = 0;
+
+  // Init dynamic resolution parameters, render size set once the window is known
+  _dynamic_resolution     = false;
+  _frame_upscaled         = false;
+  _render_scale           = 1.0;
+  _frame_time_budget      = DYNAMIC_RESOLUTION_DEFAULT_BUDGET;
+  _frame_time_smoothed    = 0.0;
+  _frame_time_query_it    = 0;
+  _frame_time_sum         = 0.0;
+  _frame_time_squared_sum = 0.0;
+  _frame_time_max         = 0.0;
+  _frame_time_samples     = 0;
+  _frame_time_over_budget = 0;
+  _render_scale_sum       = 0.0;
+
+  // Init temporal anti-aliasing parameters, only used without multi sampling
+  _taa                                 = false;
+  _taa_jitter                          = glm::vec2( 0.0 );
+  _taa_frame                           = 0;
+  _taa_history_it                      = 0;
+  _taa_history_valid                   = false;
+  _taa_history_width                   = 0;
+  _taa_history_height                  = 0;
+  _taa_previous_view_projection_matrix = glm::mat4();
+  _motion_vectors_depth                = 0;
+  _taa_query_it                        = 0;
+  _taa_time                            = 0.0;
+  _taa_time_samples                    = 0;
 
   // Init multi sample parameters
   _multi_sample    = false;
@@ -53,13 +97,82 @@ Scene::Scene( Window * iParentWindow )
 
   // Init tessellation parameters
   _tess_patch_vertices_count = 3;
+  _tess_max_level            = 64;
+  _tessellation_mode         = TESSELLATION_SCREEN_SPACE_CULLED;
+  _tessellation_edge_pixels  = TESSELLATION_EDGE_PIXELS;
+  _shader_permutations       = true;
 
   // Init omnidirectional shadow mapping parameters
-  _depth_cubemap_res = 2048;
+  _shadow_atlas_res[ 0 ]    = 2048;
+  _shadow_atlas_res[ 1 ]    = 1024;
+  _shadow_atlas_res[ 2 ]    = 512;
+  _shadow_atlas_res[ 3 ]    = 256;
+  _shadow_atlas_layers[ 0 ] = 1;
+  _shadow_atlas_layers[ 1 ] = 2;
+  _shadow_atlas_layers[ 2 ] = 3;
+  _shadow_atlas_layers[ 3 ] = 4;
+  _shadow_face_budget       = 12;
+  _shadow_triangle_count    = 0;
+  _shadow_face_update_count = 0;
+  _shadow_slot_assign_count = 0;
+
+  // No main shadow light until an atlas slot is ready
+  _current_shadow_light_source = -1;
+
+  // Init demo camera path PVS parameters
+  _demo_PVS_object_count = 0;
+  _demo_PVS_samples      = 48;
+  _demo_PVS_res          = 256;
+  _demo_PVS_culling      = true;
 
   // Lights volume
   _render_lights_volume = false;
 
+  // Init deferred lighting parameters, tiled compute path when the context allows it
+  _tiled_deferred_lighting = true;
+  _deferred_query_it       = 0;
+  _deferred_pass_time      = 0.0;
+  _geometry_pass_time      = 0.0;
+  _deferred_pass_samples   = 0;
+
+  // Init pipelines benchmark parameters
+  _pipeline_benchmark       = false;
+  _pipeline_benchmark_step  = 0;
+  _pipeline_benchmark_frame = 0;
+  _pipeline_benchmark_time  = 0.0;
+
+  // Init shadow filtering parameters
+  _shadow_filter_mode              = SHADOW_FILTER_PCF;
+  _shadow_compare_sampler          = 0;
+  _shadow_moments_memory           = 0.0;
+  _shadow_filter_benchmark         = false;
+  _shadow_filter_benchmark_step    = 0;
+  _shadow_filter_benchmark_frame   = 0;
+  _shadow_filter_benchmark_time    = 0.0;
+  _shadow_filter_benchmark_samples = 0.0;
+
+  // Init clustered forward lighting parameters
+  _clustered_lighting        = true;
+  _many_lights_count         = 256;
+  _many_lights_benchmark     = false;
+  _forward_query_it          = 0;
+  _forward_pass_time         = 0.0;
+  _forward_pass_time_samples = 0;
+  _object_lights_list_count  = 0;
+
+  // Init depth pre-pass parameters
+  _depth_prepass         = false;
+  _depth_prepass_shading = false;
+  for( unsigned int mode_it = 0; mode_it < 2; mode_it++ )
+  {
+    _forward_samples_prepass[ mode_it ] = false;
+    _forward_shaded_samples[ mode_it ]  = 0.0;
+    _forward_shaded_frames[ mode_it ]   = 0;
+    _forward_shaded_average[ mode_it ]  = 0.0;
+  }
+  _object_lights_listed      = 0;
+  _object_lights_reaching    = 0;
+
   // Revolving door
   _door_angle          = 0.0;
   _revolving_door_open = false;
@@ -111,20 +224,42 @@ Scene::Scene( Window * iParentWindow )
 
    // Create lights
   LightsInitialization();
+  _base_light_count = _lights.size();
+
+  // Create the lights grid and its texture buffer
+  _light_grid = new LightGrid();
+  glGenQueries( 2, _forward_time_queries );
+  glGenQueries( 2, _forward_samples_queries );
+  glGenQueries( 2, _post_process_time_queries );
+  glGenQueries( 2, _frame_time_queries[ 0 ] );
+  glGenQueries( 2, _frame_time_queries[ 1 ] );
+  glGenQueries( 2, _taa_time_queries );
 
   // Load all scene models
   ModelsLoading(); 
 
+  // Build the rooms props draw lists
+  PropsListsInitialization();
+
   // Init scene data 
   SceneDataInitialization();
 
+  // Bake the height mapped planes LODs, captured by the IBL probes
+  DisplacementLODsInitialization();
+
+  // Fill the lights buffer read by the environment captures
+  LightGridUpdate( false );
+
   // Init all IBL texture
   IBLInitialization();
 
   // Init tesselation parameters
   TesselationInitialization();
 
-  // Init deferred rendering g-buffer
+  // Load or bake the demo camera path PVS
+  DemoPVSInitialization();
+
+  // Init deferred rendering g-buffer, its programs were built with the others
   if( _pipeline_type == DEFERRED_RENDERING )
   {
     DeferredBuffersInitialization();
@@ -136,44 +271,65 @@ void Scene::Quit()
 
   // Delete textures
   // ---------------
-  if( _window->_toolbox->_pingpong_color_buffers[ 0 ] )
-    glDeleteTextures( 1, &_window->_toolbox->_pingpong_color_buffers[ 0 ] );
-  if( _window->_toolbox->_pingpong_color_buffers[ 1 ] )
-    glDeleteTextures( 1, &_window->_toolbox->_pingpong_color_buffers[ 1 ] );
-  if( _window->_toolbox->_temp_tex_color_buffer[ 0 ] )
-    glDeleteTextures( 1, &_window->_toolbox->_temp_tex_color_buffer[ 0 ] );
-  if( _window->_toolbox->_temp_tex_color_buffer[ 1 ] )
-    glDeleteTextures( 1, &_window->_toolbox->_temp_tex_color_buffer[ 1 ] );
-  if( _window->_toolbox->_final_tex_color_buffer[ 0 ] )
-    glDeleteTextures( 1, &_window->_toolbox->_final_tex_color_buffer[ 0 ] );
-  if( _window->_toolbox->_final_tex_color_buffer[ 1 ] )
-    glDeleteTextures( 1, &_window->_toolbox->_final_tex_color_buffer[ 1 ] );
+  // Window sized targets belong to the frame graph pool, released with the toolbox
+  if( _window->_toolbox->_taa_history[ 0 ] )
+    StateCache::DeleteTextures( 2, _window->_toolbox->_taa_history );
 
 
   // Delete VAOs
   // -----------
   if( _ground1_VAO )
-    glDeleteVertexArrays( 1, &_ground1_VAO );
+    StateCache::DeleteVertexArrays( 1, &_ground1_VAO );
+  if( _plane_depth_VAO )
+    StateCache::DeleteVertexArrays( 1, &_plane_depth_VAO );
   
 
   // Delete VBOs
   // -----------
   if( _ground1_VBO )
     glDeleteBuffers( 1, &_ground1_VBO );
+  if( _plane_depth_VBO )
+    glDeleteBuffers( 1, &_plane_depth_VBO );
+
+
+  // Delete shader permutations
+  // --------------------------
+  _forward_pbr_shader.DeletePermutations();
+  _forward_displacement_pbr_shader.DeletePermutations();
+
+
+  // Delete pre-displaced planes LODs
+  // --------------------------------
+  std::vector< Object > * planes[ 2 ] = { &_grounds_type1, &_walls_type1 };
+  for( unsigned int planes_it = 0; planes_it < 2; planes_it++ )
+  {
+    for( unsigned int plane_it = 0; plane_it < planes[ planes_it ]->size(); plane_it++ )
+    {
+      Object * plane = &( *planes[ planes_it ] )[ plane_it ];
+      if( !plane->_displacement_lods_VAO.empty() )
+      {
+        StateCache::DeleteVertexArrays( plane->_displacement_lods_VAO.size(), plane->_displacement_lods_VAO.data() );
+        glDeleteBuffers( plane->_displacement_lods_VBO.size(), plane->_displacement_lods_VBO.data() );
+        glDeleteBuffers( plane->_displacement_lods_IBO.size(), plane->_displacement_lods_IBO.data() );
+      }
+    }
+  }
 
 
   // Delete FBOs
   // -----------
   if( _window->_toolbox->_temp_hdr_FBO )
-    glDeleteFramebuffers( 1, &_window->_toolbox->_temp_hdr_FBO );
-  if( _window->_toolbox->_final_hdr_FBO )
-    glDeleteFramebuffers( 1, &_window->_toolbox->_final_hdr_FBO );
-  
+    StateCache::DeleteFramebuffers( 1, &_window->_toolbox->_temp_hdr_FBO );
+  if( _g_buffer_FBO )
+    StateCache::DeleteFramebuffers( 1, &_g_buffer_FBO );
 
-  // Delete RBOs
-  // -----------
-  if( _window->_toolbox->_temp_depth_RBO )
-    glDeleteRenderbuffers( 1, &_window->_toolbox->_temp_depth_RBO );
+
+  if( _dynamic_resolution_log.is_open() )
+    _dynamic_resolution_log.close();
+
+  // Joins the light grid slices workers
+  delete _light_grid;
+  _light_grid = NULL;
 }
 
 void Scene::SceneDataInitialization()
@@ -204,13 +360,15 @@ void Scene::SceneDataInitialization()
   };
 
 
-  // Create ground type 1 VAO
-  // ------------------------
+  // Create ground type 1 VAO, and the position only VAO shared by every plane
+  // ------------------------------------------------------------------------
   _window->_toolbox->CreatePlaneVAO( &_ground1_VAO,
                                      &_ground1_VBO,
                                      &_ground1_IBO,
+                                     &_plane_depth_VAO,
+                                     &_plane_depth_VBO,
                                      &_ground1_indices,
-                                     40,
+                                     PLANE_SIDE_VERTICES,
                                      _grounds_type1[ 0 ]._uv_scale.x );
 
 
@@ -219,8 +377,10 @@ void Scene::SceneDataInitialization()
   _window->_toolbox->CreatePlaneVAO( &_ground2_VAO,
                                      &_ground2_VBO,
                                      &_ground2_IBO,
+                                     NULL,
+                                     NULL,
                                      &_ground2_indices,
-                                     40,
+                                     PLANE_SIDE_VERTICES,
                                      3.0 );
 
 
@@ -229,8 +389,10 @@ void Scene::SceneDataInitialization()
   _window->_toolbox->CreatePlaneVAO( &_wall1_VAO,
                                      &_wall1_VBO,
                                      &_wall1_IBO,
+                                     NULL,
+                                     NULL,
                                      &_wall1_indices,
-                                     40,
+                                     PLANE_SIDE_VERTICES,
                                      _walls_type1[ 0 ]._uv_scale.x );
 
 
@@ -239,142 +401,22 @@ void Scene::SceneDataInitialization()
   _window->_toolbox->CreatePlaneVAO( &_wall2_VAO,
                                      &_wall2_VBO,
                                      &_wall2_IBO,
+                                     NULL,
+                                     NULL,
                                      &_wall2_indices,
-                                     40,
+                                     PLANE_SIDE_VERTICES,
                                      _walls_type1[ 0 ]._uv_scale.x * 1.5 );
 
 
-  // Create temp color buffer
-  // ------------------------
-  if( _pipeline_type == FORWARD_RENDERING )
-  {
-    glGenFramebuffers( 1, &_window->_toolbox->_temp_hdr_FBO );
-    glBindFramebuffer( GL_FRAMEBUFFER, _window->_toolbox->_temp_hdr_FBO );
-    glGenTextures( 2, _window->_toolbox->_temp_tex_color_buffer );
-
-    if( _multi_sample )
-    { 
-      // Multi sample textures setting
-      for( unsigned int i = 0; i < 2; i++ ) 
-      {
-        _window->_toolbox->SetFboMultiSampleTexture( _window->_toolbox->_temp_tex_color_buffer[ i ],
-                                                     _nb_multi_sample,
-                                                     GL_RGB16F,
-                                                     _window->_width,
-                                                     _window->_height,
-                                                     GL_COLOR_ATTACHMENT0 + i );
-      }
-      unsigned int attachments2[ 2 ] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-      glDrawBuffers( 2, attachments2 );
-
-      // Multi sample RBO link
-      _window->_toolbox->LinkMultiSampleRbo( _window->_toolbox->_temp_depth_RBO,
-                                             _nb_multi_sample, 
-                                             _window->_width,
-                                             _window->_height );
-    }
-    else
-    { 
-      // Textures setting
-      for( unsigned int i = 0; i < 2; i++ ) 
-      {
-        _window->_toolbox->SetFboTexture( _window->_toolbox->_temp_tex_color_buffer[ i ],
-                                          GL_RGB16F,
-                                          _window->_width,
-                                          _window->_height,
-                                          GL_COLOR_ATTACHMENT0 + i );
-      }
-      unsigned int attachments2[ 2 ] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-      glDrawBuffers( 2, attachments2 );
-      
-      // RBO link
-      _window->_toolbox->LinkRbo( _window->_toolbox->_temp_depth_RBO,
-                                  _window->_width,
-                                  _window->_height );
-    }
-    if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
-    {
-      std::cout << "Framebuffer not complete!" << std::endl;
-    }
-    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
-
-
-    // Create final color buffer
-    // -------------------------
-    glGenFramebuffers( 1, &_window->_toolbox->_final_hdr_FBO );
-    glBindFramebuffer( GL_FRAMEBUFFER, _window->_toolbox->_final_hdr_FBO );
-    glGenTextures( 2, _window->_toolbox->_final_tex_color_buffer );
-
-    for( unsigned int i = 0; i < 2; i++ ) 
-    {
-      _window->_toolbox->SetFboTexture( _window->_toolbox->_final_tex_color_buffer[ i ],
-                                        GL_RGB16F,
-                                        _window->_width,
-                                        _window->_height,
-                                        GL_COLOR_ATTACHMENT0 + i );
-    }
-
-    if( glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE )
-    {
-      std::cout << "Framebuffer not complete!" << std::endl;
-    }
-    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
-    glBindTexture( GL_TEXTURE_2D, 0 );
-  }
-
-  
-  // Create pingpong buffer and textures
-  // -----------------------------------
-  glGenFramebuffers( 1, &_window->_toolbox->_pingpong_FBO );
-  glBindFramebuffer( GL_FRAMEBUFFER, _window->_toolbox->_pingpong_FBO );
-  glGenTextures( 2, _window->_toolbox->_pingpong_color_buffers );
-  for( unsigned int i = 0; i < 2; i++ )
-  {
-    _window->_toolbox->SetFboTexture( _window->_toolbox->_pingpong_color_buffers[ i ],
-                                      GL_RGB16F,
-                                      _window->_width * _blur_downsample,
-                                      _window->_height * _blur_downsample,
-                                      GL_COLOR_ATTACHMENT0 + i );
-  }
-  if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
-  {
-    std::cout << "Framebuffer not complete!" << std::endl;
-  }
-  glBindFramebuffer( GL_FRAMEBUFFER, 0 );
-  glBindTexture( GL_TEXTURE_2D, 0 );
-
+  // Temporal anti-aliasing history, the window sized frame targets come from the frame graph
+  // -----------------------------------------------------------------------------------------
+  PostProcessTargetsUpdate();
+  DynamicResolutionScaleSet( _render_scale );
 
-  // Create depth cube map texture & FBO
-  // -----------------------------------
-  glGenFramebuffers( 1, &_window->_toolbox->_depth_map_FBO );
 
-  glGenTextures( 1, &_window->_toolbox->_depth_cubemap );
-  glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
-  for( unsigned int i = 0; i < 6; i++ )
-  {
-    glTexImage2D( GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                  0,
-                  GL_DEPTH_COMPONENT,
-                  _depth_cubemap_res,
-                  _depth_cubemap_res,
-                  0,
-                  GL_DEPTH_COMPONENT,
-                  GL_FLOAT,
-                  NULL );
-  }
-  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE );
-  
-  // Attach depth texture as FBO's depth buffer
-  glBindFramebuffer( GL_FRAMEBUFFER, _window->_toolbox->_depth_map_FBO );
-  glFramebufferTexture( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, _window->_toolbox->_depth_cubemap, 0 );
-  glDrawBuffer( GL_NONE );
-  glReadBuffer( GL_NONE );
-  glBindFramebuffer( GL_FRAMEBUFFER, 0 );
-  glBindTexture( GL_TEXTURE_2D, 0 );
+  // Create shadow atlas cube map arrays & FBOs
+  // -------------------------------------------
+  ShadowAtlasInitialization();
 
 
   // Load entrance floor material textures
@@ -529,9 +571,12 @@ void Scene::LightsInitialization()
                                  0.1,
                                  3.0 ) );
 
+  // Ranges follow the final intensities, radiance is windowed to zero there
+  PointLight::SetLightsCutoff( 0.5 );
   for( unsigned int i = 0; i < _lights.size(); i++ )
   {
     _lights[ i ]._intensity *= PointLight::GetLightsMultiplier();
+    _lights[ i ].UpdateBoundingSphereScale();
   }
 
   // room1 lights
@@ -607,8 +652,6 @@ void Scene::ObjectsInitialization()
                         true,           // receiv shadow
                         1.0,            // shadow darkness
                         0.035,          // shadow bias
-                        false,          // bloom
-                        0.4,            // bloom bright value
                         false,          // opacity map
                         true,           // normal map
                         false,          // height map
@@ -689,8 +732,6 @@ void Scene::ObjectsInitialization()
                         true,
                         0.5,
                         0.035,
-                        true,
-                        0.4,
                         false,
                         true,
                         true,
@@ -771,8 +812,6 @@ void Scene::ObjectsInitialization()
                         true,
                         1.0,
                         0.035,
-                        true,
-                        0.4,
                         false,
                         true,
                         tessellation,
@@ -840,8 +879,6 @@ void Scene::ObjectsInitialization()
                         true,
                         1.0,
                         0.035,
-                        true,
-                        0.4,
                         false,
                         true,
                         true,
@@ -905,8 +942,6 @@ void Scene::ObjectsInitialization()
                                        1.0,
                                        0.015,
                                        true,
-                                       0.70,
-                                       true,
                                        true,
                                        false,
                                        0.0,
@@ -945,8 +980,6 @@ void Scene::ObjectsInitialization()
                         true,
                         1.0,
                         0.035,
-                        true,
-                        0.4,
                         false,
                         true,
                         true,
@@ -989,8 +1022,6 @@ void Scene::ObjectsInitialization()
                         true,
                         1.0,
                         0.035,
-                        true,
-                        0.4,
                         false,
                         true,
                         true,
@@ -1047,8 +1078,6 @@ void Scene::ObjectsInitialization()
                         true,
                         1.0,
                         0.035,
-                        true,
-                        0.4,
                         false,
                         true,
                         false,
@@ -1088,8 +1117,6 @@ void Scene::ObjectsInitialization()
                       true,           // receiv shadow
                       1.0,            // shadow darkness
                       0.035,          // shadow bias
-                      true,          // bloom
-                      0.4,           // bloom bright value
                       false,          // opacity map
                       true,           // normal map
                       false,          // height map
@@ -1129,8 +1156,6 @@ void Scene::ObjectsInitialization()
                         true,           // receiv shadow
                         1.0,            // shadow darkness
                         0.035,          // shadow bias
-                        false,          // bloom
-                        0.4,           // bloom bright value
                         false,          // opacity map
                         true,           // normal map
                         false,          // height map
@@ -1215,8 +1240,6 @@ void Scene::ObjectsInitialization()
                         true,
                         1.0,
                         0.035,
-                        true,
-                        0.4,
                         false,
                         true,
                         false,
@@ -1263,8 +1286,6 @@ void Scene::ObjectsInitialization()
                         1.0,
                         0.035,
                         false,
-                        0.4,
-                        false,
                         true,
                         false,
                         0.06,
@@ -1307,8 +1328,6 @@ void Scene::ObjectsInitialization()
                         true,
                         1.0,
                         0.035,
-                        true,
-                        0.4,
                         false,
                         true,
                         false,
@@ -1368,8 +1387,6 @@ void Scene::ObjectsInitialization()
                         true,
                         1.0,
                         0.035,
-                        true,
-                        0.4,
                         false,
                         true,
                         false,
@@ -1411,8 +1428,6 @@ void Scene::ObjectsInitialization()
                         true,           // receiv shadow
                         1.0,            // shadow darkness
                         0.035,          // shadow bias
-                        true,          // bloom
-                        0.4,           // bloom bright value
                         false,          // opacity map
                         true,           // normal map
                         true,           // height map
@@ -1453,8 +1468,6 @@ void Scene::ObjectsInitialization()
                         true,           // receiv shadow
                         1.0,            // shadow darkness
                         0.035,          // shadow bias
-                        false,          // bloom
-                        0.4,           // bloom bright value
                         false,          // opacity map
                         true,           // normal map
                         false,          // height map
@@ -1538,8 +1551,6 @@ void Scene::ObjectsInitialization()
                         true,
                         1.0,
                         0.035,
-                        true,
-                        0.4,
                         false,
                         true,
                         false,
@@ -1597,8 +1608,6 @@ void Scene::ObjectsInitialization()
                             true,           // receiv shadow
                             1.0,            // shadow darkness
                             0.035,          // shadow bias
-                            true,          // bloom
-                            0.4,           // bloom bright value
                             false,          // opacity map
                             true,           // normal map
                             false,          // height map
@@ -1671,8 +1680,6 @@ void Scene::ObjectsInitialization()
                                   true,          // receiv shadow
                                   1.0,            // shadow darkness
                                   0.035,          // shadow bias
-                                  true,          // bloom
-                                  0.4,           // bloom bright value
                                   false,          // opacity map
                                   true,           // normal map
                                   false,          // height map
@@ -1728,8 +1735,6 @@ void Scene::ObjectsInitialization()
                                    false,          // receiv shadow
                                    1.0,            // shadow darkness
                                    0.035,          // shadow bias
-                                   true,          // bloom
-                                   0.4,           // bloom bright value
                                    false,          // opacity map
                                    true,           // normal map
                                    false,          // height map
@@ -1766,8 +1771,6 @@ void Scene::ObjectsInitialization()
                              true,           // receiv shadow
                              1.0,            // shadow darkness
                              0.035,          // shadow bias
-                             true,          // bloom
-                             0.4,           // bloom bright value
                              false,          // opacity map
                              true,           // normal map
                              false,          // height map
@@ -1804,8 +1807,6 @@ void Scene::ObjectsInitialization()
                        false,          // receiv shadow
                        1.0,            // shadow darkness
                        0.035,          // shadow bias
-                       true,          // bloom
-                       0.4,            // bloom bright value
                        false,          // opacity map
                        true,           // normal map
                        false,          // height map
@@ -1843,8 +1844,6 @@ void Scene::ObjectsInitialization()
                      false,          // receiv shadow
                      1.0,            // shadow darkness
                      0.035,          // shadow bias
-                     true,          // bloom
-                     0.4,            // bloom bright value
                      false,          // opacity map
                      true,           // normal map
                      false,          // height map
@@ -1881,8 +1880,6 @@ void Scene::ObjectsInitialization()
                         false,          // receiv shadow
                         1.0,            // shadow darkness
                         0.035,          // shadow bias
-                        true,          // bloom
-                        0.4,            // bloom bright value
                         false,          // opacity map
                         true,           // normal map
                         false,          // height map
@@ -1918,8 +1915,6 @@ void Scene::ObjectsInitialization()
                       false,          // receiv shadow
                       1.0,            // shadow darkness
                       0.035,          // shadow bias
-                      true,          // bloom
-                      0.4,            // bloom bright value
                       false,          // opacity map
                       true,           // normal map
                       false,          // height map
@@ -1955,8 +1950,6 @@ void Scene::ObjectsInitialization()
                      true,          // receiv shadow
                      1.0,            // shadow darkness
                      0.035,          // shadow bias
-                     true,          // bloom
-                     0.4,            // bloom bright value
                      false,          // opacity map
                      true,           // normal map
                      false,          // height map
@@ -1991,8 +1984,6 @@ void Scene::ObjectsInitialization()
                        false,          // receiv shadow
                        1.0,            // shadow darkness
                        0.035,          // shadow bias
-                       true,          // bloom
-                       0.7,            // bloom bright value
                        false,          // opacity map
                        true,           // normal map
                        false,          // height map
@@ -2027,8 +2018,6 @@ void Scene::ObjectsInitialization()
                              true,           // receiv shadow
                              1.0,            // shadow darkness
                              0.013,          // shadow bias
-                             true,          // bloom
-                             0.4,            // bloom bright value
                              false,          // opacity map
                              true,           // normal map
                              false,          // height map
@@ -2065,8 +2054,6 @@ void Scene::ObjectsInitialization()
                            true,
                            1.0,
                            0.035,
-                           false,
-                           0.4,
                            true,
                            true,
                            false,
@@ -2103,8 +2090,6 @@ void Scene::ObjectsInitialization()
                      true,          // receiv shadow
                      1.0,            // shadow darkness
                      0.035,          // shadow bias
-                     true,          // bloom
-                     0.4,            // bloom bright value
                      false,          // opacity map
                      true,           // normal map
                      false,          // height map
@@ -2140,8 +2125,6 @@ void Scene::ObjectsInitialization()
                       true,          // receiv shadow
                       1.0,            // shadow darkness
                       0.035,          // shadow bias
-                      true,          // bloom
-                      0.4,            // bloom bright value
                       false,          // opacity map
                       true,           // normal map
                       false,          // height map
@@ -2177,8 +2160,6 @@ void Scene::ObjectsInitialization()
                       false,          // receiv shadow
                       1.0,            // shadow darkness
                       0.035,          // shadow bias
-                      true,          // bloom
-                      0.4,            // bloom bright value
                       true,          // opacity map
                       true,           // normal map
                       false,          // height map
@@ -2215,8 +2196,6 @@ void Scene::ObjectsInitialization()
                      true,          // receiv shadow
                      1.0,            // shadow darkness
                      0.015,          // shadow bias
-                     false,          // bloom
-                     0.4,            // bloom bright value
                      true,          // opacity map
                      true,           // normal map
                      false,          // height map
@@ -2251,8 +2230,6 @@ void Scene::ObjectsInitialization()
                       true,          // receiv shadow
                       1.0,            // shadow darkness
                       0.015,          // shadow bias
-                      true,          // bloom
-                      0.4,            // bloom bright value
                       false,          // opacity map
                       true,           // normal map
                       false,          // height map
@@ -2288,8 +2265,6 @@ void Scene::ObjectsInitialization()
                         true,          // receiv shadow
                         1.0,            // shadow darkness
                         0.02,          // shadow bias
-                        true,          // bloom
-                        0.9,            // bloom bright value
                         false,          // opacity map
                         true,           // normal map
                         false,          // height map
@@ -2325,8 +2300,6 @@ void Scene::ObjectsInitialization()
                              true,           // receiv shadow
                              1.0,            // shadow darkness
                              0.015,          // shadow bias
-                             true,          // bloom
-                             0.4,            // bloom bright value
                              false,          // opacity map
                              true,           // normal map
                              false,          // height map
@@ -2362,8 +2335,6 @@ void Scene::ObjectsInitialization()
                      false,           // receiv shadow
                      1.0,            // shadow darkness
                      0.015,          // shadow bias
-                     true,          // bloom
-                     0.4,            // bloom bright value
                      false,          // opacity map
                      true,           // normal map
                      false,          // height map
@@ -2400,8 +2371,6 @@ void Scene::ObjectsInitialization()
                     true,           // receiv shadow
                     1.0,            // shadow darkness
                     0.015,          // shadow bias
-                    true,          // bloom
-                    0.4,            // bloom bright value
                     false,          // opacity map
                     true,           // normal map
                     false,          // height map
@@ -2436,8 +2405,6 @@ void Scene::ObjectsInitialization()
                      true,          // receiv shadow
                      1.0,            // shadow darkness
                      0.015,          // shadow bias
-                     true,          // bloom
-                     0.4,            // bloom bright value
                      false,          // opacity map
                      true,           // normal map
                      false,          // height map
@@ -2473,8 +2440,6 @@ void Scene::ObjectsInitialization()
                          true,          // receiv shadow
                          1.0,            // shadow darkness
                          0.007,          // shadow bias
-                         true,          // bloom
-                         0.4,            // bloom bright value
                          false,          // opacity map
                          true,           // normal map
                          false,          // height map
@@ -2511,8 +2476,6 @@ void Scene::ObjectsInitialization()
                      false,           // receiv shadow
                      1.0,            // shadow darkness
                      0.015,          // shadow bias
-                     true,          // bloom
-                     0.4,            // bloom bright value
                      false,          // opacity map
                      true,           // normal map
                      false,          // height map
@@ -2549,8 +2512,6 @@ void Scene::ObjectsInitialization()
                      false,          // receiv shadow
                      1.0,            // shadow darkness
                      0.015,          // shadow bias
-                     true,          // bloom
-                     0.4,            // bloom bright value
                      false,          // opacity map
                      true,           // normal map
                      false,          // height map
@@ -2586,8 +2547,6 @@ void Scene::ObjectsInitialization()
                      false,          // receiv shadow
                      1.0,            // shadow darkness
                      0.015,          // shadow bias
-                     true,          // bloom
-                     0.4,            // bloom bright value
                      false,          // opacity map
                      true,           // normal map
                      false,          // height map
@@ -2623,8 +2582,6 @@ void Scene::ObjectsInitialization()
                              true,          // receiv shadow
                              1.0,            // shadow darkness
                              0.015,          // shadow bias
-                             true,          // bloom
-                             0.4,            // bloom bright value
                              false,          // opacity map
                              true,           // normal map
                              false,          // height map
@@ -2660,8 +2617,6 @@ void Scene::ObjectsInitialization()
                              true,          // receiv shadow
                              1.0,            // shadow darkness
                              0.015,          // shadow bias
-                             true,          // bloom
-                             0.4,            // bloom bright value
                              false,          // opacity map
                              true,           // normal map
                              false,          // height map
@@ -2696,8 +2651,6 @@ void Scene::ObjectsInitialization()
                        false,          // receiv shadow
                        1.0,            // shadow darkness
                        0.015,          // shadow bias
-                       false,          // bloom
-                       0.4,            // bloom bright value
                        false,          // opacity map
                        true,           // normal map
                        false,          // height map
@@ -2733,8 +2686,6 @@ void Scene::ObjectsInitialization()
                       false,          // receiv shadow
                       1.0,            // shadow darkness
                       0.015,          // shadow bias
-                      true,          // bloom
-                      0.4,            // bloom bright value
                       false,          // opacity map
                       true,           // normal map
                       false,          // height map
@@ -2770,8 +2721,6 @@ void Scene::ObjectsInitialization()
                         false,          // receiv shadow
                         1.0,            // shadow darkness
                         0.015,          // shadow bias
-                        true,          // bloom
-                        0.4,            // bloom bright value
                         false,          // opacity map
                         true,           // normal map
                         false,          // height map
@@ -2807,8 +2756,6 @@ void Scene::ObjectsInitialization()
                      false,          // receiv shadow
                      1.0,            // shadow darkness
                      0.015,          // shadow bias
-                     true,          // bloom
-                     0.4,            // bloom bright value
                      false,          // opacity map
                      true,           // normal map
                      false,          // height map
@@ -2845,8 +2792,6 @@ void Scene::ObjectsInitialization()
                      false,          // receiv shadow
                      1.0,            // shadow darkness
                      0.015,          // shadow bias
-                     true,          // bloom
-                     0.4,            // bloom bright value
                      false,          // opacity map
                      true,           // normal map
                      false,          // height map
@@ -2881,8 +2826,6 @@ void Scene::ObjectsInitialization()
                              true,           // receiv shadow
                              1.0,            // shadow darkness
                              0.015,          // shadow bias
-                             true,          // bloom
-                             0.4,            // bloom bright value
                              false,          // opacity map
                              true,           // normal map
                              false,          // height map
@@ -2919,8 +2862,6 @@ void Scene::ObjectsInitialization()
                        true,           // receiv shadow
                        1.0,            // shadow darkness
                        0.015,          // shadow bias
-                       true,          // bloom
-                       0.4,            // bloom bright value
                        false,          // opacity map
                        true,           // normal map
                        false,          // height map
@@ -2957,8 +2898,6 @@ void Scene::ObjectsInitialization()
                         true,           // receiv shadow
                         1.0,            // shadow darkness
                         0.015,          // shadow bias
-                        true,          // bloom
-                        0.4,            // bloom bright value
                         false,          // opacity map
                         true,           // normal map
                         false,          // height map
@@ -2986,7 +2925,7 @@ void Scene::IBLInitialization()
   // ---------------------------------------------------
   glGenFramebuffers( 1, &capture_FBO );
   glGenRenderbuffers( 1, &capture_RBO );
-  glBindFramebuffer( GL_FRAMEBUFFER, capture_FBO );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, capture_FBO );
   glBindRenderbuffer( GL_RENDERBUFFER, capture_RBO );
   glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, _res_env_cubemap, _res_env_cubemap );
   glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, capture_RBO );
@@ -3007,7 +2946,7 @@ void Scene::IBLInitialization()
   // ---------------------------------
   
   // Re configure capture FBO
-  glBindFramebuffer( GL_FRAMEBUFFER, capture_FBO );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, capture_FBO );
   glBindRenderbuffer( GL_RENDERBUFFER, capture_RBO );
   glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, _res_pre_brdf_texture, _res_pre_brdf_texture );
   glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _pre_brdf_texture, 0 );
@@ -3019,7 +2958,9 @@ void Scene::IBLInitialization()
   glUniform1ui( glGetUniformLocation( _specular_pre_brdf_shader._program, "uSampleCount" ), _pre_brdf_sample_count );
   _window->_toolbox->RenderQuad();
 
-  glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
+  StateCache::DeleteFramebuffers( 1, &capture_FBO );
+  glDeleteRenderbuffers( 1, &capture_RBO );
 
   std::cout << "Scene's IBL initialization done.\n" << std::endl;
 }
@@ -3028,104 +2969,295 @@ void Scene::ShadersInitialization()
 {
   std::cout << "Scene's shaders initialization in progress..." << std::endl;
 
+  // Cold launch compiles every program, warm ones load the binary cache
+  unsigned int start_time        = SDL_GetTicks();
+  unsigned int programs_loaded   = Shader::_programs_loaded;
+  unsigned int programs_compiled = Shader::_programs_compiled;
 
-  // Set and compile shaders
-  // -----------------------
-  _forward_pbr_shader.SetShaderClassicPipeline(         "../Shaders/forward_pbr_lighting.vs", "../Shaders/forward_pbr_lighting.fs" );
+
+  // Set and compile shaders, all submitted before any status or uniform query
+  // --------------------------------------------------------------------------
+  Shader::BeginBatchCompile();
   _skybox_shader.SetShaderClassicPipeline(              "../Shaders/skybox.vs",               "../Shaders/skybox.fs" );
   _flat_color_shader.SetShaderClassicPipeline(          "../Shaders/flat_color.vs",           "../Shaders/flat_color.fs" );
   _observer_shader.SetShaderClassicPipeline(            "../Shaders/observer.vs",             "../Shaders/observer.fs" );
   _blur_shader.SetShaderClassicPipeline(                "../Shaders/observer.vs",             "../Shaders/blur.fs" );
+  _bloom_downsample_shader.SetShaderClassicPipeline(    "../Shaders/observer.vs",             "../Shaders/bloom_downsample.fs" );
+  _bloom_upsample_shader.SetShaderClassicPipeline(      "../Shaders/observer.vs",             "../Shaders/bloom_upsample.fs" );
+  _upscale_shader.SetShaderClassicPipeline(             "../Shaders/observer.vs",             "../Shaders/upscale.fs" );
+  _motion_vectors_shader.SetShaderClassicPipeline(      "../Shaders/motion_vectors.vs",       "../Shaders/motion_vectors.fs" );
+  _taa_resolve_shader.SetShaderClassicPipeline(         "../Shaders/observer.vs",             "../Shaders/taa_resolve.fs" );
   _post_process_shader.SetShaderClassicPipeline(        "../Shaders/observer.vs",             "../Shaders/post_process.fs" );
-  _MS_blit_shader.SetShaderClassicPipeline(             "../Shaders/observer.vs",             "../Shaders/multisample_blit.fs" );
   _cube_map_converter_shader.SetShaderClassicPipeline(  "../Shaders/cube_map_converter.vs",   "../Shaders/cube_map_converter.fs" );
   _diffuse_irradiance_shader.SetShaderClassicPipeline(  "../Shaders/cube_map_converter.vs",   "../Shaders/IBL_diffuse_pre_irradiance.fs" );
   _specular_pre_filter_shader.SetShaderClassicPipeline( "../Shaders/cube_map_converter.vs",   "../Shaders/IBL_specular_pre_filter.fs" );
   _specular_pre_brdf_shader.SetShaderClassicPipeline(   "../Shaders/observer.vs",             "../Shaders/IBL_specular_pre_brdf.fs" );
-  _forward_displacement_pbr_shader.SetShaderTessellationPipeline( "../Shaders/tessellation.vs",
-                                                                  "../Shaders/tessellation.cs",
-                                                                  "../Shaders/tessellation.es",
-                                                                  "../Shaders/forward_pbr_lighting.fs" );
-  _point_shadow_depth_shader.SetShaderGeometryPipeline( "../Shaders/point_shadow_depth.vs",
-                                                        "../Shaders/point_shadow_depth.gs",
-                                                        "../Shaders/point_shadow_depth.fs" );
+  _depth_prepass_shader.SetShaderClassicPipeline(       "../Shaders/depth_prepass.vs",          "../Shaders/empty.fs" );
+  _depth_prepass_alpha_test_shader.SetShaderClassicPipeline( "../Shaders/forward_pbr_lighting.vs", "../Shaders/depth_prepass.fs" );
+  _depth_prepass_displacement_shader.SetShaderTessellationPipeline( "../Shaders/tessellation.vs",
+                                                                    "../Shaders/tessellation.cs",
+                                                                    "../Shaders/tessellation.es",
+                                                                    "../Shaders/depth_prepass.fs" );
+  _point_shadow_depth_shader.SetShaderClassicPipeline(  "../Shaders/point_shadow_depth.vs",   "../Shaders/point_shadow_depth.fs" );
+  _shadow_moments_shader.SetShaderClassicPipeline(      "../Shaders/observer.vs",               "../Shaders/shadow_moments.fs" );
+  _shadow_moments_blur_shader.SetShaderClassicPipeline( "../Shaders/observer.vs",               "../Shaders/shadow_moments_blur.fs" );
+
+  // Compute shaders and image load store need GL 4.3, deferred programs are built with the g-buffer
+  _tiled_deferred_supported = GLEW_VERSION_4_3 ? true : false;
+  if( _pipeline_type == DEFERRED_RENDERING )
+  {
+    DeferredShadersInitialization();
+  }
 
-  _geometry_pass_shader.SetShaderClassicPipeline(       "../Shaders/deferred_geometry_pass.vs", "../Shaders/deferred_geometry_pass.fs" );
-  _lighting_pass_shader.SetShaderClassicPipeline(       "../Shaders/flat_color.vs",             "../Shaders/deferred_lighting_pass.fs" );
-  _empty_shader.SetShaderClassicPipeline(               "../Shaders/flat_color.vs",             "../Shaders/empty.fs" );
+  // Post process, multi sampled variants resolve in the same pass and are only built when needed
+  _compute_post_process_supported = GLEW_VERSION_4_3 ? true : false;
+  if( _compute_post_process_supported )
+  {
+    _post_process_compute_shader.SetShaderComputePipeline( "../Shaders/post_process.comp" );
+  }
+  if( _multi_sample )
+  {
+    _post_process_MS_shader._defines    = "#define MULTISAMPLE\n";
+    _bloom_prefilter_MS_shader._defines = "#define MULTISAMPLE\n";
+    _post_process_MS_shader.SetShaderClassicPipeline(    "../Shaders/observer.vs", "../Shaders/post_process.fs" );
+    _bloom_prefilter_MS_shader.SetShaderClassicPipeline( "../Shaders/observer.vs", "../Shaders/bloom_downsample.fs" );
 
+    if( _compute_post_process_supported )
+    {
+      _post_process_compute_MS_shader._defines = "#define MULTISAMPLE\n";
+      _post_process_compute_MS_shader.SetShaderComputePipeline( "../Shaders/post_process.comp" );
+    }
+  }
 
-  // Set texture uniform location
-  // ----------------------------
-  _forward_pbr_shader.Use();
-  glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uTextureAlbedo1" ),    0 ) ;
-  glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uTextureNormal1" ),    1 );
-  glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uTextureHeight1" ),    2 ) ;
-  glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uTextureAO1" ),        3 );
-  glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uTextureRoughness1" ), 4 );
-  glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uTextureMetalness1" ), 5 );
-  glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uTextureOpacity1" ),   6 );
-  glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIrradianceCubeMap" ), 7 );
-  glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uPreFilterCubeMap" ),  8 );
-  glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uPreBrdfLUT" ),        9 );
-  glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uDepthCubeMap" ),      10 );
-  glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uTextureEmissive1" ),  11 ); 
-  glUseProgram( 0 );
 
-  _forward_displacement_pbr_shader.Use();
-  glUniform1i( glGetUniformLocation( _forward_displacement_pbr_shader._program, "uTextureAlbedo1" ),    0 ) ;
-  glUniform1i( glGetUniformLocation( _forward_displacement_pbr_shader._program, "uTextureNormal1" ),    1 );
-  glUniform1i( glGetUniformLocation( _forward_displacement_pbr_shader._program, "uTextureHeight1" ),    2 ) ;
-  glUniform1i( glGetUniformLocation( _forward_displacement_pbr_shader._program, "uTextureAO1" ),        3 );
-  glUniform1i( glGetUniformLocation( _forward_displacement_pbr_shader._program, "uTextureRoughness1" ), 4 );
-  glUniform1i( glGetUniformLocation( _forward_displacement_pbr_shader._program, "uTextureMetalness1" ), 5 );
-  glUniform1i( glGetUniformLocation( _forward_displacement_pbr_shader._program, "uTextureOpacity1" ),   6 );
-  glUniform1i( glGetUniformLocation( _forward_displacement_pbr_shader._program, "uIrradianceCubeMap" ), 7 );
-  glUniform1i( glGetUniformLocation( _forward_displacement_pbr_shader._program, "uPreFilterCubeMap" ),  8 );
-  glUniform1i( glGetUniformLocation( _forward_displacement_pbr_shader._program, "uPreBrdfLUT" ),        9 ); 
-  glUniform1i( glGetUniformLocation( _forward_displacement_pbr_shader._program, "uDepthCubeMap" ),      10 ); 
-  glUseProgram( 0 );
+  // Forward programs, shadow filtering mode dependent, last ones of the batch
+  // ------------------------------------------------------------------------
+  ForwardShadersInitialization();
+  if( _lighting_pass_shader._program )
+  {
+    DeferredSamplersInitialization();
+  }
 
-  _geometry_pass_shader.Use();
-  glUniform1i( glGetUniformLocation( _geometry_pass_shader._program, "uTextureAlbedo1" ),    0 ) ;
-  glUniform1i( glGetUniformLocation( _geometry_pass_shader._program, "uTextureNormal1" ),    1 );
-  glUniform1i( glGetUniformLocation( _geometry_pass_shader._program, "uTextureHeight1" ),    2 ) ;
-  glUniform1i( glGetUniformLocation( _geometry_pass_shader._program, "uTextureAO1" ),        3 );
-  glUniform1i( glGetUniformLocation( _geometry_pass_shader._program, "uTextureRoughness1" ), 4 );
-  glUniform1i( glGetUniformLocation( _geometry_pass_shader._program, "uTextureMetalness1" ), 5 );
-  glUniform1i( glGetUniformLocation( _geometry_pass_shader._program, "uTextureSpecular1" ),  6 );
-  glUseProgram( 0 );
 
-  _lighting_pass_shader.Use();
-  glUniform1i( glGetUniformLocation( _lighting_pass_shader._program, "uGbufferPositionAndBloom" ),         0 ) ;
-  glUniform1i( glGetUniformLocation( _lighting_pass_shader._program, "uGbufferNormalAndBloomBrightness" ), 1 );
-  glUniform1i( glGetUniformLocation( _lighting_pass_shader._program, "uGbufferAlbedo" ),                   2 ) ;
-  glUniform1i( glGetUniformLocation( _lighting_pass_shader._program, "uGbufferRougnessMetalnessAO" ),      3 );
-  glUniform1i( glGetUniformLocation( _lighting_pass_shader._program, "uIrradianceCubeMap" ),               4 ); 
-  glUseProgram( 0 );
+  // Set texture uniform location
+  // ----------------------------
+  _shadow_moments_shader.Use();
+  glUniform1i( glGetUniformLocation( _shadow_moments_shader._program, "uShadowAtlas" ), 0 );
+  _shadow_moments_blur_shader.Use();
+  glUniform1i( glGetUniformLocation( _shadow_moments_blur_shader._program, "uMoments" ), 0 );
+  StateCache::UseProgram( 0 );
+
+  Shader * prepass_shaders[ 2 ] = { &_depth_prepass_alpha_test_shader, &_depth_prepass_displacement_shader };
+  for( unsigned int shader_it = 0; shader_it < 2; shader_it++ )
+  {
+    prepass_shaders[ shader_it ]->Use();
+    glUniform1i( glGetUniformLocation( prepass_shaders[ shader_it ]->_program, "uTextureHeight1" ),  2 ) ;
+    glUniform1i( glGetUniformLocation( prepass_shaders[ shader_it ]->_program, "uTextureOpacity1" ), 6 );
+  }
+  StateCache::UseProgram( 0 );
 
   _skybox_shader.Use();
   glUniform1i( glGetUniformLocation( _skybox_shader._program, "uSkyboxTexture" ), 0 );
-  glUseProgram( 0 );
+  StateCache::UseProgram( 0 );
 
   _observer_shader.Use();
   glUniform1i( glGetUniformLocation( _observer_shader._program, "uTexture1" ), 0 );
-  glUseProgram( 0 );
-
-  _MS_blit_shader.Use();
-  glUniform1i( glGetUniformLocation( _MS_blit_shader._program, "uTexture1" ), 0 );
-  glUseProgram( 0 );
+  StateCache::UseProgram( 0 );
 
   _blur_shader.Use();
   glUniform1i( glGetUniformLocation( _blur_shader._program, "uTexture" ), 0 );
-  glUseProgram( 0 );
+  StateCache::UseProgram( 0 );
+
+  _bloom_downsample_shader.Use();
+  glUniform1i( glGetUniformLocation( _bloom_downsample_shader._program, "uTexture" ), 0 );
+  StateCache::UseProgram( 0 );
+
+  _bloom_upsample_shader.Use();
+  glUniform1i( glGetUniformLocation( _bloom_upsample_shader._program, "uTexture" ), 0 );
+  StateCache::UseProgram( 0 );
+
+  _upscale_shader.Use();
+  glUniform1i( glGetUniformLocation( _upscale_shader._program, "uTexture" ), 0 );
+  StateCache::UseProgram( 0 );
+
+  _taa_resolve_shader.Use();
+  glUniform1i( glGetUniformLocation( _taa_resolve_shader._program, "uCurrentTexture" ), 0 );
+  glUniform1i( glGetUniformLocation( _taa_resolve_shader._program, "uHistoryTexture" ), 1 );
+  glUniform1i( glGetUniformLocation( _taa_resolve_shader._program, "uDepthTexture" ), 2 );
+  glUniform1i( glGetUniformLocation( _taa_resolve_shader._program, "uMotionVectorsTexture" ), 3 );
+  StateCache::UseProgram( 0 );
+
+  Shader * post_process_shaders[ 4 ] = { &_post_process_shader, &_post_process_MS_shader, &_post_process_compute_shader, &_post_process_compute_MS_shader };
+  for( unsigned int shader_it = 0; shader_it < 4; shader_it++ )
+  {
+    if( post_process_shaders[ shader_it ]->_program )
+    {
+      post_process_shaders[ shader_it ]->Use();
+      glUniform1i( glGetUniformLocation( post_process_shaders[ shader_it ]->_program, "uBaseColorTexture" ), 0 );
+      glUniform1i( glGetUniformLocation( post_process_shaders[ shader_it ]->_program, "uBloomTexture" ), 1 );
+    }
+  }
+  StateCache::UseProgram( 0 );
+
+  if( _multi_sample )
+  {
+    _bloom_prefilter_MS_shader.Use();
+    glUniform1i( glGetUniformLocation( _bloom_prefilter_MS_shader._program, "uTexture" ), 0 );
+    StateCache::UseProgram( 0 );
+  }
+
+  std::cout << "Scene's shaders initialization done in " << SDL_GetTicks() - start_time << " ms, "
+            << Shader::_programs_loaded - programs_loaded << " program(s) loaded from " << SHADER_CACHE_DIRECTORY << ", "
+            << Shader::_programs_compiled - programs_compiled << " compiled.\n" << std::endl;
+}
+
+void Scene::DeferredShadersInitialization()
+{
+  // Built once, on the first switch to the deferred pipeline or at launch when it is the selected one
+  if( _lighting_pass_shader._program )
+  {
+    return;
+  }
+
+  // Inside the launch batch its statuses are checked with the other programs, alone it is its own batch
+  bool batch = Shader::_batch_compile;
+  if( !batch )
+  {
+    Shader::BeginBatchCompile();
+  }
+
+  _geometry_pass_shader.SetShaderClassicPipeline(       "../Shaders/forward_pbr_lighting.vs",   "../Shaders/deferred_geometry_pass.fs" );
+  _geometry_displacement_pass_shader.SetShaderTessellationPipeline( "../Shaders/tessellation.vs",
+                                                                    "../Shaders/tessellation.cs",
+                                                                    "../Shaders/tessellation.es",
+                                                                    "../Shaders/deferred_geometry_pass.fs" );
+  _lighting_pass_shader.SetShaderClassicPipeline(       "../Shaders/flat_color.vs",             "../Shaders/deferred_lighting_pass.fs" );
+  _empty_shader.SetShaderClassicPipeline(               "../Shaders/flat_color.vs",             "../Shaders/empty.fs" );
+  _g_buffer_fill_shader.SetShaderClassicPipeline(       "../Shaders/observer.vs",             "../Shaders/g_buffer_fill.fs" );
+  if( _tiled_deferred_supported )
+  {
+    _tiled_lighting_shader.SetShaderComputePipeline( "../Shaders/deferred_tiled_lighting.comp" );
+  }
+
+  if( batch )
+  {
+    return;
+  }
+  Shader::EndBatchCompile();
+  DeferredSamplersInitialization();
+}
+
+void Scene::DeferredSamplersInitialization()
+{
+  Shader * geometry_shaders[ 2 ] = { &_geometry_pass_shader, &_geometry_displacement_pass_shader };
+  for( unsigned int shader_it = 0; shader_it < 2; shader_it++ )
+  {
+    geometry_shaders[ shader_it ]->Use();
+    glUniform1i( glGetUniformLocation( geometry_shaders[ shader_it ]->_program, "uTextureAlbedo1" ),    0 ) ;
+    glUniform1i( glGetUniformLocation( geometry_shaders[ shader_it ]->_program, "uTextureNormal1" ),    1 );
+    glUniform1i( glGetUniformLocation( geometry_shaders[ shader_it ]->_program, "uTextureHeight1" ),    2 ) ;
+    glUniform1i( glGetUniformLocation( geometry_shaders[ shader_it ]->_program, "uTextureAO1" ),        3 );
+    glUniform1i( glGetUniformLocation( geometry_shaders[ shader_it ]->_program, "uTextureRoughness1" ), 4 );
+    glUniform1i( glGetUniformLocation( geometry_shaders[ shader_it ]->_program, "uTextureMetalness1" ), 5 );
+    glUniform1i( glGetUniformLocation( geometry_shaders[ shader_it ]->_program, "uTextureOpacity1" ),   6 );
+    glUniform1i( glGetUniformLocation( geometry_shaders[ shader_it ]->_program, "uIrradianceCubeMap" ), 7 );
+    glUniform1i( glGetUniformLocation( geometry_shaders[ shader_it ]->_program, "uPreFilterCubeMap" ),  8 );
+    glUniform1i( glGetUniformLocation( geometry_shaders[ shader_it ]->_program, "uPreBrdfLUT" ),        9 );
+    glUniform1i( glGetUniformLocation( geometry_shaders[ shader_it ]->_program, "uTextureEmissive1" ),  11 );
+  }
+  StateCache::UseProgram( 0 );
+
+  if( _tiled_deferred_supported )
+  {
+    _tiled_lighting_shader.Use();
+    glUniform1i( glGetUniformLocation( _tiled_lighting_shader._program, "uGbufferNormal" ),                      0 );
+    glUniform1i( glGetUniformLocation( _tiled_lighting_shader._program, "uGbufferAlbedo" ),                      1 );
+    glUniform1i( glGetUniformLocation( _tiled_lighting_shader._program, "uGbufferRougnessMetalnessAO" ), 2 );
+    glUniform1i( glGetUniformLocation( _tiled_lighting_shader._program, "uGbufferDepth" ),                       3 );
+    glUniform1i( glGetUniformLocation( _tiled_lighting_shader._program, "uShadowAtlas0" ),                       10 );
+    glUniform1i( glGetUniformLocation( _tiled_lighting_shader._program, "uShadowAtlas1" ),                       12 );
+    glUniform1i( glGetUniformLocation( _tiled_lighting_shader._program, "uShadowAtlas2" ),                       13 );
+    glUniform1i( glGetUniformLocation( _tiled_lighting_shader._program, "uShadowAtlas3" ),                       14 );
+    glUniform1i( glGetUniformLocation( _tiled_lighting_shader._program, "uLightsBuffer" ),                       15 );
+    StateCache::UseProgram( 0 );
+  }
+
+  _lighting_pass_shader.Use();
+  glUniform1i( glGetUniformLocation( _lighting_pass_shader._program, "uGbufferNormal" ),                      0 ) ;
+  glUniform1i( glGetUniformLocation( _lighting_pass_shader._program, "uGbufferAlbedo" ),                      1 );
+  glUniform1i( glGetUniformLocation( _lighting_pass_shader._program, "uGbufferRougnessMetalnessAO" ), 2 ) ;
+  glUniform1i( glGetUniformLocation( _lighting_pass_shader._program, "uGbufferDepth" ),                       3 );
+  glUniform1i( glGetUniformLocation( _lighting_pass_shader._program, "uShadowAtlas0" ),                       10 );
+  glUniform1i( glGetUniformLocation( _lighting_pass_shader._program, "uShadowAtlas1" ),                       12 );
+  glUniform1i( glGetUniformLocation( _lighting_pass_shader._program, "uShadowAtlas2" ),                       13 );
+  glUniform1i( glGetUniformLocation( _lighting_pass_shader._program, "uShadowAtlas3" ),                       14 );
+  glUniform1i( glGetUniformLocation( _lighting_pass_shader._program, "uLightsBuffer" ),                       15 );
+  StateCache::UseProgram( 0 );
+}
+
+void Scene::ForwardShadersInitialization()
+{
+  // Shadow samplers type depends on the filtering mode, both programs are built for the current one.
+  // Per object lights list size comes from here too, the shader array can't drift from the CPU side clamp.
+  // Scene lights bound the lights loop, the count changes with the benchmarks and stays a uniform.
+  std::string defines = "#define SHADOW_FILTER_MODE " + to_string( _shadow_filter_mode ) + "\n" +
+                        "#define MAX_OBJECT_LIGHTS " + to_string( MAX_OBJECT_LIGHTS ) + "\n" +
+                        "#define MAX_NB_LIGHTS " + to_string( MAX_NB_LIGHTS ) + "\n";
+  _forward_pbr_shader._defines              = defines;
+  _forward_displacement_pbr_shader._defines = defines;
+
+  // Same bits order as the PBR_FEATURE_* defines
+  const char * features[ 6 ] = { "PERMUTATION_NORMAL_MAP", "PERMUTATION_OPACITY_MAP", "PERMUTATION_IBL",
+                                 "PERMUTATION_PARALLAX_CUBEMAP", "PERMUTATION_EMISSIVE", "PERMUTATION_RECEIV_SHADOW" };
+  _forward_pbr_shader._permutation_features.assign( features, features + 6 );
+  _forward_displacement_pbr_shader._permutation_features.assign( features, features + 6 );
+
+  _forward_pbr_shader.SetShaderClassicPipeline( "../Shaders/forward_pbr_lighting.vs", "../Shaders/forward_pbr_lighting.fs" );
+  _forward_displacement_pbr_shader.SetShaderTessellationPipeline( "../Shaders/tessellation.vs",
+                                                                  "../Shaders/tessellation.cs",
+                                                                  "../Shaders/tessellation.es",
+                                                                  "../Shaders/forward_pbr_lighting.fs" );
+
+  // Every launch program is submitted, the batch statuses are checked before the first uniform query
+  Shader::EndBatchCompile();
 
-  _post_process_shader.Use();
-  glUniform1i( glGetUniformLocation( _post_process_shader._program, "uBaseColorTexture" ), 0 );
-  glUniform1i( glGetUniformLocation( _post_process_shader._program, "uBloomBrightnessTexture" ), 1 );
-  glUseProgram( 0 );
 
-  std::cout << "Scene's shaders initialization done.\n" << std::endl;
+  // Set texture uniform location
+  // ----------------------------
+  _forward_pbr_shader.Use();
+  _forward_pbr_shader.SetSamplerUnit( "uTextureAlbedo1",    0 );
+  _forward_pbr_shader.SetSamplerUnit( "uTextureNormal1",    1 );
+  _forward_pbr_shader.SetSamplerUnit( "uTextureHeight1",    2 );
+  _forward_pbr_shader.SetSamplerUnit( "uTextureAO1",        3 );
+  _forward_pbr_shader.SetSamplerUnit( "uTextureRoughness1", 4 );
+  _forward_pbr_shader.SetSamplerUnit( "uTextureMetalness1", 5 );
+  _forward_pbr_shader.SetSamplerUnit( "uTextureOpacity1",   6 );
+  _forward_pbr_shader.SetSamplerUnit( "uIrradianceCubeMap", 7 );
+  _forward_pbr_shader.SetSamplerUnit( "uPreFilterCubeMap",  8 );
+  _forward_pbr_shader.SetSamplerUnit( "uPreBrdfLUT",        9 );
+  _forward_pbr_shader.SetSamplerUnit( "uShadowAtlas0",      10 );
+  _forward_pbr_shader.SetSamplerUnit( "uShadowAtlas1",      12 );
+  _forward_pbr_shader.SetSamplerUnit( "uShadowAtlas2",      13 );
+  _forward_pbr_shader.SetSamplerUnit( "uShadowAtlas3",      14 );
+  _forward_pbr_shader.SetSamplerUnit( "uTextureEmissive1",  11 );
+  StateCache::UseProgram( 0 );
+
+  _forward_displacement_pbr_shader.Use();
+  _forward_displacement_pbr_shader.SetSamplerUnit( "uTextureAlbedo1",    0 );
+  _forward_displacement_pbr_shader.SetSamplerUnit( "uTextureNormal1",    1 );
+  _forward_displacement_pbr_shader.SetSamplerUnit( "uTextureHeight1",    2 );
+  _forward_displacement_pbr_shader.SetSamplerUnit( "uTextureAO1",        3 );
+  _forward_displacement_pbr_shader.SetSamplerUnit( "uTextureRoughness1", 4 );
+  _forward_displacement_pbr_shader.SetSamplerUnit( "uTextureMetalness1", 5 );
+  _forward_displacement_pbr_shader.SetSamplerUnit( "uTextureOpacity1",   6 );
+  _forward_displacement_pbr_shader.SetSamplerUnit( "uIrradianceCubeMap", 7 );
+  _forward_displacement_pbr_shader.SetSamplerUnit( "uPreFilterCubeMap",  8 );
+  _forward_displacement_pbr_shader.SetSamplerUnit( "uPreBrdfLUT",        9 );
+  _forward_displacement_pbr_shader.SetSamplerUnit( "uShadowAtlas0",      10 );
+  _forward_displacement_pbr_shader.SetSamplerUnit( "uShadowAtlas1",      12 );
+  _forward_displacement_pbr_shader.SetSamplerUnit( "uShadowAtlas2",      13 );
+  _forward_displacement_pbr_shader.SetSamplerUnit( "uShadowAtlas3",      14 );
+  StateCache::UseProgram( 0 );
 }
 
 void Scene::ModelsLoading()
@@ -3446,1363 +3578,1854 @@ void Scene::TesselationInitialization()
 { 
   // Set size of the input patch
   glPatchParameteri( GL_PATCH_VERTICES, _tess_patch_vertices_count );
+
+  // Screen space levels are clamped to the generator limit, mirrored by the triangles estimate
+  glGetIntegerv( GL_MAX_TESS_GEN_LEVEL, &_tess_max_level );
 }
 
-void Scene::DeferredBuffersInitialization()
+void Scene::DisplacementLODsInitialization()
 {
+  std::cout << "Pre-displaced planes LODs baking in progress..." << std::endl;
 
-  // G buffer initialization
-  // -----------------------
-  glGenFramebuffers( 1, &_g_buffer_FBO );
-  glBindFramebuffer( GL_FRAMEBUFFER, _g_buffer_FBO );
-
-  unsigned int texture_id;
-
-  // Position buffer && Bloom bool
-  glGenTextures( 1, &texture_id );
-  glBindTexture( GL_TEXTURE_2D, texture_id );
-  glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA16F, _window->_width, _window->_height, 0, GL_RGBA, GL_FLOAT, NULL );
-  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-  glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture_id, 0 );
-  _g_buffer_textures.push_back( texture_id );
-
-  // Normal buffer && BloomBrightness
-  glGenTextures( 1, &texture_id );
-  glBindTexture( GL_TEXTURE_2D, texture_id );
-  glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA16F, _window->_width, _window->_height, 0, GL_RGBA, GL_FLOAT, NULL );
-  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-  glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, texture_id, 0 );
-  _g_buffer_textures.push_back( texture_id );
-
-  // Albedo buffer
-  glGenTextures( 1, &texture_id );
-  glBindTexture( GL_TEXTURE_2D, texture_id );
-  glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB16F, _window->_width, _window->_height, 0, GL_RGB, GL_FLOAT, NULL );
-  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-  glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, texture_id, 0 );
-  _g_buffer_textures.push_back( texture_id );
+  unsigned int baked_count = 0;
 
-  // Roughness && Metalness && AO
-  glGenTextures( 1, &texture_id );
-  glBindTexture( GL_TEXTURE_2D, texture_id );
-  glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB16F, _window->_width, _window->_height, 0, GL_RGB, GL_FLOAT, NULL );
-  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-  glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, texture_id, 0 );
-  _g_buffer_textures.push_back( texture_id );
-
-  // Depth
-  glGenTextures( 1, &texture_id );
-  glBindTexture( GL_TEXTURE_2D, texture_id );
-  glTexImage2D( GL_TEXTURE_2D, 0, GL_DEPTH32F_STENCIL8, _window->_width, _window->_height, 0, GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, NULL );
-  glFramebufferTexture2D( GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, texture_id, 0 );
-  _g_buffer_textures.push_back( texture_id ); 
-
-  // Lighting && brightest texture
-  for( unsigned int i = 0; i < 2; i++ ) 
-  {
-    glGenTextures( 1, &texture_id );
-    glBindTexture( GL_TEXTURE_2D, texture_id );
-    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB16F, _window->_width, _window->_height, 0, GL_RGB, GL_FLOAT, NULL );
-    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );  
-    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-    glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT4 + i, GL_TEXTURE_2D, texture_id, 0 );
-    _g_buffer_textures.push_back( texture_id );
+  // Same UV scales as the plane VAOs each object is drawn with
+  for( unsigned int ground_it = 0; ground_it < _grounds_type1.size(); ground_it++ )
+  {
+    if( _grounds_type1[ ground_it ]._height_map )
+    {
+      _window->_toolbox->CreateDisplacedPlaneLODs( &_grounds_type1[ ground_it ],
+                                                   _loaded_materials[ _grounds_type1[ ground_it ]._material_id ][ 2 ],
+                                                   ( _grounds_type1[ ground_it ]._id == 18 ) ? 3.0 : _grounds_type1[ 0 ]._uv_scale.x );
+      _grounds_type1[ ground_it ]._baked_displacement = true;
+      baked_count++;
+    }
   }
 
-  if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+  for( unsigned int wall_it = 0; wall_it < _walls_type1.size(); wall_it++ )
   {
-    std::cout << "ERROR : G-buffer's FBO not complete" << std::endl;
+    if( _walls_type1[ wall_it ]._height_map )
+    {
+      _window->_toolbox->CreateDisplacedPlaneLODs( &_walls_type1[ wall_it ],
+                                                   _loaded_materials[ _walls_type1[ wall_it ]._material_id ][ 2 ],
+                                                   ( _walls_type1[ wall_it ]._id == 4 ) ? _walls_type1[ 0 ]._uv_scale.x * 1.5 : _walls_type1[ 0 ]._uv_scale.x );
+      _walls_type1[ wall_it ]._baked_displacement = true;
+      baked_count++;
+    }
   }
 
-  glBindTexture( GL_TEXTURE_2D, 0 );
-  glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+  std::cout << "Pre-displaced planes LODs baking done, " << baked_count << " plane(s) of " << DISPLACEMENT_LOD_CHUNKS * DISPLACEMENT_LOD_CHUNKS
+            << " chunks with " << DISPLACEMENT_LOD_COUNT << " LODs.\n" << std::endl;
 }
 
-void Scene::SceneDepthPass()
+void Scene::PropsListsInitialization()
 {
-  glm::mat4 model_matrix;
-
-
-  // Create depth cubemap transformation matrices
-  // --------------------------------------------
-  glm::mat4 shadow_projection_matrix = glm::perspective( glm::radians( 90.0f ), 
-                                                         (float)_depth_cubemap_res / (float)_depth_cubemap_res,
-                                                         _shadow_near,
-                                                         _shadow_far );
-  std::vector< glm::mat4 > shadow_transform_matrices;
-  shadow_transform_matrices.push_back( shadow_projection_matrix * glm::lookAt( _lights[ _current_shadow_light_source ]._position, _lights[ _current_shadow_light_source ]._position + glm::vec3( 1.0f, 0.0f, 0.0f ), glm::vec3( 0.0f, -1.0f, 0.0f ) ) );
-  shadow_transform_matrices.push_back( shadow_projection_matrix * glm::lookAt( _lights[ _current_shadow_light_source ]._position, _lights[ _current_shadow_light_source ]._position + glm::vec3( -1.0f, 0.0f, 0.0f ), glm::vec3 (0.0f, -1.0f, 0.0f ) ) );
-  shadow_transform_matrices.push_back( shadow_projection_matrix * glm::lookAt( _lights[ _current_shadow_light_source ]._position, _lights[ _current_shadow_light_source ]._position + glm::vec3( 0.0f, 1.0f, 0.0f ), glm::vec3( 0.0f, 0.0f, 1.0f ) ) );
-  shadow_transform_matrices.push_back( shadow_projection_matrix * glm::lookAt( _lights[ _current_shadow_light_source ]._position, _lights[ _current_shadow_light_source ]._position + glm::vec3( 0.0f, -1.0f, 0.0f ), glm::vec3( 0.0f, 0.0f, -1.0f ) ) );
-  shadow_transform_matrices.push_back( shadow_projection_matrix * glm::lookAt( _lights[ _current_shadow_light_source ]._position, _lights[ _current_shadow_light_source ]._position + glm::vec3( 0.0f, 0.0f, 1.0f ), glm::vec3( 0.0f, -1.0f, 0.0f ) ) );
-  shadow_transform_matrices.push_back( shadow_projection_matrix * glm::lookAt( _lights[ _current_shadow_light_source ]._position, _lights[ _current_shadow_light_source ]._position + glm::vec3( 0.0f, 0.0f, -1.0f ), glm::vec3( 0.0f, -1.0f, 0.0f ) ) );
+  std::cout << "Scene's props draw lists initialization in progress..." << std::endl;
 
+  _room_props.clear();
+  _room_props.resize( 3 );
 
-  // Render scene to depth cubemap
-  // -----------------------------
-  glViewport( 0, 0, _depth_cubemap_res, _depth_cubemap_res );
-  glBindFramebuffer( GL_FRAMEBUFFER, _window->_toolbox->_depth_map_FBO );
-  glClear( GL_DEPTH_BUFFER_BIT );
 
-  _point_shadow_depth_shader.Use();   
+  // Room 1 props
+  // ------------
+  AddRoomProp( 1, &_room1_table1, _room1_table1_model, false );
+  AddRoomProp( 1, &_bottle,       _bottle_model,       true );
+  AddRoomProp( 1, &_ball,         _ball_model,         true );
+  AddRoomProp( 1, &_box_bag,      _box_bag_model,      true );
+  AddRoomProp( 1, &_chest,        _chest_model,        true );
+  AddRoomProp( 1, &_sofa,         _sofa_model,         true );
+  AddRoomProp( 1, &_sack,         _sack_model,         true );
+  AddRoomProp( 1, &_room1_table2, _room1_table2_model, true );
+  AddRoomProp( 1, &_book,         _book_model,         true );
+  AddRoomProp( 1, &_radio,        _radio_model,        true );
+  AddRoomProp( 1, &_ink_bottle,   _ink_bottle_model,   false );
+
+
+  // Room 2 props
+  // ------------
+  AddRoomProp( 2, &_screen,       _screen_model,       false );
+  AddRoomProp( 2, &_bike,         _bike_model,         true );
+  AddRoomProp( 2, &_pilar,        _pilar_model,        true );
+  AddRoomProp( 2, &_scanner,      _scanner_model,      false );
+  AddRoomProp( 2, &_room2_table1, _room2_table1_model, true );
+  AddRoomProp( 2, &_mask,         _mask_model,         true );
+  AddRoomProp( 2, &_arm,          _arm_model,          true );
 
-  // Send each shadow transform matrix to render into each cube map face
-  for( unsigned int i = 0; i < 6; i++ )
-  {
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, std::string( "uShadowTransformMatrices[" + std::to_string( i ) + "]" ).data() ), 1, GL_FALSE, glm::value_ptr( shadow_transform_matrices[ i ] ) );
-  }
-  glUniform1f( glGetUniformLocation( _point_shadow_depth_shader._program, "uShadowFar" ), _shadow_far );
-  glUniform3fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uLightPosition" ), 1, &_lights[ _current_shadow_light_source ]._position[ 0 ] );
 
+  // Room 3 props
+  // ------------
+  AddRoomProp( 3, &_tank,         _tank_model,         true );
+  AddRoomProp( 3, &_shelving,     _shelving_model,     true );
+  AddRoomProp( 3, &_gun1,         _gun1_model,         true );
+  AddRoomProp( 3, &_gun2,         _gun2_model,         true );
+  AddRoomProp( 3, &_gun3,         _gun3_model,         true );
+  AddRoomProp( 3, &_room3_table1, _room3_table1_model, true );
+  AddRoomProp( 3, &_room3_table2, _room3_table2_model, true );
+  AddRoomProp( 3, &_helmet,       _helmet_model,       true );
+  AddRoomProp( 3, &_knife,        _knife_model,        true );
+  AddRoomProp( 3, &_grenade,      _grenade_model,      true );
+  AddRoomProp( 3, &_gun4,         _gun4_model,         true );
+  AddRoomProp( 3, &_gun5,         _gun5_model,         true );
+  AddRoomProp( 3, &_room3_table3, _room3_table3_model, true );
+  AddRoomProp( 3, &_katana,       _katana_model,       true );
+  AddRoomProp( 3, &_helmet2,      _helmet2_model,      true );
+
+  std::cout << "Scene's props draw lists initialization done.\n" << std::endl;
+}
 
-  // Draw revolving door depth
-  // -------------------------
-  model_matrix = _revolving_door[ 0 ]._model_matrix;
-  glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-  _revolving_door_model->DrawDepth( _point_shadow_depth_shader, model_matrix );
+void Scene::AddRoomProp( unsigned int iRoom,
+                         Object *     iObject,
+                         Model *      iModel,
+                         bool         iCullFace )
+{
+  SceneProp prop;
 
+  prop._object    = iObject;
+  prop._model     = iModel;
+  prop._cull_face = iCullFace;
 
-  if( _current_room == 1 )
-  {
-    // Draw ink bottle depth
-    // ---------------------
-    model_matrix = _ink_bottle._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _ink_bottle_model->DrawDepth( _point_shadow_depth_shader, model_matrix );
+  _room_props[ iRoom - 1 ].push_back( prop );
+}
 
+void Scene::DemoPVSInitialization()
+{
+  std::cout << "Scene's demo path PVS initialization in progress..." << std::endl;
 
-    // Draw room1 table1 depth
-    // -----------------------
-    model_matrix = _room1_table1._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _room1_table1_model->DrawDepth( _point_shadow_depth_shader, model_matrix );
+  _demo_PVS.clear();
 
 
-    // Draw bottle depth
-    // -----------------
-    model_matrix = _bottle._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _bottle_model->DrawDepth( _point_shadow_depth_shader, model_matrix );
+  // Give each cullable object its bit in the PVS bitsets ( walls, grounds, then props )
+  // -----------------------------------------------------------------------------------
+  unsigned int PVS_id = 0;
 
+  for( unsigned int wall_it = 0; wall_it < _walls_type1.size(); wall_it++ )
+  {
+    _walls_type1[ wall_it ]._PVS_id = PVS_id++;
+  }
 
-    // Draw ball depth
-    // -----------------
-    model_matrix = _ball._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _ball_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+  for( unsigned int ground_it = 0; ground_it < _grounds_type1.size(); ground_it++ )
+  {
+    _grounds_type1[ ground_it ]._PVS_id = PVS_id++;
+  }
 
+  for( unsigned int room_it = 0; room_it < _room_props.size(); room_it++ )
+  {
+    for( unsigned int prop_it = 0; prop_it < _room_props[ room_it ].size(); prop_it++ )
+    {
+      _room_props[ room_it ][ prop_it ]._object->_PVS_id = PVS_id++;
+    }
+  }
 
-    // Draw _box_bag depth
-    // -------------------
-    model_matrix = _box_bag._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _box_bag_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+  _demo_PVS_object_count = PVS_id;
 
+  if( _camera->_demo_bezier_data.empty() )
+  {
+    std::cout << "No demo camera path, PVS disabled.\n" << std::endl;
+    return;
+  }
 
-    // Draw _chest depth
-    // -----------------
-    model_matrix = _chest._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _chest_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
 
+  // Get the baking input hash => any change of the camera path or of the static geometry invalidates the PVS file
+  // -------------------------------------------------------------------------------------------------------------
+  _demo_PVS_hash = 2166136261u;
 
-    // Draw _sofa depth
-    // -----------------
-    model_matrix = _sofa._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _sofa_model->DrawDepth( _point_shadow_depth_shader, model_matrix );
+  for( unsigned int segment_it = 0; segment_it < _camera->_demo_bezier_data.size(); segment_it++ )
+  {
+    DemoPVSHashUpdate( &_camera->_demo_bezier_data[ segment_it ][ 0 ], _camera->_demo_bezier_data[ segment_it ].size() * sizeof( glm::vec3 ) );
+  }
 
+  for( unsigned int wall_it = 0; wall_it < _walls_type1.size(); wall_it++ )
+  {
+    DemoPVSHashUpdate( &_walls_type1[ wall_it ]._model_matrix, sizeof( glm::mat4 ) );
+  }
 
-    // Draw _sack depth
-    // -----------------
-    model_matrix = _sack._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _sack_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+  for( unsigned int ground_it = 0; ground_it < _grounds_type1.size(); ground_it++ )
+  {
+    DemoPVSHashUpdate( &_grounds_type1[ ground_it ]._model_matrix, sizeof( glm::mat4 ) );
+  }
 
+  for( unsigned int room_it = 0; room_it < _room_props.size(); room_it++ )
+  {
+    for( unsigned int prop_it = 0; prop_it < _room_props[ room_it ].size(); prop_it++ )
+    {
+      DemoPVSHashUpdate( &_room_props[ room_it ][ prop_it ]._object->_model_matrix, sizeof( glm::mat4 ) );
+    }
+  }
 
-    // Draw _room1_table2 depth
-    // -----------------------
-    model_matrix = _room1_table2._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _room1_table2_model->DrawDepth( _point_shadow_depth_shader, model_matrix );
+  DemoPVSHashUpdate( &_camera->_projection_matrix, sizeof( glm::mat4 ) );
+  DemoPVSHashUpdate( &_demo_PVS_samples, sizeof( _demo_PVS_samples ) );
+  DemoPVSHashUpdate( &_demo_PVS_res, sizeof( _demo_PVS_res ) );
 
 
-    // Draw _book depth
-    // ----------------
-    model_matrix = _book._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _book_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+  // Load the baked PVS, or bake and save it if missing or out of date
+  // -----------------------------------------------------------------
+  if( !DemoPVSLoading() )
+  {
+    DemoPVSBaking();
+    DemoPVSSaving();
+  }
 
 
-    // Draw _radio depth
-    // ----------------
-    model_matrix = _radio._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _radio_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
-  }
+  // Print PVS statistics
+  // --------------------
+  unsigned int visible_count = 0;
 
-  if( _current_room == 2 )
+  for( unsigned int segment_it = 0; segment_it < _demo_PVS.size(); segment_it++ )
   {
+    for( unsigned int object_it = 0; object_it < _demo_PVS_object_count; object_it++ )
+    {
+      visible_count += _demo_PVS[ segment_it ][ object_it ];
+    }
+  }
 
-    // Draw _screen depth
-    // ------------------
-    model_matrix = _screen._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _screen_model->DrawDepth( _point_shadow_depth_shader, model_matrix );
+  std::cout << "Demo path PVS : " << _demo_PVS.size() << " segments, "
+            << ( float )visible_count / ( float )_demo_PVS.size() << " / " << _demo_PVS_object_count << " objects visible per segment on average" << std::endl;
 
+  std::cout << "Scene's demo path PVS initialization done.\n" << std::endl;
+}
 
-    // Draw _bike depth
-    // ----------------
-    model_matrix = _bike._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _bike_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+void Scene::DemoPVSHashUpdate( const void * iData,
+                               unsigned int iSize )
+{
+  const unsigned char * bytes = ( const unsigned char * )iData;
 
+  // FNV-1a
+  for( unsigned int byte_it = 0; byte_it < iSize; byte_it++ )
+  {
+    _demo_PVS_hash ^= bytes[ byte_it ];
+    _demo_PVS_hash *= 16777619u;
+  }
+}
 
-    // Draw _pilar depth
-    // -----------------
-    model_matrix = _pilar._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _pilar_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+void Scene::DemoPVSBaking()
+{
+  std::cout << "Demo path PVS baking in progress..." << std::endl;
 
+  unsigned int start_time = SDL_GetTicks();
 
-    // Draw _scanner depth
-    // -----------------
-    model_matrix = _scanner._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _scanner_model->DrawDepth( _point_shadow_depth_shader, model_matrix );
+  int width  = _demo_PVS_res;
+  int height = ( int )( ( float )_demo_PVS_res * ( float )_window->_height / ( float )_window->_width );
 
 
-    // Draw _room2_table1 depth
-    // ------------------------
-    model_matrix = _room2_table1._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _room2_table1_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+  // Create the object ID buffer
+  // ---------------------------
+  unsigned int ID_FBO;
+  unsigned int ID_texture;
+  unsigned int ID_depth_RBO;
 
+  glGenFramebuffers( 1, &ID_FBO );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, ID_FBO );
 
-    // Draw _mask depth
-    // ----------------
-    model_matrix = _mask._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _mask_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+  glGenTextures( 1, &ID_texture );
+  StateCache::BindTexture( GL_TEXTURE_2D, ID_texture );
+  glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+  glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+  glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ID_texture, 0 );
+  StateCache::BindTexture( GL_TEXTURE_2D, 0 );
 
+  glGenRenderbuffers( 1, &ID_depth_RBO );
+  glBindRenderbuffer( GL_RENDERBUFFER, ID_depth_RBO );
+  glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height );
+  glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, ID_depth_RBO );
+  glBindRenderbuffer( GL_RENDERBUFFER, 0 );
 
-    // Draw _arm depth
-    // ---------------
-    model_matrix = _arm._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _arm_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
-  }
-
-  if( _current_room == 3 )
+  if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
   {
+    std::cout << "Framebuffer not complete!" << std::endl;
+  }
 
-    // Draw _tank depth
-    // ----------------
-    model_matrix = _tank._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _tank_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+  glViewport( 0, 0, width, height );
+  StateCache::Enable( GL_DEPTH_TEST );
+  StateCache::Disable( GL_CULL_FACE );
+  StateCache::Disable( GL_BLEND );
 
 
-    // Draw _shelving depth
-    // --------------------
-    model_matrix = _shelving._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _shelving_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+  // Render the ID buffer along the camera path
+  // ------------------------------------------
 
+  // 10% guard band around the real frustum to stay conservative between two samples
+  glm::mat4 projection_matrix = glm::scale( glm::mat4(), glm::vec3( 1.0 / 1.1, 1.0 / 1.1, 1.0 ) ) * _camera->_projection_matrix;
 
-    // Draw _gun1 depth
-    // ----------------
-    model_matrix = _gun1._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _gun1_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+  _flat_color_shader.Use();
+  glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( projection_matrix ) );
 
+  std::vector< unsigned char > pixels( width * height * 4 );
+  std::vector< std::vector< glm::vec3 > > * path = &_camera->_demo_bezier_data;
 
-    // Draw _gun2 depth
-    // ----------------
-    model_matrix = _gun2._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _gun2_model->DrawDepth( _point_shadow_depth_shader, model_matrix );
+  for( unsigned int segment_it = 0; segment_it < path->size(); segment_it++ )
+  {
+    std::vector< bool > segment_PVS( _demo_PVS_object_count, false );
 
+    for( unsigned int sample_it = 0; sample_it < _demo_PVS_samples; sample_it++ )
+    {
+      // Slightly overshoot the segment end, the demo script can render one frame past t = 1.0 before stepping
+      float t = ( ( float )sample_it / ( float )( _demo_PVS_samples - 1 ) ) * 1.02;
 
-    // Draw _gun3 depth
-    // ----------------
-    model_matrix = _gun3._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _gun3_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+      glm::vec3 position;
+      position.x = _camera->BezierCalculation( ( *path )[ segment_it ][ 0 ].x, ( *path )[ segment_it ][ 1 ].x, ( *path )[ segment_it ][ 2 ].x, ( *path )[ segment_it ][ 3 ].x, t );
+      position.y = _camera->BezierCalculation( ( *path )[ segment_it ][ 0 ].y, ( *path )[ segment_it ][ 1 ].y, ( *path )[ segment_it ][ 2 ].y, ( *path )[ segment_it ][ 3 ].y, t );
+      position.z = _camera->BezierCalculation( ( *path )[ segment_it ][ 0 ].z, ( *path )[ segment_it ][ 1 ].z, ( *path )[ segment_it ][ 2 ].z, ( *path )[ segment_it ][ 3 ].z, t );
 
+      float yaw   = _camera->BezierCalculation( ( *path )[ segment_it ][ 4 ].x, ( *path )[ segment_it ][ 5 ].x, ( *path )[ segment_it ][ 6 ].x, ( *path )[ segment_it ][ 7 ].x, t );
+      float pitch = _camera->BezierCalculation( ( *path )[ segment_it ][ 4 ].y, ( *path )[ segment_it ][ 5 ].y, ( *path )[ segment_it ][ 6 ].y, ( *path )[ segment_it ][ 7 ].y, t );
 
-    // Draw _room3_table1 depth
-    // ------------------------
-    model_matrix = _room3_table1._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _room3_table1_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+      glm::vec3 front;
+      front.x = cos( glm::radians( yaw ) ) * cos( glm::radians( pitch ) );
+      front.y = sin( glm::radians( pitch ) );
+      front.z = sin( glm::radians( yaw ) ) * cos( glm::radians( pitch ) );
 
+      glm::mat4 view_matrix = glm::lookAt( position, position + glm::normalize( front ), _camera->_up );
+      glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( view_matrix ) );
 
-    // Draw _room3_table2 depth
-    // ------------------------
-    model_matrix = _room3_table2._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _room3_table2_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+      glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
+      // Opaque objects first, then see-through objects are only depth tested against them
+      DemoPVSObjectsIDRendering( true );
+      StateCache::DepthMask( GL_FALSE );
+      DemoPVSObjectsIDRendering( false );
+      StateCache::DepthMask( GL_TRUE );
 
-    // Draw _helmet depth
-    // ------------------
-    model_matrix = _helmet._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _helmet_model->DrawDepth( _point_shadow_depth_shader, model_matrix );
+      // Every ID left in the buffer is visible from this sample
+      glReadPixels( 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[ 0 ] );
 
+      for( unsigned int pixel_it = 0; pixel_it < pixels.size(); pixel_it += 4 )
+      {
+        unsigned int ID = pixels[ pixel_it ] | ( pixels[ pixel_it + 1 ] << 8 );
+        
+        if( ID > 0 && ID <= _demo_PVS_object_count )
+        {
+          segment_PVS[ ID - 1 ] = true;
+        }
+      }
+    }
 
-    // Draw _knife depth
-    // -----------------
-    model_matrix = _knife._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _knife_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+    _demo_PVS.push_back( segment_PVS );
+  }
 
+  StateCache::UseProgram( 0 );
 
-    // Draw _grenade depth
-    // -------------------
-    model_matrix = _grenade._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _grenade_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
 
+  // Delete the ID buffer and restore the window viewport
+  // ----------------------------------------------------
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
+  StateCache::DeleteFramebuffers( 1, &ID_FBO );
+  StateCache::DeleteTextures( 1, &ID_texture );
+  glDeleteRenderbuffers( 1, &ID_depth_RBO );
+  glViewport( 0, 0, _window->_width, _window->_height );
 
-    // Draw _gun4 depth
-    // ----------------
-    model_matrix = _gun4._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _gun4_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+  std::cout << "Demo path PVS baking done ( " << path->size() * _demo_PVS_samples << " samples in " << SDL_GetTicks() - start_time << " ms )." << std::endl;
+}
 
+void Scene::DemoPVSObjectsIDRendering( bool iOpaque )
+{
+  glm::vec3 ID_color;
 
-    // Draw _gun5 depth
-    // ----------------
-    model_matrix = _gun5._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _gun5_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
 
+  // Walls and grounds ID rendering
+  // ------------------------------
+  for( unsigned int wall_it = 0; wall_it < _walls_type1.size(); wall_it++ )
+  {
+    Object * wall = &_walls_type1[ wall_it ];
 
-    // Draw _room3_table3 depth
-    // ------------------------
-    model_matrix = _room3_table3._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _room3_table3_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+    if( ( wall->_alpha == 1.0 && !wall->_opacity_map ) == iOpaque )
+    {
+      ID_color = DemoPVSIDToColor( wall->_PVS_id );
+      glUniform3fv( glGetUniformLocation( _flat_color_shader._program, "uColor" ), 1, &ID_color[ 0 ] );
+      glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( wall->_model_matrix ) );
 
+      StateCache::BindVertexArray( _plane_depth_VAO );
+      glDrawElements( GL_TRIANGLES, _wall1_indices.size(), GL_UNSIGNED_INT, 0 );
+    }
+  }
 
-    // Draw _katana depth
-    // ------------------
-    model_matrix = _katana._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _katana_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+  for( unsigned int ground_it = 0; ground_it < _grounds_type1.size(); ground_it++ )
+  {
+    Object * ground = &_grounds_type1[ ground_it ];
 
+    if( ( ground->_alpha == 1.0 && !ground->_opacity_map ) == iOpaque )
+    {
+      ID_color = DemoPVSIDToColor( ground->_PVS_id );
+      glUniform3fv( glGetUniformLocation( _flat_color_shader._program, "uColor" ), 1, &ID_color[ 0 ] );
+      glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( ground->_model_matrix ) );
 
-    // Draw _helmet2 depth
-    // -------------------
-    model_matrix = _helmet2._model_matrix;
-    glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    _helmet2_model->DrawDepth( _point_shadow_depth_shader, model_matrix ); 
+      StateCache::BindVertexArray( _plane_depth_VAO );
+      glDrawElements( GL_TRIANGLES, _ground1_indices.size(), GL_UNSIGNED_INT, 0 );
+    }
   }
 
+  StateCache::BindVertexArray( 0 );
+
+
+  // Props ID rendering ( doors and lights are always drawn and never occlude, they move or are too thin )
+  // -----------------------------------------------------------------------------------------------------
+  for( unsigned int room_it = 0; room_it < _room_props.size(); room_it++ )
+  {
+    for( unsigned int prop_it = 0; prop_it < _room_props[ room_it ].size(); prop_it++ )
+    {
+      Object * prop = _room_props[ room_it ][ prop_it ]._object;
+
+      if( ( prop->_alpha == 1.0 && !prop->_opacity_map ) == iOpaque )
+      {
+        ID_color = DemoPVSIDToColor( prop->_PVS_id );
+        glUniform3fv( glGetUniformLocation( _flat_color_shader._program, "uColor" ), 1, &ID_color[ 0 ] );
 
-  glUseProgram( 0 );
-  glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+        _room_props[ room_it ][ prop_it ]._model->DrawDepth( _flat_color_shader, prop->_model_matrix );
+      }
+    }
+  }
 }
 
-void Scene::SceneForwardRendering()
+glm::vec3 Scene::DemoPVSIDToColor( unsigned int iPVSID )
 {
+  // 0 is kept for the background, IDs are stored on 16 bits in the red and green RGBA8 channels
+  unsigned int ID = iPVSID + 1;
 
-  Shader * current_shader;
-  glm::mat4 model_matrix;
+  return glm::vec3( ( float )( ID & 0xFF ) / 255.0, ( float )( ( ID >> 8 ) & 0xFF ) / 255.0, 0.0 );
+}
 
+bool Scene::DemoPVSLoading()
+{
+  std::ifstream file( DEMO_PVS_FILE, std::ios::binary );
 
-  // Bind correct buffer for drawing
-  // -------------------------------
-  glViewport( 0, 0, _window->_width, _window->_height );
-  glBindFramebuffer( GL_FRAMEBUFFER, _window->_toolbox->_temp_hdr_FBO );
-  glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+  if( !file.is_open() )
+  {
+    return false;
+  }
 
+  unsigned int hash;
+  unsigned int segment_count;
+  unsigned int object_count;
 
-  // Draw skybox
-  // -----------
-  /*glDepthMask( GL_FALSE ); // desactivé juste pour draw la skybox
-  _skybox_shader.Use();   
-  glm::mat4 skybox_view_matrix = glm::mat4( glm::mat3( _camera->_view_matrix ) );  // Remove any translation component of the view matrix
+  file.read( ( char * )&hash, sizeof( hash ) );
+  file.read( ( char * )&segment_count, sizeof( segment_count ) );
+  file.read( ( char * )&object_count, sizeof( object_count ) );
 
-  model_matrix = glm::mat4( 1.0f );
-  glUniformMatrix4fv( glGetUniformLocation( _skybox_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-  glUniformMatrix4fv( glGetUniformLocation( _skybox_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( skybox_view_matrix ) );
-  glUniformMatrix4fv( glGetUniformLocation( _skybox_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-  glUniform1f( glGetUniformLocation( _skybox_shader._program, "uAlpha" ), 1.0 );
+  if( !file || hash != _demo_PVS_hash || segment_count != _camera->_demo_bezier_data.size() || object_count != _demo_PVS_object_count )
+  {
+    std::cout << "Demo path PVS file out of date." << std::endl;
+    return false;
+  }
 
-  glUniform1i( glGetUniformLocation( _skybox_shader._program, "uBloom" ), false );
-  glUniform1f( glGetUniformLocation( _skybox_shader._program, "uBloomBrightness" ), 1.0 );
+  // One bit per object, packed by 8
+  unsigned int segment_bytes = ( object_count + 7 ) / 8;
+  std::vector< unsigned char > bytes( segment_bytes );
 
-  glActiveTexture( GL_TEXTURE0 );
-  glBindTexture( GL_TEXTURE_CUBE_MAP, _walls_type1[ 0 ]._IBL_cubemaps[ 0 ] ); 
-  //glBindTexture( GL_TEXTURE_CUBE_MAP,_revolving_door[ 0 ]._IBL_cubemaps[ 0 ] ); 
+  _demo_PVS.clear();
 
-  _window->_toolbox->RenderCube();
+  for( unsigned int segment_it = 0; segment_it < segment_count; segment_it++ )
+  {
+    file.read( ( char * )&bytes[ 0 ], segment_bytes );
 
-  glDepthMask( GL_TRUE );  // réactivé pour draw le reste
-  glUseProgram( 0 );*/
+    if( !file )
+    {
+      std::cout << "ERROR::DEMO_PVS::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+      _demo_PVS.clear();
+      return false;
+    }
 
+    std::vector< bool > segment_PVS( object_count, false );
 
-  // Draw lamps
-  // ----------
-  /*_flat_color_shader.Use();
+    for( unsigned int object_it = 0; object_it < object_count; object_it++ )
+    {
+      segment_PVS[ object_it ] = ( bytes[ object_it / 8 ] >> ( object_it % 8 ) ) & 1;
+    }
 
-  for( int i = 0; i < _lights.size(); i++ )
-  {
-    model_matrix= glm::mat4();
-    model_matrix = glm::translate( model_matrix, _lights[ i ]._position );
-    model_matrix = glm::scale( model_matrix, glm::vec3( 0.04f ) ); 
-    glm::vec3 lamp_color = _lights[ i ]._color * _lights[ i ]._intensity;
-    glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uViewMatrix" ) , 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniform3f( glGetUniformLocation( _flat_color_shader._program, "uColor" ), lamp_color.x, lamp_color.y, lamp_color.z );
+    _demo_PVS.push_back( segment_PVS );
+  }
 
-    glUniform1i( glGetUniformLocation( _flat_color_shader._program, "uBloom" ), true );
-    glUniform1f( glGetUniformLocation( _flat_color_shader._program, "uBloomBrightness" ), 1.0f );
+  std::cout << "Demo path PVS loaded from " << DEMO_PVS_FILE << "." << std::endl;
 
-    _sphere_model->Draw( _flat_color_shader, model_matrix );
-  }
-  glBindVertexArray( 0 );
-  glUseProgram( 0 );*/
+  return true;
+}
 
+void Scene::DemoPVSSaving()
+{
+  std::ofstream file( DEMO_PVS_FILE, std::ios::binary | std::ios::trunc );
 
-  // Draw grounds type 1
-  // -------------------
-  for( int ground_it = _grounds_start_it; ground_it < _grounds_end_it; ground_it ++ )
+  if( !file.is_open() )
   {
-    ( _grounds_type1[ ground_it ]._height_map == true ) ? current_shader = &_forward_displacement_pbr_shader : current_shader = &_forward_pbr_shader; 
+    std::cout << "ERROR::DEMO_PVS::FILE_NOT_SUCCESFULLY_WRITTEN" << std::endl;
+    return;
+  }
 
-    current_shader->Use();
+  unsigned int segment_count = _demo_PVS.size();
 
-    model_matrix = _grounds_type1[ ground_it ]._model_matrix; 
-   
-    // Textures binding
-    glActiveTexture( GL_TEXTURE0 );
-    glBindTexture( GL_TEXTURE_2D, _loaded_materials[ _grounds_type1[ ground_it ]._material_id ][ 0 ] );  
-    glActiveTexture( GL_TEXTURE1 );
-    glBindTexture( GL_TEXTURE_2D, _loaded_materials[ _grounds_type1[ ground_it ]._material_id ][ 1 ] ); 
-    glActiveTexture( GL_TEXTURE2 );
-    glBindTexture( GL_TEXTURE_2D, _loaded_materials[ _grounds_type1[ ground_it ]._material_id ][ 2 ] ); 
-    glActiveTexture( GL_TEXTURE3 );
-    glBindTexture( GL_TEXTURE_2D, _loaded_materials[ _grounds_type1[ ground_it ]._material_id ][ 3 ] ); 
-    glActiveTexture( GL_TEXTURE4 );
-    glBindTexture( GL_TEXTURE_2D, _loaded_materials[ _grounds_type1[ ground_it ]._material_id ][ 4 ] ); 
-    glActiveTexture( GL_TEXTURE5 );
-    glBindTexture( GL_TEXTURE_2D, _loaded_materials[ _grounds_type1[ ground_it ]._material_id ][ 5 ] ); 
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _grounds_type1[ ground_it ]._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _grounds_type1[ ground_it ]._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture );
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+  file.write( ( char * )&_demo_PVS_hash, sizeof( _demo_PVS_hash ) );
+  file.write( ( char * )&segment_count, sizeof( segment_count ) );
+  file.write( ( char * )&_demo_PVS_object_count, sizeof( _demo_PVS_object_count ) );
 
-    // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
+  unsigned int segment_bytes = ( _demo_PVS_object_count + 7 ) / 8;
 
-    glUniform3fv( glGetUniformLocation( current_shader->_program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  for( unsigned int segment_it = 0; segment_it < segment_count; segment_it++ )
+  {
+    std::vector< unsigned char > bytes( segment_bytes, 0 );
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
+    for( unsigned int object_it = 0; object_it < _demo_PVS_object_count; object_it++ )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( current_shader->_program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
+      if( _demo_PVS[ segment_it ][ object_it ] )
+      {
+        bytes[ object_it / 8 ] |= ( 1 << ( object_it % 8 ) );
+      }
     }
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uBloom" ), _grounds_type1[ ground_it ]._bloom );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uBloomBrightness" ), _grounds_type1[ ground_it ]._bloom_brightness );
+    file.write( ( char * )&bytes[ 0 ], segment_bytes );
+  }
+}
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uIBL" ), _grounds_type1[ ground_it ]._IBL );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uParallaxCubemap" ), _grounds_type1[ ground_it ]._parallax_cubemap );
-    glUniform3fv( glGetUniformLocation( current_shader->_program, "uCubemapPos" ), 1, &_grounds_type1[ ground_it ]._IBL_position[ 0 ] );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uIsWall" ), false );
+bool Scene::IsInDemoPVS( unsigned int iPVSID )
+{
+  // Only the scripted camera has a known path => free camera always draws everything
+  if( !_demo_PVS_culling || !_camera->_demo_script || _demo_PVS.empty() )
+  {
+    return true;
+  }
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uAlpha" ), _grounds_type1[ ground_it ]._alpha );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uOpacityMap" ), _grounds_type1[ ground_it ]._opacity_map );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uDisplacementFactor" ), -_grounds_type1[ ground_it ]._displacement_factor );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uTessellationFactor" ), _grounds_type1[ ground_it ]._tessellation_factor );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uNormalMap" ), _grounds_type1[ ground_it ]._normal_map );
+  return _demo_PVS[ _camera->_bezier_step ][ iPVSID ];
+}
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uReceivShadow" ), _grounds_type1[ ground_it ]._receiv_shadow );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowBias" ), _grounds_type1[ ground_it ]._shadow_bias );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowDarkness" ), _grounds_type1[ ground_it ]._shadow_darkness );
+void Scene::DeferredBuffersInitialization()
+{
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uEmissive" ), _grounds_type1[ ground_it ]._emissive );
-    if( _grounds_type1[ ground_it ]._emissive )
+  // G buffer initialization
+  // -----------------------
+  // Compact layout, position is rebuilt from depth => 16 bytes per pixel against 36 before.
+  // Its textures are frame graph targets, attached each time the graph is built.
+  glGenFramebuffers( 1, &_g_buffer_FBO );
+
+  glGenQueries( 2, _deferred_time_queries );
+  glGenQueries( 2, _geometry_time_queries );
+}
+
+void Scene::ShadowAtlasInitialization()
+{
+  // Linear distance fits 16 bits while one step stays under a millimeter
+  _shadow_depth_16_bits = ( _shadow_far / 65535.0 ) < 0.001;
+
+  unsigned int texel_size = _shadow_depth_16_bits ? 2 : 4;
+  _shadow_atlas_memory    = 0.0;
+  _shadow_baseline_memory = 0.0;
+
+  _shadow_slots.clear();
+  _shadow_slots_order.clear();
+  _light_shadow_slot.assign( _lights.size(), -1 );
+
+  glGenFramebuffers( 1, &_window->_toolbox->_static_depth_map_FBO );
+  glGenFramebuffers( 1, &_window->_toolbox->_depth_map_FBO );
+
+  for( unsigned int tier_it = 0; tier_it < SHADOW_ATLAS_TIER_COUNT; tier_it++ )
+  {
+    // Static casters cache and atlas with dynamic casters over it
+    unsigned int * cubemap_arrays[ 2 ] = { &_window->_toolbox->_static_shadow_atlas[ tier_it ], &_window->_toolbox->_shadow_atlas[ tier_it ] };
+
+    for( unsigned int array_it = 0; array_it < 2; array_it++ )
     {
-      glActiveTexture( GL_TEXTURE11 );
-      glBindTexture( GL_TEXTURE_2D, _loaded_materials[ _grounds_type1[ ground_it ]._material_id ][ 6 ] );
-      glUniform1f( glGetUniformLocation( current_shader->_program, "uEmissiveFactor" ), _grounds_type1[ ground_it ]._emissive_factor );
+      glGenTextures( 1, cubemap_arrays[ array_it ] );
+      StateCache::BindTexture( GL_TEXTURE_CUBE_MAP_ARRAY, *cubemap_arrays[ array_it ] );
+      glTexImage3D( GL_TEXTURE_CUBE_MAP_ARRAY,
+                    0,
+                    _shadow_depth_16_bits ? GL_DEPTH_COMPONENT16 : GL_DEPTH_COMPONENT32F,
+                    _shadow_atlas_res[ tier_it ],
+                    _shadow_atlas_res[ tier_it ],
+                    _shadow_atlas_layers[ tier_it ] * 6,
+                    0,
+                    GL_DEPTH_COMPONENT,
+                    GL_FLOAT,
+                    NULL );
+      glTexParameteri( GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+      glTexParameteri( GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+      glTexParameteri( GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+      glTexParameteri( GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+      glTexParameteri( GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE );
+
+      _shadow_atlas_memory    += ( float )texel_size * _shadow_atlas_res[ tier_it ] * _shadow_atlas_res[ tier_it ] * _shadow_atlas_layers[ tier_it ] * 6;
+      _shadow_baseline_memory += 4.0 * 2048.0 * 2048.0 * _shadow_atlas_layers[ tier_it ] * 6;
     }
 
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uID" ), _grounds_type1[ ground_it ]._id );  
+    for( unsigned int layer_it = 0; layer_it < _shadow_atlas_layers[ tier_it ]; layer_it++ )
+    {
+      ShadowSlot slot;
+      slot._light         = -1;
+      slot._tier          = tier_it;
+      slot._layer         = layer_it;
+      slot._ready         = false;
+      slot._static_faces  = 0;
+      slot._refresh_faces = 0;
+      slot._dynamic_faces = 0;
+      slot._moment_faces  = 0;
+      _shadow_slots.push_back( slot );
+    }
+  }
+  StateCache::BindTexture( GL_TEXTURE_CUBE_MAP_ARRAY, 0 );
 
-    ( _grounds_type1[ ground_it ]._id == 18 ) ? glBindVertexArray( _ground2_VAO ) : glBindVertexArray( _ground1_VAO );
-    ( _grounds_type1[ ground_it ]._height_map == true ) ? glDrawElements( GL_PATCHES, _ground1_indices.size(), GL_UNSIGNED_INT, 0 ) : glDrawElements( GL_TRIANGLES, _ground1_indices.size(), GL_UNSIGNED_INT, 0 );
-    glBindVertexArray( 0 );
-    glUseProgram( 0 );
+  // Depth only FBOs, atlas layers are attached in turn during the depth pass
+  unsigned int depth_map_FBOs[ 2 ] = { _window->_toolbox->_static_depth_map_FBO, _window->_toolbox->_depth_map_FBO };
+  for( unsigned int FBO_it = 0; FBO_it < 2; FBO_it++ )
+  {
+    StateCache::BindFramebuffer( GL_FRAMEBUFFER, depth_map_FBOs[ FBO_it ] );
+    glDrawBuffer( GL_NONE );
+    glReadBuffer( GL_NONE );
   }
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+  // Hardware depth comparison with bilinear weights, only bound over the atlas in the Poisson filtering mode
+  glGenSamplers( 1, &_shadow_compare_sampler );
+  glSamplerParameteri( _shadow_compare_sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+  glSamplerParameteri( _shadow_compare_sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+  glSamplerParameteri( _shadow_compare_sampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+  glSamplerParameteri( _shadow_compare_sampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+  glSamplerParameteri( _shadow_compare_sampler, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE );
+  glSamplerParameteri( _shadow_compare_sampler, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE );
+  glSamplerParameteri( _shadow_compare_sampler, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL );
+
+  // Depth pass GPU timers, read back one frame later
+  glGenQueries( 2, _shadow_time_queries );
+  _shadow_query_it                = 0;
+  _shadow_pass_time               = 0.0;
+  _shadow_pass_time_samples       = 0;
+  _shadow_texels_updated          = 0.0;
+  _shadow_baseline_texels_updated = 0.0;
+
+  std::cout << "Shadow atlas : " << _shadow_slots.size() << " slots, " 
+            << ( _shadow_depth_16_bits ? "16" : "32" ) << " bits depth, " 
+            << _shadow_atlas_memory / ( 1024.0 * 1024.0 ) << " MB ( fixed 2048 float slots : " 
+            << _shadow_baseline_memory / ( 1024.0 * 1024.0 ) << " MB )" << std::endl;
+}
 
+float Scene::ShadowImportance( unsigned int iLightIt )
+{
+  PointLight * light = &_lights[ iLightIt ];
+  glm::mat4 view_projection_matrix = _camera->_projection_matrix * _camera->_view_matrix;
 
-  // Draw walls type 1
-  // -----------------
-  for( unsigned int wall_it = _walls_start_it; wall_it < _walls_end_it; wall_it++ )
+  // Benchmark lights never get a shadow slot
+  if( !light->_casts_shadow )
   {
-    ( _walls_type1[ wall_it ]._height_map == true ) ? current_shader = &_forward_displacement_pbr_shader : current_shader = &_forward_pbr_shader; 
+    return 0.0;
+  }
 
-    current_shader->Use();
+  // Light volume out of view
+  if( !SphereInFrustum( &view_projection_matrix, light->_position, light->_max_lighting_distance ) )
+  {
+    return 0.0;
+  }
 
-    model_matrix = _walls_type1[ wall_it ]._model_matrix;
+  // Light volume projected size, full screen when the camera is inside
+  float projected_size = light->_max_lighting_distance / glm::max( glm::length( light->_position - _camera->_position ), light->_max_lighting_distance );
 
-    // Textures binding
-    glActiveTexture( GL_TEXTURE0 );
-    glBindTexture( GL_TEXTURE_2D, _loaded_materials[ _walls_type1[ wall_it ]._material_id ][ 0 ] );  
-    glActiveTexture( GL_TEXTURE1 );
-    glBindTexture( GL_TEXTURE_2D, _loaded_materials[ _walls_type1[ wall_it ]._material_id ][ 1 ] ); 
-    glActiveTexture( GL_TEXTURE2 );
-    glBindTexture( GL_TEXTURE_2D, _loaded_materials[ _walls_type1[ wall_it ]._material_id ][ 2 ] ); 
-    glActiveTexture( GL_TEXTURE3 );
-    glBindTexture( GL_TEXTURE_2D, _loaded_materials[ _walls_type1[ wall_it ]._material_id ][ 3 ] ); 
-    glActiveTexture( GL_TEXTURE4 );
-    glBindTexture( GL_TEXTURE_2D, _loaded_materials[ _walls_type1[ wall_it ]._material_id ][ 4 ] ); 
-    glActiveTexture( GL_TEXTURE5 );
-    glBindTexture( GL_TEXTURE_2D, _loaded_materials[ _walls_type1[ wall_it ]._material_id ][ 5 ] ); 
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _walls_type1[ wall_it ]._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _walls_type1[ wall_it ]._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture );
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+  return projected_size * projected_size * light->_intensity;
+}
 
-    // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
+unsigned int Scene::ShadowWantedTier( unsigned int iLightIt )
+{
+  PointLight * light = &_lights[ iLightIt ];
 
-    glUniform3fv( glGetUniformLocation( current_shader->_program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  // Light volume projected diameter in pixels, screen height when the camera is inside
+  float distance = glm::length( light->_position - _camera->_position );
+  float diameter = ( float )_window->_height;
+  if( distance > light->_max_lighting_distance )
+  {
+    diameter = glm::min( diameter, ( light->_max_lighting_distance / distance ) * _camera->_projection_matrix[ 1 ][ 1 ] * ( float )_window->_height );
+  }
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
+  // Smallest pool resolution covering it
+  unsigned int tier_it = 0;
+  while( tier_it + 1 < SHADOW_ATLAS_TIER_COUNT && ( float )_shadow_atlas_res[ tier_it + 1 ] >= diameter )
+  {
+    tier_it++;
+  }
+
+  return tier_it;
+}
+
+void Scene::ShadowAtlasAllocation()
+{
+
+  // Rank visible lights, slot owners get a bonus to avoid slots ping-pong
+  // ---------------------------------------------------------------------
+  std::vector< std::pair< float, int > > ranking;
+  for( unsigned int light_it = 0; light_it < _lights.size(); light_it++ )
+  {
+    float importance = ShadowImportance( light_it );
+    if( importance <= 0.0 )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( current_shader->_program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
+      continue;
     }
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uBloom" ), _walls_type1[ wall_it ]._bloom );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uBloomBrightness" ), _walls_type1[ wall_it ]._bloom_brightness );
+    if( _light_shadow_slot[ light_it ] >= 0 )
+    {
+      importance *= 1.25;
+    }
+    ranking.push_back( std::make_pair( importance, light_it ) );
+  }
+  std::sort( ranking.rbegin(), ranking.rend() );
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uIBL" ), _walls_type1[ wall_it ]._IBL );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uParallaxCubemap" ), _walls_type1[ wall_it ]._parallax_cubemap );
-    glUniform3fv( glGetUniformLocation( current_shader->_program, "uCubemapPos" ), 1, &_walls_type1[ wall_it ]._IBL_position[ 0 ] );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uIsWall" ), true );
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uAlpha" ), _walls_type1[ wall_it ]._alpha );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uOpacityMap" ), _walls_type1[ wall_it ]._opacity_map );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uDisplacementFactor" ), -_walls_type1[ wall_it ]._displacement_factor );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uTessellationFactor" ), _walls_type1[ wall_it ]._tessellation_factor );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uNormalMap" ), _walls_type1[ wall_it ]._normal_map );
+  // Wanted tier from projected size, next smaller resolution when the pool is full
+  // -----------------------------------------------------------------------------
+  std::vector< int > wanted_tier( _lights.size(), -1 );
+  unsigned int tier_use[ SHADOW_ATLAS_TIER_COUNT ] = { 0 };
+  for( unsigned int rank_it = 0; rank_it < ranking.size(); rank_it++ )
+  {
+    unsigned int light_it = ranking[ rank_it ].second;
+    unsigned int tier_it  = ShadowWantedTier( light_it );
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uReceivShadow" ), _walls_type1[ wall_it ]._receiv_shadow );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowBias" ), _walls_type1[ wall_it ]._shadow_bias );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowDarkness" ), _walls_type1[ wall_it ]._shadow_darkness );
+    // Keep the owned slot while one tier away to avoid reallocation on tiny moves
+    int slot_it = _light_shadow_slot[ light_it ];
+    if( slot_it >= 0 )
+    {
+      unsigned int owned_tier = _shadow_slots[ slot_it ]._tier;
+      if( abs( ( int )owned_tier - ( int )tier_it ) <= 1 && tier_use[ owned_tier ] < _shadow_atlas_layers[ owned_tier ] )
+      {
+        tier_it = owned_tier;
+      }
+    }
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uEmissive" ), _walls_type1[ wall_it ]._emissive );
-    if( _walls_type1[ wall_it ]._emissive )
+    while( tier_it < SHADOW_ATLAS_TIER_COUNT && tier_use[ tier_it ] == _shadow_atlas_layers[ tier_it ] )
     {
-      glActiveTexture( GL_TEXTURE11 );
-      glBindTexture( GL_TEXTURE_2D, _loaded_materials[ _walls_type1[ wall_it ]._material_id ][ 6 ] );
-      glUniform1f( glGetUniformLocation( current_shader->_program, "uEmissiveFactor" ), _walls_type1[ wall_it ]._emissive_factor );
+      tier_it++;
+    }
+    if( tier_it == SHADOW_ATLAS_TIER_COUNT )
+    {
+      continue;
     }
-    
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uID" ), _walls_type1[ wall_it ]._id );  
 
-    ( _walls_type1[ wall_it ]._id == 4 ) ? glBindVertexArray( _wall2_VAO ) : glBindVertexArray( _wall1_VAO );
-    ( _walls_type1[ wall_it ]._height_map == true ) ? glDrawElements( GL_PATCHES, _wall1_indices.size(), GL_UNSIGNED_INT, 0 ) : glDrawElements( GL_TRIANGLES, _wall1_indices.size(), GL_UNSIGNED_INT, 0 );
-    glBindVertexArray( 0 );
-    glUseProgram( 0 );
+    wanted_tier[ light_it ] = tier_it;
+    tier_use[ tier_it ]++;
   }
 
 
-  // Draw simple doors
-  // -----------------
-  glEnable( GL_CULL_FACE );
-  glCullFace( GL_BACK );
-  _forward_pbr_shader.Use();
-
-  // Matrices uniforms
-  glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-  glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-  glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
-
-  // Point lights uniforms
-  glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-  for( int i = 0; i < _lights.size(); i++ )
+  // Release slots of lights changing tier or losing their slot
+  // ----------------------------------------------------------
+  for( unsigned int slot_it = 0; slot_it < _shadow_slots.size(); slot_it++ )
   {
-    string temp = to_string( i );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-    glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
+    ShadowSlot * slot = &_shadow_slots[ slot_it ];
+    if( slot->_light >= 0 && wanted_tier[ slot->_light ] != ( int )slot->_tier )
+    {
+      _light_shadow_slot[ slot->_light ] = -1;
+      slot->_light = -1;
+      slot->_ready = false;
+    }
   }
 
-  // IBL uniforms
-  glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), true );
-  glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-  glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), false );
 
+  // Give free slots to waiting lights
+  // ---------------------------------
+  for( unsigned int light_it = 0; light_it < _lights.size(); light_it++ )
+  {
+    if( wanted_tier[ light_it ] < 0 || _light_shadow_slot[ light_it ] >= 0 )
+    {
+      continue;
+    }
 
-  for( int door_it = 0; door_it < _simple_door.size(); door_it++ )
-  { 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _simple_door[ door_it ]._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _simple_door[ door_it ]._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+    for( unsigned int slot_it = 0; slot_it < _shadow_slots.size(); slot_it++ )
+    {
+      ShadowSlot * slot = &_shadow_slots[ slot_it ];
+      if( slot->_light >= 0 || ( int )slot->_tier != wanted_tier[ light_it ] )
+      {
+        continue;
+      }
 
-    model_matrix = _simple_door[ door_it ]._model_matrix;
+      slot->_light         = light_it;
+      slot->_ready         = false;
+      slot->_static_faces  = 0;
+      slot->_refresh_faces = 0;
+      slot->_dynamic_faces = 0;
+      slot->_moment_faces  = 0;
+      slot->_dynamic_state.clear();
+      _light_shadow_slot[ light_it ] = slot_it;
+      _shadow_slot_assign_count++;
+      break;
+    }
+  }
 
-    // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _simple_door[ door_it ]._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _simple_door[ door_it ]._bloom_brightness );
+  // Main shadow light is the most important one with a ready slot
+  // -------------------------------------------------------------
+  _current_shadow_light_source = -1;
+  _shadow_slots_order.clear();
+  for( unsigned int rank_it = 0; rank_it < ranking.size(); rank_it++ )
+  {
+    int slot_it = _light_shadow_slot[ ranking[ rank_it ].second ];
+    if( slot_it < 0 )
+    {
+      continue;
+    }
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _simple_door[ door_it ]._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _simple_door[ door_it ]._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _simple_door[ door_it ]._normal_map );
+    _shadow_slots_order.push_back( slot_it );
+    if( _current_shadow_light_source < 0 && _shadow_slots[ slot_it ]._ready )
+    {
+      _current_shadow_light_source = ranking[ rank_it ].second;
+    }
+  }
+}
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _simple_door[ door_it ]._emissive );
+void Scene::SceneDepthPass()
+{
+  ShadowAtlasAllocation();
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _simple_door[ door_it ]._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _simple_door[ door_it ]._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _simple_door[ door_it ]._shadow_darkness );
+  // Collect previous frame depth pass GPU time
+  GLuint64 elapsed_time = 0;
+  if( _shadow_query_it > 0 )
+  {
+    glGetQueryObjectui64v( _shadow_time_queries[ ( _shadow_query_it - 1 ) % 2 ], GL_QUERY_RESULT, &elapsed_time );
+    _shadow_pass_time += elapsed_time / 1000000.0;
+    _shadow_pass_time_samples++;
+  }
+  glBeginQuery( GL_TIME_ELAPSED, _shadow_time_queries[ _shadow_query_it % 2 ] );
+  _shadow_query_it++;
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _simple_door[ door_it ]._id );      
+  unsigned int budget = _shadow_face_budget;
+  _shadow_triangle_count    = 0;
+  _shadow_face_update_count = 0;
 
-    _simple_door_model->Draw( _forward_pbr_shader, model_matrix );
+
+  // Shadow casters, every rooms props are static, the revolving door is dynamic
+  // ---------------------------------------------------------------------------
+  std::vector< SceneProp > all_static_casters;
+  for( unsigned int room_it = 0; room_it < _room_props.size(); room_it++ )
+  {
+    all_static_casters.insert( all_static_casters.end(), _room_props[ room_it ].begin(), _room_props[ room_it ].end() );
   }
 
-  glUseProgram( 0 );
-  glDisable( GL_CULL_FACE );
+  SceneProp door_caster;
+  door_caster._object    = &_revolving_door[ 0 ];
+  door_caster._model     = _revolving_door_model;
+  door_caster._cull_face = false;
 
+  _point_shadow_depth_shader.Use();   
+  glUniform1f( glGetUniformLocation( _point_shadow_depth_shader._program, "uShadowFar" ), _shadow_far );
 
-  // Draw top lights
-  // ---------------
-  glEnable( GL_CULL_FACE );
-  glCullFace( GL_BACK );
-  _forward_pbr_shader.Use();
-
-  for( int light_it = 0; light_it < _top_light.size(); light_it++ )
-  { 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _top_light[ light_it ]._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _top_light[ light_it ]._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
-
-    model_matrix = _top_light[ light_it ]._model_matrix;
-
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
+  // Update slots by importance order within the frame faces budget
+  // --------------------------------------------------------------
+  for( unsigned int order_it = 0; order_it < _shadow_slots_order.size() && budget > 0; order_it++ )
+  {
+    ShadowSlot * slot = &_shadow_slots[ _shadow_slots_order[ order_it ] ];
+    if( slot->_light < 0 )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
+      continue;
     }
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _top_light[ light_it ]._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _top_light[ light_it ]._parallax_cubemap );
-
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _top_light[ light_it ]._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _top_light[ light_it ]._bloom_brightness );
-
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _top_light[ light_it ]._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _top_light[ light_it ]._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _top_light[ light_it ]._normal_map );
+    unsigned int res             = _shadow_atlas_res[ slot->_tier ];
+    unsigned int static_atlas    = _window->_toolbox->_static_shadow_atlas[ slot->_tier ];
+    unsigned int atlas           = _window->_toolbox->_shadow_atlas[ slot->_tier ];
+    std::vector< glm::mat4 > shadow_transform_matrices;
+    ShadowTransformMatrices( slot->_light, res, &shadow_transform_matrices );
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _top_light[ light_it ]._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _top_light[ light_it ]._emissive_factor );
+    glViewport( 0, 0, res, res );
+    glUniform3fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uLightPosition" ), 1, &_lights[ slot->_light ]._position[ 0 ] );
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _top_light[ light_it ]._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _top_light[ light_it ]._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _top_light[ light_it ]._shadow_darkness );
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _top_light[ light_it ]._id );      
+    // Static casters cache faces, rendered once per slot assignment
+    if( slot->_static_faces != 0x3F )
+    {
+      std::vector< SceneProp > static_casters = all_static_casters;
+      std::vector< glm::vec3 > static_casters_center;
+      std::vector< float >     static_casters_radius;
+      ShadowCastersCulling( slot->_light, &static_casters, &static_casters_center, &static_casters_radius );
 
-    _top_light_model->Draw( _forward_pbr_shader, model_matrix );
-  }
+      StateCache::BindFramebuffer( GL_FRAMEBUFFER, _window->_toolbox->_static_depth_map_FBO );
 
-  glUseProgram( 0 );
-  glDisable( GL_CULL_FACE );
+      for( unsigned int face_it = 0; face_it < 6 && budget > 0; face_it++ )
+      {
+        if( slot->_static_faces & ( 1 << face_it ) )
+        {
+          continue;
+        }
 
+        glFramebufferTextureLayer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, static_atlas, 0, slot->_layer * 6 + face_it );
+        glClear( GL_DEPTH_BUFFER_BIT );
+        ShadowCastersRendering( &static_casters, &static_casters_center, &static_casters_radius, &shadow_transform_matrices[ face_it ] );
 
-  // Draw wall lights
-  // ----------------
-  glEnable( GL_CULL_FACE );
-  glCullFace( GL_BACK );
-  _forward_pbr_shader.Use();
+        slot->_static_faces  |= 1 << face_it;
+        slot->_refresh_faces |= 1 << face_it;
+        _shadow_face_update_count++;
+        _shadow_texels_updated          += ( double )res * res;
+        _shadow_baseline_texels_updated += 2048.0 * 2048.0;
+        budget--;
+      }
+    }
 
-  for( int light_it = 0; light_it < _wall_light.size(); light_it++ )
-  { 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _wall_light[ light_it ]._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _wall_light[ light_it ]._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
 
-    model_matrix = _wall_light[ light_it ]._model_matrix;
+    // Dynamic casters, faces they touch now or touched last refresh need a refresh
+    std::vector< SceneProp > dynamic_casters;
+    std::vector< glm::vec3 > dynamic_casters_center;
+    std::vector< float >     dynamic_casters_radius;
+    std::vector< glm::mat4 > dynamic_state;
+    unsigned int             dynamic_faces = 0;
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+    dynamic_casters.push_back( door_caster );
+    ShadowCastersCulling( slot->_light, &dynamic_casters, &dynamic_casters_center, &dynamic_casters_radius );
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
+    if( !dynamic_casters.empty() )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
+      dynamic_state.push_back( _revolving_door[ 0 ]._model_matrix );
+      dynamic_state.push_back( _door_rotation_matrix );
+      dynamic_state.push_back( _door1_rotation_matrix );
+      dynamic_state.push_back( _door2_rotation_matrix );
     }
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _wall_light[ light_it ]._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _wall_light[ light_it ]._parallax_cubemap );
+    for( unsigned int face_it = 0; face_it < 6; face_it++ )
+    {
+      for( unsigned int caster_it = 0; caster_it < dynamic_casters.size(); caster_it++ )
+      {
+        if( SphereInFrustum( &shadow_transform_matrices[ face_it ], dynamic_casters_center[ caster_it ], dynamic_casters_radius[ caster_it ] ) )
+        {
+          dynamic_faces |= 1 << face_it;
+        }
+      }
+    }
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _wall_light[ light_it ]._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _wall_light[ light_it ]._bloom_brightness );
+    if( dynamic_state != slot->_dynamic_state )
+    {
+      slot->_refresh_faces |= dynamic_faces | slot->_dynamic_faces;
+      slot->_dynamic_state  = dynamic_state;
+      slot->_dynamic_faces  = dynamic_faces;
+    }
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _wall_light[ light_it ]._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _wall_light[ light_it ]._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _wall_light[ light_it ]._normal_map );
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _wall_light[ light_it ]._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _wall_light[ light_it ]._emissive_factor );
+    // Atlas faces refresh, static face copy then dynamic casters over it
+    for( unsigned int face_it = 0; face_it < 6 && budget > 0; face_it++ )
+    {
+      if( !( slot->_refresh_faces & ( 1 << face_it ) ) || !( slot->_static_faces & ( 1 << face_it ) ) )
+      {
+        continue;
+      }
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _wall_light[ light_it ]._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _wall_light[ light_it ]._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _wall_light[ light_it ]._shadow_darkness );
+      StateCache::BindFramebuffer( GL_READ_FRAMEBUFFER, _window->_toolbox->_static_depth_map_FBO );
+      glFramebufferTextureLayer( GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, static_atlas, 0, slot->_layer * 6 + face_it );
+      StateCache::BindFramebuffer( GL_DRAW_FRAMEBUFFER, _window->_toolbox->_depth_map_FBO );
+      glFramebufferTextureLayer( GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, atlas, 0, slot->_layer * 6 + face_it );
+      glBlitFramebuffer( 0, 0, res, res, 0, 0, res, res, GL_DEPTH_BUFFER_BIT, GL_NEAREST );
+
+      StateCache::BindFramebuffer( GL_FRAMEBUFFER, _window->_toolbox->_depth_map_FBO );
+      ShadowCastersRendering( &dynamic_casters, &dynamic_casters_center, &dynamic_casters_radius, &shadow_transform_matrices[ face_it ] );
+
+      slot->_refresh_faces &= ~( 1 << face_it );
+      slot->_moment_faces  &= ~( 1 << face_it );
+      _shadow_face_update_count++;
+      _shadow_texels_updated          += ( double )res * res;
+      _shadow_baseline_texels_updated += 2048.0 * 2048.0;
+      budget--;
+    }
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _wall_light[ light_it ]._id );      
+    if( slot->_static_faces == 0x3F && slot->_refresh_faces == 0 )
+    {
+      slot->_ready = true;
+    }
+  }
 
-    _wall_light_model->Draw( _forward_pbr_shader, model_matrix );
+  // Moments faces follow the atlas faces refreshed above
+  if( _shadow_filter_mode == SHADOW_FILTER_MOMENTS )
+  {
+    ShadowMomentsUpdate();
   }
 
-  glUseProgram( 0 );
-  glDisable( GL_CULL_FACE );
 
+  glEndQuery( GL_TIME_ELAPSED );
 
-  if( _current_room == 1 )
-  {
-    // Draw room1 table1
-    // -----------------
-    _forward_pbr_shader.Use();
+  StateCache::UseProgram( 0 );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
 
-    model_matrix = _room1_table1._model_matrix;
+void Scene::ShadowTransformMatrices( unsigned int               iLightIt,
+                                     unsigned int               iRes,
+                                     std::vector< glm::mat4 > * oMatrices )
+{
+  glm::vec3 light_position = _lights[ iLightIt ]._position;
+  glm::mat4 shadow_projection_matrix = glm::perspective( glm::radians( 90.0f ), 
+                                                         (float)iRes / (float)iRes,
+                                                         _shadow_near,
+                                                         _shadow_far );
+  oMatrices->clear();
+  oMatrices->push_back( shadow_projection_matrix * glm::lookAt( light_position, light_position + glm::vec3( 1.0f, 0.0f, 0.0f ), glm::vec3( 0.0f, -1.0f, 0.0f ) ) );
+  oMatrices->push_back( shadow_projection_matrix * glm::lookAt( light_position, light_position + glm::vec3( -1.0f, 0.0f, 0.0f ), glm::vec3 (0.0f, -1.0f, 0.0f ) ) );
+  oMatrices->push_back( shadow_projection_matrix * glm::lookAt( light_position, light_position + glm::vec3( 0.0f, 1.0f, 0.0f ), glm::vec3( 0.0f, 0.0f, 1.0f ) ) );
+  oMatrices->push_back( shadow_projection_matrix * glm::lookAt( light_position, light_position + glm::vec3( 0.0f, -1.0f, 0.0f ), glm::vec3( 0.0f, 0.0f, -1.0f ) ) );
+  oMatrices->push_back( shadow_projection_matrix * glm::lookAt( light_position, light_position + glm::vec3( 0.0f, 0.0f, 1.0f ), glm::vec3( 0.0f, -1.0f, 0.0f ) ) );
+  oMatrices->push_back( shadow_projection_matrix * glm::lookAt( light_position, light_position + glm::vec3( 0.0f, 0.0f, -1.0f ), glm::vec3( 0.0f, -1.0f, 0.0f ) ) );
+}
 
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _room1_table1._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _room1_table1._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+void Scene::ShadowCastersCulling( unsigned int               iLightIt,
+                                  std::vector< SceneProp > * ioCasters,
+                                  std::vector< glm::vec3 > * oCenters,
+                                  std::vector< float > *     oRadius )
+{
+  PointLight * light = &_lights[ iLightIt ];
+  
+  for( unsigned int caster_it = 0; caster_it < ioCasters->size(); )
+  {
+    glm::vec3 center;
+    float     radius;
+    ( *ioCasters )[ caster_it ]._model->WorldBoundingSphere( ( *ioCasters )[ caster_it ]._object->_model_matrix, &center, &radius );
 
-    // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
+    // A caster outside the light sphere can't shadow any lit receiver
+    if( glm::length( center - light->_position ) > radius + light->_max_lighting_distance )
+    {
+      ioCasters->erase( ioCasters->begin() + caster_it );
+      continue;
+    }
 
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+    oCenters->push_back( center );
+    oRadius->push_back( radius );
+    caster_it++;
+  }
+}
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
+bool Scene::SphereInFrustum( glm::mat4 * iViewProjectionMatrix,
+                             glm::vec3   iCenter,
+                             float       iRadius )
+{
+  // Frustum planes ( Gribb & Hartmann extraction )
+  for( unsigned int plane_it = 0; plane_it < 6; plane_it++ )
+  {
+    glm::vec4 plane;
+    float sign = ( plane_it % 2 == 0 ) ? 1.0 : -1.0;
+    for( unsigned int j = 0; j < 4; j++ )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
+      plane[ j ] = ( *iViewProjectionMatrix )[ j ][ 3 ] + sign * ( *iViewProjectionMatrix )[ j ][ plane_it / 2 ];
     }
+    plane /= glm::length( glm::vec3( plane ) );
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _room1_table1._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _room1_table1._bloom_brightness );
+    if( glm::dot( glm::vec3( plane ), iCenter ) + plane.w < -iRadius )
+    {
+      return false;
+    }
+  }
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _room1_table1._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _room1_table1._parallax_cubemap );
+  return true;
+}
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _room1_table1._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _room1_table1._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _room1_table1._normal_map );
+void Scene::ShadowCastersRendering( std::vector< SceneProp > * iCasters,
+                                    std::vector< glm::vec3 > * iCenters,
+                                    std::vector< float > *     iRadius,
+                                    glm::mat4 *                iShadowTransformMatrix )
+{
+  glUniformMatrix4fv( glGetUniformLocation( _point_shadow_depth_shader._program, "uShadowTransformMatrix" ), 1, GL_FALSE, glm::value_ptr( *iShadowTransformMatrix ) );
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _room1_table1._emissive );
+  for( unsigned int caster_it = 0; caster_it < iCasters->size(); caster_it++ )
+  {
+    if( SphereInFrustum( iShadowTransformMatrix, ( *iCenters )[ caster_it ], ( *iRadius )[ caster_it ] ) )
+    {
+      _shadow_triangle_count += ( *iCasters )[ caster_it ]._model->DrawDepth( _point_shadow_depth_shader, ( *iCasters )[ caster_it ]._object->_model_matrix );
+    }
+  }
+}
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _room1_table1._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _room1_table1._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _room1_table1._shadow_darkness );
+void Scene::ShadowMomentsInitialization()
+{
+  _shadow_moments_memory = 0.0;
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _room1_table1._id );      
+  // Moments tiers at half the atlas resolution, blur and bilinear filtering make up for it
+  for( unsigned int tier_it = 0; tier_it < SHADOW_ATLAS_TIER_COUNT; tier_it++ )
+  {
+    _shadow_moments_res[ tier_it ] = _shadow_atlas_res[ tier_it ] / 2;
 
-    _room1_table1_model->Draw( _forward_pbr_shader, model_matrix );
+    glGenTextures( 1, &_window->_toolbox->_shadow_moments_atlas[ tier_it ] );
+    StateCache::BindTexture( GL_TEXTURE_CUBE_MAP_ARRAY, _window->_toolbox->_shadow_moments_atlas[ tier_it ] );
+    glTexImage3D( GL_TEXTURE_CUBE_MAP_ARRAY,
+                  0,
+                  GL_RG32F,
+                  _shadow_moments_res[ tier_it ],
+                  _shadow_moments_res[ tier_it ],
+                  _shadow_atlas_layers[ tier_it ] * 6,
+                  0,
+                  GL_RG,
+                  GL_FLOAT,
+                  NULL );
+    glTexParameteri( GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+    glTexParameteri( GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+    glTexParameteri( GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+    glTexParameteri( GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+    glTexParameteri( GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE );
 
-    glUseProgram( 0 );
+    _shadow_moments_memory += 8.0 * _shadow_moments_res[ tier_it ] * _shadow_moments_res[ tier_it ] * _shadow_atlas_layers[ tier_it ] * 6;
+  }
+  StateCache::BindTexture( GL_TEXTURE_CUBE_MAP_ARRAY, 0 );
 
+  // Blur buffers, one face at a time in their lower left corner
+  glGenTextures( 2, _window->_toolbox->_shadow_moments_buffers );
+  for( unsigned int buffer_it = 0; buffer_it < 2; buffer_it++ )
+  {
+    StateCache::BindTexture( GL_TEXTURE_2D, _window->_toolbox->_shadow_moments_buffers[ buffer_it ] );
+    glTexImage2D( GL_TEXTURE_2D, 0, GL_RG32F, _shadow_moments_res[ 0 ], _shadow_moments_res[ 0 ], 0, GL_RG, GL_FLOAT, NULL );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
 
-    // Draw bottle
-    // -----------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
+    _shadow_moments_memory += 8.0 * _shadow_moments_res[ 0 ] * _shadow_moments_res[ 0 ];
+  }
+  StateCache::BindTexture( GL_TEXTURE_2D, 0 );
 
-    _forward_pbr_shader.Use();
+  glGenFramebuffers( 1, &_window->_toolbox->_shadow_moments_FBO );
 
-    model_matrix = _bottle._model_matrix;
+  std::cout << "Shadow moments : RG32F at half the atlas resolution, " << _shadow_moments_memory / ( 1024.0 * 1024.0 ) << " MB" << std::endl;
+}
 
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _bottle._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _bottle._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+void Scene::ShadowMomentsUpdate()
+{
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, _window->_toolbox->_shadow_moments_FBO );
+  StateCache::ActiveTexture( GL_TEXTURE0 );
 
-    // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
+  for( unsigned int slot_it = 0; slot_it < _shadow_slots.size(); slot_it++ )
+  {
+    ShadowSlot * slot = &_shadow_slots[ slot_it ];
+    if( slot->_light < 0 || !slot->_ready || slot->_moment_faces == 0x3F )
+    {
+      continue;
+    }
 
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+    int res = _shadow_moments_res[ slot->_tier ];
+    glViewport( 0, 0, res, res );
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
+    for( unsigned int face_it = 0; face_it < 6; face_it++ )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
+      if( slot->_moment_faces & ( 1 << face_it ) )
+      {
+        continue;
+      }
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _bottle._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _bottle._bloom_brightness );
+      // Warped depth moments of the atlas face
+      _shadow_moments_shader.Use();
+      glUniform1i( glGetUniformLocation( _shadow_moments_shader._program, "uFace" ), face_it );
+      glUniform1f( glGetUniformLocation( _shadow_moments_shader._program, "uLayer" ), ( float )slot->_layer );
+      glUniform1f( glGetUniformLocation( _shadow_moments_shader._program, "uMomentsRes" ), ( float )res );
+      StateCache::BindTexture( GL_TEXTURE_CUBE_MAP_ARRAY, _window->_toolbox->_shadow_atlas[ slot->_tier ] );
+      glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _window->_toolbox->_shadow_moments_buffers[ 0 ], 0 );
+      _window->_toolbox->RenderQuad();
+
+      // Separable blur, horizontal in the second buffer then vertical in the moments face
+      _shadow_moments_blur_shader.Use();
+      glUniform1i( glGetUniformLocation( _shadow_moments_blur_shader._program, "uMomentsRes" ), res );
+
+      glUniform2i( glGetUniformLocation( _shadow_moments_blur_shader._program, "uDirection" ), 1, 0 );
+      StateCache::BindTexture( GL_TEXTURE_2D, _window->_toolbox->_shadow_moments_buffers[ 0 ] );
+      glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _window->_toolbox->_shadow_moments_buffers[ 1 ], 0 );
+      _window->_toolbox->RenderQuad();
+
+      glUniform2i( glGetUniformLocation( _shadow_moments_blur_shader._program, "uDirection" ), 0, 1 );
+      StateCache::BindTexture( GL_TEXTURE_2D, _window->_toolbox->_shadow_moments_buffers[ 1 ] );
+      glFramebufferTextureLayer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, _window->_toolbox->_shadow_moments_atlas[ slot->_tier ], 0, slot->_layer * 6 + face_it );
+      _window->_toolbox->RenderQuad();
+
+      slot->_moment_faces |= 1 << face_it;
+    }
+  }
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _bottle._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _bottle._parallax_cubemap );
+  StateCache::UseProgram( 0 );
+}
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _bottle._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _bottle._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _bottle._normal_map );
+void Scene::ShadowFilterSwitch( unsigned int iMode )
+{
+  if( iMode == _shadow_filter_mode )
+  {
+    return;
+  }
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _bottle._emissive );
+  // Moments targets allocated on first use, then rebuilt from the atlas at the next depth pass
+  if( iMode == SHADOW_FILTER_MOMENTS )
+  {
+    if( _window->_toolbox->_shadow_moments_FBO == 0 )
+    {
+      ShadowMomentsInitialization();
+    }
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _bottle._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _bottle._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _bottle._shadow_darkness );
+    for( unsigned int slot_it = 0; slot_it < _shadow_slots.size(); slot_it++ )
+    {
+      _shadow_slots[ slot_it ]._moment_faces = 0;
+    }
+  }
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _bottle._id );      
+  _shadow_filter_mode = iMode;
 
-    _bottle_model->Draw( _forward_pbr_shader, model_matrix );
+  _forward_pbr_shader.DeletePermutations();
+  _forward_displacement_pbr_shader.DeletePermutations();
+  StateCache::DeleteProgram( _forward_pbr_shader._program );
+  StateCache::DeleteProgram( _forward_displacement_pbr_shader._program );
+  ForwardShadersInitialization();
+}
 
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+void Scene::ShadowFilterBenchmarkStart()
+{
+  if( _shadow_filter_benchmark || _pipeline_benchmark )
+  {
+    return;
+  }
 
+  _shadow_filter_benchmark_saved_mode = _shadow_filter_mode;
+  _shadow_filter_benchmark_saved_type = _pipeline_type;
 
-    // Draw ball
-    // ---------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
+  // Forward pass only, PCF first as the quality reference
+  _pipeline_type = FORWARD_RENDERING;
+  ShadowFilterSwitch( SHADOW_FILTER_PCF );
 
-    ( _ball._height_map == true ) ? current_shader = &_forward_displacement_pbr_shader : current_shader = &_forward_pbr_shader; 
+  _shadow_filter_benchmark         = true;
+  _shadow_filter_benchmark_step    = 0;
+  _shadow_filter_benchmark_frame   = 0;
+  _shadow_filter_benchmark_time    = 0.0;
+  _shadow_filter_benchmark_samples = 0.0;
 
-    current_shader->Use();
+  std::cout << std::endl << "Shadow filtering benchmark, " << SHADOW_FILTER_BENCHMARK_FRAMES << " frames per mode after " << SHADOW_FILTER_BENCHMARK_WARMUP << " warmup frames, camera should stay still" << std::endl
+                         << "----------------------------------------------------------------------------------------" << std::endl;
+  fprintf( stderr, "%-34s | %10s | %14s | %9s | %9s | %s\n", "mode", "forward ms", "ns per sample", "RMSE", "PSNR dB", "pixels off by more than 5/255" );
+}
 
-    model_matrix = _ball._model_matrix;
+void Scene::ShadowFilterBenchmarkFrameEnd()
+{
+  _shadow_filter_benchmark_frame++;
+  if( _shadow_filter_benchmark_frame <= SHADOW_FILTER_BENCHMARK_WARMUP + SHADOW_FILTER_BENCHMARK_FRAMES )
+  {
+    return;
+  }
 
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _ball._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _ball._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
 
-    // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
+  // Final frame of the step, compared to the PCF one on 8 bits RGB
+  // --------------------------------------------------------------
+  std::vector< unsigned char > frame( _window->_width * _window->_height * 3 );
+  StateCache::BindFramebuffer( GL_READ_FRAMEBUFFER, 0 );
+  glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+  glReadPixels( 0, 0, _window->_width, _window->_height, GL_RGB, GL_UNSIGNED_BYTE, &frame[ 0 ] );
 
-    glUniform3fv( glGetUniformLocation( current_shader->_program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  if( _shadow_filter_benchmark_step == 0 )
+  {
+    _shadow_filter_benchmark_reference = frame;
+  }
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
+  double       squared_error = 0.0;
+  unsigned int pixels_off    = 0;
+  unsigned int pixel_count   = _window->_width * _window->_height;
+  for( unsigned int pixel_it = 0; pixel_it < pixel_count; pixel_it++ )
+  {
+    int max_difference = 0;
+    for( unsigned int channel_it = 0; channel_it < 3; channel_it++ )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( current_shader->_program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
+      int difference = ( int )frame[ pixel_it * 3 + channel_it ] - ( int )_shadow_filter_benchmark_reference[ pixel_it * 3 + channel_it ];
+      squared_error += difference * difference;
+      max_difference = std::max( max_difference, std::abs( difference ) );
     }
+    pixels_off += ( max_difference > 5 ) ? 1 : 0;
+  }
+  double RMSE = sqrt( squared_error / ( pixel_count * 3.0 ) );
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uBloom" ), _ball._bloom );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uBloomBrightness" ), _ball._bloom_brightness );
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uIBL" ), _ball._IBL );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uParallaxCubemap" ), _ball._parallax_cubemap );
+  // Forward pass cost per frame and per shaded sample
+  // -------------------------------------------------
+  const char * filter_names[ SHADOW_FILTER_MODE_COUNT ] = { "PCF 20 taps", "hardware compare Poisson 8 taps", "blurred exponential moments 1 tap" };
+  double forward_time = _shadow_filter_benchmark_time / SHADOW_FILTER_BENCHMARK_FRAMES;
+  fprintf( stderr, "%-34s | %10.3f | %14.3f | %9.3f | %9.2f | %.2f%%\n",
+           filter_names[ _shadow_filter_mode ],
+           forward_time,
+           ( _shadow_filter_benchmark_samples > 0.0 ) ? ( _shadow_filter_benchmark_time * 1000000.0 ) / _shadow_filter_benchmark_samples : 0.0,
+           RMSE,
+           ( RMSE > 0.0 ) ? 20.0 * log10( 255.0 / RMSE ) : 99.99,
+           100.0 * pixels_off / pixel_count );
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uAlpha" ), _ball._alpha );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uOpacityMap" ), _ball._opacity_map );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uNormalMap" ), _ball._normal_map );
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uEmissive" ), _ball._emissive );
+  // Next mode or previous state back
+  // --------------------------------
+  _shadow_filter_benchmark_step++;
+  _shadow_filter_benchmark_frame   = 0;
+  _shadow_filter_benchmark_time    = 0.0;
+  _shadow_filter_benchmark_samples = 0.0;
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uReceivShadow" ), _ball._receiv_shadow );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowBias" ), _ball._shadow_bias );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowDarkness" ), _ball._shadow_darkness );
+  if( _shadow_filter_benchmark_step < SHADOW_FILTER_MODE_COUNT )
+  {
+    ShadowFilterSwitch( _shadow_filter_benchmark_step );
+    return;
+  }
 
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uID" ), _ball._id );      
+  ShadowFilterSwitch( _shadow_filter_benchmark_saved_mode );
+  _pipeline_type = _shadow_filter_benchmark_saved_type;
+  _shadow_filter_benchmark_reference.clear();
+  _shadow_filter_benchmark = false;
+}
 
-    _ball_model->Draw( *current_shader, model_matrix );
+void Scene::LightGridUpdate( bool iClustered )
+{
+  // Shadow slot code per light, tier * 16 + layer or -1 while the slot is not ready
+  std::vector< float > shadow_codes( _lights.size(), -1.0 );
+  for( unsigned int light_it = 0; light_it < _lights.size(); light_it++ )
+  {
+    int slot_it = _light_shadow_slot[ light_it ];
+    if( slot_it >= 0 && _shadow_slots[ slot_it ]._ready )
+    {
+      shadow_codes[ light_it ] = ( float )( _shadow_slots[ slot_it ]._tier * 16 + _shadow_slots[ slot_it ]._layer );
+    }
+  }
 
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+  _light_grid->Update( &_lights,
+                       &shadow_codes,
+                       _camera->_view_matrix,
+                       _camera->_unjittered_projection_matrix,
+                       _near,
+                       _far,
+                       iClustered );
+}
 
+void Scene::ForwardLightsBinding( Shader * iShader,
+                                  bool     iClustered,
+                                  float    iIntensityScale )
+{
+  for( unsigned int tier_it = 0; tier_it < SHADOW_ATLAS_TIER_COUNT; tier_it++ )
+  {
+    // Atlas tiers use units 10, 12, 13 and 14, unit 11 is the emissive texture
+    unsigned int unit = 10 + tier_it + ( tier_it > 0 ? 1 : 0 );
+    StateCache::ActiveTexture( GL_TEXTURE0 + unit );
+    StateCache::BindTexture( GL_TEXTURE_CUBE_MAP_ARRAY, ( _shadow_filter_mode == SHADOW_FILTER_MOMENTS ) ? _window->_toolbox->_shadow_moments_atlas[ tier_it ] 
+                                                                                               : _window->_toolbox->_shadow_atlas[ tier_it ] );
+    glBindSampler( unit, ( _shadow_filter_mode == SHADOW_FILTER_POISSON ) ? _shadow_compare_sampler : 0 );
+  }
+  StateCache::ActiveTexture( GL_TEXTURE15 );
+  StateCache::BindTexture( GL_TEXTURE_BUFFER, _light_grid->_buffer_texture );
+
+  // Clusters lists only match the camera view, other views loop over every light
+  bool clustered = iClustered && _light_grid->_index_offset > _light_grid->_cluster_offset;
+
+  glUniform1i( glGetUniformLocation( iShader->_program, "uLightCount" ), _light_grid->_light_count );
+  glUniform1f( glGetUniformLocation( iShader->_program, "uLightIntensityScale" ), iIntensityScale );
+  glUniform1i( glGetUniformLocation( iShader->_program, "uLightSourceIt" ), _current_shadow_light_source );
+  glUniform1i( glGetUniformLocation( iShader->_program, "uClusteredLighting" ), clustered );
+  glUniform3i( glGetUniformLocation( iShader->_program, "uClusterGrid" ), LIGHT_GRID_X, LIGHT_GRID_Y, LIGHT_GRID_Z );
+  glUniform2f( glGetUniformLocation( iShader->_program, "uClusterTileSize" ), ( float )_render_width / LIGHT_GRID_X, ( float )_render_height / LIGHT_GRID_Y );
+  glUniform1f( glGetUniformLocation( iShader->_program, "uClusterSliceScale" ), _light_grid->_slice_scale );
+  glUniform1f( glGetUniformLocation( iShader->_program, "uClusterSliceBias" ), _light_grid->_slice_bias );
+  glUniform1i( glGetUniformLocation( iShader->_program, "uClusterOffset" ), _light_grid->_cluster_offset );
+  glUniform1i( glGetUniformLocation( iShader->_program, "uClusterIndexOffset" ), _light_grid->_index_offset );
+  glUniform1i( glGetUniformLocation( iShader->_program, "uObjectLightsList" ), false );
+}
 
-    // Draw box bag
-    // ------------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
+void Scene::ObjectLightsListUpdate( Object *  iObject,
+                                    glm::vec3 iMin,
+                                    glm::vec3 iMax )
+{
+  // Lights whose sphere reaches the box, ranked by the radiance they bring at its closest point
+  std::vector< std::pair< float, unsigned int > > ranking;
+  for( unsigned int light_it = 0; light_it < _lights.size(); light_it++ )
+  {
+    PointLight * light = &_lights[ light_it ];
+    glm::vec3 closest_point = glm::clamp( light->_position, iMin, iMax );
+    float distance = glm::length( closest_point - light->_position );
+    if( distance >= light->_max_lighting_distance )
+    {
+      continue;
+    }
 
-    ( _box_bag._height_map == true ) ? current_shader = &_forward_displacement_pbr_shader : current_shader = &_forward_pbr_shader; 
+    float window = 1.0 - glm::pow( distance / light->_max_lighting_distance, 4.0f );
+    float peak_radiance = glm::max( glm::max( light->_color.r, light->_color.g ), light->_color.b ) * light->_intensity;
+    ranking.push_back( std::make_pair( -peak_radiance * window * window / glm::max( distance * distance, 0.01f ), light_it ) );
+  }
 
-    current_shader->Use();
+  unsigned int list_size = glm::min( ( unsigned int )ranking.size(), ( unsigned int )MAX_OBJECT_LIGHTS );
+  std::partial_sort( ranking.begin(), ranking.begin() + list_size, ranking.end() );
 
-    model_matrix = _box_bag._model_matrix;
+  iObject->_lights_list.clear();
+  for( unsigned int list_it = 0; list_it < list_size; list_it++ )
+  {
+    iObject->_lights_list.push_back( ranking[ list_it ].second );
+  }
 
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _box_bag._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _box_bag._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+  _object_lights_list_count++;
+  _object_lights_listed   += list_size;
+  _object_lights_reaching += ranking.size();
+}
 
-    // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
+void Scene::ObjectsLightsListsUpdate()
+{
+  _object_lights_list_count = 0;
+  _object_lights_listed     = 0;
+  _object_lights_reaching   = 0;
 
-    glUniform3fv( glGetUniformLocation( current_shader->_program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  glm::vec3 center;
+  float     radius;
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
+  // Grounds and walls are unit planes, padded for the displacement
+  std::vector< Object > * planes[ 2 ] = { &_grounds_type1, &_walls_type1 };
+  for( unsigned int planes_it = 0; planes_it < 2; planes_it++ )
+  {
+    for( unsigned int plane_it = 0; plane_it < planes[ planes_it ]->size(); plane_it++ )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( current_shader->_program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
+      Object * plane = &( *planes[ planes_it ] )[ plane_it ];
+      glm::vec3 bound_min( 1e30 );
+      glm::vec3 bound_max( -1e30 );
+      for( unsigned int corner_it = 0; corner_it < 4; corner_it++ )
+      {
+        glm::vec3 corner = glm::vec3( plane->_model_matrix * glm::vec4( ( float )( corner_it & 1 ), 0.0, ( float )( corner_it >> 1 ), 1.0 ) );
+        bound_min = glm::min( bound_min, corner );
+        bound_max = glm::max( bound_max, corner );
+      }
+      ObjectLightsListUpdate( plane, bound_min - glm::vec3( 0.1 ), bound_max + glm::vec3( 0.1 ) );
     }
+  }
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uBloom" ), _box_bag._bloom );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uBloomBrightness" ), _box_bag._bloom_brightness );
+  // Models use the box around their world bounding sphere
+  std::vector< SceneProp > props;
+  for( unsigned int room_it = 0; room_it < _room_props.size(); room_it++ )
+  {
+    props.insert( props.end(), _room_props[ room_it ].begin(), _room_props[ room_it ].end() );
+  }
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uIBL" ), _box_bag._IBL );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uParallaxCubemap" ), _box_bag._parallax_cubemap );
+  std::vector< Object > * objects[ 4 ] = { &_simple_door, &_top_light, &_wall_light, &_revolving_door };
+  Model *                 models[ 4 ]  = { _simple_door_model, _top_light_model, _wall_light_model, _revolving_door_model };
+  for( unsigned int objects_it = 0; objects_it < 4; objects_it++ )
+  {
+    for( unsigned int object_it = 0; object_it < objects[ objects_it ]->size(); object_it++ )
+    {
+      SceneProp prop;
+      prop._object    = &( *objects[ objects_it ] )[ object_it ];
+      prop._model     = models[ objects_it ];
+      prop._cull_face = true;
+      props.push_back( prop );
+    }
+  }
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uAlpha" ), _box_bag._alpha );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uOpacityMap" ), _box_bag._opacity_map );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uNormalMap" ), _box_bag._normal_map );
+  for( unsigned int prop_it = 0; prop_it < props.size(); prop_it++ )
+  {
+    props[ prop_it ]._model->WorldBoundingSphere( props[ prop_it ]._object->_model_matrix, &center, &radius );
+    ObjectLightsListUpdate( props[ prop_it ]._object, center - glm::vec3( radius ), center + glm::vec3( radius ) );
+  }
+}
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uEmissive" ), _box_bag._emissive );
+void Scene::ObjectLightsBinding( Shader * iShader,
+                                 Object * iObject )
+{
+  // Clusters already bound the lights reaching each fragment
+  if( _clustered_lighting )
+  {
+    return;
+  }
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uReceivShadow" ), _box_bag._receiv_shadow );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowBias" ), _box_bag._shadow_bias );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowDarkness" ), _box_bag._shadow_darkness );
-
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uID" ), _box_bag._id );      
-
-    _box_bag_model->Draw( *current_shader, model_matrix );
-
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+  glUniform1i( glGetUniformLocation( iShader->_program, "uObjectLightsList" ), true );
+  glUniform1i( glGetUniformLocation( iShader->_program, "uObjectLightCount" ), iObject->_lights_list.size() );
+  if( iObject->_lights_list.size() > 0 )
+  {
+    glUniform1iv( glGetUniformLocation( iShader->_program, "uObjectLights" ), iObject->_lights_list.size(), ( const GLint * )&iObject->_lights_list[ 0 ] );
+  }
+}
 
+unsigned int Scene::ObjectPermutation( Object * iObject )
+{
+  // Features values of the object, bits of the PBR_FEATURE_* defines
+  unsigned int values = 0;
+  values |= iObject->_normal_map       ? PBR_FEATURE_NORMAL_MAP       : 0;
+  values |= iObject->_opacity_map      ? PBR_FEATURE_OPACITY_MAP      : 0;
+  values |= iObject->_IBL              ? PBR_FEATURE_IBL              : 0;
+  values |= iObject->_parallax_cubemap ? PBR_FEATURE_PARALLAX_CUBEMAP : 0;
+  values |= iObject->_emissive         ? PBR_FEATURE_EMISSIVE         : 0;
+  values |= iObject->_receiv_shadow    ? PBR_FEATURE_RECEIV_SHADOW    : 0;
+
+  return values;
+}
 
-    // Draw chest
-    // ----------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
+unsigned int Scene::DoorPermutation( Object * iObject )
+{
+  // Doors move between rooms, IBL forced on and parallax correction off whatever the object says
+  return ( ObjectPermutation( iObject ) | PBR_FEATURE_IBL ) & ~PBR_FEATURE_PARALLAX_CUBEMAP;
+}
 
-    ( _chest._height_map == true ) ? current_shader = &_forward_displacement_pbr_shader : current_shader = &_forward_pbr_shader; 
+void Scene::PermutationUniform( Shader *     iShader,
+                                unsigned int iSpecialized,
+                                unsigned int iFeature,
+                                const char * iName,
+                                bool         iValue )
+{
+  // A specialized feature is a constant of the permutation, there is no uniform to set
+  if( !( iSpecialized & iFeature ) )
+  {
+    glUniform1i( glGetUniformLocation( iShader->_program, iName ), iValue );
+  }
+}
 
-    current_shader->Use();
+void Scene::ManyLightsBenchmark( bool iEnable )
+{
+  // Back to the scene lights, shadow slots of removed lights are released by the next allocation
+  if( !iEnable )
+  {
+    _lights.erase( _lights.begin() + _base_light_count, _lights.end() );
+    for( unsigned int slot_it = 0; slot_it < _shadow_slots.size(); slot_it++ )
+    {
+      if( _shadow_slots[ slot_it ]._light >= ( int )_base_light_count )
+      {
+        _shadow_slots[ slot_it ]._light = -1;
+        _shadow_slots[ slot_it ]._ready = false;
+      }
+    }
+    _light_shadow_slot.resize( _lights.size() );
+    return;
+  }
 
-    model_matrix = _chest._model_matrix;
+  // Small colored lights scattered over the grounds, same seed for comparable runs
+  srand( 1234 );
+  unsigned int light_count = glm::min( _many_lights_count, ( unsigned int )MAX_NB_LIGHTS - _base_light_count );
+  for( unsigned int light_it = 0; light_it < light_count; light_it++ )
+  {
+    Object * ground = &_grounds_type1[ rand() % _grounds_type1.size() ];
+    glm::vec3 position = ground->_IBL_position + glm::vec3( ( ( rand() % 1000 ) / 1000.0 - 0.5 ) * _ground_size,
+                                                           0.2 + ( ( rand() % 1000 ) / 1000.0 ) * ( _wall_size - 0.4 ),
+                                                           ( ( rand() % 1000 ) / 1000.0 - 0.5 ) * _ground_size );
+    glm::vec3 color( 0.3 + ( rand() % 700 ) / 1000.0, 0.3 + ( rand() % 700 ) / 1000.0, 0.3 + ( rand() % 700 ) / 1000.0 );
+
+    PointLight light( position, color, 0.05 * PointLight::GetLightsMultiplier(), 1.5 );
+    light.UpdateBoundingSphereScale();
+    light._casts_shadow = false;
+    _lights.push_back( light );
+  }
+  _light_shadow_slot.resize( _lights.size(), -1 );
+}
 
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _chest._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _chest._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+void Scene::PrintForwardLightingInfos()
+{
+  Uint32 t;
+  static Uint32 t0 = 0;
+  t = SDL_GetTicks();
+  if( t - t0 > 1000 )
+  {
+    double pass_time = ( _forward_pass_time_samples > 0 ) ? _forward_pass_time / _forward_pass_time_samples : 0.0;
+    fprintf( stderr, "Forward lighting -> %s, %u lights, forward pass %.3f ms, light grid built in %.3f ms, %u light indices in %u/%u clusters\n",
+             _clustered_lighting ? "clustered" : "per object lists",
+             ( unsigned int )_lights.size(),
+             pass_time,
+             _light_grid->_build_time,
+             _light_grid->_index_count,
+             _light_grid->_occupied_cluster_count,
+             LIGHT_GRID_X * LIGHT_GRID_Y * LIGHT_GRID_Z );
+
+    // Fragments shaded, each mode keeps its last average for the comparison
+    for( unsigned int mode_it = 0; mode_it < 2; mode_it++ )
+    {
+      if( _forward_shaded_frames[ mode_it ] > 0 )
+      {
+        _forward_shaded_average[ mode_it ] = _forward_shaded_samples[ mode_it ] / _forward_shaded_frames[ mode_it ];
+      }
+      _forward_shaded_samples[ mode_it ] = 0.0;
+      _forward_shaded_frames[ mode_it ]  = 0;
+    }
+    fprintf( stderr, "Forward lighting -> depth pre-pass %s, %.2f M samples shaded per frame ( without pre-pass %.2f M, with %.2f M )\n",
+             _depth_prepass ? "on" : "off",
+             _forward_shaded_average[ _depth_prepass ] / 1000000.0,
+             _forward_shaded_average[ 0 ] / 1000000.0,
+             _forward_shaded_average[ 1 ] / 1000000.0 );
 
-    // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
+    if( !_clustered_lighting && _object_lights_list_count > 0 )
+    {
+      fprintf( stderr, "Forward lighting -> %.2f lights shaded per object ( %.2f reaching it, %u in the scene )\n",
+               ( float )_object_lights_listed / _object_lights_list_count,
+               ( float )_object_lights_reaching / _object_lights_list_count,
+               ( unsigned int )_lights.size() );
+    }
 
-    glUniform3fv( glGetUniformLocation( current_shader->_program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+    _forward_pass_time         = 0.0;
+    _forward_pass_time_samples = 0;
+    t0 = t;
+  }
+}
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
+void Scene::PrintShadowPassInfos()
+{
+  Uint32 t;
+  static Uint32 t0 = 0;
+  t = SDL_GetTicks();
+  if( t - t0 > 1000 )
+  {
+    unsigned int ready_count = 0;
+    for( unsigned int slot_it = 0; slot_it < _shadow_slots.size(); slot_it++ )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( current_shader->_program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
+      ready_count += _shadow_slots[ slot_it ]._ready ? 1 : 0;
     }
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uBloom" ), _chest._bloom );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uBloomBrightness" ), _chest._bloom_brightness );
-
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uIBL" ), _chest._IBL );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uParallaxCubemap" ), _chest._parallax_cubemap );
+    fprintf( stderr, "Shadow atlas -> %u shadowed lights, %u slot assignments, %u faces updated and %u triangles rasterized last frame\n", ready_count, _shadow_slot_assign_count, _shadow_face_update_count, _shadow_triangle_count );
+
+    // Fixed 2048 baseline : same face updates at full resolution with float storage
+    double texels_ratio = ( _shadow_baseline_texels_updated > 0.0 ) ? _shadow_texels_updated / _shadow_baseline_texels_updated : 1.0;
+    double pass_time    = ( _shadow_pass_time_samples > 0 ) ? _shadow_pass_time / _shadow_pass_time_samples : 0.0;
+    fprintf( stderr, "Shadow atlas -> depth pass %.3f ms, %.1f%% of the fixed 2048 texels ( ~%.3f ms at 2048 ), memory %.1f MB instead of %.1f MB\n", 
+             pass_time,
+             texels_ratio * 100.0,
+             ( texels_ratio > 0.0 ) ? pass_time / texels_ratio : 0.0,
+             _shadow_atlas_memory / ( 1024.0 * 1024.0 ),
+             _shadow_baseline_memory / ( 1024.0 * 1024.0 ) );
+
+    const char * filter_names[ SHADOW_FILTER_MODE_COUNT ] = { "PCF 20 taps", "hardware compare Poisson 8 taps", "blurred exponential moments 1 tap" };
+    fprintf( stderr, "Shadow atlas -> %s filtering, moments memory %.1f MB\n", 
+             filter_names[ _shadow_filter_mode ],
+             _shadow_moments_memory / ( 1024.0 * 1024.0 ) );
+
+    _shadow_pass_time               = 0.0;
+    _shadow_pass_time_samples       = 0;
+    _shadow_texels_updated          = 0.0;
+    _shadow_baseline_texels_updated = 0.0;
+    t0 = t;
+  }
+}
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uAlpha" ), _chest._alpha );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uOpacityMap" ), _chest._opacity_map );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uNormalMap" ), _chest._normal_map );
+void Scene::ForwardDepthPrePass()
+{
+  // Shading pass draw list, nearest first, planes then models in one ranking
+  std::vector< Object * >  planes;
+  std::vector< bool >      planes_wall;
+  std::vector< SceneProp > props;
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uEmissive" ), _chest._emissive );
+  for( unsigned int ground_it = _grounds_start_it; ground_it < _grounds_end_it; ground_it++ )
+  {
+    if( IsInDemoPVS( _grounds_type1[ ground_it ]._PVS_id ) )
+    {
+      planes.push_back( &_grounds_type1[ ground_it ] );
+      planes_wall.push_back( false );
+    }
+  }
+  for( unsigned int wall_it = _walls_start_it; wall_it < _walls_end_it; wall_it++ )
+  {
+    if( IsInDemoPVS( _walls_type1[ wall_it ]._PVS_id ) )
+    {
+      planes.push_back( &_walls_type1[ wall_it ] );
+      planes_wall.push_back( true );
+    }
+  }
+  ModelsDrawList( &props );
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uReceivShadow" ), _chest._receiv_shadow );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowBias" ), _chest._shadow_bias );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowDarkness" ), _chest._shadow_darkness );
+  std::vector< std::pair< float, unsigned int > > ranking;
+  for( unsigned int plane_it = 0; plane_it < planes.size(); plane_it++ )
+  {
+    glm::vec3 center = glm::vec3( planes[ plane_it ]->_model_matrix[ 3 ] );
+    ranking.push_back( std::make_pair( glm::length( center - _camera->_position ), plane_it ) );
+  }
+  for( unsigned int prop_it = 0; prop_it < props.size(); prop_it++ )
+  {
+    glm::vec3 center = glm::vec3( props[ prop_it ]._object->_model_matrix * glm::vec4( props[ prop_it ]._model->_bounding_sphere_center, 1.0 ) );
+    float distance = glm::max( glm::length( center - _camera->_position ) - props[ prop_it ]._model->_bounding_sphere_radius, 0.0f );
+    ranking.push_back( std::make_pair( distance, ( unsigned int )planes.size() + prop_it ) );
+  }
+  std::sort( ranking.begin(), ranking.end() );
 
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uID" ), _chest._id );      
 
-    _chest_model->Draw( *current_shader, model_matrix );
+  // Depth only, opaque parts with the shading pass alpha test
+  // ---------------------------------------------------------
+  glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+  StateCache::DepthFunc( GL_LESS );
+  StateCache::DepthMask( GL_TRUE );
 
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+  Shader * prepass_shaders[ 3 ] = { &_depth_prepass_shader, &_depth_prepass_alpha_test_shader, &_depth_prepass_displacement_shader };
+  for( unsigned int shader_it = 0; shader_it < 3; shader_it++ )
+  {
+    prepass_shaders[ shader_it ]->Use();
+    glUniformMatrix4fv( glGetUniformLocation( prepass_shaders[ shader_it ]->_program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
+    glUniformMatrix4fv( glGetUniformLocation( prepass_shaders[ shader_it ]->_program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
+    glUniform3fv( glGetUniformLocation( prepass_shaders[ shader_it ]->_program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  }
 
+  for( unsigned int rank_it = 0; rank_it < ranking.size(); rank_it++ )
+  {
+    unsigned int draw_it = ranking[ rank_it ].second;
 
-    // Draw sofa
-    // ----------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
+    // Planes, the tessellated ones go through the same control and evaluation stages as the shading pass
+    if( draw_it < planes.size() )
+    {
+      Object * plane = planes[ draw_it ];
 
-    ( _sofa._height_map == true ) ? current_shader = &_forward_displacement_pbr_shader : current_shader = &_forward_pbr_shader; 
+      // Pre-displaced planes, plain shader over their LODs
+      if( plane->_baked_displacement && !plane->_opacity_map && plane->_alpha == 1.0 )
+      {
+        _depth_prepass_shader.Use();
+        glUniformMatrix4fv( glGetUniformLocation( _depth_prepass_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( plane->_model_matrix ) );
+        DisplacementLODsDraw( plane, _camera->_position );
+        continue;
+      }
 
-    current_shader->Use();
+      // Plain planes from the position only stream
+      if( !plane->_height_map && !plane->_opacity_map && plane->_alpha == 1.0 )
+      {
+        _depth_prepass_shader.Use();
+        glUniformMatrix4fv( glGetUniformLocation( _depth_prepass_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( plane->_model_matrix ) );
+        StateCache::BindVertexArray( _plane_depth_VAO );
+        glDrawElements( GL_TRIANGLES, _ground1_indices.size(), GL_UNSIGNED_INT, 0 );
+        StateCache::BindVertexArray( 0 );
+        continue;
+      }
 
-    model_matrix = _sofa._model_matrix;
+      Shader * current_shader = ( plane->_height_map && !plane->_baked_displacement ) ? &_depth_prepass_displacement_shader : &_depth_prepass_alpha_test_shader;
+      current_shader->Use();
 
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _sofa._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _sofa._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+      StateCache::ActiveTexture( GL_TEXTURE2 );
+      StateCache::BindTexture( GL_TEXTURE_2D, _loaded_materials[ plane->_material_id ][ 2 ] );
 
-    // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
+      glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( plane->_model_matrix ) );
+      glUniform1f( glGetUniformLocation( current_shader->_program, "uAlpha" ), plane->_alpha );
+      glUniform1i( glGetUniformLocation( current_shader->_program, "uOpacityMap" ), plane->_opacity_map );
+      glUniform1f( glGetUniformLocation( current_shader->_program, "uDisplacementFactor" ), -plane->_displacement_factor );
+      glUniform1f( glGetUniformLocation( current_shader->_program, "uTessellationFactor" ), plane->_tessellation_factor );
 
-    glUniform3fv( glGetUniformLocation( current_shader->_program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+      if( plane->_baked_displacement )
+      {
+        DisplacementLODsDraw( plane, _camera->_position );
+      }
+      else if( planes_wall[ draw_it ] )
+      {
+        ( plane->_id == 4 ) ? StateCache::BindVertexArray( _wall2_VAO ) : StateCache::BindVertexArray( _wall1_VAO );
+        ( plane->_height_map == true ) ? glDrawElements( GL_PATCHES, _wall1_indices.size(), GL_UNSIGNED_INT, 0 ) : glDrawElements( GL_TRIANGLES, _wall1_indices.size(), GL_UNSIGNED_INT, 0 );
+      }
+      else
+      {
+        ( plane->_id == 18 ) ? StateCache::BindVertexArray( _ground2_VAO ) : StateCache::BindVertexArray( _ground1_VAO );
+        ( plane->_height_map == true ) ? glDrawElements( GL_PATCHES, _ground1_indices.size(), GL_UNSIGNED_INT, 0 ) : glDrawElements( GL_TRIANGLES, _ground1_indices.size(), GL_UNSIGNED_INT, 0 );
+      }
+      StateCache::BindVertexArray( 0 );
+      continue;
+    }
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
+    // Models opaque parts, meshes bind their own opacity map, plain ones vanish when the object alpha is below 1
+    SceneProp * prop = &props[ draw_it - planes.size() ];
+    if( prop->_cull_face )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( current_shader->_program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
+      StateCache::Enable( GL_CULL_FACE );
+      StateCache::CullFace( GL_BACK );
     }
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uBloom" ), _sofa._bloom );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uBloomBrightness" ), _sofa._bloom_brightness );
+    _depth_prepass_alpha_test_shader.Use();
+    glUniform1f( glGetUniformLocation( _depth_prepass_alpha_test_shader._program, "uAlpha" ), prop->_object->_alpha );
+    prop->_model->DrawDepthPrePass( _depth_prepass_shader, _depth_prepass_alpha_test_shader, prop->_object->_model_matrix, prop->_object->_alpha == 1.0 );
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uIBL" ), _sofa._IBL );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uParallaxCubemap" ), _sofa._parallax_cubemap );
+    StateCache::Disable( GL_CULL_FACE );
+  }
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uAlpha" ), _sofa._alpha );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uOpacityMap" ), _sofa._opacity_map );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uNormalMap" ), _sofa._normal_map );
+  StateCache::UseProgram( 0 );
+  glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+}
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uEmissive" ), _sofa._emissive );
+void Scene::SceneForwardRendering()
+{
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uReceivShadow" ), _sofa._receiv_shadow );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowBias" ), _sofa._shadow_bias );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowDarkness" ), _sofa._shadow_darkness );
+  Shader * current_shader;
+  glm::mat4 model_matrix;
 
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uID" ), _sofa._id );      
 
-    _sofa_model->Draw( *current_shader, model_matrix );
+  // Lights grid and forward pass GPU timer, read back one frame later
+  // -----------------------------------------------------------------
+  GLuint64 elapsed_time = 0;
+  if( _forward_query_it > 0 )
+  {
+    glGetQueryObjectui64v( _forward_time_queries[ ( _forward_query_it - 1 ) % 2 ], GL_QUERY_RESULT, &elapsed_time );
+    _forward_pass_time += elapsed_time / 1000000.0;
+    _forward_pass_time_samples++;
 
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+    if( _shadow_filter_benchmark && _shadow_filter_benchmark_frame > SHADOW_FILTER_BENCHMARK_WARMUP )
+    {
+      _shadow_filter_benchmark_time += elapsed_time / 1000000.0;
+    }
+  }
+  glBeginQuery( GL_TIME_ELAPSED, _forward_time_queries[ _forward_query_it % 2 ] );
+  _forward_query_it++;
 
+  LightGridUpdate( _clustered_lighting );
 
-    // Draw sack
-    // ---------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
+  if( !_clustered_lighting )
+  {
+    ObjectsLightsListsUpdate();
+  }
 
-    ( _sack._height_map == true ) ? current_shader = &_forward_displacement_pbr_shader : current_shader = &_forward_pbr_shader; 
 
-    current_shader->Use();
+  // Bind correct buffer for drawing
+  // -------------------------------
+  glViewport( 0, 0, _render_width, _render_height );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, _window->_toolbox->_temp_hdr_FBO );
+  glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
-    model_matrix = _sack._model_matrix;
 
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _sack._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _sack._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+  // Depth pre-pass, the shading pass then only runs on the visible fragments
+  // ------------------------------------------------------------------------
+  if( _depth_prepass )
+  {
+    ForwardDepthPrePass();
 
-    // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
+    StateCache::DepthFunc( GL_EQUAL );
+    StateCache::DepthMask( GL_FALSE );
+    _depth_prepass_shading = true;
+  }
 
-    glUniform3fv( glGetUniformLocation( current_shader->_program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  // Samples reaching the shading, read back one frame later
+  GLuint64 shaded_samples = 0;
+  if( _forward_query_it > 1 )
+  {
+    unsigned int query_it = ( _forward_query_it - 2 ) % 2;
+    glGetQueryObjectui64v( _forward_samples_queries[ query_it ], GL_QUERY_RESULT, &shaded_samples );
+    _forward_shaded_samples[ _forward_samples_prepass[ query_it ] ] += shaded_samples;
+    _forward_shaded_frames[ _forward_samples_prepass[ query_it ] ]++;
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
+    if( _shadow_filter_benchmark && _shadow_filter_benchmark_frame > SHADOW_FILTER_BENCHMARK_WARMUP )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( current_shader->_program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
+      _shadow_filter_benchmark_samples += shaded_samples;
     }
+  }
+  _forward_samples_prepass[ ( _forward_query_it - 1 ) % 2 ] = _depth_prepass;
+  glBeginQuery( GL_SAMPLES_PASSED, _forward_samples_queries[ ( _forward_query_it - 1 ) % 2 ] );
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uBloom" ), _sack._bloom );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uBloomBrightness" ), _sack._bloom_brightness );
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uIBL" ), _sack._IBL );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uParallaxCubemap" ), _sack._parallax_cubemap );
+  // Draw skybox
+  // -----------
+  /*StateCache::DepthMask( GL_FALSE ); // desactivé juste pour draw la skybox
+  _skybox_shader.Use();   
+  glm::mat4 skybox_view_matrix = glm::mat4( glm::mat3( _camera->_view_matrix ) );  // Remove any translation component of the view matrix
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uAlpha" ), _sack._alpha );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uOpacityMap" ), _sack._opacity_map );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uNormalMap" ), _sack._normal_map );
+  model_matrix = glm::mat4( 1.0f );
+  glUniformMatrix4fv( glGetUniformLocation( _skybox_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
+  glUniformMatrix4fv( glGetUniformLocation( _skybox_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( skybox_view_matrix ) );
+  glUniformMatrix4fv( glGetUniformLocation( _skybox_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
+  glUniform1f( glGetUniformLocation( _skybox_shader._program, "uAlpha" ), 1.0 );
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uEmissive" ), _sack._emissive );
+  StateCache::ActiveTexture( GL_TEXTURE0 );
+  StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, _walls_type1[ 0 ]._IBL_cubemaps[ 0 ] ); 
+  //glBindTexture( GL_TEXTURE_CUBE_MAP,_revolving_door[ 0 ]._IBL_cubemaps[ 0 ] ); 
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uReceivShadow" ), _sack._receiv_shadow );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowBias" ), _sack._shadow_bias );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowDarkness" ), _sack._shadow_darkness );
+  _window->_toolbox->RenderCube();
+
+  StateCache::DepthMask( GL_TRUE );  // réactivé pour draw le reste
+  StateCache::UseProgram( 0 );*/
 
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uID" ), _sack._id );      
 
-    _sack_model->Draw( *current_shader, model_matrix );
+  // Draw lamps
+  // ----------
+  /*_flat_color_shader.Use();
 
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+  for( int i = 0; i < _lights.size(); i++ )
+  {
+    model_matrix= glm::mat4();
+    model_matrix = glm::translate( model_matrix, _lights[ i ]._position );
+    model_matrix = glm::scale( model_matrix, glm::vec3( 0.04f ) ); 
+    glm::vec3 lamp_color = _lights[ i ]._color * _lights[ i ]._intensity;
+    glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uViewMatrix" ) , 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
+    glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
+    glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
+    glUniform3f( glGetUniformLocation( _flat_color_shader._program, "uColor" ), lamp_color.x, lamp_color.y, lamp_color.z );
 
+    _sphere_model->Draw( _flat_color_shader, model_matrix );
+  }
+  StateCache::BindVertexArray( 0 );
+  StateCache::UseProgram( 0 );*/
 
-    // Draw room1_table2
-    // -----------------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
 
-    ( _room1_table2._height_map == true ) ? current_shader = &_forward_displacement_pbr_shader : current_shader = &_forward_pbr_shader; 
+  // Draw grounds type 1
+  // -------------------
+  for( int ground_it = _grounds_start_it; ground_it < _grounds_end_it; ground_it ++ )
+  {
+    if( !IsInDemoPVS( _grounds_type1[ ground_it ]._PVS_id ) )
+    {
+      continue;
+    }
 
-    current_shader->Use();
+    ( _grounds_type1[ ground_it ]._height_map && !_grounds_type1[ ground_it ]._baked_displacement ) ? current_shader = &_forward_displacement_pbr_shader : current_shader = &_forward_pbr_shader; 
 
-    model_matrix = _room1_table2._model_matrix;
+    unsigned int specialized = _shader_permutations ? PBR_FEATURES_ALL : 0;
+    current_shader->UsePermutation( specialized, ObjectPermutation( &_grounds_type1[ ground_it ] ) );
 
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _room1_table2._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _room1_table2._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+    model_matrix = _grounds_type1[ ground_it ]._model_matrix; 
+   
+    // Textures binding
+    StateCache::BindTextures( 0, 6, &_loaded_materials[ _grounds_type1[ ground_it ]._material_id ][ 0 ], GL_TEXTURE_2D );
+    StateCache::ActiveTexture( GL_TEXTURE7 );
+    StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, _grounds_type1[ ground_it ]._IBL_cubemaps[ 1 ] );
+    StateCache::ActiveTexture( GL_TEXTURE8 );
+    StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, _grounds_type1[ ground_it ]._IBL_cubemaps[ 2 ] ); 
+    StateCache::ActiveTexture( GL_TEXTURE9 );
+    StateCache::BindTexture( GL_TEXTURE_2D, _pre_brdf_texture );
 
     // Matrices uniforms
     glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
@@ -4811,70 +5434,81 @@ void Scene::SceneForwardRendering()
 
     glUniform3fv( glGetUniformLocation( current_shader->_program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
-    {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( current_shader->_program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
-
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uBloom" ), _room1_table2._bloom );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uBloomBrightness" ), _room1_table2._bloom_brightness );
+    // Point lights and shadow atlas binding
+    ForwardLightsBinding( current_shader, _clustered_lighting, 1.0 );
+    ObjectLightsBinding( current_shader, &_grounds_type1[ ground_it ] );
 
     // IBL uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uIBL" ), _room1_table2._IBL );
+    PermutationUniform( current_shader, specialized, PBR_FEATURE_IBL, "uIBL", _grounds_type1[ ground_it ]._IBL );
     glUniform1f( glGetUniformLocation( current_shader->_program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uParallaxCubemap" ), _room1_table2._parallax_cubemap );
+    PermutationUniform( current_shader, specialized, PBR_FEATURE_PARALLAX_CUBEMAP, "uParallaxCubemap", _grounds_type1[ ground_it ]._parallax_cubemap );
+    glUniform3fv( glGetUniformLocation( current_shader->_program, "uCubemapPos" ), 1, &_grounds_type1[ ground_it ]._IBL_position[ 0 ] );
 
     // Opacity uniforms
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uAlpha" ), _room1_table2._alpha );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uOpacityMap" ), _room1_table2._opacity_map );
+    glUniform1f( glGetUniformLocation( current_shader->_program, "uAlpha" ), _grounds_type1[ ground_it ]._alpha );
+    PermutationUniform( current_shader, specialized, PBR_FEATURE_OPACITY_MAP, "uOpacityMap", _grounds_type1[ ground_it ]._opacity_map );
     glUniform1f( glGetUniformLocation( current_shader->_program, "uOpacityDiscard" ), 1.0 );
     
     // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uNormalMap" ), _room1_table2._normal_map );
-
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uEmissive" ), _room1_table2._emissive );
+    glUniform1f( glGetUniformLocation( current_shader->_program, "uDisplacementFactor" ), -_grounds_type1[ ground_it ]._displacement_factor );
+    glUniform1f( glGetUniformLocation( current_shader->_program, "uTessellationFactor" ), _grounds_type1[ ground_it ]._tessellation_factor );
+    PermutationUniform( current_shader, specialized, PBR_FEATURE_NORMAL_MAP, "uNormalMap", _grounds_type1[ ground_it ]._normal_map );
 
     // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uReceivShadow" ), _room1_table2._receiv_shadow );
+    PermutationUniform( current_shader, specialized, PBR_FEATURE_RECEIV_SHADOW, "uReceivShadow", _grounds_type1[ ground_it ]._receiv_shadow );
     glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowBias" ), _room1_table2._shadow_bias );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowDarkness" ), _room1_table2._shadow_darkness );
+    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowBias" ), _grounds_type1[ ground_it ]._shadow_bias );
+    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowDarkness" ), _grounds_type1[ ground_it ]._shadow_darkness );
 
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uID" ), _room1_table2._id );      
+    // Emissive uniforms
+    PermutationUniform( current_shader, specialized, PBR_FEATURE_EMISSIVE, "uEmissive", _grounds_type1[ ground_it ]._emissive );
+    if( _grounds_type1[ ground_it ]._emissive )
+    {
+      StateCache::ActiveTexture( GL_TEXTURE11 );
+      StateCache::BindTexture( GL_TEXTURE_2D, _loaded_materials[ _grounds_type1[ ground_it ]._material_id ][ 6 ] );
+      glUniform1f( glGetUniformLocation( current_shader->_program, "uEmissiveFactor" ), _grounds_type1[ ground_it ]._emissive_factor );
+    }
 
-    _room1_table2_model->Draw( *current_shader, model_matrix );
+    glUniform1f( glGetUniformLocation( current_shader->_program, "uID" ), _grounds_type1[ ground_it ]._id );  
 
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+    if( _grounds_type1[ ground_it ]._baked_displacement )
+    {
+      DisplacementLODsDraw( &_grounds_type1[ ground_it ], _camera->_position );
+    }
+    else
+    {
+      ( _grounds_type1[ ground_it ]._id == 18 ) ? StateCache::BindVertexArray( _ground2_VAO ) : StateCache::BindVertexArray( _ground1_VAO );
+      ( _grounds_type1[ ground_it ]._height_map == true ) ? glDrawElements( GL_PATCHES, _ground1_indices.size(), GL_UNSIGNED_INT, 0 ) : glDrawElements( GL_TRIANGLES, _ground1_indices.size(), GL_UNSIGNED_INT, 0 );
+    }
+    StateCache::BindVertexArray( 0 );
+    StateCache::UseProgram( 0 );
+  }
 
 
-    // Draw book
-    // ---------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
+  // Draw walls type 1
+  // -----------------
+  for( unsigned int wall_it = _walls_start_it; wall_it < _walls_end_it; wall_it++ )
+  {
+    if( !IsInDemoPVS( _walls_type1[ wall_it ]._PVS_id ) )
+    {
+      continue;
+    }
 
-    ( _book._height_map == true ) ? current_shader = &_forward_displacement_pbr_shader : current_shader = &_forward_pbr_shader; 
+    ( _walls_type1[ wall_it ]._height_map && !_walls_type1[ wall_it ]._baked_displacement ) ? current_shader = &_forward_displacement_pbr_shader : current_shader = &_forward_pbr_shader; 
 
-    current_shader->Use();
+    unsigned int specialized = _shader_permutations ? PBR_FEATURES_ALL : 0;
+    current_shader->UsePermutation( specialized, ObjectPermutation( &_walls_type1[ wall_it ] ) );
 
-    model_matrix = _book._model_matrix;
+    model_matrix = _walls_type1[ wall_it ]._model_matrix;
 
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _book._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _book._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+    // Textures binding
+    StateCache::BindTextures( 0, 6, &_loaded_materials[ _walls_type1[ wall_it ]._material_id ][ 0 ], GL_TEXTURE_2D );
+    StateCache::ActiveTexture( GL_TEXTURE7 );
+    StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, _walls_type1[ wall_it ]._IBL_cubemaps[ 1 ] );
+    StateCache::ActiveTexture( GL_TEXTURE8 );
+    StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, _walls_type1[ wall_it ]._IBL_cubemaps[ 2 ] ); 
+    StateCache::ActiveTexture( GL_TEXTURE9 );
+    StateCache::BindTexture( GL_TEXTURE_2D, _pre_brdf_texture );
 
     // Matrices uniforms
     glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
@@ -4883,207 +5517,196 @@ void Scene::SceneForwardRendering()
 
     glUniform3fv( glGetUniformLocation( current_shader->_program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
-    {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( current_shader->_program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
-
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uBloom" ), _book._bloom );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uBloomBrightness" ), _book._bloom_brightness );
+    // Point lights and shadow atlas binding
+    ForwardLightsBinding( current_shader, _clustered_lighting, 1.0 );
+    ObjectLightsBinding( current_shader, &_walls_type1[ wall_it ] );
 
     // IBL uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uIBL" ), _book._IBL );
+    PermutationUniform( current_shader, specialized, PBR_FEATURE_IBL, "uIBL", _walls_type1[ wall_it ]._IBL );
     glUniform1f( glGetUniformLocation( current_shader->_program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uParallaxCubemap" ), _book._parallax_cubemap );
+    PermutationUniform( current_shader, specialized, PBR_FEATURE_PARALLAX_CUBEMAP, "uParallaxCubemap", _walls_type1[ wall_it ]._parallax_cubemap );
+    glUniform3fv( glGetUniformLocation( current_shader->_program, "uCubemapPos" ), 1, &_walls_type1[ wall_it ]._IBL_position[ 0 ] );
 
     // Opacity uniforms
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uAlpha" ), _book._alpha );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uOpacityMap" ), _book._opacity_map );
+    glUniform1f( glGetUniformLocation( current_shader->_program, "uAlpha" ), _walls_type1[ wall_it ]._alpha );
+    PermutationUniform( current_shader, specialized, PBR_FEATURE_OPACITY_MAP, "uOpacityMap", _walls_type1[ wall_it ]._opacity_map );
     glUniform1f( glGetUniformLocation( current_shader->_program, "uOpacityDiscard" ), 1.0 );
     
     // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uNormalMap" ), _book._normal_map );
-
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uEmissive" ), _book._emissive );
+    glUniform1f( glGetUniformLocation( current_shader->_program, "uDisplacementFactor" ), -_walls_type1[ wall_it ]._displacement_factor );
+    glUniform1f( glGetUniformLocation( current_shader->_program, "uTessellationFactor" ), _walls_type1[ wall_it ]._tessellation_factor );
+    PermutationUniform( current_shader, specialized, PBR_FEATURE_NORMAL_MAP, "uNormalMap", _walls_type1[ wall_it ]._normal_map );
 
     // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uReceivShadow" ), _book._receiv_shadow );
+    PermutationUniform( current_shader, specialized, PBR_FEATURE_RECEIV_SHADOW, "uReceivShadow", _walls_type1[ wall_it ]._receiv_shadow );
     glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowBias" ), _book._shadow_bias );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowDarkness" ), _book._shadow_darkness );
-
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uID" ), _book._id );      
-
-    _book_model->Draw( *current_shader, model_matrix );
+    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowBias" ), _walls_type1[ wall_it ]._shadow_bias );
+    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowDarkness" ), _walls_type1[ wall_it ]._shadow_darkness );
 
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+    // Emissive uniforms
+    PermutationUniform( current_shader, specialized, PBR_FEATURE_EMISSIVE, "uEmissive", _walls_type1[ wall_it ]._emissive );
+    if( _walls_type1[ wall_it ]._emissive )
+    {
+      StateCache::ActiveTexture( GL_TEXTURE11 );
+      StateCache::BindTexture( GL_TEXTURE_2D, _loaded_materials[ _walls_type1[ wall_it ]._material_id ][ 6 ] );
+      glUniform1f( glGetUniformLocation( current_shader->_program, "uEmissiveFactor" ), _walls_type1[ wall_it ]._emissive_factor );
+    }
+    
+    glUniform1f( glGetUniformLocation( current_shader->_program, "uID" ), _walls_type1[ wall_it ]._id );  
 
+    if( _walls_type1[ wall_it ]._baked_displacement )
+    {
+      DisplacementLODsDraw( &_walls_type1[ wall_it ], _camera->_position );
+    }
+    else
+    {
+      ( _walls_type1[ wall_it ]._id == 4 ) ? StateCache::BindVertexArray( _wall2_VAO ) : StateCache::BindVertexArray( _wall1_VAO );
+      ( _walls_type1[ wall_it ]._height_map == true ) ? glDrawElements( GL_PATCHES, _wall1_indices.size(), GL_UNSIGNED_INT, 0 ) : glDrawElements( GL_TRIANGLES, _wall1_indices.size(), GL_UNSIGNED_INT, 0 );
+    }
+    StateCache::BindVertexArray( 0 );
+    StateCache::UseProgram( 0 );
+  }
 
-    // Draw radio
-    // ----------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
 
-    ( _radio._height_map == true ) ? current_shader = &_forward_displacement_pbr_shader : current_shader = &_forward_pbr_shader; 
+  // Draw simple doors
+  // -----------------
+  StateCache::Enable( GL_CULL_FACE );
+  StateCache::CullFace( GL_BACK );
+  unsigned int specialized = _shader_permutations ? PBR_FEATURES_OBJECT : 0;
 
-    current_shader->Use();
+  for( int door_it = 0; door_it < _simple_door.size(); door_it++ )
+  { 
+    // Permutation may change from one door to the next, every uniform is set on its program
+    _forward_pbr_shader.UsePermutation( specialized, DoorPermutation( &_simple_door[ door_it ] ) );
 
-    model_matrix = _radio._model_matrix;
+    // IBL cubemap texture binding
+    StateCache::ActiveTexture( GL_TEXTURE7 );
+    StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, _simple_door[ door_it ]._IBL_cubemaps[ 1 ] );
+    StateCache::ActiveTexture( GL_TEXTURE8 );
+    StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, _simple_door[ door_it ]._IBL_cubemaps[ 2 ] ); 
+    StateCache::ActiveTexture( GL_TEXTURE9 );
+    StateCache::BindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
 
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _radio._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _radio._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+    model_matrix = _simple_door[ door_it ]._model_matrix;
 
     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( current_shader->_program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-
-    glUniform3fv( glGetUniformLocation( current_shader->_program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
-
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
-    {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( current_shader->_program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( current_shader->_program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
+    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
+    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
+    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
+    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uBloom" ), _radio._bloom );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uBloomBrightness" ), _radio._bloom_brightness );
+    // Point lights and shadow atlas binding
+    ForwardLightsBinding( &_forward_pbr_shader, _clustered_lighting, 1.0 );
+    ObjectLightsBinding( &_forward_pbr_shader, &_simple_door[ door_it ] );
 
     // IBL uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uIBL" ), _radio._IBL );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uParallaxCubemap" ), _radio._parallax_cubemap );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_IBL, "uIBL", true );
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_PARALLAX_CUBEMAP, "uParallaxCubemap", false );
 
     // Opacity uniforms
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uAlpha" ), _radio._alpha );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uOpacityMap" ), _radio._opacity_map );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uOpacityDiscard" ), 1.0 );
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _simple_door[ door_it ]._alpha );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_OPACITY_MAP, "uOpacityMap", _simple_door[ door_it ]._opacity_map );
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
     
     // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uNormalMap" ), _radio._normal_map );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_NORMAL_MAP, "uNormalMap", _simple_door[ door_it ]._normal_map );
 
     // Emissive uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uEmissive" ), _radio._emissive );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_EMISSIVE, "uEmissive", _simple_door[ door_it ]._emissive );
 
     // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uReceivShadow" ), _radio._receiv_shadow );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( current_shader->_program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowBias" ), _radio._shadow_bias );
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uShadowDarkness" ), _radio._shadow_darkness );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_RECEIV_SHADOW, "uReceivShadow", _simple_door[ door_it ]._receiv_shadow );
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _simple_door[ door_it ]._shadow_bias );
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _simple_door[ door_it ]._shadow_darkness );
 
-    glUniform1f( glGetUniformLocation( current_shader->_program, "uID" ), _radio._id );      
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _simple_door[ door_it ]._id );      
 
-    _radio_model->Draw( *current_shader, model_matrix );
+    _simple_door_model->Draw( _forward_pbr_shader, model_matrix );
+  }
 
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+  StateCache::UseProgram( 0 );
+  StateCache::Disable( GL_CULL_FACE );
 
 
-    // Draw ink bottle
-    // ---------------
-    _forward_pbr_shader.Use();
+  // Draw top lights
+  // ---------------
+  StateCache::Enable( GL_CULL_FACE );
+  StateCache::CullFace( GL_BACK );
+  for( int light_it = 0; light_it < _top_light.size(); light_it++ )
+  { 
+    _forward_pbr_shader.UsePermutation( specialized, ObjectPermutation( &_top_light[ light_it ] ) );
 
-    model_matrix = _ink_bottle._model_matrix;
+    // IBL cubemap texture binding
+    StateCache::ActiveTexture( GL_TEXTURE7 );
+    StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, _top_light[ light_it ]._IBL_cubemaps[ 1 ] );
+    StateCache::ActiveTexture( GL_TEXTURE8 );
+    StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, _top_light[ light_it ]._IBL_cubemaps[ 2 ] ); 
+    StateCache::ActiveTexture( GL_TEXTURE9 );
+    StateCache::BindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
 
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _ink_bottle._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _ink_bottle._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+    model_matrix = _top_light[ light_it ]._model_matrix;
 
-    // Matrices uniforms
+     // Matrices uniforms
     glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
     glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-
+    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
     glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
-    {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
-
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _ink_bottle._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _ink_bottle._bloom_brightness );
+    // Point lights and shadow atlas binding
+    ForwardLightsBinding( &_forward_pbr_shader, _clustered_lighting, 1.0 );
+    ObjectLightsBinding( &_forward_pbr_shader, &_top_light[ light_it ] );
 
     // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), true );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_IBL, "uIBL", _top_light[ light_it ]._IBL );
     glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), false );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_PARALLAX_CUBEMAP, "uParallaxCubemap", _top_light[ light_it ]._parallax_cubemap );
 
     // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _ink_bottle._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _ink_bottle._opacity_map );
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _top_light[ light_it ]._alpha );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_OPACITY_MAP, "uOpacityMap", _top_light[ light_it ]._opacity_map );
     glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
     
     // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _ink_bottle._normal_map );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_NORMAL_MAP, "uNormalMap", _top_light[ light_it ]._normal_map );
 
     // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _ink_bottle._emissive );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_EMISSIVE, "uEmissive", _top_light[ light_it ]._emissive );
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _top_light[ light_it ]._emissive_factor );
 
     // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _ink_bottle._receiv_shadow );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_RECEIV_SHADOW, "uReceivShadow", _top_light[ light_it ]._receiv_shadow );
     glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _ink_bottle._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _ink_bottle._shadow_darkness );
-
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _ink_bottle._id );      
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _top_light[ light_it ]._shadow_bias );
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _top_light[ light_it ]._shadow_darkness );
 
-    _ink_bottle_model->Draw( _forward_pbr_shader, model_matrix );
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _top_light[ light_it ]._id );      
 
-    glUseProgram( 0 );
+    _top_light_model->Draw( _forward_pbr_shader, model_matrix );
   }
 
-  if( _current_room == 2 )
-  {
+  StateCache::UseProgram( 0 );
+  StateCache::Disable( GL_CULL_FACE );
+
 
-    // Draw screen
-    // -----------
-    _forward_pbr_shader.Use();
+  // Draw wall lights
+  // ----------------
+  StateCache::Enable( GL_CULL_FACE );
+  StateCache::CullFace( GL_BACK );
+  for( int light_it = 0; light_it < _wall_light.size(); light_it++ )
+  { 
+    _forward_pbr_shader.UsePermutation( specialized, ObjectPermutation( &_wall_light[ light_it ] ) );
 
     // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _screen._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _screen._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+    StateCache::ActiveTexture( GL_TEXTURE7 );
+    StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, _wall_light[ light_it ]._IBL_cubemaps[ 1 ] );
+    StateCache::ActiveTexture( GL_TEXTURE8 );
+    StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, _wall_light[ light_it ]._IBL_cubemaps[ 2 ] ); 
+    StateCache::ActiveTexture( GL_TEXTURE9 );
+    StateCache::BindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
 
-    model_matrix = _screen._model_matrix;
+    model_matrix = _wall_light[ light_it ]._model_matrix;
 
      // Matrices uniforms
     glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
@@ -5091,1952 +5714,2274 @@ void Scene::SceneForwardRendering()
     glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
     glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
-    {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
+    // Point lights and shadow atlas binding
+    ForwardLightsBinding( &_forward_pbr_shader, _clustered_lighting, 1.0 );
+    ObjectLightsBinding( &_forward_pbr_shader, &_wall_light[ light_it ] );
 
     // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _screen._IBL );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_IBL, "uIBL", _wall_light[ light_it ]._IBL );
     glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _screen._parallax_cubemap );
-
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _screen._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _screen._bloom_brightness );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_PARALLAX_CUBEMAP, "uParallaxCubemap", _wall_light[ light_it ]._parallax_cubemap );
 
     // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _screen._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _screen._opacity_map );
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _wall_light[ light_it ]._alpha );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_OPACITY_MAP, "uOpacityMap", _wall_light[ light_it ]._opacity_map );
     glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
     
     // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _screen._normal_map );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_NORMAL_MAP, "uNormalMap", _wall_light[ light_it ]._normal_map );
 
     // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _screen._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _screen._emissive_factor );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_EMISSIVE, "uEmissive", _wall_light[ light_it ]._emissive );
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _wall_light[ light_it ]._emissive_factor );
 
     // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _screen._receiv_shadow );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_RECEIV_SHADOW, "uReceivShadow", _wall_light[ light_it ]._receiv_shadow );
     glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _screen._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _screen._shadow_darkness );
-
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _screen._id );      
-
-    _screen_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _wall_light[ light_it ]._shadow_bias );
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _wall_light[ light_it ]._shadow_darkness );
 
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _wall_light[ light_it ]._id );      
 
-    // Draw bike
-    // ---------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
+    _wall_light_model->Draw( _forward_pbr_shader, model_matrix );
+  }
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _bike._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _bike._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+  StateCache::UseProgram( 0 );
+  StateCache::Disable( GL_CULL_FACE );
 
-    model_matrix = _bike._model_matrix;
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  // Draw current room props
+  // -----------------------
+  std::vector< SceneProp > * room_props = &_room_props[ _current_room - 1 ];
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
+  for( unsigned int prop_it = 0; prop_it < room_props->size(); prop_it++ )
+  {
+    if( IsInDemoPVS( ( *room_props )[ prop_it ]._object->_PVS_id ) )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
+      ForwardPropRendering( &( *room_props )[ prop_it ] );
     }
-
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _bike._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _bike._parallax_cubemap );
-
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _bike._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _bike._bloom_brightness );
-
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _bike._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _bike._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _bike._normal_map );
-
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _bike._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _bike._emissive_factor );
-
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _bike._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _bike._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _bike._shadow_darkness );
-
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _bike._id );      
-
-    _bike_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+  }
 
 
-    // Draw pilar
-    // ----------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
+  // Draw revolving doors
+  // --------------------
+  StateCache::Enable( GL_CULL_FACE );
+  StateCache::CullFace( GL_BACK );
+  for( int door_it = 0; door_it < _revolving_door.size(); door_it++ )
+  { 
+    _forward_pbr_shader.UsePermutation( specialized, DoorPermutation( &_revolving_door[ door_it ] ) );
 
     // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _pilar._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _pilar._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+    StateCache::ActiveTexture( GL_TEXTURE7 );
+    StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, _revolving_door[ door_it ]._IBL_cubemaps[ 1 ] );
+    StateCache::ActiveTexture( GL_TEXTURE8 );
+    StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, _revolving_door[ door_it ]._IBL_cubemaps[ 2 ] ); 
+    StateCache::ActiveTexture( GL_TEXTURE9 );
+    StateCache::BindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
 
-    model_matrix = _pilar._model_matrix;
+    model_matrix = _revolving_door[ door_it ]._model_matrix;
 
-     // Matrices uniforms
+    // Matrices uniforms
     glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
     glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
     glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
     glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
-    {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
+    // Point lights and shadow atlas binding
+    ForwardLightsBinding( &_forward_pbr_shader, _clustered_lighting, 1.0 );
+    ObjectLightsBinding( &_forward_pbr_shader, &_revolving_door[ door_it ] );
 
     // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _pilar._IBL );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_IBL, "uIBL", true );
     glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _pilar._parallax_cubemap );
-
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _pilar._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _pilar._bloom_brightness );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_PARALLAX_CUBEMAP, "uParallaxCubemap", false );
 
     // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _pilar._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _pilar._opacity_map );
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _revolving_door[ door_it ]._alpha );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_OPACITY_MAP, "uOpacityMap", _revolving_door[ door_it ]._opacity_map );
     glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
     
     // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _pilar._normal_map );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_NORMAL_MAP, "uNormalMap", _revolving_door[ door_it ]._normal_map );
 
     // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _pilar._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _pilar._emissive_factor );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_EMISSIVE, "uEmissive", _revolving_door[ door_it ]._emissive );
 
     // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _pilar._receiv_shadow );
+    PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_RECEIV_SHADOW, "uReceivShadow", _revolving_door[ door_it ]._receiv_shadow );
     glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _pilar._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _pilar._shadow_darkness );
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _revolving_door[ door_it ]._shadow_bias );
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _revolving_door[ door_it ]._shadow_darkness );
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _pilar._id );      
+    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _revolving_door[ door_it ]._id );      
 
-    _pilar_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+    _revolving_door_model->Draw( _forward_pbr_shader, model_matrix );
+  }
 
+  StateCache::UseProgram( 0 );
+  StateCache::Disable( GL_CULL_FACE );
 
-    // Draw scanner
-    // ------------
-    _forward_pbr_shader.Use();
+  glEndQuery( GL_SAMPLES_PASSED );
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _scanner._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _scanner._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+  if( _depth_prepass )
+  {
+    StateCache::DepthFunc( GL_LESS );
+    StateCache::DepthMask( GL_TRUE );
+    _depth_prepass_shading = false;
+  }
 
-    model_matrix = _scanner._model_matrix;
+  glEndQuery( GL_TIME_ELAPSED );
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
-    {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
+  // Unbind current FBO
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
+  StateCache::BindVertexArray( 0 );
+}
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _scanner._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _scanner._parallax_cubemap );
+void Scene::ForwardPropRendering( SceneProp * iProp )
+{
+  Object *  object = iProp->_object;
+  glm::mat4 model_matrix;
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _scanner._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _scanner._bloom_brightness );
+  if( iProp->_cull_face )
+  {
+    StateCache::Enable( GL_CULL_FACE );
+    StateCache::CullFace( GL_BACK );
+  }
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _scanner._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _scanner._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _scanner._normal_map );
+  unsigned int specialized = _shader_permutations ? PBR_FEATURES_OBJECT : 0;
+  _forward_pbr_shader.UsePermutation( specialized, ObjectPermutation( object ) );
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _scanner._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _scanner._emissive_factor );
+  // IBL cubemap texture binding
+  StateCache::ActiveTexture( GL_TEXTURE7 );
+  StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, object->_IBL_cubemaps[ 1 ] );
+  StateCache::ActiveTexture( GL_TEXTURE8 );
+  StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, object->_IBL_cubemaps[ 2 ] ); 
+  StateCache::ActiveTexture( GL_TEXTURE9 );
+  StateCache::BindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _scanner._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _scanner._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _scanner._shadow_darkness );
+  model_matrix = object->_model_matrix;
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _scanner._id );      
+  // Matrices uniforms
+  glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
+  glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
+  glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
+  glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
 
-    _scanner_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
+  // Point lights and shadow atlas binding
+  ForwardLightsBinding( &_forward_pbr_shader, _clustered_lighting, 1.0 );
+  ObjectLightsBinding( &_forward_pbr_shader, object );
 
+  // IBL uniforms
+  PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_IBL, "uIBL", object->_IBL );
+  glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
+  PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_PARALLAX_CUBEMAP, "uParallaxCubemap", object->_parallax_cubemap );
 
-    // Draw room2_table1
-    // -----------------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
+  // Opacity uniforms
+  glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), object->_alpha );
+  PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_OPACITY_MAP, "uOpacityMap", object->_opacity_map );
+  glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
+  
+  // Displacement mapping uniforms
+  PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_NORMAL_MAP, "uNormalMap", object->_normal_map );
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _room2_table1._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _room2_table1._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+  // Emissive uniforms
+  PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_EMISSIVE, "uEmissive", object->_emissive );
+  glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), object->_emissive_factor );
 
-    model_matrix = _room2_table1._model_matrix;
+  // Omnidirectional shadow mapping uniforms
+  PermutationUniform( &_forward_pbr_shader, specialized, PBR_FEATURE_RECEIV_SHADOW, "uReceivShadow", object->_receiv_shadow );
+  glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
+  glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), object->_shadow_bias );
+  glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), object->_shadow_darkness );
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), object->_id );      
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
-    {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
+  iProp->_model->Draw( _forward_pbr_shader, model_matrix );
+  StateCache::UseProgram( 0 );
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _room2_table1._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _room2_table1._parallax_cubemap );
+  if( iProp->_cull_face )
+  {
+    StateCache::Disable( GL_CULL_FACE );
+  }
+}
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _room2_table1._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _room2_table1._bloom_brightness );
+void Scene::DeferredObjectBinding( Shader *     iShader,
+                                   Object *     iObject,
+                                   unsigned int iSpecialized )
+{
+  // IBL cubemap texture binding
+  StateCache::ActiveTexture( GL_TEXTURE7 );
+  StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, iObject->_IBL_cubemaps[ 1 ] );
+  StateCache::ActiveTexture( GL_TEXTURE8 );
+  StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, iObject->_IBL_cubemaps[ 2 ] ); 
+  StateCache::ActiveTexture( GL_TEXTURE9 );
+  StateCache::BindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _room2_table1._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _room2_table1._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _room2_table1._normal_map );
+  // Matrices uniforms
+  glUniformMatrix4fv( glGetUniformLocation( iShader->_program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( iObject->_model_matrix ) );
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _room2_table1._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _room2_table1._emissive_factor );
+  // IBL uniforms
+  PermutationUniform( iShader, iSpecialized, PBR_FEATURE_IBL, "uIBL", iObject->_IBL );
+  glUniform1f( glGetUniformLocation( iShader->_program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
+  PermutationUniform( iShader, iSpecialized, PBR_FEATURE_PARALLAX_CUBEMAP, "uParallaxCubemap", iObject->_parallax_cubemap );
+  glUniform3fv( glGetUniformLocation( iShader->_program, "uCubemapPos" ), 1, &iObject->_IBL_position[ 0 ] );
+
+  // Opacity uniforms
+  glUniform1f( glGetUniformLocation( iShader->_program, "uAlpha" ), iObject->_alpha );
+  PermutationUniform( iShader, iSpecialized, PBR_FEATURE_OPACITY_MAP, "uOpacityMap", iObject->_opacity_map );
+  glUniform1f( glGetUniformLocation( iShader->_program, "uOpacityDiscard" ), 1.0 );
+
+  // Displacement mapping uniforms
+  glUniform1f( glGetUniformLocation( iShader->_program, "uDisplacementFactor" ), -iObject->_displacement_factor );
+  glUniform1f( glGetUniformLocation( iShader->_program, "uTessellationFactor" ), iObject->_tessellation_factor );
+  PermutationUniform( iShader, iSpecialized, PBR_FEATURE_NORMAL_MAP, "uNormalMap", iObject->_normal_map );
+
+  // Omnidirectional shadow mapping uniforms
+  PermutationUniform( iShader, iSpecialized, PBR_FEATURE_RECEIV_SHADOW, "uReceivShadow", iObject->_receiv_shadow );
+  glUniform1f( glGetUniformLocation( iShader->_program, "uShadowFar" ), _shadow_far );
+  glUniform1f( glGetUniformLocation( iShader->_program, "uShadowBias" ), iObject->_shadow_bias );
+  glUniform1f( glGetUniformLocation( iShader->_program, "uShadowDarkness" ), iObject->_shadow_darkness );
+
+  // Emissive uniforms
+  PermutationUniform( iShader, iSpecialized, PBR_FEATURE_EMISSIVE, "uEmissive", iObject->_emissive );
+  glUniform1f( glGetUniformLocation( iShader->_program, "uEmissiveFactor" ), iObject->_emissive_factor );
+
+  glUniform1f( glGetUniformLocation( iShader->_program, "uID" ), iObject->_id );      
+}
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _room2_table1._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _room2_table1._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _room2_table1._shadow_darkness );
+void Scene::DeferredGeometryPass( glm::mat4 * iProjectionMatrix,
+                                  glm::mat4 * iViewMatrix )
+{ 
+  Shader * current_shader;
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _room2_table1._id );      
 
-    _room2_table1_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+  // Bind and clear G-buffer textures, the lighting target gets the ambient and emissive terms
+  // -----------------------------------------------------------------------------------------
+  unsigned int attachments[ 4 ] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
+  glDrawBuffers( 4, attachments );
 
+  // Only the geometry pass updates the depth buffer
+  StateCache::DepthMask( GL_TRUE );
+  glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
-    // Draw mask
-    // ---------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
+  // Use depth test while drawing G-buffer textures
+  StateCache::Enable( GL_DEPTH_TEST );
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _mask._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _mask._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+  StateCache::Disable( GL_BLEND );
 
-    model_matrix = _mask._model_matrix;
+  // View uniforms of both geometry programs
+  Shader * geometry_shaders[ 2 ] = { &_geometry_pass_shader, &_geometry_displacement_pass_shader };
+  for( unsigned int shader_it = 0; shader_it < 2; shader_it++ )
+  {
+    geometry_shaders[ shader_it ]->Use();
+    glUniformMatrix4fv( glGetUniformLocation( geometry_shaders[ shader_it ]->_program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( *iViewMatrix ) );
+    glUniformMatrix4fv( glGetUniformLocation( geometry_shaders[ shader_it ]->_program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( *iProjectionMatrix ) );
+    glUniform3fv( glGetUniformLocation( geometry_shaders[ shader_it ]->_program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  }
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
-    {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
+  // Draw grounds and walls type 1, tessellated when height mapped
+  // -------------------------------------------------------------
+  std::vector< Object > * planes[ 2 ]      = { &_grounds_type1, &_walls_type1 };
+  unsigned int            planes_start[ 2 ] = { ( unsigned int )_grounds_start_it, ( unsigned int )_walls_start_it };
+  unsigned int            planes_end[ 2 ]   = { ( unsigned int )_grounds_end_it, ( unsigned int )_walls_end_it };
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _mask._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _mask._parallax_cubemap );
+  for( unsigned int planes_it = 0; planes_it < 2; planes_it++ )
+  {
+    for( unsigned int plane_it = planes_start[ planes_it ]; plane_it < planes_end[ planes_it ]; plane_it++ )
+    {
+      Object * plane = &( *planes[ planes_it ] )[ plane_it ];
+      if( !IsInDemoPVS( plane->_PVS_id ) )
+      {
+        continue;
+      }
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _mask._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _mask._bloom_brightness );
+      current_shader = ( plane->_height_map && !plane->_baked_displacement ) ? &_geometry_displacement_pass_shader : &_geometry_pass_shader;
+      current_shader->Use();
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _mask._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _mask._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _mask._normal_map );
+      // Textures binding
+      for( unsigned int texture_it = 0; texture_it < 6; texture_it++ )
+      {
+        StateCache::ActiveTexture( GL_TEXTURE0 + texture_it );
+        StateCache::BindTexture( GL_TEXTURE_2D, _loaded_materials[ plane->_material_id ][ texture_it ] );
+      }
+      if( plane->_emissive )
+      {
+        StateCache::ActiveTexture( GL_TEXTURE11 );
+        StateCache::BindTexture( GL_TEXTURE_2D, _loaded_materials[ plane->_material_id ][ 6 ] );
+      }
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _mask._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _mask._emissive_factor );
+      DeferredObjectBinding( current_shader, plane, 0 );
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _mask._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _mask._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _mask._shadow_darkness );
+      if( plane->_baked_displacement )
+      {
+        DisplacementLODsDraw( plane, glm::vec3( glm::inverse( *iViewMatrix )[ 3 ] ) );
+      }
+      else if( planes_it == 0 )
+      {
+        ( plane->_id == 18 ) ? StateCache::BindVertexArray( _ground2_VAO ) : StateCache::BindVertexArray( _ground1_VAO );
+        ( plane->_height_map == true ) ? glDrawElements( GL_PATCHES, _ground1_indices.size(), GL_UNSIGNED_INT, 0 ) : glDrawElements( GL_TRIANGLES, _ground1_indices.size(), GL_UNSIGNED_INT, 0 );
+      }
+      else
+      {
+        ( plane->_id == 4 ) ? StateCache::BindVertexArray( _wall2_VAO ) : StateCache::BindVertexArray( _wall1_VAO );
+        ( plane->_height_map == true ) ? glDrawElements( GL_PATCHES, _wall1_indices.size(), GL_UNSIGNED_INT, 0 ) : glDrawElements( GL_TRIANGLES, _wall1_indices.size(), GL_UNSIGNED_INT, 0 );
+      }
+      StateCache::BindVertexArray( 0 );
+    }
+  }
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _mask._id );      
 
-    _mask_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+  // Draw models opaque parts, transparent parts are forward rendered after the lighting
+  // -----------------------------------------------------------------------------------
+  std::vector< SceneProp > props;
+  ModelsDrawList( &props );
 
+  _geometry_pass_shader.Use();
+  for( unsigned int prop_it = 0; prop_it < props.size(); prop_it++ )
+  {
+    if( props[ prop_it ]._cull_face )
+    {
+      StateCache::Enable( GL_CULL_FACE );
+      StateCache::CullFace( GL_BACK );
+    }
 
-    // Draw arm
-    // --------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
+    DeferredObjectBinding( &_geometry_pass_shader, props[ prop_it ]._object, 0 );
+    DeferredDoorsIBLOverride( &_geometry_pass_shader, props[ prop_it ]._model, 0 );
+    props[ prop_it ]._model->DrawParts( _geometry_pass_shader, props[ prop_it ]._object->_model_matrix, true, false );
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _arm._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _arm._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+    StateCache::Disable( GL_CULL_FACE );
+  }
+  StateCache::UseProgram( 0 );
 
-    model_matrix = _arm._model_matrix;
+  // Only the geometry pass modify the depth buffer, then disable after it
+  StateCache::DepthMask( GL_FALSE );
+}
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+void Scene::ModelsDrawList( std::vector< SceneProp > * oProps )
+{
+  // Doors and lights always drawn, current room props through the PVS
+  std::vector< Object > * objects[ 4 ] = { &_simple_door, &_top_light, &_wall_light, &_revolving_door };
+  Model *                 models[ 4 ]  = { _simple_door_model, _top_light_model, _wall_light_model, _revolving_door_model };
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
+  SceneProp prop;
+  prop._cull_face = true;
+  for( unsigned int objects_it = 0; objects_it < 4; objects_it++ )
+  {
+    for( unsigned int object_it = 0; object_it < objects[ objects_it ]->size(); object_it++ )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
+      prop._object = &( *objects[ objects_it ] )[ object_it ];
+      prop._model  = models[ objects_it ];
+      oProps->push_back( prop );
     }
+  }
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _arm._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _arm._parallax_cubemap );
-
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _arm._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _arm._bloom_brightness );
-
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _arm._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _arm._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _arm._normal_map );
+  std::vector< SceneProp > * room_props = &_room_props[ _current_room - 1 ];
+  for( unsigned int prop_it = 0; prop_it < room_props->size(); prop_it++ )
+  {
+    if( IsInDemoPVS( ( *room_props )[ prop_it ]._object->_PVS_id ) )
+    {
+      oProps->push_back( ( *room_props )[ prop_it ] );
+    }
+  }
+}
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _arm._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _arm._emissive_factor );
+void Scene::DeferredDoorsIBLOverride( Shader *     iShader,
+                                      Model *      iModel,
+                                      unsigned int iSpecialized )
+{
+  // Doors move between rooms, same forced IBL as the forward pipeline
+  if( iModel == _simple_door_model || iModel == _revolving_door_model )
+  {
+    PermutationUniform( iShader, iSpecialized, PBR_FEATURE_IBL, "uIBL", true );
+    PermutationUniform( iShader, iSpecialized, PBR_FEATURE_PARALLAX_CUBEMAP, "uParallaxCubemap", false );
+  }
+}
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _arm._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _arm._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _arm._shadow_darkness );
+void Scene::DeferredTransparentPass( glm::mat4 * iProjectionMatrix,
+                                     glm::mat4 * iViewMatrix )
+{
+  // Forward shading over the lit targets, tested against the G-buffer depth
+  glDrawBuffer( GL_COLOR_ATTACHMENT3 );
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _arm._id );      
+  StateCache::Enable( GL_DEPTH_TEST );
+  StateCache::DepthMask( GL_FALSE );
 
-    _arm_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+  unsigned int specialized = _shader_permutations ? PBR_FEATURES_OBJECT : 0;
 
-  }
+  std::vector< SceneProp > props;
+  ModelsDrawList( &props );
 
-  if( _current_room == 3 )
+  for( unsigned int prop_it = 0; prop_it < props.size(); prop_it++ )
   {
+    Model * model = props[ prop_it ]._model;
+    bool    door  = ( model == _simple_door_model || model == _revolving_door_model );
+    _forward_pbr_shader.UsePermutation( specialized, door ? DoorPermutation( props[ prop_it ]._object ) : ObjectPermutation( props[ prop_it ]._object ) );
 
-    // Draw tank
-    // ---------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
+    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( *iViewMatrix ) );
+    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( *iProjectionMatrix ) );
+    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _tank._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _tank._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+    // Few transparent fragments, they loop over every light
+    ForwardLightsBinding( &_forward_pbr_shader, false, 1.0 );
 
-    model_matrix = _tank._model_matrix;
+    DeferredObjectBinding( &_forward_pbr_shader, props[ prop_it ]._object, specialized );
+    DeferredDoorsIBLOverride( &_forward_pbr_shader, model, specialized );
+    props[ prop_it ]._model->DrawParts( _forward_pbr_shader, props[ prop_it ]._object->_model_matrix, false, true );
+  }
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  StateCache::UseProgram( 0 );
+}
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
-    {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
+void Scene::DeferredLightingPass( glm::mat4 * iProjectionMatrix,
+                                  glm::mat4 * iViewMatrix )
+{ 
+  float screen_size[ 2 ] = { ( float )_render_width, ( float )_render_height };
+  glm::mat4 model_matrix;
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _tank._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _tank._parallax_cubemap );
+  // Fragments world position rebuilt from depth
+  glm::mat4 inverse_view_projection = glm::inverse( *iProjectionMatrix * *iViewMatrix );
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _tank._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _tank._bloom_brightness );
-
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _tank._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _tank._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _tank._normal_map );
-
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _tank._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _tank._emissive_factor );
-
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _tank._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _tank._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _tank._shadow_darkness );
-
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _tank._id );      
-
-    _tank_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+  // Shadow atlas tiers and lights texture buffer, lights are read by index
+  for( unsigned int tier_it = 0; tier_it < SHADOW_ATLAS_TIER_COUNT; tier_it++ )
+  {
+    StateCache::ActiveTexture( GL_TEXTURE10 + tier_it + ( tier_it > 0 ? 1 : 0 ) );
+    StateCache::BindTexture( GL_TEXTURE_CUBE_MAP_ARRAY, _window->_toolbox->_shadow_atlas[ tier_it ] );
+    glBindSampler( 10 + tier_it + ( tier_it > 0 ? 1 : 0 ), 0 );
+  }
+  StateCache::ActiveTexture( GL_TEXTURE15 );
+  StateCache::BindTexture( GL_TEXTURE_BUFFER, _light_grid->_buffer_texture );
 
+  // Enable stencil test for stencil pass and lighting pass
+  StateCache::Enable( GL_STENCIL_TEST );
 
-    // Draw shelving
-    // -------------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
+  for( int i = 0; i < _lights.size(); i++ )
+  {
+    
+    // Stencil pass
+    // ------------
+    _empty_shader.Use();   
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _shelving._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _shelving._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+    // Don't draw anything during the stencil pass, juste modify the stencil buffer
+    glDrawBuffer( GL_NONE );
+    
+    // Need depth test enable to perform stencil buffer modification     
+    StateCache::Enable( GL_DEPTH_TEST );
 
-    model_matrix = _shelving._model_matrix;
+    // Need both volume sphere faces to perform stencil buffer modification
+    StateCache::Disable( GL_CULL_FACE );
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+    glClear( GL_STENCIL_BUFFER_BIT );
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
-    {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
+    // Set stencil operation correctly
+    glStencilFunc( GL_ALWAYS, 0, 0 );
+    glStencilOpSeparate( GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP );
+    glStencilOpSeparate( GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP );
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _shelving._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _shelving._parallax_cubemap );
+    // Set correct model matrix
+    model_matrix = glm::mat4();
+    model_matrix = glm::translate( model_matrix, _lights[ i ]._position );
+    model_matrix = glm::scale( model_matrix, glm::vec3( _lights[ i ]._max_lighting_distance ) ); 
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _shelving._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _shelving._bloom_brightness );
+    // Uniforms
+    glUniformMatrix4fv( glGetUniformLocation( _empty_shader._program, "uViewMatrix" ) , 1, GL_FALSE, glm::value_ptr( *iViewMatrix ) );
+    glUniformMatrix4fv( glGetUniformLocation( _empty_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
+    glUniformMatrix4fv( glGetUniformLocation( _empty_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( *iProjectionMatrix ) );
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _shelving._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _shelving._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
+    _sphere_model->Draw( _empty_shader, model_matrix );
+    StateCache::BindVertexArray( 0 );
     
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _shelving._normal_map );
-
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _shelving._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _shelving._emissive_factor );
+    StateCache::UseProgram( 0 );
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _shelving._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _shelving._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _shelving._shadow_darkness );
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _shelving._id );      
+    // Lighting pass
+    // -------------
 
-    _shelving_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+    // Bind the rendered frames
+    glDrawBuffer( GL_COLOR_ATTACHMENT3 );
+ 
+    _lighting_pass_shader.Use();   
 
+    // Bind lighting input texture
+    StateCache::ActiveTexture( GL_TEXTURE0 );
+    StateCache::BindTexture( GL_TEXTURE_2D, _g_buffer_textures[ 0 ] );  
+    StateCache::ActiveTexture( GL_TEXTURE1 );
+    StateCache::BindTexture( GL_TEXTURE_2D, _g_buffer_textures[ 1 ] ); 
+    StateCache::ActiveTexture( GL_TEXTURE2 );
+    StateCache::BindTexture( GL_TEXTURE_2D, _g_buffer_textures[ 2 ] ); 
+    StateCache::ActiveTexture( GL_TEXTURE3 );
+    StateCache::BindTexture( GL_TEXTURE_2D, _g_buffer_textures[ 3 ] );
 
-    // Draw gun1
-    // ---------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
+    // Set stencil test to pass only for the stencil values calculated before, when not equal 0 
+    glStencilFunc( GL_NOTEQUAL, 0, 0xFF );
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _gun1._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _gun1._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+    // Don't need depth test anymore at this point
+    StateCache::Disable( GL_DEPTH_TEST );
 
-    model_matrix = _gun1._model_matrix;
+    // Set additional blending for all point light result
+    StateCache::Enable( GL_BLEND );
+    glBlendEquation( GL_FUNC_ADD );
+    StateCache::BlendFunc( GL_ONE, GL_ONE );
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+    // Front face culling to still calculate lighting when camera is inside the volume sphere
+    StateCache::Enable( GL_CULL_FACE );
+    StateCache::CullFace( GL_FRONT );
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
-    {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
+    glUniformMatrix4fv( glGetUniformLocation( _lighting_pass_shader._program, "uViewMatrix" ) , 1, GL_FALSE, glm::value_ptr( *iViewMatrix ) );
+    glUniformMatrix4fv( glGetUniformLocation( _lighting_pass_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
+    glUniformMatrix4fv( glGetUniformLocation( _lighting_pass_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( *iProjectionMatrix ) );
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _gun1._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _gun1._parallax_cubemap );
+    glUniformMatrix4fv( glGetUniformLocation( _lighting_pass_shader._program, "uInverseViewProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( inverse_view_projection ) );
+    glUniform3fv( glGetUniformLocation( _lighting_pass_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+    glUniform1i( glGetUniformLocation( _lighting_pass_shader._program, "uLightIndex" ), i );
+    glUniform1f( glGetUniformLocation( _lighting_pass_shader._program, "uShadowFar" ), _shadow_far );
+    glUniform2fv( glGetUniformLocation( _lighting_pass_shader._program, "uScreenSize" ), 1, screen_size );
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _gun1._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _gun1._bloom_brightness );
+    _sphere_model->Draw( _lighting_pass_shader, model_matrix );
+    StateCache::BindVertexArray( 0 );
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _gun1._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _gun1._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _gun1._normal_map );
+    StateCache::UseProgram( 0 );
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _gun1._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _gun1._emissive_factor );
+    StateCache::Disable( GL_BLEND );
+  }
+  // Disable stencil test
+  StateCache::Disable( GL_STENCIL_TEST );
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _gun1._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _gun1._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _gun1._shadow_darkness );
+  StateCache::CullFace( GL_BACK );
+  StateCache::Disable( GL_BLEND );
+}
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _gun1._id );      
+void Scene::DeferredTiledLightingPass( glm::mat4 * iProjectionMatrix,
+                                       glm::mat4 * iViewMatrix )
+{
+  _tiled_lighting_shader.Use();
 
-    _gun1_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+  // G-buffer read once, lights from the lights texture buffer
+  for( unsigned int texture_it = 0; texture_it < 4; texture_it++ )
+  {
+    StateCache::ActiveTexture( GL_TEXTURE0 + texture_it );
+    StateCache::BindTexture( GL_TEXTURE_2D, _g_buffer_textures[ texture_it ] );
+  }
+  for( unsigned int tier_it = 0; tier_it < SHADOW_ATLAS_TIER_COUNT; tier_it++ )
+  {
+    StateCache::ActiveTexture( GL_TEXTURE10 + tier_it + ( tier_it > 0 ? 1 : 0 ) );
+    StateCache::BindTexture( GL_TEXTURE_CUBE_MAP_ARRAY, _window->_toolbox->_shadow_atlas[ tier_it ] );
+    glBindSampler( 10 + tier_it + ( tier_it > 0 ? 1 : 0 ), 0 );
+  }
+  StateCache::ActiveTexture( GL_TEXTURE15 );
+  StateCache::BindTexture( GL_TEXTURE_BUFFER, _light_grid->_buffer_texture );
+
+  // Lights added over the geometry pass ambient
+  glBindImageTexture( 0, _g_buffer_textures[ 4 ], 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F );
+
+  glUniformMatrix4fv( glGetUniformLocation( _tiled_lighting_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( *iViewMatrix ) );
+  glUniformMatrix4fv( glGetUniformLocation( _tiled_lighting_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( *iProjectionMatrix ) );
+  glUniformMatrix4fv( glGetUniformLocation( _tiled_lighting_shader._program, "uInverseViewProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( glm::inverse( *iProjectionMatrix * *iViewMatrix ) ) );
+  glUniform3fv( glGetUniformLocation( _tiled_lighting_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  glUniform1f( glGetUniformLocation( _tiled_lighting_shader._program, "uNear" ), _near );
+  glUniform1f( glGetUniformLocation( _tiled_lighting_shader._program, "uFar" ), _far );
+  glUniform2i( glGetUniformLocation( _tiled_lighting_shader._program, "uScreenSize" ), _render_width, _render_height );
+  glUniform1i( glGetUniformLocation( _tiled_lighting_shader._program, "uLightCount" ), _light_grid->_light_count );
+  glUniform1f( glGetUniformLocation( _tiled_lighting_shader._program, "uShadowFar" ), _shadow_far );
+
+  // One work group per 16x16 tile
+  glDispatchCompute( ( _render_width + 15 ) / 16, ( _render_height + 15 ) / 16, 1 );
+
+  // Following passes sample the targets or draw into them
+  glMemoryBarrier( GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT );
+
+  glBindImageTexture( 0, 0, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F );
+  StateCache::UseProgram( 0 );
+}
 
+void Scene::PrintDeferredLightingInfos()
+{
+  Uint32 t;
+  static Uint32 t0 = 0;
+  t = SDL_GetTicks();
+  if( _pipeline_type == DEFERRED_RENDERING && t - t0 > 1000 )
+  {
+    fprintf( stderr, "Deferred lighting -> %s, %u lights, G-buffer %u B/px ( %.1f MB ), geometry pass %.3f ms, lighting pass %.3f ms\n",
+             ( _tiled_deferred_lighting && _tiled_deferred_supported ) ? "tiled compute" : "stencil volumes",
+             ( unsigned int )_lights.size(),
+             G_BUFFER_COMPACT_BYTES_PER_PIXEL,
+             G_BUFFER_COMPACT_BYTES_PER_PIXEL * _window->_width * _window->_height / ( 1024.0 * 1024.0 ),
+             ( _deferred_pass_samples > 0 ) ? _geometry_pass_time / _deferred_pass_samples : 0.0,
+             ( _deferred_pass_samples > 0 ) ? _deferred_pass_time / _deferred_pass_samples : 0.0 );
+
+    _geometry_pass_time    = 0.0;
+    _deferred_pass_time    = 0.0;
+    _deferred_pass_samples = 0;
+    t0 = t;
+  }
+}
 
-    // Draw gun2
-    // ---------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
+void Scene::GBufferBandwidthBenchmark()
+{
+  // Previous and compact layouts, color attachments then depth
+  const GLenum legacy_formats[ 5 ][ 3 ]  = { { GL_RGBA16F,           GL_RGBA,          GL_FLOAT                          },
+                                             { GL_RGBA16F,           GL_RGBA,          GL_FLOAT                          },
+                                             { GL_RGB16F,            GL_RGB,           GL_FLOAT                          },
+                                             { GL_RGB16F,            GL_RGB,           GL_FLOAT                          },
+                                             { GL_DEPTH32F_STENCIL8, GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV } };
+  const GLenum compact_formats[ 5 ][ 3 ] = { { GL_RG16,              GL_RG,            GL_UNSIGNED_SHORT                 },
+                                             { GL_SRGB8_ALPHA8,      GL_RGBA,          GL_UNSIGNED_BYTE                  },
+                                             { GL_RGBA8,             GL_RGBA,          GL_UNSIGNED_BYTE                  },
+                                             { GL_NONE,              GL_NONE,          GL_NONE                           },
+                                             { GL_DEPTH24_STENCIL8,  GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8              } };
+  const GLenum ( * layouts[ 2 ] )[ 3 ]   = { legacy_formats, compact_formats };
+  const unsigned int layouts_bytes[ 2 ]  = { G_BUFFER_LEGACY_BYTES_PER_PIXEL, G_BUFFER_COMPACT_BYTES_PER_PIXEL };
+  const char *       layouts_names[ 2 ]  = { "previous", "compact" };
+  const unsigned int resolutions[ 2 ][ 2 ] = { { 1440, 900 }, { 3840, 2160 } };
+  const unsigned int fill_count = 32;
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _gun2._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _gun2._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+  unsigned int attachments[ 4 ] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
+  unsigned int query;
+  glGenQueries( 1, &query );
 
-    model_matrix = _gun2._model_matrix;
+  std::cout << std::endl << "G-buffer fill benchmark, " << fill_count << " full screen fills" << std::endl
+                         << "--------------------------------------------" << std::endl;
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  for( unsigned int resolution_it = 0; resolution_it < 2; resolution_it++ )
+  {
+    unsigned int width  = resolutions[ resolution_it ][ 0 ];
+    unsigned int height = resolutions[ resolution_it ][ 1 ];
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
+    for( unsigned int layout_it = 0; layout_it < 2; layout_it++ )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
+      unsigned int FBO;
+      unsigned int textures[ 5 ];
+      unsigned int color_count = 0;
+
+      glGenFramebuffers( 1, &FBO );
+      StateCache::BindFramebuffer( GL_FRAMEBUFFER, FBO );
+      glGenTextures( 5, textures );
+      for( unsigned int texture_it = 0; texture_it < 5; texture_it++ )
+      {
+        const GLenum * format = layouts[ layout_it ][ texture_it ];
+        if( format[ 0 ] == GL_NONE )
+        {
+          continue;
+        }
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _gun2._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _gun2._parallax_cubemap );
+        StateCache::BindTexture( GL_TEXTURE_2D, textures[ texture_it ] );
+        glTexImage2D( GL_TEXTURE_2D, 0, format[ 0 ], width, height, 0, format[ 1 ], format[ 2 ], NULL );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+        if( texture_it == 4 )
+        {
+          glFramebufferTexture2D( GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, textures[ texture_it ], 0 );
+        }
+        else
+        {
+          glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + color_count, GL_TEXTURE_2D, textures[ texture_it ], 0 );
+          color_count++;
+        }
+      }
+      glDrawBuffers( color_count, attachments );
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _gun2._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _gun2._bloom_brightness );
+      if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+      {
+        std::cout << "ERROR : G-buffer benchmark FBO not complete" << std::endl;
+      }
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _gun2._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _gun2._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _gun2._normal_map );
+      // Every pixel written on all targets, depth included
+      glViewport( 0, 0, width, height );
+      StateCache::Enable( GL_DEPTH_TEST );
+      StateCache::DepthFunc( GL_ALWAYS );
+      StateCache::DepthMask( GL_TRUE );
+      StateCache::Disable( GL_BLEND );
+      _g_buffer_fill_shader.Use();
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _gun2._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _gun2._emissive_factor );
+      glBeginQuery( GL_TIME_ELAPSED, query );
+      for( unsigned int fill_it = 0; fill_it < fill_count; fill_it++ )
+      {
+        _window->_toolbox->RenderQuad();
+      }
+      glEndQuery( GL_TIME_ELAPSED );
+
+      GLuint64 elapsed_time = 0;
+      glGetQueryObjectui64v( query, GL_QUERY_RESULT, &elapsed_time );
+      double fill_time = ( elapsed_time / 1000000.0 ) / fill_count;
+      double fill_size = ( double )layouts_bytes[ layout_it ] * width * height;
+
+      fprintf( stderr, "%ux%u %-8s : %2u B/px, %6.1f MB, fill %.3f ms, %.1f GB/s\n",
+               width,
+               height,
+               layouts_names[ layout_it ],
+               layouts_bytes[ layout_it ],
+               fill_size / ( 1024.0 * 1024.0 ),
+               fill_time,
+               ( fill_time > 0.0 ) ? ( fill_size / ( fill_time / 1000.0 ) ) / 1000000000.0 : 0.0 );
+
+      StateCache::UseProgram( 0 );
+      StateCache::DeleteTextures( 5, textures );
+      StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
+      StateCache::DeleteFramebuffers( 1, &FBO );
+    }
+  }
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _gun2._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _gun2._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _gun2._shadow_darkness );
+  glDeleteQueries( 1, &query );
+  StateCache::DepthFunc( GL_LESS );
+  glViewport( 0, 0, _window->_width, _window->_height );
+}
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _gun2._id );      
+void Scene::SceneDeferredRendering()
+{
 
-    _gun2_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+  // Projection and view matrices setting
+  glm::mat4 model_matrix;
 
+  // Lights texels with their shadow slots, both lighting paths read them by index
+  LightGridUpdate( false );
 
-    // Draw gun3
-    // ---------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
+  // Bind and clear the rendered frames
+  glViewport( 0, 0, _render_width, _render_height );
+  StateCache::BindFramebuffer( GL_DRAW_FRAMEBUFFER, _g_buffer_FBO );
+  glDrawBuffer( GL_COLOR_ATTACHMENT3 );
+  glClear( GL_COLOR_BUFFER_BIT );
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _gun3._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _gun3._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
 
-    model_matrix = _gun3._model_matrix;
+  // Passes timed one frame later
+  GLuint64 elapsed_time = 0;
+  if( _deferred_query_it > 0 )
+  {
+    glGetQueryObjectui64v( _geometry_time_queries[ ( _deferred_query_it - 1 ) % 2 ], GL_QUERY_RESULT, &elapsed_time );
+    _geometry_pass_time += elapsed_time / 1000000.0;
+    glGetQueryObjectui64v( _deferred_time_queries[ ( _deferred_query_it - 1 ) % 2 ], GL_QUERY_RESULT, &elapsed_time );
+    _deferred_pass_time += elapsed_time / 1000000.0;
+    _deferred_pass_samples++;
+  }
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
-    {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
+  // Deferred rendering G-buffer pass
+  // --------------------------------
+  glBeginQuery( GL_TIME_ELAPSED, _geometry_time_queries[ _deferred_query_it % 2 ] );
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _gun3._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _gun3._parallax_cubemap );
+  DeferredGeometryPass( &_camera->_projection_matrix,
+                        &_camera->_view_matrix );
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _gun3._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _gun3._bloom_brightness );
+  glEndQuery( GL_TIME_ELAPSED );
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _gun3._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _gun3._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _gun3._normal_map );
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _gun3._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _gun3._emissive_factor );
+  // Deferred rendering lighting pass
+  // --------------------------------
+  glBeginQuery( GL_TIME_ELAPSED, _deferred_time_queries[ _deferred_query_it % 2 ] );
+  _deferred_query_it++;
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _gun3._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _gun3._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _gun3._shadow_darkness );
+  if( _tiled_deferred_lighting && _tiled_deferred_supported )
+  {
+    DeferredTiledLightingPass( &_camera->_projection_matrix,
+                               &_camera->_view_matrix );
+  }
+  else
+  {
+    DeferredLightingPass( &_camera->_projection_matrix,
+                          &_camera->_view_matrix );
+  }
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _gun3._id );      
+  glEndQuery( GL_TIME_ELAPSED );
 
-    _gun3_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
 
+  // Forward render transparent parts over the lit frame
+  // ---------------------------------------------------
+  DeferredTransparentPass( &_camera->_projection_matrix,
+                           &_camera->_view_matrix );
 
-    // Draw room3_table1
-    // -----------------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _room3_table1._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _room3_table1._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+  // Forward render lamps sphere
+  // ---------------------------
+  StateCache::Enable( GL_DEPTH_TEST );
+  StateCache::DepthMask( GL_FALSE );
 
-    model_matrix = _room3_table1._model_matrix;
+  _flat_color_shader.Use();
+  for( int i = 0; i < _lights.size(); i++ )
+  {
+    model_matrix = glm::mat4();
+    model_matrix = glm::translate( model_matrix, _lights[ i ]._position );
+    model_matrix = glm::scale( model_matrix, glm::vec3( 0.04f ) ); 
+    glm::vec3 lamp_color = _lights[ i ]._color * _lights[ i ]._intensity;
+    glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uViewMatrix" ) , 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
+    glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
+    glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
+    glUniform3f( glGetUniformLocation( _flat_color_shader._program, "uColor" ), lamp_color.x, lamp_color.y, lamp_color.z );
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+    _sphere_model->Draw( _flat_color_shader, model_matrix );
+  }
+  StateCache::UseProgram( 0 );
+  
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
+  // Forward render lights volume
+  // ----------------------------
+  if( _render_lights_volume )
+  {
+    _flat_color_shader.Use();
     for( int i = 0; i < _lights.size(); i++ )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
-
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _room3_table1._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _room3_table1._parallax_cubemap );
-
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _room3_table1._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _room3_table1._bloom_brightness );
-
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _room3_table1._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _room3_table1._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _room3_table1._normal_map );
-
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _room3_table1._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _room3_table1._emissive_factor );
-
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _room3_table1._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _room3_table1._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _room3_table1._shadow_darkness );
-
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _room3_table1._id );      
-
-    _room3_table1_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
-
+      model_matrix = glm::mat4();
+      model_matrix = glm::translate( model_matrix, _lights[ i ]._position );
+      model_matrix = glm::scale( model_matrix, glm::vec3( _lights[ i ]._max_lighting_distance ) ); 
+      glm::vec3 sphere_color = glm::vec3( 0.0, 0.0, 1.0 ) * _lights[ i ]._intensity;
+      glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uViewMatrix" ) , 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
+      glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
+      glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
+      glUniform3f( glGetUniformLocation( _flat_color_shader._program, "uColor" ), sphere_color.x, sphere_color.y, sphere_color.z );
 
-    // Draw room3_table2
-    // -----------------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
+      _sphere_model->Draw( _flat_color_shader, model_matrix );
+    }
+    StateCache::UseProgram( 0 );
+  }
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _room3_table2._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _room3_table2._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+  // Unbind current FBO
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
 
-    model_matrix = _room3_table2._model_matrix;
+void Scene::PipelineSwitch()
+{
+  // G-buffer FBO and deferred programs built on first use, the frame graph brings the targets
+  if( _g_buffer_FBO == 0 )
+  {
+    DeferredShadersInitialization();
+    DeferredBuffersInitialization();
+  }
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  _pipeline_type = ( _pipeline_type == FORWARD_RENDERING ) ? DEFERRED_RENDERING : FORWARD_RENDERING;
+}
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
-    {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
+void Scene::PipelineBenchmarkStart()
+{
+  if( _pipeline_benchmark || _shadow_filter_benchmark )
+  {
+    return;
+  }
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _room3_table2._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _room3_table2._parallax_cubemap );
+  if( _g_buffer_FBO == 0 )
+  {
+    DeferredShadersInitialization();
+    DeferredBuffersInitialization();
+  }
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _room3_table2._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _room3_table2._bloom_brightness );
+  // Current state restored at the end
+  _pipeline_benchmark_saved_type        = _pipeline_type;
+  _pipeline_benchmark_saved_many_lights = _many_lights_benchmark;
+  _pipeline_benchmark_saved_many_count  = _many_lights_count;
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _room3_table2._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _room3_table2._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _room3_table2._normal_map );
+  glGenQueries( 4, &_pipeline_benchmark_queries[ 0 ][ 0 ] );
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _room3_table2._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _room3_table2._emissive_factor );
+  _pipeline_benchmark      = true;
+  _pipeline_benchmark_step = 0;
+  PipelineBenchmarkStepSetup();
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _room3_table2._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _room3_table2._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _room3_table2._shadow_darkness );
+  std::cout << std::endl << "Pipelines benchmark, " << PIPELINE_BENCHMARK_FRAMES << " frames per step after " << PIPELINE_BENCHMARK_WARMUP << " warmup frames" << std::endl
+                         << "------------------------------------------------------------" << std::endl;
+}
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _room3_table2._id );      
+void Scene::PipelineBenchmarkStepSetup()
+{
+  // Extra lights on top of the scene ones, forward then deferred for each count
+  const unsigned int extra_lights[ PIPELINE_BENCHMARK_LIGHT_STEPS ] = { 0, 32, 128, 448 };
+  unsigned int light_step = _pipeline_benchmark_step / 2;
 
-    _room3_table2_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+  ManyLightsBenchmark( false );
+  if( extra_lights[ light_step ] > 0 )
+  {
+    _many_lights_count = extra_lights[ light_step ];
+    ManyLightsBenchmark( true );
+  }
+  _pipeline_benchmark_lights[ light_step ] = _lights.size();
 
+  _pipeline_type = ( _pipeline_benchmark_step % 2 == 0 ) ? FORWARD_RENDERING : DEFERRED_RENDERING;
 
-    // Draw helmet
-    // -----------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
+  _pipeline_benchmark_frame = 0;
+  _pipeline_benchmark_time  = 0.0;
+}
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _helmet._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _helmet._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+void Scene::PipelineBenchmarkFrameBegin()
+{
+  // Timestamps, the passes own elapsed time queries can't be nested in a wider one
+  glQueryCounter( _pipeline_benchmark_queries[ _pipeline_benchmark_frame % 2 ][ 0 ], GL_TIMESTAMP );
+}
 
-    model_matrix = _helmet._model_matrix;
+void Scene::PipelineBenchmarkFrameEnd()
+{
+  glQueryCounter( _pipeline_benchmark_queries[ _pipeline_benchmark_frame % 2 ][ 1 ], GL_TIMESTAMP );
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  // Previous frame read back, warmup frames ignored
+  if( _pipeline_benchmark_frame > PIPELINE_BENCHMARK_WARMUP )
+  {
+    GLuint64 start_time, end_time;
+    glGetQueryObjectui64v( _pipeline_benchmark_queries[ ( _pipeline_benchmark_frame - 1 ) % 2 ][ 0 ], GL_QUERY_RESULT, &start_time );
+    glGetQueryObjectui64v( _pipeline_benchmark_queries[ ( _pipeline_benchmark_frame - 1 ) % 2 ][ 1 ], GL_QUERY_RESULT, &end_time );
+    _pipeline_benchmark_time += ( end_time - start_time ) / 1000000.0;
+  }
+  _pipeline_benchmark_frame++;
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
-    {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
+  if( _pipeline_benchmark_frame <= PIPELINE_BENCHMARK_WARMUP + PIPELINE_BENCHMARK_FRAMES )
+  {
+    return;
+  }
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _helmet._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _helmet._parallax_cubemap );
+  // Last frame of the step still in flight, drained before switching
+  GLuint64 drain_time;
+  glGetQueryObjectui64v( _pipeline_benchmark_queries[ ( _pipeline_benchmark_frame - 1 ) % 2 ][ 1 ], GL_QUERY_RESULT, &drain_time );
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _helmet._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _helmet._bloom_brightness );
+  _pipeline_benchmark_results[ _pipeline_benchmark_step ] = _pipeline_benchmark_time / PIPELINE_BENCHMARK_FRAMES;
+  _pipeline_benchmark_step++;
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _helmet._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _helmet._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _helmet._normal_map );
+  if( _pipeline_benchmark_step < PIPELINE_BENCHMARK_LIGHT_STEPS * 2 )
+  {
+    PipelineBenchmarkStepSetup();
+    return;
+  }
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _helmet._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _helmet._emissive_factor );
+  // Results table, GPU frame time from scene rendering to post process
+  fprintf( stderr, "\n%8s | %12s | %13s | %s\n", "lights", "forward ms", "deferred ms", "deferred / forward" );
+  for( unsigned int light_step = 0; light_step < PIPELINE_BENCHMARK_LIGHT_STEPS; light_step++ )
+  {
+    double forward_time  = _pipeline_benchmark_results[ light_step * 2 ];
+    double deferred_time = _pipeline_benchmark_results[ light_step * 2 + 1 ];
+    fprintf( stderr, "%8u | %12.3f | %13.3f | %.2f\n",
+             _pipeline_benchmark_lights[ light_step ],
+             forward_time,
+             deferred_time,
+             ( forward_time > 0.0 ) ? deferred_time / forward_time : 0.0 );
+  }
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _helmet._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _helmet._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _helmet._shadow_darkness );
+  // Previous state back
+  ManyLightsBenchmark( false );
+  _many_lights_count = _pipeline_benchmark_saved_many_count;
+  if( _pipeline_benchmark_saved_many_lights )
+  {
+    ManyLightsBenchmark( true );
+  }
+  _pipeline_type = _pipeline_benchmark_saved_type;
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _helmet._id );      
+  glDeleteQueries( 4, &_pipeline_benchmark_queries[ 0 ][ 0 ] );
+  _pipeline_benchmark = false;
+}
 
-    _helmet_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+void Scene::BloomMipChainInitialization( unsigned int * oMips,
+                                         unsigned int   iWidth,
+                                         unsigned int   iHeight )
+{
+  // Packed float is enough for blurred brightness, 4 bytes per texel against 6 for RGB16F
+  glGenTextures( BLOOM_MIP_COUNT, oMips );
+  for( unsigned int mip_it = 0; mip_it < BLOOM_MIP_COUNT; mip_it++ )
+  {
+    StateCache::BindTexture( GL_TEXTURE_2D, oMips[ mip_it ] );
+    glTexImage2D( GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, std::max( iWidth >> ( mip_it + 1 ), 1u ), std::max( iHeight >> ( mip_it + 1 ), 1u ), 0, GL_RGB, GL_FLOAT, NULL );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+  }
+  StateCache::BindTexture( GL_TEXTURE_2D, 0 );
+}
 
+void Scene::BloomMipChainRendering( unsigned int   iSourceTexture,
+                                    bool           iMultiSample,
+                                    unsigned int * iMips,
+                                    unsigned int   iWidth,
+                                    unsigned int   iHeight )
+{
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, _window->_toolbox->_bloom_FBO );
+  glDrawBuffer( GL_COLOR_ATTACHMENT0 );
+  StateCache::ActiveTexture( GL_TEXTURE0 );
 
-    // Draw knife
-    // ----------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _knife._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _knife._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+  // Downsample chain, brightness threshold applied while reading the full resolution frame
+  // --------------------------------------------------------------------------------------
+  unsigned int source_texture = iSourceTexture;
+  unsigned int source_width   = iWidth;
+  unsigned int source_height  = iHeight;
 
-    model_matrix = _knife._model_matrix;
+  for( unsigned int mip_it = 0; mip_it < BLOOM_MIP_COUNT; mip_it++ )
+  {
+    unsigned int mip_width  = std::max( iWidth >> ( mip_it + 1 ), 1u );
+    unsigned int mip_height = std::max( iHeight >> ( mip_it + 1 ), 1u );
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+    glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, iMips[ mip_it ], 0 );
+    glViewport( 0, 0, mip_width, mip_height );
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
+    // Multi sampled frames are read without a resolve, first sample of each texel is enough once blurred
+    if( mip_it == 0 && iMultiSample )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
+      _bloom_prefilter_MS_shader.Use();
+      glUniform1f( glGetUniformLocation( _bloom_prefilter_MS_shader._program, "uThreshold" ), _bloom_threshold );
+      glUniform1f( glGetUniformLocation( _bloom_prefilter_MS_shader._program, "uKnee" ), _bloom_knee );
+      StateCache::BindTexture( GL_TEXTURE_2D_MULTISAMPLE, source_texture );
+      _window->_toolbox->RenderQuad();
+
+      source_texture = iMips[ mip_it ];
+      source_width   = mip_width;
+      source_height  = mip_height;
+      continue;
     }
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _knife._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _knife._parallax_cubemap );
+    _bloom_downsample_shader.Use();
+    glUniform1f( glGetUniformLocation( _bloom_downsample_shader._program, "uThreshold" ), _bloom_threshold );
+    glUniform1f( glGetUniformLocation( _bloom_downsample_shader._program, "uKnee" ), _bloom_knee );
+    StateCache::BindTexture( GL_TEXTURE_2D, source_texture );
+    glUniform2f( glGetUniformLocation( _bloom_downsample_shader._program, "uSourceTexelSize" ), 1.0 / source_width, 1.0 / source_height );
+    glUniform1i( glGetUniformLocation( _bloom_downsample_shader._program, "uPrefilter" ), mip_it == 0 );
+    _window->_toolbox->RenderQuad();
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _knife._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _knife._bloom_brightness );
+    source_texture = iMips[ mip_it ];
+    source_width   = mip_width;
+    source_height  = mip_height;
+  }
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _knife._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _knife._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _knife._normal_map );
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _knife._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _knife._emissive_factor );
+  // Upsample chain, each level tent filtered and added over the next larger one
+  // ---------------------------------------------------------------------------
+  _bloom_upsample_shader.Use();
+  glUniform1f( glGetUniformLocation( _bloom_upsample_shader._program, "uRadius" ), _bloom_radius );
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _knife._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _knife._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _knife._shadow_darkness );
+  StateCache::Enable( GL_BLEND );
+  StateCache::BlendFunc( GL_ONE, GL_ONE );
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _knife._id );      
+  for( unsigned int mip_it = BLOOM_MIP_COUNT - 1; mip_it > 0; mip_it-- )
+  {
+    glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, iMips[ mip_it - 1 ], 0 );
+    glViewport( 0, 0, std::max( iWidth >> mip_it, 1u ), std::max( iHeight >> mip_it, 1u ) );
 
-    _knife_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+    StateCache::BindTexture( GL_TEXTURE_2D, iMips[ mip_it ] );
+    glUniform2f( glGetUniformLocation( _bloom_upsample_shader._program, "uSourceTexelSize" ), 1.0 / std::max( iWidth >> ( mip_it + 1 ), 1u ), 1.0 / std::max( iHeight >> ( mip_it + 1 ), 1u ) );
+    _window->_toolbox->RenderQuad();
+  }
 
+  StateCache::Disable( GL_BLEND );
+  StateCache::UseProgram( 0 );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
 
-    // Draw grenade
-    // ------------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
+void Scene::BlurProcess()
+{ 
+  // Deferred, resolved and upscaled frames are never multi sampled
+  if( _frame_upscaled )
+  {
+    BloomMipChainRendering( _window->_toolbox->_upscale_output, false, _window->_toolbox->_bloom_mips, _window->_width, _window->_height );
+  }
+  else
+  {
+    BloomMipChainRendering( SceneColorTexture(), ( _pipeline_type == FORWARD_RENDERING ) && _multi_sample, _window->_toolbox->_bloom_mips, _window->_width, _window->_height );
+  }
+}
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _grenade._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _grenade._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+void Scene::BloomBenchmark()
+{
+  const unsigned int resolutions[ 3 ][ 2 ] = { { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 } };
+  const unsigned int run_count = 16;
 
-    model_matrix = _grenade._model_matrix;
+  unsigned int query;
+  glGenQueries( 1, &query );
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  std::cout << std::endl << "Bloom blur benchmark, " << run_count << " runs" << std::endl
+                         << "----------------------------" << std::endl;
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
+  for( unsigned int resolution_it = 0; resolution_it < 3; resolution_it++ )
+  {
+    unsigned int width  = resolutions[ resolution_it ][ 0 ];
+    unsigned int height = resolutions[ resolution_it ][ 1 ];
+
+    // Bright HDR source, the blur cost does not depend on the content
+    unsigned int FBO;
+    unsigned int source_texture;
+    unsigned int pingpong_textures[ 2 ];
+    unsigned int mips[ BLOOM_MIP_COUNT ];
+
+    glGenFramebuffers( 1, &FBO );
+    StateCache::BindFramebuffer( GL_FRAMEBUFFER, FBO );
+    glGenTextures( 1, &source_texture );
+    _window->_toolbox->SetFboTexture( source_texture, GL_RGB16F, width, height, GL_COLOR_ATTACHMENT0 );
+    glDrawBuffer( GL_COLOR_ATTACHMENT0 );
+    glClearColor( 2.0f, 2.0f, 2.0f, 1.0f );
+    glClear( GL_COLOR_BUFFER_BIT );
+    glClearColor( 0.0f, 0.0f, 0.0f, 1.0f );
+
+    glGenTextures( 2, pingpong_textures );
+    for( unsigned int i = 0; i < 2; i++ )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
+      _window->_toolbox->SetFboTexture( pingpong_textures[ i ], GL_RGB16F, width, height, GL_COLOR_ATTACHMENT1 + i );
     }
+    BloomMipChainInitialization( mips, width, height );
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _grenade._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _grenade._parallax_cubemap );
+    StateCache::Disable( GL_BLEND );
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _grenade._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _grenade._bloom_brightness );
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _grenade._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _grenade._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _grenade._normal_map );
+    // Previous full resolution separable gaussian ping-pong
+    // -----------------------------------------------------
+    glViewport( 0, 0, width, height );
+    _blur_shader.Use();
+    StateCache::ActiveTexture( GL_TEXTURE0 );
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _grenade._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _grenade._emissive_factor );
-
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _grenade._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _grenade._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _grenade._shadow_darkness );
+    glBeginQuery( GL_TIME_ELAPSED, query );
+    for( unsigned int run_it = 0; run_it < run_count; run_it++ )
+    {
+      int horizontal = 1;
+      for( unsigned int pass_it = 0; pass_it < BLOOM_BENCHMARK_BLUR_PASSES; pass_it++ )
+      {
+        glDrawBuffer( GL_COLOR_ATTACHMENT1 + ( horizontal == 0 ? 0 : 1 ) );
+        horizontal = ( horizontal == 0 ) ? 1 : 0;
+        StateCache::BindTexture( GL_TEXTURE_2D, ( pass_it == 0 ) ? source_texture : pingpong_textures[ horizontal ] );
+        glUniform1f( glGetUniformLocation( _blur_shader._program, "uHorizontal" ), horizontal );
+        glUniform1f( glGetUniformLocation( _blur_shader._program, "uOffsetFactor" ), 1.8 );
+        _window->_toolbox->RenderQuad();
+      }
+    }
+    glEndQuery( GL_TIME_ELAPSED );
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _grenade._id );      
+    GLuint64 elapsed_time = 0;
+    glGetQueryObjectui64v( query, GL_QUERY_RESULT, &elapsed_time );
+    double previous_time = ( elapsed_time / 1000000.0 ) / run_count;
+    StateCache::UseProgram( 0 );
 
-    _grenade_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
 
+    // Half resolution mip chain
+    // -------------------------
+    glBeginQuery( GL_TIME_ELAPSED, query );
+    for( unsigned int run_it = 0; run_it < run_count; run_it++ )
+    {
+      BloomMipChainRendering( source_texture, false, mips, width, height );
+    }
+    glEndQuery( GL_TIME_ELAPSED );
 
-    // Draw gun4
-    // ---------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
+    glGetQueryObjectui64v( query, GL_QUERY_RESULT, &elapsed_time );
+    double mip_chain_time = ( elapsed_time / 1000000.0 ) / run_count;
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _gun4._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _gun4._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+    // Targets memory, two full resolution RGB16F buffers against the packed float chain
+    double previous_size  = 2.0 * 6.0 * width * height;
+    double mip_chain_size = 0.0;
+    for( unsigned int mip_it = 0; mip_it < BLOOM_MIP_COUNT; mip_it++ )
+    {
+      mip_chain_size += 4.0 * std::max( width >> ( mip_it + 1 ), 1u ) * std::max( height >> ( mip_it + 1 ), 1u );
+    }
 
-    model_matrix = _gun4._model_matrix;
+    fprintf( stderr, "%ux%u : previous %.3f ms ( %.1f MB ), mip chain %.3f ms ( %.1f MB ), x%.2f\n",
+             width,
+             height,
+             previous_time,
+             previous_size / ( 1024.0 * 1024.0 ),
+             mip_chain_time,
+             mip_chain_size / ( 1024.0 * 1024.0 ),
+             ( mip_chain_time > 0.0 ) ? previous_time / mip_chain_time : 0.0 );
+
+    StateCache::DeleteTextures( BLOOM_MIP_COUNT, mips );
+    StateCache::DeleteTextures( 2, pingpong_textures );
+    StateCache::DeleteTextures( 1, &source_texture );
+    StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
+    StateCache::DeleteFramebuffers( 1, &FBO );
+  }
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  glDeleteQueries( 1, &query );
+  glViewport( 0, 0, _window->_width, _window->_height );
+}
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
+void Scene::PostProcessTargetsUpdate()
+{
+  // Window resized, the history is rebuilt at the new size
+  bool resized = ( _post_process_targets_width != _window->_width || _post_process_targets_height != _window->_height );
+  _post_process_targets_width  = _window->_width;
+  _post_process_targets_height = _window->_height;
+
+  // Temporal anti-aliasing history ping-pong, read the frame after it is written so it stays out of the frame graph
+  bool taa = _taa && !_multi_sample;
+  if( ( !taa || resized ) && _window->_toolbox->_taa_history[ 0 ] )
+  {
+    StateCache::DeleteTextures( 2, _window->_toolbox->_taa_history );
+    StateCache::DeleteFramebuffers( 2, _window->_toolbox->_taa_FBO );
+    for( unsigned int history_it = 0; history_it < 2; history_it++ )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
+      _window->_toolbox->_taa_history[ history_it ] = 0;
+      _window->_toolbox->_taa_FBO[ history_it ]     = 0;
     }
+  }
+  if( taa && !_window->_toolbox->_taa_history[ 0 ] )
+  {
+    glGenFramebuffers( 2, _window->_toolbox->_taa_FBO );
+    glGenTextures( 2, _window->_toolbox->_taa_history );
+    for( unsigned int history_it = 0; history_it < 2; history_it++ )
+    {
+      StateCache::BindFramebuffer( GL_FRAMEBUFFER, _window->_toolbox->_taa_FBO[ history_it ] );
+      _window->_toolbox->SetFboTexture( _window->_toolbox->_taa_history[ history_it ],
+                                        GL_RGB16F,
+                                        _window->_width,
+                                        _window->_height,
+                                        GL_COLOR_ATTACHMENT0 );
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _gun4._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _gun4._parallax_cubemap );
+      if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+      {
+        std::cout << "ERROR : temporal anti-aliasing FBO not complete" << std::endl;
+      }
+    }
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _gun4._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _gun4._bloom_brightness );
+    StateCache::BindTexture( GL_TEXTURE_2D, 0 );
+    StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _gun4._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _gun4._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _gun4._normal_map );
+    _taa_history_valid = false;
+  }
+}
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _gun4._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _gun4._emissive_factor );
+void Scene::FrameGraphUpdate()
+{
+  // Features adding or removing passes, the pipeline included
+  bool         compute  = _compute_post_process && _compute_post_process_supported;
+  unsigned int features = ( ( _pipeline_type == DEFERRED_RENDERING ) ? 1 : 0 ) |
+                          ( _bloom                                   ? 2 : 0 ) |
+                          ( compute                                  ? 4 : 0 ) |
+                          ( ( _dynamic_resolution && !_multi_sample ) ? 8 : 0 ) |
+                          ( ( _taa && !_multi_sample )                ? 16 : 0 ) |
+                          ( _multi_sample                            ? 32 : 0 );
+
+  if( features == _frame_graph_features && _frame_graph_width == _window->_width && _frame_graph_height == _window->_height )
+  {
+    return;
+  }
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _gun4._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _gun4._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _gun4._shadow_darkness );
+  _frame_graph_features = features;
+  _frame_graph_width    = _window->_width;
+  _frame_graph_height   = _window->_height;
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _gun4._id );      
+  FrameGraphBuild();
+}
 
-    _gun4_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+void Scene::FrameGraphBuild()
+{
+  RenderGraph * graph = _window->_toolbox->_render_graph;
+  graph->Clear();
 
+  unsigned int width              = _window->_width;
+  unsigned int height             = _window->_height;
+  bool         deferred           = ( _pipeline_type == DEFERRED_RENDERING );
+  bool         compute            = _compute_post_process && _compute_post_process_supported;
+  bool         dynamic_resolution = _dynamic_resolution && !_multi_sample;
+  bool         taa                = _taa && !_multi_sample;
+  unsigned int samples            = ( !deferred && _multi_sample ) ? _nb_multi_sample : 0;
 
-    // Draw gun5
-    // ---------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _gun5._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _gun5._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+  // Scene targets, the frame graph only sees the running pipeline
+  // --------------------------------------------------------------
+  int scene_color;
+  int scene_depth;
+  int g_buffer[ 5 ] = { -1, -1, -1, -1, -1 };
 
-    model_matrix = _gun5._model_matrix;
+  if( deferred )
+  {
+    g_buffer[ 0 ] = graph->CreateTarget( "G-buffer normal",   RenderGraph::TargetDesc( GL_RG16,             width, height, 0, GL_NEAREST ) );
+    g_buffer[ 1 ] = graph->CreateTarget( "G-buffer albedo",   RenderGraph::TargetDesc( GL_SRGB8_ALPHA8,     width, height, 0, GL_NEAREST ) );
+    g_buffer[ 2 ] = graph->CreateTarget( "G-buffer material", RenderGraph::TargetDesc( GL_RGBA8,            width, height, 0, GL_NEAREST ) );
+    g_buffer[ 3 ] = graph->CreateTarget( "G-buffer depth",    RenderGraph::TargetDesc( GL_DEPTH24_STENCIL8, width, height, 0, GL_NEAREST ) );
+    g_buffer[ 4 ] = graph->CreateTarget( "Lighting",          RenderGraph::TargetDesc( GL_RGBA16F,          width, height, 0, GL_LINEAR ) );
+
+    // Geometry already writes ambient and emissive to the lighting target, transparent parts and lamps
+    // are then drawn over it against the G-buffer depth
+    graph->AddPass( "Geometry", std::vector< int >(), std::vector< int >( g_buffer, g_buffer + 5 ) );
+    graph->AddPass( "Lighting", std::vector< int >( g_buffer, g_buffer + 4 ), std::vector< int >( 1, g_buffer[ 4 ] ) );
+    graph->AddPass( "Transparent", std::vector< int >( 1, g_buffer[ 3 ] ), std::vector< int >( 1, g_buffer[ 4 ] ) );
+
+    scene_color = g_buffer[ 4 ];
+    scene_depth = g_buffer[ 3 ];
+  }
+  else
+  {
+    // Bloom brightness is extracted later from the resolved color when multi sampled
+    scene_color = graph->CreateTarget( "Scene color", RenderGraph::TargetDesc( GL_RGB16F,            width, height, samples, GL_LINEAR ) );
+    scene_depth = graph->CreateTarget( "Scene depth", RenderGraph::TargetDesc( GL_DEPTH_COMPONENT24, width, height, samples, GL_NEAREST ) );
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+    int outputs[ 2 ] = { scene_color, scene_depth };
+    graph->AddPass( "Forward", std::vector< int >(), std::vector< int >( outputs, outputs + 2 ) );
+  }
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
-    {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _gun5._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _gun5._parallax_cubemap );
+  // Temporal anti-aliasing, the resolved frame goes to the persistent history
+  // --------------------------------------------------------------------------
+  std::vector< int > post_sources( 1, scene_color );
+  int motion_vectors = -1;
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _gun5._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _gun5._bloom_brightness );
+  if( taa )
+  {
+    motion_vectors = graph->CreateTarget( "Motion vectors", RenderGraph::TargetDesc( GL_RG16F, width, height, 0, GL_NEAREST ) );
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _gun5._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _gun5._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _gun5._normal_map );
+    int resolve_inputs[ 3 ] = { scene_color, scene_depth, motion_vectors };
+    graph->AddPass( "MotionVectors", std::vector< int >( 1, scene_depth ), std::vector< int >( 1, motion_vectors ) );
+    graph->AddPass( "TemporalResolve", std::vector< int >( resolve_inputs, resolve_inputs + 3 ), std::vector< int >() );
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _gun5._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _gun5._emissive_factor );
+    post_sources.clear();
+  }
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _gun5._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _gun5._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _gun5._shadow_darkness );
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _gun5._id );      
+  // Post process chain, the scene color is still read when the frame isn't scaled down
+  // -----------------------------------------------------------------------------------
+  int upscale_output = -1;
+  if( dynamic_resolution )
+  {
+    upscale_output = graph->CreateTarget( "Upscale output", RenderGraph::TargetDesc( GL_RGB16F, width, height, 0, GL_LINEAR ) );
+    graph->AddPass( "Upscale", post_sources, std::vector< int >( 1, upscale_output ) );
+    post_sources.push_back( upscale_output );
+  }
 
-    _gun5_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+  int bloom_mips[ BLOOM_MIP_COUNT ];
+  for( unsigned int mip_it = 0; mip_it < BLOOM_MIP_COUNT; mip_it++ )
+  {
+    bloom_mips[ mip_it ] = -1;
+  }
+  if( _bloom )
+  {
+    for( unsigned int mip_it = 0; mip_it < BLOOM_MIP_COUNT; mip_it++ )
+    {
+      bloom_mips[ mip_it ] = graph->CreateTarget( "Bloom mip " + std::to_string( mip_it ),
+                                                  RenderGraph::TargetDesc( GL_R11F_G11F_B10F,
+                                                                           std::max( width >> ( mip_it + 1 ), 1u ),
+                                                                           std::max( height >> ( mip_it + 1 ), 1u ),
+                                                                           0,
+                                                                           GL_LINEAR ) );
+    }
+    graph->AddPass( "Bloom", post_sources, std::vector< int >( bloom_mips, bloom_mips + BLOOM_MIP_COUNT ) );
+    post_sources.push_back( bloom_mips[ 0 ] );
+  }
 
+  // Compute variant output, images can't target the default framebuffer so it is blitted there
+  int post_process_output = -1;
+  if( compute )
+  {
+    post_process_output = graph->CreateTarget( "Post process output", RenderGraph::TargetDesc( GL_RGBA8, width, height, 0, GL_NEAREST ) );
+  }
+  graph->AddPass( "PostProcess", post_sources, ( post_process_output < 0 ) ? std::vector< int >() : std::vector< int >( 1, post_process_output ) );
 
-    // Draw room3_table3
-    // -----------------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
+  graph->Compile();
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _room3_table3._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _room3_table3._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
 
-    model_matrix = _room3_table3._model_matrix;
+  // Compiled textures handed to the passes, FBOs of disabled passes let their old textures go
+  // ------------------------------------------------------------------------------------------
+  Toolbox * toolbox = _window->_toolbox;
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  toolbox->_temp_tex_color_buffer  = deferred ? 0 : graph->Texture( scene_color );
+  toolbox->_temp_depth_texture     = deferred ? 0 : graph->Texture( scene_depth );
+  toolbox->_motion_vectors_texture = graph->Texture( motion_vectors );
+  toolbox->_upscale_output         = graph->Texture( upscale_output );
+  toolbox->_post_process_output    = graph->Texture( post_process_output );
+  for( unsigned int mip_it = 0; mip_it < BLOOM_MIP_COUNT; mip_it++ )
+  {
+    toolbox->_bloom_mips[ mip_it ] = graph->Texture( bloom_mips[ mip_it ] );
+  }
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
+  _g_buffer_textures.clear();
+  if( deferred )
+  {
+    for( unsigned int texture_it = 0; texture_it < 5; texture_it++ )
     {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
+      _g_buffer_textures.push_back( graph->Texture( g_buffer[ texture_it ] ) );
     }
+  }
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _room3_table3._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _room3_table3._parallax_cubemap );
+  GLenum       scene_attachments[ 2 ] = { GL_COLOR_ATTACHMENT0, GL_DEPTH_ATTACHMENT };
+  unsigned int scene_textures[ 2 ]    = { toolbox->_temp_tex_color_buffer, toolbox->_temp_depth_texture };
+  FrameGraphAttach( &toolbox->_temp_hdr_FBO, 2, scene_attachments, scene_textures, samples > 0 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D );
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _room3_table3._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _room3_table3._bloom_brightness );
+  if( _g_buffer_FBO )
+  {
+    GLenum       g_buffer_attachments[ 5 ] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_DEPTH_STENCIL_ATTACHMENT, GL_COLOR_ATTACHMENT3 };
+    unsigned int g_buffer_textures[ 5 ]    = { 0, 0, 0, 0, 0 };
+    for( unsigned int texture_it = 0; texture_it < _g_buffer_textures.size(); texture_it++ )
+    {
+      g_buffer_textures[ texture_it ] = _g_buffer_textures[ texture_it ];
+    }
+    FrameGraphAttach( &_g_buffer_FBO, 5, g_buffer_attachments, g_buffer_textures, GL_TEXTURE_2D );
+  }
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _room3_table3._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _room3_table3._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _room3_table3._normal_map );
+  // Scene depth is attached when the motion vectors pass first runs, it depends on the pipeline
+  GLenum       motion_attachments[ 2 ] = { GL_COLOR_ATTACHMENT0, GL_DEPTH_STENCIL_ATTACHMENT };
+  unsigned int motion_textures[ 2 ]    = { toolbox->_motion_vectors_texture, 0 };
+  FrameGraphAttach( &toolbox->_motion_vectors_FBO, 2, motion_attachments, motion_textures, GL_TEXTURE_2D );
+  _motion_vectors_depth = 0;
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _room3_table3._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _room3_table3._emissive_factor );
+  GLenum color_attachment = GL_COLOR_ATTACHMENT0;
+  FrameGraphAttach( &toolbox->_upscale_FBO, 1, &color_attachment, &toolbox->_upscale_output, GL_TEXTURE_2D );
+  FrameGraphAttach( &toolbox->_post_process_FBO, 1, &color_attachment, &toolbox->_post_process_output, GL_TEXTURE_2D );
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _room3_table3._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _room3_table3._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _room3_table3._shadow_darkness );
+  // Bloom mips are attached one by one while the chain is drawn
+  if( _bloom && !toolbox->_bloom_FBO )
+  {
+    glGenFramebuffers( 1, &toolbox->_bloom_FBO );
+  }
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _room3_table3._id );      
+  fprintf( stderr, "Frame graph -> %u x %u, %s pipeline, render targets %.1f MB ( %.1f MB without aliasing ), peak %.1f MB\n",
+           width,
+           height,
+           deferred ? "deferred" : "forward",
+           graph->_memory / ( 1024.0 * 1024.0 ),
+           graph->_unaliased_memory / ( 1024.0 * 1024.0 ),
+           graph->_peak_memory / ( 1024.0 * 1024.0 ) );
+}
 
-    _room3_table3_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+void Scene::FrameGraphAttach( unsigned int *       ioFBO,
+                              unsigned int         iCount,
+                              const GLenum *       iAttachments,
+                              const unsigned int * iTextures,
+                              GLenum               iTextureTarget )
+{
+  // Created with its first texture, then kept, a zero texture detaches the attachment
+  bool attached = false;
+  for( unsigned int attachment_it = 0; attachment_it < iCount; attachment_it++ )
+  {
+    attached = attached || ( iTextures[ attachment_it ] != 0 );
+  }
 
+  if( *ioFBO == 0 )
+  {
+    if( !attached )
+    {
+      return;
+    }
+    glGenFramebuffers( 1, ioFBO );
+  }
 
-    // Draw katana
-    // -----------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, *ioFBO );
+  for( unsigned int attachment_it = 0; attachment_it < iCount; attachment_it++ )
+  {
+    glFramebufferTexture2D( GL_FRAMEBUFFER, iAttachments[ attachment_it ], iTextureTarget, iTextures[ attachment_it ], 0 );
+  }
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _katana._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _katana._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+  if( attached && glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+  {
+    std::cout << "ERROR : frame graph FBO " << *ioFBO << " not complete" << std::endl;
+  }
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
 
-    model_matrix = _katana._model_matrix;
+void Scene::PostProcess()
+{ 
+  // Bloom chain and final pass GPU timer, read back one frame later
+  // ---------------------------------------------------------------
+  GLuint64 elapsed_time = 0;
+  if( _post_process_query_it > 0 )
+  {
+    glGetQueryObjectui64v( _post_process_time_queries[ ( _post_process_query_it - 1 ) % 2 ], GL_QUERY_RESULT, &elapsed_time );
+    _post_process_time += elapsed_time / 1000000.0;
+    _post_process_time_samples++;
+  }
+  glBeginQuery( GL_TIME_ELAPSED, _post_process_time_queries[ _post_process_query_it % 2 ] );
+  _post_process_query_it++;
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  // Scaled frames are brought back to the window size first, bloom and final pass read the result
+  _frame_upscaled = ( _render_width != _window->_width || _render_height != _window->_height );
+  if( _frame_upscaled )
+  {
+    UpscaleProcess();
+  }
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
-    {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-    }
+  if( _bloom )
+  {
+    BlurProcess();
+  }
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _katana._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _katana._parallax_cubemap );
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _katana._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _katana._bloom_brightness );
+  // Resolve && bloom composite && exposure && tone mapping && gamma in one pass
+  // ---------------------------------------------------------------------------
+  bool multi_sample = ( _pipeline_type == FORWARD_RENDERING ) && _multi_sample;
+  bool compute      = _compute_post_process && _compute_post_process_supported;
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _katana._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _katana._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _katana._normal_map );
+  Shader * shader;
+  if( compute )
+  {
+    shader = multi_sample ? &_post_process_compute_MS_shader : &_post_process_compute_shader;
+  }
+  else
+  {
+    shader = multi_sample ? &_post_process_MS_shader : &_post_process_shader;
+  }
+  shader->Use();
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _katana._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _katana._emissive_factor );
+  StateCache::ActiveTexture( GL_TEXTURE0 );
+  if( _frame_upscaled )
+  {
+    StateCache::BindTexture( GL_TEXTURE_2D, _window->_toolbox->_upscale_output );
+  }
+  else
+  {
+    StateCache::BindTexture( multi_sample ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D, SceneColorTexture() );
+  }
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _katana._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _katana._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _katana._shadow_darkness );
+  if( _bloom )
+  {
+    StateCache::ActiveTexture( GL_TEXTURE1 );
+    StateCache::BindTexture( GL_TEXTURE_2D, _window->_toolbox->_bloom_mips[ 0 ] );
+  }
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _katana._id );      
+  glUniform1i( glGetUniformLocation( shader->_program, "uSampleCount" ), _nb_multi_sample );
+  glUniform1i( glGetUniformLocation( shader->_program, "uBloom" ), _bloom );
+  glUniform1f( glGetUniformLocation( shader->_program, "uBloomStrength" ), 1.0 / BLOOM_MIP_COUNT );
+  glUniform1f( glGetUniformLocation( shader->_program, "uExposure" ), _exposure );
+  glUniform1f( glGetUniformLocation( shader->_program, "uEnd" ), _end );
 
-    _katana_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+  if( compute )
+  {
+    // 8x8 threads groups, then copied to the default framebuffer
+    glBindImageTexture( 0, _window->_toolbox->_post_process_output, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8 );
+    glDispatchCompute( ( _window->_width + 7 ) / 8, ( _window->_height + 7 ) / 8, 1 );
+    glMemoryBarrier( GL_FRAMEBUFFER_BARRIER_BIT );
+
+    StateCache::BindFramebuffer( GL_READ_FRAMEBUFFER, _window->_toolbox->_post_process_FBO );
+    StateCache::BindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 );
+    glBlitFramebuffer( 0, 0, _window->_width, _window->_height, 0, 0, _window->_width, _window->_height, GL_COLOR_BUFFER_BIT, GL_NEAREST );
+    StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
+  }
+  else
+  {
+    // Every pixel is written by the quad, nothing to clear nor depth test
+    glViewport( 0, 0, _window->_width, _window->_height );
+    StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
+    StateCache::Disable( GL_DEPTH_TEST );
+    _window->_toolbox->RenderQuad();
+    StateCache::Enable( GL_DEPTH_TEST );
+  }
 
+  StateCache::UseProgram( 0 );
+  glEndQuery( GL_TIME_ELAPSED );
+}
 
-    // Draw helmet2
-    // ------------
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_BACK );
-    _forward_pbr_shader.Use();
+double Scene::PostProcessBandwidth( unsigned int iChain,
+                                    bool         iMultiSample,
+                                    bool         iBloom )
+{
+  // Nominal formats sizes, HDR frame RGB16F ( RGBA16F in deferred ), bloom mips and back buffer 4 bytes
+  double pixels       = ( double )_window->_width * _window->_height;
+  double color_bytes  = ( _pipeline_type == DEFERRED_RENDERING ) ? 8.0 : 6.0;
+  double sample_count = iMultiSample ? _nb_multi_sample : 1.0;
+  double bytes        = 0.0;
+
+  // Separate resolve pass, every sample read and one resolved texel written
+  if( iChain == POST_PROCESS_PREVIOUS && iMultiSample )
+  {
+    bytes += pixels * ( sample_count * color_bytes + color_bytes );
+  }
 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _helmet2._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _helmet2._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+  if( iBloom )
+  {
+    // First downsample reads one texel per pixel, resolved or first sample
+    bytes += pixels * color_bytes;
 
-    model_matrix = _helmet2._model_matrix;
+    for( unsigned int mip_it = 0; mip_it < BLOOM_MIP_COUNT; mip_it++ )
+    {
+      double mip_pixels = ( double )std::max( _window->_width >> ( mip_it + 1 ), 1 ) * std::max( _window->_height >> ( mip_it + 1 ), 1 );
 
-     // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+      // Written by its downsample, read by the next one
+      bytes += mip_pixels * 4.0 * ( ( mip_it + 1 < BLOOM_MIP_COUNT ) ? 2.0 : 1.0 );
 
-    // Point lights uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-    for( int i = 0; i < _lights.size(); i++ )
-    {
-      string temp = to_string( i );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-      glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-      glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
+      // Upsample reads the smaller level and blends over this one
+      if( mip_it + 1 < BLOOM_MIP_COUNT )
+      {
+        double lower_pixels = ( double )std::max( _window->_width >> ( mip_it + 2 ), 1 ) * std::max( _window->_height >> ( mip_it + 2 ), 1 );
+        bytes += lower_pixels * 4.0 + mip_pixels * 4.0 * 2.0;
+      }
     }
 
-    // IBL uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), _helmet2._IBL );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), _helmet2._parallax_cubemap );
-
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _helmet2._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _helmet2._bloom_brightness );
+    // Composite reads the first level
+    bytes += pixels * 0.25 * 4.0;
+  }
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _helmet2._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _helmet2._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _helmet2._normal_map );
+  // Final pass reads the frame, every sample when it resolves too, and writes the back buffer
+  if( iChain == POST_PROCESS_PREVIOUS )
+  {
+    bytes += pixels * ( color_bytes + 4.0 );
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _helmet2._emissive );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uEmissiveFactor" ), _helmet2._emissive_factor );
+    // Color and depth clear of the default framebuffer
+    bytes += pixels * ( 4.0 + 4.0 );
+  }
+  else
+  {
+    bytes += pixels * ( sample_count * color_bytes + 4.0 );
+  }
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _helmet2._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _helmet2._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _helmet2._shadow_darkness );
+  // Compute output image then blitted, read and written again
+  if( iChain == POST_PROCESS_COMPUTE )
+  {
+    bytes += pixels * 4.0 * 2.0;
+  }
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _helmet2._id );      
+  return bytes;
+}
 
-    _helmet2_model->Draw( _forward_pbr_shader, model_matrix );
-    glUseProgram( 0 );
-    glDisable( GL_CULL_FACE );
+void Scene::PrintPostProcessInfos()
+{
+  Uint32 t;
+  static Uint32 t0 = 0;
+  t = SDL_GetTicks();
+  if( t - t0 > 1000 )
+  {
+    bool multi_sample = ( _pipeline_type == FORWARD_RENDERING ) && _multi_sample;
+    bool compute      = _compute_post_process && _compute_post_process_supported;
+
+    fprintf( stderr, "Post process -> %s, MSAA %s, bloom %s, %.3f ms, %.1f MB per frame ( previous chain %.1f MB )\n",
+             compute ? "fused compute" : "fused fragment",
+             multi_sample ? "on" : "off",
+             _bloom ? "on" : "off",
+             ( _post_process_time_samples > 0 ) ? _post_process_time / _post_process_time_samples : 0.0,
+             PostProcessBandwidth( compute ? POST_PROCESS_COMPUTE : POST_PROCESS_FRAGMENT, multi_sample, _bloom ) / ( 1024.0 * 1024.0 ),
+             PostProcessBandwidth( POST_PROCESS_PREVIOUS, multi_sample, _bloom ) / ( 1024.0 * 1024.0 ) );
+
+    _post_process_time         = 0.0;
+    _post_process_time_samples = 0;
+    t0 = t;
   }
+}
 
+void Scene::PostProcessBandwidthReport()
+{
+  const char * chains_names[ 3 ] = { "previous", "fused fragment", "fused compute" };
 
-  // Draw revolving doors
-  // --------------------
-  glEnable( GL_CULL_FACE );
-  glCullFace( GL_BACK );
-  _forward_pbr_shader.Use();
-
-  // Matrices uniforms
-  glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-  glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-  glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
+  std::cout << std::endl << "Post process bandwidth per frame, " << _window->_width << "x" << _window->_height << ", MSAA x" << _nb_multi_sample << std::endl
+                         << "-------------------------------------------------------" << std::endl;
 
-  // Point lights uniforms
-  glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightCount" ), _lights.size() );
-  for( int i = 0; i < _lights.size(); i++ )
+  for( unsigned int config_it = 0; config_it < 4; config_it++ )
   {
-    string temp = to_string( i );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_lights[ i ]._position[ 0 ] );
-    glUniform3fv( glGetUniformLocation( _forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_lights[ i ]._color[ 0 ] );
-    glUniform1f(  glGetUniformLocation( _forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _lights[ i ]._intensity );
-  }
+    bool multi_sample = ( config_it & 2 ) != 0;
+    bool bloom        = ( config_it & 1 ) != 0;
 
-  // IBL uniforms
-  glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uIBL" ), true );
-  glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uMaxMipLevel" ), ( float )( _pre_filter_max_mip_Level - 1 ) );
-  glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uParallaxCubemap" ), false );
+    fprintf( stderr, "MSAA %-3s bloom %-3s :", multi_sample ? "on" : "off", bloom ? "on" : "off" );
+    for( unsigned int chain_it = 0; chain_it < 3; chain_it++ )
+    {
+      fprintf( stderr, " %s %6.1f MB%s", chains_names[ chain_it ], PostProcessBandwidth( chain_it, multi_sample, bloom ) / ( 1024.0 * 1024.0 ), ( chain_it < 2 ) ? "," : "\n" );
+    }
+  }
+}
 
+void Scene::DynamicResolutionScaleSet( float iScale )
+{
+  // Multi sampled frames can't go through the upscaler, they keep the window size
+  _render_scale = ( _dynamic_resolution && !_multi_sample ) ? glm::clamp( iScale, ( float )DYNAMIC_RESOLUTION_MIN_SCALE, 1.0f ) : 1.0f;
 
-  for( int door_it = 0; door_it < _revolving_door.size(); door_it++ )
-  { 
-    // IBL cubemap texture binding
-    glActiveTexture( GL_TEXTURE7 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _revolving_door[ door_it ]._IBL_cubemaps[ 1 ] );
-    glActiveTexture( GL_TEXTURE8 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _revolving_door[ door_it ]._IBL_cubemaps[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE9 );
-    glBindTexture( GL_TEXTURE_2D, _pre_brdf_texture ); 
-    glActiveTexture( GL_TEXTURE10 );
-    glBindTexture( GL_TEXTURE_CUBE_MAP, _window->_toolbox->_depth_cubemap );
+  // Only the viewport changes, targets keep the window size so no reallocation
+  _render_width  = std::max( ( int )( _window->_width * _render_scale + 0.5f ), 1 );
+  _render_height = std::max( ( int )( _window->_height * _render_scale + 0.5f ), 1 );
+}
 
-    model_matrix = _revolving_door[ door_it ]._model_matrix;
+void Scene::DynamicResolutionFrameBegin()
+{
+  glQueryCounter( _frame_time_queries[ _frame_time_query_it % 2 ][ 0 ], GL_TIMESTAMP );
+}
 
-    // Matrices uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
+void Scene::DynamicResolutionFrameEnd()
+{
+  glQueryCounter( _frame_time_queries[ _frame_time_query_it % 2 ][ 1 ], GL_TIMESTAMP );
+  _frame_time_query_it++;
 
-    // Bloom uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uBloom" ), _revolving_door[ door_it ]._bloom );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uBloomBrightness" ), _revolving_door[ door_it ]._bloom_brightness );
+  // GPU frame time read back one frame later
+  if( _frame_time_query_it < 2 )
+  {
+    return;
+  }
 
-    // Opacity uniforms
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uAlpha" ), _revolving_door[ door_it ]._alpha );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityMap" ), _revolving_door[ door_it ]._opacity_map );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uOpacityDiscard" ), 1.0 );
-    
-    // Displacement mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uNormalMap" ), _revolving_door[ door_it ]._normal_map );
+  GLuint64 start_time = 0;
+  GLuint64 end_time   = 0;
+  glGetQueryObjectui64v( _frame_time_queries[ _frame_time_query_it % 2 ][ 0 ], GL_QUERY_RESULT, &start_time );
+  glGetQueryObjectui64v( _frame_time_queries[ _frame_time_query_it % 2 ][ 1 ], GL_QUERY_RESULT, &end_time );
+  double frame_time = ( end_time - start_time ) / 1000000.0;
 
-    // Emissive uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uEmissive" ), _revolving_door[ door_it ]._emissive );
+  _frame_time_smoothed = ( _frame_time_query_it == 2 ) ? frame_time : _frame_time_smoothed + ( frame_time - _frame_time_smoothed ) * 0.1;
 
-    // Omnidirectional shadow mapping uniforms
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uReceivShadow" ), _revolving_door[ door_it ]._receiv_shadow );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowFar" ), _shadow_far );
-    glUniform1i( glGetUniformLocation( _forward_pbr_shader._program, "uLightSourceIt" ), _current_shadow_light_source );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowBias" ), _revolving_door[ door_it ]._shadow_bias );
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uShadowDarkness" ), _revolving_door[ door_it ]._shadow_darkness );
+  _frame_time_sum         += frame_time;
+  _frame_time_squared_sum += frame_time * frame_time;
+  _frame_time_max          = std::max( _frame_time_max, frame_time );
+  _frame_time_over_budget += ( frame_time > _frame_time_budget ) ? 1 : 0;
+  _render_scale_sum       += _render_scale;
+  _frame_time_samples++;
 
-    glUniform1f( glGetUniformLocation( _forward_pbr_shader._program, "uID" ), _revolving_door[ door_it ]._id );      
+  // Per frame log along the demo camera path
+  if( _camera->_demo_script )
+  {
+    if( !_dynamic_resolution_log.is_open() )
+    {
+      _dynamic_resolution_log.open( DYNAMIC_RESOLUTION_LOG_FILE, std::ios::trunc );
+      _dynamic_resolution_log << "frame,gpu_ms,smoothed_ms,budget_ms,scale,width,height" << std::endl;
+    }
+    _dynamic_resolution_log << _frame_time_query_it << "," << frame_time << "," << _frame_time_smoothed << "," << _frame_time_budget << ","
+                            << _render_scale << "," << _render_width << "," << _render_height << "\n";
+  }
 
-    _revolving_door_model->Draw( _forward_pbr_shader, model_matrix );
+  if( !_dynamic_resolution || _multi_sample )
+  {
+    return;
   }
 
-  glUseProgram( 0 );
-  glDisable( GL_CULL_FACE );
 
+  // Frame time controller
+  // ---------------------
 
-  // Unbind current FBO
-  glBindFramebuffer( GL_FRAMEBUFFER, 0 );
-  glBindVertexArray( 0 );
+  // Pixels cost grows with the scale squared, aimed under the budget to absorb spikes
+  float target_scale = _render_scale * sqrt( ( _frame_time_budget * DYNAMIC_RESOLUTION_HEADROOM ) / std::max( _frame_time_smoothed, 0.001 ) );
+  target_scale = glm::clamp( target_scale, ( float )DYNAMIC_RESOLUTION_MIN_SCALE, 1.0f );
+
+  // Quantized steps, dropped at once when over budget but raised one step at a time to avoid oscillations
+  float step = DYNAMIC_RESOLUTION_SCALE_STEP;
+  if( target_scale < _render_scale - step * 0.5f )
+  {
+    DynamicResolutionScaleSet( std::floor( target_scale / step ) * step );
+  }
+  else if( target_scale > _render_scale + step )
+  {
+    DynamicResolutionScaleSet( _render_scale + step );
+  }
+}
 
+void Scene::UpscaleProcess()
+{
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, _window->_toolbox->_upscale_FBO );
+  glViewport( 0, 0, _window->_width, _window->_height );
 
-  // Blit multi sample texture to classic texture
-  // --------------------------------------------
-  if( _multi_sample )
-  {
-    // Bind and clear normal texture where we need to blit
-    glBindFramebuffer( GL_FRAMEBUFFER, _window->_toolbox->_final_hdr_FBO );
-    unsigned int attachments2[ 2 ] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-    glDrawBuffers( 2, attachments2 );
-    glClear( GL_COLOR_BUFFER_BIT );
+  _upscale_shader.Use();
 
-    // Convert multi sample texture into normal texture
-    _MS_blit_shader.Use();
+  StateCache::ActiveTexture( GL_TEXTURE0 );
+  StateCache::BindTexture( GL_TEXTURE_2D, SceneColorTexture() );
 
-    glDrawBuffer( GL_COLOR_ATTACHMENT0 );
-    
-    glActiveTexture( GL_TEXTURE0 );
-    glBindTexture( GL_TEXTURE_2D_MULTISAMPLE, _window->_toolbox->_temp_tex_color_buffer[ 0 ] );
-    glUniform1i( glGetUniformLocation( _MS_blit_shader._program, "uSampleCount" ), _nb_multi_sample );    
-    _window->_toolbox->RenderQuad();
+  glUniform2i( glGetUniformLocation( _upscale_shader._program, "uRenderSize" ), _render_width, _render_height );
+  _window->_toolbox->RenderQuad();
 
-    // Same convert with brightness texture ( bloom )
-    glDrawBuffer( GL_COLOR_ATTACHMENT1 );
-    
-    glActiveTexture( GL_TEXTURE0 );
-    glBindTexture( GL_TEXTURE_2D_MULTISAMPLE, _window->_toolbox->_temp_tex_color_buffer[ 1 ] );
-    glUniform1i( glGetUniformLocation( _MS_blit_shader._program, "uSampleCount" ), _nb_multi_sample );
-    _window->_toolbox->RenderQuad();
+  StateCache::UseProgram( 0 );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
 
-    glUseProgram( 0 );
-    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+void Scene::PrintDynamicResolutionInfos()
+{
+  Uint32 t;
+  static Uint32 t0 = 0;
+  t = SDL_GetTicks();
+  if( t - t0 > 1000 )
+  {
+    double average  = ( _frame_time_samples > 0 ) ? _frame_time_sum / _frame_time_samples : 0.0;
+    double variance = ( _frame_time_samples > 0 ) ? _frame_time_squared_sum / _frame_time_samples - average * average : 0.0;
+
+    fprintf( stderr, "Dynamic resolution -> %s, scale %.2f ( %dx%d, %.2f average ), GPU frame %.3f ms, deviation %.3f ms, max %.3f ms, %u/%u frames over the %.2f ms budget\n",
+             ( _dynamic_resolution && !_multi_sample ) ? "on" : "off",
+             _render_scale,
+             _render_width,
+             _render_height,
+             ( _frame_time_samples > 0 ) ? _render_scale_sum / _frame_time_samples : _render_scale,
+             average,
+             sqrt( std::max( variance, 0.0 ) ),
+             _frame_time_max,
+             _frame_time_over_budget,
+             _frame_time_samples,
+             _frame_time_budget );
+
+    _frame_time_sum         = 0.0;
+    _frame_time_squared_sum = 0.0;
+    _frame_time_max         = 0.0;
+    _frame_time_samples     = 0;
+    _frame_time_over_budget = 0;
+    _render_scale_sum       = 0.0;
+    t0 = t;
   }
 }
 
-void Scene::DeferredGeometryPass( glm::mat4 * iProjectionMatrix,
-                                  glm::mat4 * iViewMatrix )
-{ 
-  glm::mat4 model_matrix;
-
+unsigned int Scene::SceneColorTexture()
+{
+  // Resolved history once the temporal pass ran, else the pipeline own lighting target
+  if( _taa && !_multi_sample )
+  {
+    return _window->_toolbox->_taa_history[ _taa_history_it % 2 ];
+  }
 
-  // Bind and clear G-buffer textures
-  // --------------------------------
-  unsigned int attachments[ 4 ] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
-  glDrawBuffers( 4, attachments );
+  return ( _pipeline_type == DEFERRED_RENDERING ) ? _g_buffer_textures[ 4 ] : _window->_toolbox->_temp_tex_color_buffer;
+}
 
-  // Only the geometry pass updates the depth buffer
-  glDepthMask( GL_TRUE );
-  glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+void Scene::TemporalJitterUpdate()
+{
+  // Halton ( 2, 3 ) sequence, first point skipped as it sits on the pixel corner
+  unsigned int index = ( _taa_frame % TAA_JITTER_PHASES ) + 1;
+  glm::vec2 halton = glm::vec2( 0.0 );
+  for( unsigned int axis_it = 0; axis_it < 2; axis_it++ )
+  {
+    unsigned int base     = axis_it + 2;
+    float        fraction = 1.0f;
+    for( unsigned int i = index; i > 0; i /= base )
+    {
+      fraction          /= base;
+      halton[ axis_it ] += fraction * ( i % base );
+    }
+  }
+  _taa_frame++;
 
-  // Use depth test while drawing G-buffer textures
-  glEnable( GL_DEPTH_TEST );
+  // Within the pixel in NDC, at the current render size
+  _taa_jitter = ( halton - 0.5f ) * 2.0f / glm::vec2( _render_width, _render_height );
+  _camera->SetProjectionJitter( _taa_jitter );
+}
 
-  glEnable( GL_CULL_FACE );
-  glCullFace( GL_BACK );
+void Scene::MotionVectorsPass()
+{
+  // Scene depth attached again only when the pipeline changes, doors are tested against it
+  unsigned int depth_texture = ( _pipeline_type == DEFERRED_RENDERING ) ? _g_buffer_textures[ 3 ] : _window->_toolbox->_temp_depth_texture;
 
-  glDisable( GL_BLEND );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, _window->_toolbox->_motion_vectors_FBO );
+  if( _motion_vectors_depth != depth_texture )
+  {
+    glFramebufferTexture2D( GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, 0, 0 );
+    glFramebufferTexture2D( GL_FRAMEBUFFER, 
+                            ( _pipeline_type == DEFERRED_RENDERING ) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+                            GL_TEXTURE_2D,
+                            depth_texture,
+                            0 );
 
+    if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+    {
+      std::cout << "ERROR : motion vectors FBO not complete" << std::endl;
+    }
+    _motion_vectors_depth = depth_texture;
+  }
 
-  // Draw ground1
-  // ------------
-  _geometry_pass_shader.Use();
+  // Zero is read as camera only motion, the resolve rebuilds it from depth
+  glViewport( 0, 0, _render_width, _render_height );
+  glClear( GL_COLOR_BUFFER_BIT );
 
-  model_matrix = glm::mat4();
-  model_matrix = glm::translate( model_matrix, _grounds_type1[ 0 ]._position );
-  model_matrix = glm::rotate( model_matrix, _grounds_type1[ 0 ]._angle, glm::vec3( -1.0, 0.0 , 0.0 ) );
-  model_matrix = glm::scale( model_matrix, _grounds_type1[ 0 ]._scale ); 
-
-  glActiveTexture( GL_TEXTURE0 );
-  glBindTexture( GL_TEXTURE_2D, _loaded_materials[ 0 ][ 0 ] );  
-  glActiveTexture( GL_TEXTURE1 );
-  glBindTexture( GL_TEXTURE_2D, _loaded_materials[ 0 ][ 1 ] ); 
-  glActiveTexture( GL_TEXTURE3 );
-  glBindTexture( GL_TEXTURE_2D, _loaded_materials[ 0 ][ 3 ] ); 
-  glActiveTexture( GL_TEXTURE4 );
-  glBindTexture( GL_TEXTURE_2D, _loaded_materials[ 0 ][ 4 ] ); 
-  glActiveTexture( GL_TEXTURE5 );
-  glBindTexture( GL_TEXTURE_2D, _loaded_materials[ 0 ][ 5 ] ); 
-
-  glUniformMatrix4fv( glGetUniformLocation( _geometry_pass_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( *iViewMatrix ) );
-  glUniformMatrix4fv( glGetUniformLocation( _geometry_pass_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-  glUniformMatrix4fv( glGetUniformLocation( _geometry_pass_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( *iProjectionMatrix ) );
-
-  glUniform1i( glGetUniformLocation( _geometry_pass_shader._program, "uBloom" ), _grounds_type1[ 0 ]._bloom );
-  glUniform1f( glGetUniformLocation( _geometry_pass_shader._program, "uBloomBrightness" ), _grounds_type1[ 0 ]._bloom_brightness );
-
-  glBindVertexArray( _ground1_VAO );
-  glDrawArrays( GL_TRIANGLES, 0, 6 );
-  glBindVertexArray( 0 );
-  glUseProgram( 0 );
 
-  // Only the geometry pass modify the depth buffer, then disable after it
-  glDepthMask( GL_FALSE );
-}
+  // Doors object motion, only their visible fragments
+  // -------------------------------------------------
+  StateCache::DepthFunc( GL_LEQUAL );
+  StateCache::DepthMask( GL_FALSE );
+  StateCache::Enable( GL_CULL_FACE );
+  StateCache::CullFace( GL_BACK );
 
-void Scene::DeferredLightingPass( glm::mat4 * iProjectionMatrix,
-                                  glm::mat4 * iViewMatrix )
-{ 
-  float screen_size[ 2 ] = { ( float )_window->_width, ( float )_window->_height };
-  glm::mat4 model_matrix;
+  _motion_vectors_shader.Use();
 
-  // Enable stencil test for stencil pass and lighting pass
-  glEnable( GL_STENCIL_TEST );
+  glm::mat4 view_projection_matrix = _camera->_unjittered_projection_matrix * _camera->_view_matrix;
+  glUniformMatrix4fv( glGetUniformLocation( _motion_vectors_shader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
+  glUniformMatrix4fv( glGetUniformLocation( _motion_vectors_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
+  glUniformMatrix4fv( glGetUniformLocation( _motion_vectors_shader._program, "uViewProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( view_projection_matrix ) );
+  glUniformMatrix4fv( glGetUniformLocation( _motion_vectors_shader._program, "uPreviousViewProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _taa_previous_view_projection_matrix ) );
 
-  for( int i = 0; i < _lights.size(); i++ )
+  for( unsigned int door_it = 0; door_it < _revolving_door.size(); door_it++ )
   {
-    
-    // Stencil pass
-    // ------------
-    _empty_shader.Use();   
-
-    // Don't draw anything during the stencil pass, juste modify the stencil buffer
-    glDrawBuffer( GL_NONE );
-    
-    // Need depth test enable to perform stencil buffer modification     
-    glEnable( GL_DEPTH_TEST );
+    _revolving_door_model->DrawMotionVectors( _motion_vectors_shader, _revolving_door[ door_it ]._model_matrix );
+  }
 
-    // Need both volume sphere faces to perform stencil buffer modification
-    glDisable( GL_CULL_FACE );
+  for( unsigned int door_it = 0; door_it < _simple_door.size(); door_it++ )
+  {
+    _simple_door_model->DrawMotionVectors( _motion_vectors_shader, _simple_door[ door_it ]._model_matrix );
+  }
 
-    glClear( GL_STENCIL_BUFFER_BIT );
+  StateCache::UseProgram( 0 );
+  StateCache::Disable( GL_CULL_FACE );
+  StateCache::DepthMask( GL_TRUE );
+  StateCache::DepthFunc( GL_LESS );
 
-    // Set stencil operation correctly
-    glStencilFunc( GL_ALWAYS, 0, 0 );
-    glStencilOpSeparate( GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP );
-    glStencilOpSeparate( GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
 
-    // Set correct model matrix
-    model_matrix = glm::mat4();
-    model_matrix = glm::translate( model_matrix, _lights[ i ]._position );
-    model_matrix = glm::scale( model_matrix, glm::vec3( _lights[ i ]._max_lighting_distance ) ); 
+void Scene::TemporalResolve()
+{
+  // Motion vectors and resolve GPU timer, read back one frame later
+  // ---------------------------------------------------------------
+  GLuint64 elapsed_time = 0;
+  if( _taa_query_it > 0 )
+  {
+    glGetQueryObjectui64v( _taa_time_queries[ ( _taa_query_it - 1 ) % 2 ], GL_QUERY_RESULT, &elapsed_time );
+    _taa_time += elapsed_time / 1000000.0;
+    _taa_time_samples++;
+  }
+  glBeginQuery( GL_TIME_ELAPSED, _taa_time_queries[ _taa_query_it % 2 ] );
+  _taa_query_it++;
 
-    // Uniforms
-    glUniformMatrix4fv( glGetUniformLocation( _empty_shader._program, "uViewMatrix" ) , 1, GL_FALSE, glm::value_ptr( *iViewMatrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _empty_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _empty_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( *iProjectionMatrix ) );
+  // History restarts when the rendered sub-rectangle changes size
+  if( _taa_history_width != _render_width || _taa_history_height != _render_height )
+  {
+    _taa_history_width  = _render_width;
+    _taa_history_height = _render_height;
+    _taa_history_valid  = false;
+  }
 
-    //_sphere_model->Draw( _empty_shader, model_matrix );
-    glBindVertexArray( 0 );
-    
-    glUseProgram( 0 );
+  MotionVectorsPass();
 
 
-    // Lighting pass
-    // -------------
+  // History reprojection and accumulation, written in the other history target
+  // --------------------------------------------------------------------------
+  unsigned int current_color = ( _pipeline_type == DEFERRED_RENDERING ) ? _g_buffer_textures[ 4 ] : _window->_toolbox->_temp_tex_color_buffer;
+  unsigned int depth_texture = ( _pipeline_type == DEFERRED_RENDERING ) ? _g_buffer_textures[ 3 ] : _window->_toolbox->_temp_depth_texture;
+  _taa_history_it++;
 
-    // Bind the rendered frames
-    unsigned int attachments[ 2 ] = { GL_COLOR_ATTACHMENT4, GL_COLOR_ATTACHMENT5 };
-    glDrawBuffers( 2, attachments );
- 
-    _lighting_pass_shader.Use();   
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, _window->_toolbox->_taa_FBO[ _taa_history_it % 2 ] );
+  glViewport( 0, 0, _render_width, _render_height );
 
-    // Bind lighting input texture
-    glActiveTexture( GL_TEXTURE0 );
-    glBindTexture( GL_TEXTURE_2D, _g_buffer_textures[ 0 ] );  
-    glActiveTexture( GL_TEXTURE1 );
-    glBindTexture( GL_TEXTURE_2D, _g_buffer_textures[ 1 ] ); 
-    glActiveTexture( GL_TEXTURE2 );
-    glBindTexture( GL_TEXTURE_2D, _g_buffer_textures[ 2 ] ); 
-    glActiveTexture( GL_TEXTURE3 );
-    glBindTexture( GL_TEXTURE_2D, _g_buffer_textures[ 3 ] );
-    //glActiveTexture( GL_TEXTURE4 );
-    //glBindTexture( GL_TEXTURE_CUBE_MAP, _irradiance_cubeMaps[ _current_env ] );
+  _taa_resolve_shader.Use();
 
-    // Set stencil test to pass only for the stencil values calculated before, when not equal 0 
-    glStencilFunc( GL_NOTEQUAL, 0, 0xFF );
+  StateCache::ActiveTexture( GL_TEXTURE0 );
+  StateCache::BindTexture( GL_TEXTURE_2D, current_color );
+  StateCache::ActiveTexture( GL_TEXTURE1 );
+  StateCache::BindTexture( GL_TEXTURE_2D, _window->_toolbox->_taa_history[ ( _taa_history_it + 1 ) % 2 ] );
+  StateCache::ActiveTexture( GL_TEXTURE2 );
+  StateCache::BindTexture( GL_TEXTURE_2D, depth_texture );
+  StateCache::ActiveTexture( GL_TEXTURE3 );
+  StateCache::BindTexture( GL_TEXTURE_2D, _window->_toolbox->_motion_vectors_texture );
 
-    // Don't need depth test anymore at this point
-    glDisable( GL_DEPTH_TEST );
+  glm::mat4 inverse_view_projection_matrix = glm::inverse( _camera->_projection_matrix * _camera->_view_matrix );
+  glUniformMatrix4fv( glGetUniformLocation( _taa_resolve_shader._program, "uInverseViewProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( inverse_view_projection_matrix ) );
+  glUniformMatrix4fv( glGetUniformLocation( _taa_resolve_shader._program, "uPreviousViewProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _taa_previous_view_projection_matrix ) );
+  glUniform2f( glGetUniformLocation( _taa_resolve_shader._program, "uJitter" ), _taa_jitter.x * 0.5f, _taa_jitter.y * 0.5f );
+  glUniform2i( glGetUniformLocation( _taa_resolve_shader._program, "uRenderSize" ), _render_width, _render_height );
+  glUniform1i( glGetUniformLocation( _taa_resolve_shader._program, "uHistoryValid" ), _taa_history_valid );
+  glUniform1f( glGetUniformLocation( _taa_resolve_shader._program, "uBlendFactor" ), TAA_BLEND_FACTOR );
 
-    // Set additional blending for all point light result
-    glEnable( GL_BLEND );
-    glBlendEquation( GL_FUNC_ADD );
-    glBlendFunc( GL_ONE, GL_ONE );
+  StateCache::Disable( GL_DEPTH_TEST );
+  _window->_toolbox->RenderQuad();
+  StateCache::Enable( GL_DEPTH_TEST );
 
-    // Front face culling to still calculate lighting when camera is inside the volume sphere
-    glEnable( GL_CULL_FACE );
-    glCullFace( GL_FRONT );
+  StateCache::UseProgram( 0 );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
 
-    glUniformMatrix4fv( glGetUniformLocation( _lighting_pass_shader._program, "uViewMatrix" ) , 1, GL_FALSE, glm::value_ptr( *iViewMatrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _lighting_pass_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _lighting_pass_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( *iProjectionMatrix ) );
+  // Next frame reprojects to this camera, without the jitter
+  _taa_previous_view_projection_matrix = _camera->_unjittered_projection_matrix * _camera->_view_matrix;
+  _taa_history_valid = true;
 
-    glUniform3fv( glGetUniformLocation( _lighting_pass_shader._program, "uViewPos" ), 1, &_camera->_position[ 0 ] );
-    glUniform3fv( glGetUniformLocation( _lighting_pass_shader._program, "uLightPos" ), 1, &_lights[ i ]._position[ 0 ] );
-    glUniform3fv( glGetUniformLocation( _lighting_pass_shader._program, "uLightColor" ), 1, &_lights[ i ]._color[ 0 ] );
-    glUniform1f(  glGetUniformLocation( _lighting_pass_shader._program, "uLightIntensity" ), _lights[ i ]._intensity );
-    glUniform1f(  glGetUniformLocation( _lighting_pass_shader._program, "uLightMaxDistance" ), _lights[ i ]._max_lighting_distance );
-    glUniform2fv( glGetUniformLocation( _lighting_pass_shader._program, "uScreenSize" ), 1, screen_size );
+  glEndQuery( GL_TIME_ELAPSED );
+}
 
-    //_sphere_model->Draw( _lighting_pass_shader, model_matrix );
-    glBindVertexArray( 0 );
+double Scene::AntiAliasingMemory( unsigned int iMode )
+{
+  // Forward HDR color and depth targets, RGB16F padded to 8 bytes and 4 bytes depth per sample
+  double pixels       = ( double )_window->_width * _window->_height;
+  double sample_bytes = 8.0 + 4.0;
 
-    glUseProgram( 0 );
+  if( iMode == ANTI_ALIASING_MSAA )
+  {
+    return pixels * sample_bytes * _nb_multi_sample;
+  }
 
-    glDisable( GL_BLEND );
+  // Two RGB16F histories and the RG16F motion vectors over the single sampled targets
+  if( iMode == ANTI_ALIASING_TAA )
+  {
+    return pixels * ( sample_bytes + 2.0 * 8.0 + 4.0 );
   }
-  // Disable stencil test
-  glDisable( GL_STENCIL_TEST );
 
-  glCullFace( GL_BACK );
-  glDisable( GL_BLEND );
+  return pixels * sample_bytes;
 }
 
-void Scene::SceneDeferredRendering()
+void Scene::PrintAntiAliasingInfos()
 {
+  Uint32 t;
+  static Uint32 t0 = 0;
+  t = SDL_GetTicks();
+  if( t - t0 > 1000 )
+  {
+    unsigned int mode = _multi_sample ? ANTI_ALIASING_MSAA : ( _taa ? ANTI_ALIASING_TAA : ANTI_ALIASING_NONE );
+
+    fprintf( stderr, "Anti-aliasing -> %s, temporal resolve %.3f ms, targets %.1f MB ( none %.1f MB, MSAA x%d %.1f MB, TAA %.1f MB )\n",
+             ( mode == ANTI_ALIASING_MSAA ) ? "MSAA" : ( ( mode == ANTI_ALIASING_TAA ) ? "TAA" : "off" ),
+             ( _taa_time_samples > 0 ) ? _taa_time / _taa_time_samples : 0.0,
+             AntiAliasingMemory( mode ) / ( 1024.0 * 1024.0 ),
+             AntiAliasingMemory( ANTI_ALIASING_NONE ) / ( 1024.0 * 1024.0 ),
+             _nb_multi_sample,
+             AntiAliasingMemory( ANTI_ALIASING_MSAA ) / ( 1024.0 * 1024.0 ),
+             AntiAliasingMemory( ANTI_ALIASING_TAA ) / ( 1024.0 * 1024.0 ) );
+
+    _taa_time         = 0.0;
+    _taa_time_samples = 0;
+    t0 = t;
+  }
+}
 
-  // Projection and view matrices setting
-  glm::mat4 model_matrix;
-
-  // Bind and clear the rendered frames
-  glBindFramebuffer( GL_DRAW_FRAMEBUFFER, _g_buffer_FBO );
-  unsigned int attachments[ 2 ] = { GL_COLOR_ATTACHMENT4, GL_COLOR_ATTACHMENT5 };
-  glDrawBuffers( 2, attachments );
-  glClear( GL_COLOR_BUFFER_BIT );
-
+void Scene::TessellationUniformsUpdate()
+{
+  Shader * tessellated_shaders[ 3 ] = { &_forward_displacement_pbr_shader, &_depth_prepass_displacement_shader, &_geometry_displacement_pass_shader };
 
-  // Deferred rendering G-buffer pass
-  // --------------------------------
-  DeferredGeometryPass( &_camera->_projection_matrix,
-                        &_camera->_view_matrix );
+  for( unsigned int shader_it = 0; shader_it < 3; shader_it++ )
+  {
+    // Deferred geometry program not built while forward only was used
+    if( tessellated_shaders[ shader_it ]->_program == 0 )
+    {
+      continue;
+    }
 
+    // Recorded by the shader, permutations linked mid frame get them before their first draw
+    float viewport_size[ 2 ] = { ( float )_render_width, ( float )_render_height };
+    tessellated_shaders[ shader_it ]->SetPersistentInt( "uTessellationMode", _tessellation_mode );
+    tessellated_shaders[ shader_it ]->SetPersistentFloats( "uViewportSize", 2, viewport_size );
+    tessellated_shaders[ shader_it ]->SetPersistentFloats( "uTessellationEdgePixels", 1, &_tessellation_edge_pixels );
+  }
+  StateCache::UseProgram( 0 );
+}
 
-  // Deferred rendering lighting pass
-  // --------------------------------
-  DeferredLightingPass( &_camera->_projection_matrix,
-                        &_camera->_view_matrix );
+unsigned int Scene::TessellationTrianglesEstimate( Object *       iPlane,
+                                                   unsigned int   iMode,
+                                                   unsigned int * oCulledPatches )
+{
+  // Same plane grid as CreatePlaneVAO, flat patches so the PN control points stay inside each triangle
+  const unsigned int side = PLANE_SIDE_VERTICES;
 
+  glm::mat4 view_projection = _camera->_projection_matrix * _camera->_view_matrix;
+  glm::vec3 normal          = glm::normalize( glm::transpose( glm::inverse( glm::mat3( iPlane->_model_matrix ) ) ) * glm::vec3( 0.0, -1.0, 0.0 ) );
+  float displacement        = -iPlane->_displacement_factor;
 
-  // Forward render lamps sphere
-  // ---------------------------
-  glEnable( GL_DEPTH_TEST );
-  glDepthMask( GL_FALSE );
+  // Displaced surface seen from the side it is pushed toward
+  glm::vec3 outward = normal * ( ( displacement > 0.0f ) ? 1.0f : -1.0f );
 
-  _flat_color_shader.Use();
-  for( int i = 0; i < _lights.size(); i++ )
+  glm::vec4 frustum_planes[ 6 ];
+  for( int axis = 0; axis < 3; axis++ )
   {
-    model_matrix = glm::mat4();
-    model_matrix = glm::translate( model_matrix, _lights[ i ]._position );
-    model_matrix = glm::scale( model_matrix, glm::vec3( 0.04f ) ); 
-    glm::vec3 lamp_color = _lights[ i ]._color * _lights[ i ]._intensity;
-    glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uViewMatrix" ) , 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-    glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-    glUniform3f( glGetUniformLocation( _flat_color_shader._program, "uColor" ), lamp_color.x, lamp_color.y, lamp_color.z );
-
-    glUniform1i( glGetUniformLocation( _flat_color_shader._program, "uBloom" ), true );
-    glUniform1f( glGetUniformLocation( _flat_color_shader._program, "uBloomBrightness" ), 1.0f );
+    for( int side_it = 0; side_it < 2; side_it++ )
+    {
+      float sign = ( side_it == 0 ) ? -1.0f : 1.0f;
+      glm::vec4 plane( view_projection[ 0 ][ 3 ] + view_projection[ 0 ][ axis ] * sign,
+                       view_projection[ 1 ][ 3 ] + view_projection[ 1 ][ axis ] * sign,
+                       view_projection[ 2 ][ 3 ] + view_projection[ 2 ][ axis ] * sign,
+                       view_projection[ 3 ][ 3 ] + view_projection[ 3 ][ axis ] * sign );
+      frustum_planes[ axis * 2 + side_it ] = plane / glm::length( glm::vec3( plane.x, plane.y, plane.z ) );
+    }
+  }
 
-    //_sphere_model->Draw( _flat_color_shader, model_matrix );
+  std::vector< glm::vec3 > positions( side * side );
+  for( unsigned int width_it = 0; width_it < side; width_it++ )
+  {
+    for( unsigned int height_it = 0; height_it < side; height_it++ )
+    {
+      glm::vec4 position = iPlane->_model_matrix * glm::vec4( ( float )width_it / ( side - 1 ), 0.0, ( float )height_it / ( side - 1 ), 1.0 );
+      positions[ width_it * side + height_it ] = glm::vec3( position.x, position.y, position.z );
+    }
   }
-  glUseProgram( 0 );
-  
 
-  // Forward render lights volume
-  // ----------------------------
-  if( _render_lights_volume )
+  unsigned int triangles = 0;
+  for( unsigned int width_it = 0; width_it < side - 1; width_it++ )
   {
-    _flat_color_shader.Use();
-    for( int i = 0; i < _lights.size(); i++ )
+    for( unsigned int height_it = 0; height_it < side - 1; height_it++ )
     {
-      model_matrix = glm::mat4();
-      model_matrix = glm::translate( model_matrix, _lights[ i ]._position );
-      model_matrix = glm::scale( model_matrix, glm::vec3( _lights[ i ]._max_lighting_distance ) ); 
-      glm::vec3 sphere_color = glm::vec3( 0.0, 0.0, 1.0 ) * _lights[ i ]._intensity;
-      glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uViewMatrix" ) , 1, GL_FALSE, glm::value_ptr( _camera->_view_matrix ) );
-      glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uModelMatrix" ), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
-      glUniformMatrix4fv( glGetUniformLocation( _flat_color_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( _camera->_projection_matrix ) );
-      glUniform3f( glGetUniformLocation( _flat_color_shader._program, "uColor" ), sphere_color.x, sphere_color.y, sphere_color.z );
+      unsigned int vertex = height_it * side + width_it;
+      unsigned int patches[ 2 ][ 3 ] = { { vertex, vertex + side, vertex + side + 1 }, { vertex, vertex + side + 1, vertex + 1 } };
+
+      for( unsigned int patch_it = 0; patch_it < 2; patch_it++ )
+      {
+        glm::vec3 corners[ 3 ] = { positions[ patches[ patch_it ][ 0 ] ], positions[ patches[ patch_it ][ 1 ] ], positions[ patches[ patch_it ][ 2 ] ] };
+
+        // Frustum and back-face tests, bounding sphere grown by the displacement
+        if( iMode == TESSELLATION_SCREEN_SPACE_CULLED )
+        {
+          glm::vec3 center = ( corners[ 0 ] + corners[ 1 ] + corners[ 2 ] ) / 3.0f;
+          float radius     = std::max( glm::length( corners[ 0 ] - center ), std::max( glm::length( corners[ 1 ] - center ), glm::length( corners[ 2 ] - center ) ) ) + std::abs( displacement );
+
+          bool culled = false;
+          for( int plane_it = 0; plane_it < 6; plane_it++ )
+          {
+            if( glm::dot( glm::vec3( frustum_planes[ plane_it ] ), center ) + frustum_planes[ plane_it ].w < -radius )
+            {
+              culled = true;
+            }
+          }
+
+          if( displacement != 0.0f && glm::dot( outward, _camera->_position - corners[ 0 ] ) < 0.0f
+                                   && glm::dot( outward, _camera->_position - corners[ 1 ] ) < 0.0f
+                                   && glm::dot( outward, _camera->_position - corners[ 2 ] ) < 0.0f )
+          {
+            culled = true;
+          }
+
+          if( culled )
+          {
+            ( *oCulledPatches )++;
+            continue;
+          }
+        }
+
+        // Outer levels, edge opposite to each corner, rounded up by the equal spacing
+        unsigned int outer_levels[ 3 ];
+        unsigned int inner_level = 1;
+        for( int edge_it = 0; edge_it < 3; edge_it++ )
+        {
+          glm::vec3 position0 = corners[ ( edge_it + 1 ) % 3 ];
+          glm::vec3 position1 = corners[ ( edge_it + 2 ) % 3 ];
+          float level;
+
+          if( iMode == TESSELLATION_DISTANCE_BANDS )
+          {
+            float average_distance = ( glm::length( _camera->_position - position0 ) + glm::length( _camera->_position - position1 ) ) * 0.5f;
+            level = ( average_distance <= 1.5f ) ? 175.0f : ( average_distance <= 4.0f ) ? 80.0f : ( average_distance <= 6.0f ) ? 20.0f : ( average_distance <= 8.0f ) ? 10.0f : 5.0f;
+            level *= iPlane->_tessellation_factor;
+          }
+          else
+          {
+            float pixels = ( glm::length( position1 - position0 ) * _camera->_projection_matrix[ 1 ][ 1 ] * _render_height * 0.5f ) /
+                           std::max( glm::length( _camera->_position - ( position0 + position1 ) * 0.5f ), 0.0001f );
+            level = ( pixels * iPlane->_tessellation_factor ) / _tessellation_edge_pixels;
+          }
+
+          outer_levels[ edge_it ] = ( unsigned int )std::ceil( glm::clamp( level, 1.0f, ( float )_tess_max_level ) );
+          inner_level = std::max( inner_level, outer_levels[ edge_it ] );
+        }
 
-      glUniform1i( glGetUniformLocation( _flat_color_shader._program, "uBloom" ), false );
+        // Bands mode inner level is the third outer one, a single segment inner level is split when an edge isn't
+        if( iMode == TESSELLATION_DISTANCE_BANDS )
+        {
+          inner_level = outer_levels[ 2 ];
+        }
+        if( inner_level == 1 && ( outer_levels[ 0 ] > 1 || outer_levels[ 1 ] > 1 || outer_levels[ 2 ] > 1 ) )
+        {
+          inner_level = 2;
+        }
 
-      //_sphere_model->Draw( _flat_color_shader, model_matrix );
+        if( inner_level == 1 )
+        {
+          triangles += 1;
+          continue;
+        }
+
+        // Outer ring strips, then the concentric inner rings down to a point or a single triangle
+        triangles += outer_levels[ 0 ] + outer_levels[ 1 ] + outer_levels[ 2 ] + 3 * ( inner_level - 2 );
+        for( int ring = ( int )inner_level - 2; ring >= 2; ring -= 2 )
+        {
+          triangles += 3 * ( ring + ring - 2 );
+        }
+        triangles += ( inner_level % 2 == 1 ) ? 1 : 0;
+      }
     }
-    glUseProgram( 0 );
   }
 
-  // Unbind current FBO
-  glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+  return triangles;
 }
 
-void Scene::BlurProcess()
-{ 
-  bool first_ite = true;
-  int horizontal = 1; 
-
-  // Bind correct FBO
-  glViewport( 0, 0, _window->_width * _blur_downsample, _window->_height * _blur_downsample );
-  glBindFramebuffer( GL_FRAMEBUFFER, _window->_toolbox->_pingpong_FBO ); 
-  _blur_shader.Use();
-  
-  for( unsigned int i = 0; i < _blur_pass_count; i++ )
+void Scene::PrintTessellationInfos()
+{
+  Uint32 t;
+  static Uint32 t0 = 0;
+  t = SDL_GetTicks();
+  if( t - t0 > 1000 )
   {
-    horizontal == 0 ? glDrawBuffer( GL_COLOR_ATTACHMENT0 ) : glDrawBuffer( GL_COLOR_ATTACHMENT1 ); 
-    glClear( GL_COLOR_BUFFER_BIT );
-
-    horizontal = ( horizontal == 0 ) ? 1 : 0;
+    // Current room displaced planes, as drawn by each tessellated pass
+    std::vector< Object * > planes;
+    for( unsigned int ground_it = _grounds_start_it; ground_it < _grounds_end_it; ground_it++ )
+    {
+      if( _grounds_type1[ ground_it ]._height_map && IsInDemoPVS( _grounds_type1[ ground_it ]._PVS_id ) )
+      {
+        planes.push_back( &_grounds_type1[ ground_it ] );
+      }
+    }
+    for( unsigned int wall_it = _walls_start_it; wall_it < _walls_end_it; wall_it++ )
+    {
+      if( _walls_type1[ wall_it ]._height_map && IsInDemoPVS( _walls_type1[ wall_it ]._PVS_id ) )
+      {
+        planes.push_back( &_walls_type1[ wall_it ] );
+      }
+    }
 
-    if( !first_ite )
+    unsigned int triangles[ TESSELLATION_MODE_COUNT ] = { 0, 0, 0 };
+    unsigned int culled_patches = 0;
+    for( unsigned int mode_it = 0; mode_it < TESSELLATION_MODE_COUNT; mode_it++ )
     {
-      glActiveTexture( GL_TEXTURE0 );
-      glBindTexture( GL_TEXTURE_2D, _window->_toolbox->_pingpong_color_buffers[ horizontal ] );
+      for( unsigned int plane_it = 0; plane_it < planes.size(); plane_it++ )
+      {
+        triangles[ mode_it ] += TessellationTrianglesEstimate( planes[ plane_it ], mode_it, &culled_patches );
+      }
     }
-    else
+
+    unsigned int patches = planes.size() * ( PLANE_SIDE_VERTICES - 1 ) * ( PLANE_SIDE_VERTICES - 1 ) * 2;
+
+    // Pre-displaced LODs triangles from the same camera, whether the planes currently use them or not
+    unsigned int baked_triangles = 0;
+    unsigned int baked_planes    = 0;
+    for( unsigned int plane_it = 0; plane_it < planes.size(); plane_it++ )
     {
-      first_ite = false;
-      glActiveTexture( GL_TEXTURE0 );
-      
-      if( _multi_sample )
+      if( planes[ plane_it ]->_displacement_lods_VAO.empty() )
       {
-        glBindTexture( GL_TEXTURE_2D, _window->_toolbox->_final_tex_color_buffer[ 1 ] );    
+        continue;
       }
-      else
-      { 
-        if( _pipeline_type == FORWARD_RENDERING )
-        {
-          glBindTexture( GL_TEXTURE_2D, _window->_toolbox->_temp_tex_color_buffer[ 1 ] ); 
-        }
-        else
-        {
-          glBindTexture( GL_TEXTURE_2D, _g_buffer_textures[ 6 ] ); 
-        }
+
+      for( unsigned int chunk_it = 0; chunk_it < DISPLACEMENT_LOD_CHUNKS * DISPLACEMENT_LOD_CHUNKS; chunk_it++ )
+      {
+        unsigned int segments = DISPLACEMENT_LOD0_SEGMENTS >> DisplacementLODSelect( planes[ plane_it ], chunk_it, _camera->_position );
+        baked_triangles += segments * segments * 2;
       }
+      baked_planes += planes[ plane_it ]->_baked_displacement ? 1 : 0;
     }
 
-    glUniform1f( glGetUniformLocation( _blur_shader._program, "uHorizontal" ), horizontal );
-    glUniform1f( glGetUniformLocation( _blur_shader._program, "uOffsetFactor" ), _blur_offset_factor );
-    _window->_toolbox->RenderQuad();
+    fprintf( stderr, "Tessellation -> %s, estimated triangles per pass : distance bands %u, screen space %u, screen space culled %u ( %u / %u patches culled ), pre-displaced LODs %u ( %u / %u planes baked )\n",
+             ( _tessellation_mode == TESSELLATION_DISTANCE_BANDS ) ? "distance bands" : ( ( _tessellation_mode == TESSELLATION_SCREEN_SPACE ) ? "screen space" : "screen space culled" ),
+             triangles[ TESSELLATION_DISTANCE_BANDS ],
+             triangles[ TESSELLATION_SCREEN_SPACE ],
+             triangles[ TESSELLATION_SCREEN_SPACE_CULLED ],
+             culled_patches,
+             patches,
+             baked_triangles,
+             baked_planes,
+             ( unsigned int )planes.size() );
+
+    t0 = t;
   }
-
-  glUseProgram( 0 );
-  glBindFramebuffer( GL_FRAMEBUFFER, 0 );     
 }
 
-void Scene::PostProcess()
-{ 
-  // Bind correct FBO
-  glViewport( 0, 0, _window->_width, _window->_height );
-  glBindFramebuffer( GL_FRAMEBUFFER, 0 );
-  glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+void Scene::PrintStateCacheInfos()
+{
+  Uint32 t;
+  static Uint32 t0 = 0;
+  t = SDL_GetTicks();
+  if( t - t0 > 1000 )
+  {
+    unsigned int calls = StateCache::_frame_issued_calls + StateCache::_frame_skipped_calls;
 
-  _post_process_shader.Use();
+    fprintf( stderr, "State cache -> %s, last frame binds and states : %u issued, %u skipped ( %.1f %% of %u calls )\n",
+             StateCache::_enabled ? "on" : "off",
+             StateCache::_frame_issued_calls,
+             StateCache::_frame_skipped_calls,
+             ( calls > 0 ) ? 100.0 * StateCache::_frame_skipped_calls / calls : 0.0,
+             calls );
 
-  glActiveTexture( GL_TEXTURE0 );
-  
-  if( _multi_sample )
-  {
-    glBindTexture( GL_TEXTURE_2D, _window->_toolbox->_final_tex_color_buffer[ 0 ] );
+    t0 = t;
   }
-  else
+}
+
+void Scene::PrintRenderTargetsInfos()
+{
+  RenderGraph * graph = _window->_toolbox->_render_graph;
+
+  std::cout << std::endl << "Frame graph render targets" << std::endl
+                         << "--------------------------" << std::endl;
+  graph->PrintTargets();
+  fprintf( stderr, "Pooled %.1f MB against %.1f MB without aliasing, peak %.1f MB, built %u times\n",
+           graph->_memory / ( 1024.0 * 1024.0 ),
+           graph->_unaliased_memory / ( 1024.0 * 1024.0 ),
+           graph->_peak_memory / ( 1024.0 * 1024.0 ),
+           graph->_compile_count );
+}
+
+unsigned int Scene::DisplacementLODSelect( Object *     iPlane,
+                                           unsigned int iChunk,
+                                           glm::vec3    iViewPosition )
+{
+  // Chunk world bounds grown by the displacement, LOD from the closest point distance
+  float chunk_size = 1.0f / DISPLACEMENT_LOD_CHUNKS;
+  float chunk_x    = ( iChunk / DISPLACEMENT_LOD_CHUNKS ) * chunk_size;
+  float chunk_z    = ( iChunk % DISPLACEMENT_LOD_CHUNKS ) * chunk_size;
+
+  glm::vec3 bounds_min( 1.0e10 );
+  glm::vec3 bounds_max( -1.0e10 );
+  for( unsigned int corner_it = 0; corner_it < 4; corner_it++ )
   {
-    if( _pipeline_type == FORWARD_RENDERING )
-    {
-      glBindTexture( GL_TEXTURE_2D, _window->_toolbox->_temp_tex_color_buffer[ 0 ] );
-    }
-    else
-    {
-      glBindTexture( GL_TEXTURE_2D, _g_buffer_textures[ 5 ] );
-    }
+    glm::vec4 corner = iPlane->_model_matrix * glm::vec4( chunk_x + ( corner_it & 1 ) * chunk_size, 0.0, chunk_z + ( corner_it >> 1 ) * chunk_size, 1.0 );
+    bounds_min = glm::min( bounds_min, glm::vec3( corner ) );
+    bounds_max = glm::max( bounds_max, glm::vec3( corner ) );
   }
+  bounds_min -= glm::vec3( std::abs( iPlane->_displacement_factor ) );
+  bounds_max += glm::vec3( std::abs( iPlane->_displacement_factor ) );
 
-  if( _bloom )
+  float distance = glm::length( iViewPosition - glm::clamp( iViewPosition, bounds_min, bounds_max ) );
+
+  unsigned int lod = 0;
+  while( lod < DISPLACEMENT_LOD_COUNT - 1 && distance > DISPLACEMENT_LOD0_DISTANCE * ( 1 << lod ) )
   {
-    glActiveTexture( GL_TEXTURE1 );
-    glBindTexture( GL_TEXTURE_2D, _window->_toolbox->_pingpong_color_buffers[ 0 ] );
+    lod++;
   }
 
-  glUniform1i( glGetUniformLocation( _post_process_shader._program, "uBloom" ), _bloom );
-  glUniform1f( glGetUniformLocation( _post_process_shader._program, "uExposure" ), _exposure );
-  glUniform1f( glGetUniformLocation( _post_process_shader._program, "uEnd" ), _end );
-  _window->_toolbox->RenderQuad();
+  return lod;
+}
+
+void Scene::DisplacementLODsDraw( Object *  iPlane,
+                                  glm::vec3 iViewPosition )
+{
+  for( unsigned int chunk_it = 0; chunk_it < DISPLACEMENT_LOD_CHUNKS * DISPLACEMENT_LOD_CHUNKS; chunk_it++ )
+  {
+    unsigned int lod      = DisplacementLODSelect( iPlane, chunk_it, iViewPosition );
+    unsigned int segments = DISPLACEMENT_LOD0_SEGMENTS >> lod;
+
+    StateCache::BindVertexArray( iPlane->_displacement_lods_VAO[ chunk_it * DISPLACEMENT_LOD_COUNT + lod ] );
+    glDrawElements( GL_TRIANGLES, segments * segments * 6, GL_UNSIGNED_INT, 0 );
+  }
 
-  glUseProgram( 0 );
+  StateCache::BindVertexArray( 0 );
 }
 
 void Scene::AnimationsUpdate()
@@ -7051,8 +7996,6 @@ void Scene::AnimationsUpdate()
       _grounds_start_it = 0;
       _grounds_end_it   = 2;  
 
-      _current_shadow_light_source = 2;
-
       break;
 
     case 2:
@@ -7061,8 +8004,6 @@ void Scene::AnimationsUpdate()
     
       _grounds_start_it = 2;
       _grounds_end_it   = 4;
-
-      _current_shadow_light_source = 0;
       break;
 
     case 3:
@@ -7071,14 +8012,25 @@ void Scene::AnimationsUpdate()
     
       _grounds_start_it = 4;
       _grounds_end_it   = _grounds_type1.size();
-
-      _current_shadow_light_source = 1;
       break;
 
     default:
       break;
   }  
 
+  // Motion vectors compare against the last drawn doors
+  _previous_door_rotation_matrix     = _door_rotation_matrix;
+  _previous_door1_rotation_matrix    = _door1_rotation_matrix;
+  _previous_door2_rotation_matrix    = _door2_rotation_matrix;
+  _previous_door_translation_matrix1 = _door_translation_matrix1;
+  _previous_door_translation_matrix2 = _door_translation_matrix2;
+
+  // Doors stay still while the shadow filtering benchmark compares frames
+  if( _shadow_filter_benchmark )
+  {
+    return;
+  }
+
 
   // Revolving door rotation matrix update
   // -------------------------------------
@@ -4,6 +4,7 @@
 #include "object.hpp"
 #include "classic_model.hpp"
 #include "camera.hpp"
+#include "light_grid.hpp"
 
 
 #ifndef SCENE_H
@@ -11,9 +12,133 @@
 
 #include <GL/glew.h>
 
+#include <algorithm>
+#include <fstream>
+
 #define FORWARD_RENDERING 0
 #define DEFERRED_RENDERING 1
 
+#define DEMO_PVS_FILE "../demo_path.pvs"
+
+#define SHADOW_ATLAS_TIER_COUNT 4
+
+// Shadow lookups filtering modes, compiled in the forward shaders
+#define SHADOW_FILTER_PCF        0
+#define SHADOW_FILTER_POISSON    1
+#define SHADOW_FILTER_MOMENTS    2
+#define SHADOW_FILTER_MODE_COUNT 3
+
+#define SHADOW_FILTER_BENCHMARK_WARMUP 20
+#define SHADOW_FILTER_BENCHMARK_FRAMES 100
+
+#define MAX_NB_LIGHTS 512
+
+#define PIPELINE_BENCHMARK_LIGHT_STEPS 4
+#define PIPELINE_BENCHMARK_WARMUP      20
+#define PIPELINE_BENCHMARK_FRAMES      100
+#define MAX_OBJECT_LIGHTS 8
+
+// G-buffer color and depth bytes per pixel, lighting targets apart
+#define G_BUFFER_LEGACY_BYTES_PER_PIXEL  36
+#define G_BUFFER_COMPACT_BYTES_PER_PIXEL 16
+
+// Bloom mip chain levels, from half resolution down
+#define BLOOM_MIP_COUNT 6
+
+// Previous full resolution separable blur passes, kept for the bloom benchmark
+#define BLOOM_BENCHMARK_BLUR_PASSES 6
+
+// Post process chains compared by the per frame bandwidth estimate
+#define POST_PROCESS_PREVIOUS 0
+#define POST_PROCESS_FRAGMENT 1
+#define POST_PROCESS_COMPUTE  2
+
+// Dynamic resolution, render scale bounds and quantization, GPU frame time budget in ms
+#define DYNAMIC_RESOLUTION_MIN_SCALE      0.5
+#define DYNAMIC_RESOLUTION_SCALE_STEP     0.05
+#define DYNAMIC_RESOLUTION_HEADROOM       0.9
+#define DYNAMIC_RESOLUTION_DEFAULT_BUDGET 16.667
+#define DYNAMIC_RESOLUTION_LOG_FILE       "../dynamic_resolution.csv"
+
+// Temporal anti-aliasing, Halton jitter sequence length and current frame weight in the history
+#define TAA_JITTER_PHASES 8
+#define TAA_BLEND_FACTOR  0.1
+
+// Anti-aliasing modes compared by the targets memory estimate
+#define ANTI_ALIASING_NONE 0
+#define ANTI_ALIASING_MSAA 1
+#define ANTI_ALIASING_TAA  2
+
+// Planes grid side, each quad split in two patches when tessellated
+#define PLANE_SIDE_VERTICES 40
+
+// Tessellation levels modes, same values in tessellation.cs
+#define TESSELLATION_DISTANCE_BANDS      0
+#define TESSELLATION_SCREEN_SPACE        1
+#define TESSELLATION_SCREEN_SPACE_CULLED 2
+#define TESSELLATION_MODE_COUNT          3
+
+// Targeted tessellated edges length in pixels at a tessellation factor of 1
+#define TESSELLATION_EDGE_PIXELS 8.0
+
+// Pre-displaced planes, chunks per side, LOD 0 segments per chunk side halved at each LOD as the distance doubles
+#define DISPLACEMENT_LOD_COUNT     3
+#define DISPLACEMENT_LOD_CHUNKS    4
+#define DISPLACEMENT_LOD0_SEGMENTS 64
+#define DISPLACEMENT_LOD0_DISTANCE 2.0
+
+// Forward PBR permutation features, bit order of the shaders _permutation_features
+#define PBR_FEATURE_NORMAL_MAP       ( 1 << 0 )
+#define PBR_FEATURE_OPACITY_MAP      ( 1 << 1 )
+#define PBR_FEATURE_IBL              ( 1 << 2 )
+#define PBR_FEATURE_PARALLAX_CUBEMAP ( 1 << 3 )
+#define PBR_FEATURE_EMISSIVE         ( 1 << 4 )
+#define PBR_FEATURE_RECEIV_SHADOW    ( 1 << 5 )
+#define PBR_FEATURES_ALL             0x3F
+
+// Models set the normal and opacity maps per mesh, only the object wide features are specialized
+#define PBR_FEATURES_OBJECT ( PBR_FEATURE_IBL | PBR_FEATURE_PARALLAX_CUBEMAP | PBR_FEATURE_EMISSIVE | PBR_FEATURE_RECEIV_SHADOW )
+
+
+//******************************************************************************
+//**********  Class SceneProp  *************************************************
+//******************************************************************************
+
+class SceneProp
+{
+  public:  
+    
+    Object * _object;
+    Model *  _model;
+    bool     _cull_face;
+};
+
+
+//******************************************************************************
+//**********  Class ShadowSlot  ************************************************
+//******************************************************************************
+
+class ShadowSlot
+{
+  public:  
+    
+    int                      _light;
+    unsigned int             _tier;
+    unsigned int             _layer;
+    bool                     _ready;
+
+    // Faces bitmasks : static cache faces rendered, atlas faces waiting for a copy and dynamic overlay
+    unsigned int             _static_faces;
+    unsigned int             _refresh_faces;
+
+    // Dynamic casters state at last refresh
+    std::vector< glm::mat4 > _dynamic_state;
+    unsigned int             _dynamic_faces;
+
+    // Moments faces up to date with the atlas ones, moments filtering mode only
+    unsigned int             _moment_faces;
+};
+
 
 //******************************************************************************
 //**********  Class Scene  *****************************************************
@@ -38,6 +163,12 @@ class Scene
     void SceneDataInitialization();
 
     void ShadersInitialization();
+
+    void DeferredShadersInitialization();
+
+    void DeferredSamplersInitialization();
+
+    void ForwardShadersInitialization();
     
     void LightsInitialization();
 
@@ -47,8 +178,34 @@ class Scene
 
     void TesselationInitialization();
 
+    void DisplacementLODsInitialization();
+
     void ModelsLoading();
 
+    void PropsListsInitialization();
+
+    void AddRoomProp( unsigned int iRoom,
+                      Object *     iObject,
+                      Model *      iModel,
+                      bool         iCullFace );
+
+    void DemoPVSInitialization();
+
+    void DemoPVSHashUpdate( const void * iData,
+                            unsigned int iSize );
+
+    void DemoPVSBaking();
+
+    void DemoPVSObjectsIDRendering( bool iOpaque );
+
+    glm::vec3 DemoPVSIDToColor( unsigned int iPVSID );
+
+    bool DemoPVSLoading();
+
+    void DemoPVSSaving();
+
+    bool IsInDemoPVS( unsigned int iPVSID );
+
     void ObjectsIBLInitialization();
 
     void ObjectCubemapsGeneration( Object *     iObject,
@@ -57,22 +214,196 @@ class Scene
 
     void DeferredBuffersInitialization();
 
+    void ShadowAtlasInitialization();
+
+    void ShadowAtlasAllocation();
+
+    float ShadowImportance( unsigned int iLightIt );
+
+    unsigned int ShadowWantedTier( unsigned int iLightIt );
+
     void SceneDepthPass();
 
+    void ShadowTransformMatrices( unsigned int               iLightIt,
+                                  unsigned int               iRes,
+                                  std::vector< glm::mat4 > * oMatrices );
+
+    void ShadowCastersCulling( unsigned int               iLightIt,
+                               std::vector< SceneProp > * ioCasters,
+                               std::vector< glm::vec3 > * oCenters,
+                               std::vector< float > *     oRadius );
+
+    bool SphereInFrustum( glm::mat4 * iViewProjectionMatrix,
+                          glm::vec3   iCenter,
+                          float       iRadius );
+
+    void ShadowCastersRendering( std::vector< SceneProp > * iCasters,
+                                 std::vector< glm::vec3 > * iCenters,
+                                 std::vector< float > *     iRadius,
+                                 glm::mat4 *                iShadowTransformMatrix );
+
+    void ShadowMomentsInitialization();
+
+    void ShadowMomentsUpdate();
+
+    void ShadowFilterSwitch( unsigned int iMode );
+
+    void ShadowFilterBenchmarkStart();
+
+    void ShadowFilterBenchmarkFrameEnd();
+
+    void LightGridUpdate( bool iClustered );
+
+    void ForwardLightsBinding( Shader * iShader,
+                               bool     iClustered,
+                               float    iIntensityScale );
+
+    void ObjectLightsListUpdate( Object *  iObject,
+                                 glm::vec3 iMin,
+                                 glm::vec3 iMax );
+
+    void ObjectsLightsListsUpdate();
+
+    void ObjectLightsBinding( Shader * iShader,
+                              Object * iObject );
+
+    unsigned int ObjectPermutation( Object * iObject );
+
+    unsigned int DoorPermutation( Object * iObject );
+
+    void PermutationUniform( Shader *     iShader,
+                             unsigned int iSpecialized,
+                             unsigned int iFeature,
+                             const char * iName,
+                             bool         iValue );
+
+    void ManyLightsBenchmark( bool iEnable );
+
+    void PrintForwardLightingInfos();
+
+    void PrintShadowPassInfos();
+
+    void ForwardDepthPrePass();
+
     void SceneForwardRendering();
 
+    void ForwardPropRendering( SceneProp * iProp );
+
+    void DeferredObjectBinding( Shader *     iShader,
+                                Object *     iObject,
+                                unsigned int iSpecialized );
+
+    void DeferredDoorsIBLOverride( Shader *     iShader,
+                                   Model *      iModel,
+                                   unsigned int iSpecialized );
+
+    void ModelsDrawList( std::vector< SceneProp > * oProps );
+
     void DeferredGeometryPass( glm::mat4 * iProjectionMatrix,
                                glm::mat4 * iViewMatrix );
 
     void DeferredLightingPass( glm::mat4 * iProjectionMatrix,
                                glm::mat4 * iViewMatrix );
 
+    void DeferredTiledLightingPass( glm::mat4 * iProjectionMatrix,
+                                    glm::mat4 * iViewMatrix );
+
+    void DeferredTransparentPass( glm::mat4 * iProjectionMatrix,
+                                  glm::mat4 * iViewMatrix );
+
+    void PrintDeferredLightingInfos();
+
+    void GBufferBandwidthBenchmark();
+
     void SceneDeferredRendering();
 
+    void PipelineSwitch();
+
+    void PipelineBenchmarkStart();
+
+    void PipelineBenchmarkStepSetup();
+
+    void PipelineBenchmarkFrameBegin();
+
+    void PipelineBenchmarkFrameEnd();
+
+    void BloomMipChainInitialization( unsigned int * oMips,
+                                      unsigned int   iWidth,
+                                      unsigned int   iHeight );
+
+    void BloomMipChainRendering( unsigned int   iSourceTexture,
+                                 bool           iMultiSample,
+                                 unsigned int * iMips,
+                                 unsigned int   iWidth,
+                                 unsigned int   iHeight );
+
     void BlurProcess();
 
+    void BloomBenchmark();
+
+    void PostProcessTargetsUpdate();
+
+    void FrameGraphUpdate();
+
+    void FrameGraphBuild();
+
+    void FrameGraphAttach( unsigned int *       ioFBO,
+                           unsigned int         iCount,
+                           const GLenum *       iAttachments,
+                           const unsigned int * iTextures,
+                           GLenum               iTextureTarget );
+
     void PostProcess();
 
+    double PostProcessBandwidth( unsigned int iChain,
+                                 bool         iMultiSample,
+                                 bool         iBloom );
+
+    void PrintPostProcessInfos();
+
+    void PostProcessBandwidthReport();
+
+    void DynamicResolutionScaleSet( float iScale );
+
+    void DynamicResolutionFrameBegin();
+
+    void DynamicResolutionFrameEnd();
+
+    void UpscaleProcess();
+
+    void PrintDynamicResolutionInfos();
+
+    unsigned int SceneColorTexture();
+
+    void TemporalJitterUpdate();
+
+    void MotionVectorsPass();
+
+    void TemporalResolve();
+
+    double AntiAliasingMemory( unsigned int iMode );
+
+    void PrintAntiAliasingInfos();
+
+    void TessellationUniformsUpdate();
+
+    unsigned int TessellationTrianglesEstimate( Object *       iPlane,
+                                                unsigned int   iMode,
+                                                unsigned int * oCulledPatches );
+
+    void PrintTessellationInfos();
+
+    void PrintStateCacheInfos();
+
+    void PrintRenderTargetsInfos();
+
+    unsigned int DisplacementLODSelect( Object *     iPlane,
+                                        unsigned int iChunk,
+                                        glm::vec3    iViewPosition );
+
+    void DisplacementLODsDraw( Object *  iPlane,
+                               glm::vec3 iViewPosition );
+
     void AnimationsUpdate();
 
     void RevolvingDoorScript();
@@ -95,21 +426,37 @@ class Scene
     // Shaders
     Shader _forward_pbr_shader;
     Shader _forward_displacement_pbr_shader;
+    Shader _depth_prepass_shader;
+    Shader _depth_prepass_alpha_test_shader;
+    Shader _depth_prepass_displacement_shader;
     Shader _skybox_shader;
     Shader _flat_color_shader;
     Shader _observer_shader;
     Shader _blur_shader;
+    Shader _bloom_downsample_shader;
+    Shader _bloom_upsample_shader;
     Shader _post_process_shader;
-    Shader _MS_blit_shader;
+    Shader _post_process_MS_shader;
+    Shader _post_process_compute_shader;
+    Shader _post_process_compute_MS_shader;
+    Shader _bloom_prefilter_MS_shader;
+    Shader _upscale_shader;
+    Shader _motion_vectors_shader;
+    Shader _taa_resolve_shader;
     Shader _cube_map_converter_shader;
     Shader _diffuse_irradiance_shader;
     Shader _specular_pre_filter_shader;
     Shader _specular_pre_brdf_shader;
     Shader _point_shadow_depth_shader;
+    Shader _shadow_moments_shader;
+    Shader _shadow_moments_blur_shader;
 
     Shader _geometry_pass_shader;
+    Shader _geometry_displacement_pass_shader;
     Shader _lighting_pass_shader;
     Shader _empty_shader;
+    Shader _tiled_lighting_shader;
+    Shader _g_buffer_fill_shader;
 
     // VAOs
     unsigned int _ground1_VAO;
@@ -117,11 +464,15 @@ class Scene
     unsigned int _wall1_VAO;
     unsigned int _wall2_VAO;
 
+    // Position only VAO for depth passes, planes only differ by their UV scale
+    unsigned int _plane_depth_VAO;
+
     // VBOs
     unsigned int _ground1_VBO;
     unsigned int _ground2_VBO;
     unsigned int _wall1_VBO;
     unsigned int _wall2_VBO;
+    unsigned int _plane_depth_VBO;
 
     // IBOs
     unsigned int                _ground1_IBO;
@@ -140,14 +491,84 @@ class Scene
    
     // Deferred rendering data
     unsigned int _g_buffer_FBO;
-    std::vector< unsigned int > _g_buffer_textures; // [ position, normal, color, roughness_metalness_AO, depth, lighting, brightest ]
+    std::vector< unsigned int > _g_buffer_textures; // [ normal, color, roughness_metalness_AO, depth, lighting ]
+
+    // Deferred lighting, tiled compute pass or per light stencil volumes
+    bool         _tiled_deferred_lighting;
+    bool         _tiled_deferred_supported;
+    unsigned int _deferred_time_queries[ 2 ];
+    unsigned int _geometry_time_queries[ 2 ];
+    unsigned int _deferred_query_it;
+    double       _deferred_pass_time;
+    double       _geometry_pass_time;
+    unsigned int _deferred_pass_samples;
+
+    // Forward against deferred over growing light counts, one step per pipeline and count
+    bool         _pipeline_benchmark;
+    unsigned int _pipeline_benchmark_step;
+    unsigned int _pipeline_benchmark_frame;
+    unsigned int _pipeline_benchmark_queries[ 2 ][ 2 ];
+    double       _pipeline_benchmark_time;
+    double       _pipeline_benchmark_results[ PIPELINE_BENCHMARK_LIGHT_STEPS * 2 ];
+    unsigned int _pipeline_benchmark_lights[ PIPELINE_BENCHMARK_LIGHT_STEPS ];
+    int          _pipeline_benchmark_saved_type;
+    bool         _pipeline_benchmark_saved_many_lights;
+    unsigned int _pipeline_benchmark_saved_many_count;
 
     // Bloom parameters
     float _exposure;
     bool  _bloom;
-    float _blur_downsample;
-    int   _blur_pass_count;
-    float _blur_offset_factor;
+    float _bloom_threshold;
+    float _bloom_knee;
+    float _bloom_radius;
+
+    // Fused post process, resolve && bloom composite && tone mapping in one pass, timed one frame later
+    bool         _compute_post_process;
+    bool         _compute_post_process_supported;
+    unsigned int _post_process_time_queries[ 2 ];
+    unsigned int _post_process_query_it;
+    double       _post_process_time;
+    unsigned int _post_process_time_samples;
+    int          _post_process_targets_width;
+    int          _post_process_targets_height;
+
+    // Frame graph built for this window size and these features, rebuilt before a frame when they change
+    unsigned int _frame_graph_features;
+    int          _frame_graph_width;
+    int          _frame_graph_height;
+
+    // Dynamic resolution, scene passes drawn in the bottom left corner of the window sized targets
+    bool         _dynamic_resolution;
+    bool         _frame_upscaled;
+    float        _render_scale;
+    int          _render_width;
+    int          _render_height;
+    float        _frame_time_budget;
+    double       _frame_time_smoothed;
+    unsigned int _frame_time_queries[ 2 ][ 2 ];
+    unsigned int _frame_time_query_it;
+    double       _frame_time_sum;
+    double       _frame_time_squared_sum;
+    double       _frame_time_max;
+    unsigned int _frame_time_samples;
+    unsigned int _frame_time_over_budget;
+    double       _render_scale_sum;
+    std::ofstream _dynamic_resolution_log;
+
+    // Temporal anti-aliasing, jittered projection and history ping-pong, timed one frame later
+    bool         _taa;
+    glm::vec2    _taa_jitter;
+    unsigned int _taa_frame;
+    unsigned int _taa_history_it;
+    bool         _taa_history_valid;
+    int          _taa_history_width;
+    int          _taa_history_height;
+    glm::mat4    _taa_previous_view_projection_matrix;
+    unsigned int _motion_vectors_depth;
+    unsigned int _taa_time_queries[ 2 ];
+    unsigned int _taa_query_it;
+    double       _taa_time;
+    unsigned int _taa_time_samples;
 
     // Multi sample parameters
     bool _multi_sample;
@@ -169,9 +590,56 @@ class Scene
     // Tessellation parameters
     int _tess_max_patch_vertices;
     int _tess_patch_vertices_count;
+    int _tess_max_level;
+
+    // Tessellation levels mode and targeted edges length, set per frame on the displacement shaders
+    unsigned int _tessellation_mode;
+    float        _tessellation_edge_pixels;
+
+    // Forward PBR objects drawn with their features compiled as constants, else with the uniforms branching program
+    bool _shader_permutations;
 
     // Omnidirectional shadow mapping parameters
-    unsigned int _depth_cubemap_res;
+    unsigned int _shadow_atlas_res[ SHADOW_ATLAS_TIER_COUNT ];
+    unsigned int _shadow_atlas_layers[ SHADOW_ATLAS_TIER_COUNT ];
+    unsigned int _shadow_face_budget;
+    bool         _shadow_depth_16_bits;
+    unsigned int _shadow_triangle_count;
+    unsigned int _shadow_face_update_count;
+    unsigned int _shadow_slot_assign_count;
+
+    // Shadow atlas cost against one fixed 2048 cubemap per slot
+    float        _shadow_atlas_memory;
+    float        _shadow_baseline_memory;
+    double       _shadow_texels_updated;
+    double       _shadow_baseline_texels_updated;
+    unsigned int _shadow_time_queries[ 2 ];
+    unsigned int _shadow_query_it;
+    double       _shadow_pass_time;
+    unsigned int _shadow_pass_time_samples;
+
+    // Shadow atlas slots, static casters cache and per light slot index
+    std::vector< ShadowSlot > _shadow_slots;
+    std::vector< int >        _light_shadow_slot;
+
+    // Owned slots by decreasing light importance, refresh order under the faces budget
+    std::vector< unsigned int > _shadow_slots_order;
+
+    // Shadow lookups filtering, hardware compare sampler or blurred moments at half the tiers resolution
+    unsigned int _shadow_filter_mode;
+    unsigned int _shadow_compare_sampler;
+    unsigned int _shadow_moments_res[ SHADOW_ATLAS_TIER_COUNT ];
+    float        _shadow_moments_memory;
+
+    // Filtering modes benchmark, forward pass cost and final frame error against PCF
+    bool                         _shadow_filter_benchmark;
+    unsigned int                 _shadow_filter_benchmark_step;
+    unsigned int                 _shadow_filter_benchmark_frame;
+    unsigned int                 _shadow_filter_benchmark_saved_mode;
+    int                          _shadow_filter_benchmark_saved_type;
+    double                       _shadow_filter_benchmark_time;
+    double                       _shadow_filter_benchmark_samples;
+    std::vector< unsigned char > _shadow_filter_benchmark_reference;
 
     // Pointer on the scene window
     Window * _window;
@@ -189,6 +657,31 @@ class Scene
     std::vector < PointLight >  _room3_lights;
     bool _render_lights_volume;
 
+    // Clustered forward lighting, lights lists per view froxel
+    LightGrid *  _light_grid;
+    bool         _clustered_lighting;
+    unsigned int _base_light_count;
+    unsigned int _many_lights_count;
+    bool         _many_lights_benchmark;
+    unsigned int _forward_time_queries[ 2 ];
+    unsigned int _forward_query_it;
+    double       _forward_pass_time;
+    unsigned int _forward_pass_time_samples;
+
+    // Depth pre-pass then GL_EQUAL shading, samples shaded counted [ without, with ] it
+    bool         _depth_prepass;
+    bool         _depth_prepass_shading;
+    unsigned int _forward_samples_queries[ 2 ];
+    bool         _forward_samples_prepass[ 2 ];
+    double       _forward_shaded_samples[ 2 ];
+    unsigned int _forward_shaded_frames[ 2 ];
+    double       _forward_shaded_average[ 2 ];
+
+    // Per object lights lists, used when clustered lighting is off
+    unsigned int _object_lights_list_count;
+    unsigned int _object_lights_listed;
+    unsigned int _object_lights_reaching;
+
     // Scene's objects
     std::vector< Object > _walls_type1;
     std::vector< Object > _walls_type2;
@@ -233,6 +726,17 @@ class Scene
     float                 _ground_size;
     float                 _wall_size;
 
+    // Rooms props draw lists [ room1, room2, room3 ]
+    std::vector< std::vector< SceneProp > > _room_props;
+
+    // Demo camera path potentially visible sets, one bitset per bezier segment
+    std::vector< std::vector< bool > > _demo_PVS;
+    unsigned int                       _demo_PVS_object_count;
+    unsigned int                       _demo_PVS_samples;
+    unsigned int                       _demo_PVS_res;
+    unsigned int                       _demo_PVS_hash;
+    bool                               _demo_PVS_culling;
+
     // Models
     Model * _sphere_model;
     Model * _ink_bottle_model;
@@ -278,6 +782,13 @@ class Scene
     glm::mat4 _door1_rotation_matrix;
     glm::mat4 _door2_rotation_matrix;
     float     _door_angle;
+
+    // Previous frame doors matrices for the motion vectors
+    glm::mat4 _previous_door_rotation_matrix;
+    glm::mat4 _previous_door1_rotation_matrix;
+    glm::mat4 _previous_door2_rotation_matrix;
+    glm::mat4 _previous_door_translation_matrix1;
+    glm::mat4 _previous_door_translation_matrix2;
     bool      _revolving_door_open;
 
     // Simple door translation matrix
@@ -1,23 +1,56 @@
 #include "shader.hpp"
 
+#include <chrono>
+#include <iomanip>
+#include <thread>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <direct.h>
+#define MAKE_DIRECTORY( iPath ) _mkdir( iPath )
+#else
+#include <sys/stat.h>
+#define MAKE_DIRECTORY( iPath ) mkdir( iPath, 0755 )
+#endif
+
 
 //******************************************************************************
 //**********  Class Shader  ****************************************************
 //******************************************************************************
+
+unsigned int Shader::_programs_loaded   = 0;
+unsigned int Shader::_programs_compiled = 0;
+
+bool                   Shader::_batch_compile = false;
+std::vector< Shader * > Shader::_pending_shaders;
   
 Shader::Shader()
 {
+  // Optional programs stay at 0 when never built
+  _program = 0;
 
+  _permutations_compile_time = 0.0;
+  _dynamic_program           = 0;
 }
 
 void Shader::Use() 
 { 
-  glUseProgram( this->_program ); 
+  // Back to the program branching on the features uniforms after a permutation
+  if( _dynamic_program )
+  {
+    this->_program = _dynamic_program;
+  }
+
+  StateCache::UseProgram( this->_program ); 
 }
 
 void Shader::SetShaderClassicPipeline( const GLchar * iVertexPath,
                                        const GLchar * iFragmentPath )
 {
+  _stage_paths.clear();
+  _stage_paths.push_back( iVertexPath );
+  _stage_paths.push_back( iFragmentPath );
+
   std::string vertex_code;
   std::string fragment_code;
   std::ifstream vertex_shader_file;
@@ -36,52 +69,26 @@ void Shader::SetShaderClassicPipeline( const GLchar * iVertexPath,
     vertex_code = vertex_shader_stream.str();
     fragment_code = fragment_shader_stream.str();
   }
-  catch( std::ifstream::failure e )
+  catch( const std::ifstream::failure & e )
   {
     std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
   }
 
-  const GLchar * vertex_shader_code = vertex_code.c_str();
-  const GLchar * fragment_shader_code = fragment_code.c_str();
-  unsigned int vertex, fragment;
-  GLint success;
-  GLchar infoLog[ 512 ];
-
-  // Vertex shader
-  vertex = glCreateShader( GL_VERTEX_SHADER );
-  glShaderSource( vertex, 1, &vertex_shader_code, NULL );
-  glCompileShader( vertex );
-  glGetShaderiv( vertex, GL_COMPILE_STATUS, &success );
-  if( !success )
-  {
-    glGetShaderInfoLog( vertex, 512, NULL, infoLog );
-    std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-  }
+  vertex_code   = InsertDefines( vertex_code );
+  fragment_code = InsertDefines( fragment_code );
 
-  // Fragment shader
-  fragment = glCreateShader( GL_FRAGMENT_SHADER );
-  glShaderSource( fragment, 1, &fragment_shader_code, NULL );
-  glCompileShader( fragment );
-  glGetShaderiv( fragment, GL_COMPILE_STATUS, &success );
-  if( !success )
+  // Linked program of a previous launch when neither the sources nor the driver changed
+  std::string binary_path = ProgramBinaryPath( vertex_code + fragment_code );
+  if( LoadProgramBinary( binary_path ) )
   {
-    glGetShaderInfoLog( fragment, 512, NULL, infoLog );
-    std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+    return;
   }
 
-  // Create shader program
-  this->_program = glCreateProgram();
-  glAttachShader( this->_program, vertex );
-  glAttachShader( this->_program, fragment );
-  glLinkProgram( this->_program );
-  glGetProgramiv( this->_program, GL_LINK_STATUS, &success );
-  if( !success )
-  {
-    glGetProgramInfoLog( this->_program, 512, NULL, infoLog );
-    std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-  }
-  glDeleteShader( vertex );
-  glDeleteShader( fragment );
+  // Stages compiled and linked, statuses checked now or at the end of the batch
+  std::vector< unsigned int > stages;
+  stages.push_back( CompileStage( GL_VERTEX_SHADER,   vertex_code ) );
+  stages.push_back( CompileStage( GL_FRAGMENT_SHADER, fragment_code ) );
+  LinkStages( stages, binary_path );
 }
 
 void Shader::SetShaderGeometryPipeline( const GLchar * iVertexPath,
@@ -114,68 +121,26 @@ void Shader::SetShaderGeometryPipeline( const GLchar * iVertexPath,
     geo_code      = geo_shader_stream.str();
     fragment_code = fragment_shader_stream.str();
   }
-  catch( std::ifstream::failure e )
+  catch( const std::ifstream::failure & e )
   {
     std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
   }
 
-  const GLchar * vertex_shader_code   = vertex_code.c_str();
-  const GLchar * geo_shader_code      = geo_code.c_str();
-  const GLchar * fragment_shader_code = fragment_code.c_str();
-  unsigned int vertex, geo, fragment;
-  GLint success;
-  GLchar infoLog[ 512 ];
-  
-  // Vertex shader
-  vertex = glCreateShader( GL_VERTEX_SHADER );
-  glShaderSource( vertex, 1, &vertex_shader_code, NULL );
-  glCompileShader( vertex );
-  glGetShaderiv( vertex, GL_COMPILE_STATUS, &success );
-  if( !success )
-  {
-    glGetShaderInfoLog( vertex, 512, NULL, infoLog );
-    std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-  }
-
-  // Geometry shader
-  geo = glCreateShader( GL_GEOMETRY_SHADER );
-  glShaderSource( geo, 1, &geo_shader_code, NULL );
-  glCompileShader( geo );
-  glGetShaderiv( geo, GL_COMPILE_STATUS, &success );
-  if( !success )
-  {
-    glGetShaderInfoLog( geo, 512, NULL, infoLog );
-    std::cout << "ERROR::SHADER::GEOMETRY::COMPILATION_FAILED\n" << infoLog << std::endl;
-  }
+  vertex_code   = InsertDefines( vertex_code );
+  geo_code      = InsertDefines( geo_code );
+  fragment_code = InsertDefines( fragment_code );
 
-  // Fragment shader
-  fragment = glCreateShader( GL_FRAGMENT_SHADER );
-  glShaderSource( fragment, 1, &fragment_shader_code, NULL );
-  glCompileShader( fragment );
-  glGetShaderiv( fragment, GL_COMPILE_STATUS, &success );
-  if( !success )
-  {
-    glGetShaderInfoLog( fragment, 512, NULL, infoLog );
-    std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-  }
-
-  // Create shader program
-  this->_program = glCreateProgram();
-  glAttachShader( this->_program, vertex );
-  glAttachShader( this->_program, geo );
-  glAttachShader( this->_program, fragment );
-  glLinkProgram( this->_program );
-  glGetProgramiv( this->_program, GL_LINK_STATUS, &success );
-  if( !success )
+  std::string binary_path = ProgramBinaryPath( vertex_code + geo_code + fragment_code );
+  if( LoadProgramBinary( binary_path ) )
   {
-    glGetProgramInfoLog( this->_program, 512, NULL, infoLog );
-    std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    return;
   }
 
-  // Free
-  glDeleteShader( vertex );
-  glDeleteShader( geo );
-  glDeleteShader( fragment );
+  std::vector< unsigned int > stages;
+  stages.push_back( CompileStage( GL_VERTEX_SHADER,   vertex_code ) );
+  stages.push_back( CompileStage( GL_GEOMETRY_SHADER, geo_code ) );
+  stages.push_back( CompileStage( GL_FRAGMENT_SHADER, fragment_code ) );
+  LinkStages( stages, binary_path );
 }
 
 void Shader::SetShaderTessellationPipeline( const char * iVertexPath,
@@ -183,6 +148,12 @@ void Shader::SetShaderTessellationPipeline( const char * iVertexPath,
                                             const char * iTessellationEvaluationPath,
                                             const char * iFragmentPath )
 {
+  _stage_paths.clear();
+  _stage_paths.push_back( iVertexPath );
+  _stage_paths.push_back( iTessellationControlPath );
+  _stage_paths.push_back( iTessellationEvaluationPath );
+  _stage_paths.push_back( iFragmentPath );
+
   std::string vertex_code;
   std::string tess_control_code;
   std::string tess_eval_code;
@@ -216,108 +187,473 @@ void Shader::SetShaderTessellationPipeline( const char * iVertexPath,
     tess_eval_code    = tess_eval_shader_stream.str();
     fragment_code     = fragment_shader_stream.str();
   }
-  catch( std::ifstream::failure e )
+  catch( const std::ifstream::failure & e )
   {
     std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
   }
 
-  const GLchar * vertex_shader_code       = vertex_code.c_str();
-  const GLchar * tess_control_shader_code = tess_control_code.c_str();
-  const GLchar * tess_eval_shader_code    = tess_eval_code.c_str();
-  const GLchar * fragment_shader_code     = fragment_code.c_str();
-  unsigned int vertex, tess_control, tess_eval, fragment;
-  GLint success;
-  GLchar infoLog[ 512 ];
-  
-  // Vertex shader
-  vertex = glCreateShader( GL_VERTEX_SHADER );
-  if( vertex == 0 )
+  vertex_code       = InsertDefines( vertex_code );
+  tess_control_code = InsertDefines( tess_control_code );
+  tess_eval_code    = InsertDefines( tess_eval_code );
+  fragment_code     = InsertDefines( fragment_code );
+
+  std::string binary_path = ProgramBinaryPath( vertex_code + tess_control_code + tess_eval_code + fragment_code );
+  if( LoadProgramBinary( binary_path ) )
   {
-    fprintf( stderr, "Error creating shader type %d\n", GL_VERTEX_SHADER );
+    return;
   }
-  glShaderSource( vertex, 1, &vertex_shader_code, NULL );
-  glCompileShader( vertex );
-  glGetShaderiv( vertex, GL_COMPILE_STATUS, &success );
-  if( !success )
+
+  std::vector< unsigned int > stages;
+  stages.push_back( CompileStage( GL_VERTEX_SHADER,          vertex_code ) );
+  stages.push_back( CompileStage( GL_TESS_CONTROL_SHADER,    tess_control_code ) );
+  stages.push_back( CompileStage( GL_TESS_EVALUATION_SHADER, tess_eval_code ) );
+  stages.push_back( CompileStage( GL_FRAGMENT_SHADER,        fragment_code ) );
+  LinkStages( stages, binary_path );
+}
+
+
+void Shader::SetShaderComputePipeline( const GLchar * iComputePath )
+{
+  std::string compute_code;
+  std::ifstream compute_shader_file;
+  compute_shader_file.exceptions( std::ifstream::badbit );
+  try
   {
-    glGetShaderInfoLog( vertex, 512, NULL, infoLog );
-    std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+    compute_shader_file.open( iComputePath );
+    std::stringstream compute_shader_stream;
+    compute_shader_stream << compute_shader_file.rdbuf();
+    compute_shader_file.close();
+    compute_code = compute_shader_stream.str();
+  }
+  catch( const std::ifstream::failure & e )
+  {
+    std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
   }
 
-  // Tess control shader
-  tess_control = glCreateShader( GL_TESS_CONTROL_SHADER );
-  if( tess_control == 0 )
+  compute_code = InsertDefines( compute_code );
+
+  std::string binary_path = ProgramBinaryPath( compute_code );
+  if( LoadProgramBinary( binary_path ) )
   {
-    fprintf( stderr, "Error creating shader type %d\n", GL_TESS_CONTROL_SHADER );
+    return;
   }
-  glShaderSource( tess_control, 1, &tess_control_shader_code, NULL );
-  glCompileShader( tess_control );
-  glGetShaderiv( tess_control, GL_COMPILE_STATUS, &success );
-  if( !success )
+
+  std::vector< unsigned int > stages;
+  stages.push_back( CompileStage( GL_COMPUTE_SHADER, compute_code ) );
+  LinkStages( stages, binary_path );
+}
+
+void Shader::UsePermutation( unsigned int iSpecialized,
+                             unsigned int iValues )
+{
+  if( _dynamic_program == 0 )
   {
-    glGetShaderInfoLog( tess_control, 512, NULL, infoLog );
-    std::cout << "ERROR::SHADER::TESS CONTROL::COMPILATION_FAILED\n" << infoLog << std::endl;
+    _dynamic_program = _program;
   }
 
-  // Tess eval shader
-  tess_eval = glCreateShader( GL_TESS_EVALUATION_SHADER );
-  if( tess_eval == 0 )
+  // Nothing specialized, same program as Use()
+  if( iSpecialized == 0 )
   {
-    fprintf( stderr, "Error creating shader type %d\n", GL_TESS_EVALUATION_SHADER );
+    Use();
+    return;
   }
-  glShaderSource( tess_eval, 1, &tess_eval_shader_code, NULL );
-  glCompileShader( tess_eval );
-  glGetShaderiv( tess_eval, GL_COMPILE_STATUS, &success );
-  if( !success )
+
+  unsigned int key = iSpecialized | ( ( iValues & iSpecialized ) << 16 );
+  std::map< unsigned int, unsigned int >::iterator permutation = _permutations.find( key );
+
+  if( permutation == _permutations.end() )
+  {
+    // Compiled on first use with the specialized features defined, dead branches fold away
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    std::string base_defines = _defines;
+    for( unsigned int feature_it = 0; feature_it < _permutation_features.size(); feature_it++ )
+    {
+      if( iSpecialized & ( 1 << feature_it ) )
+      {
+        _defines += "#define " + _permutation_features[ feature_it ] + ( ( iValues & ( 1 << feature_it ) ) ? " true\n" : " false\n" );
+      }
+    }
+
+    // Copied, the pipeline call refills _stage_paths from these pointers
+    std::vector< std::string > paths = _stage_paths;
+    ( paths.size() == 4 ) ? SetShaderTessellationPipeline( paths[ 0 ].c_str(), paths[ 1 ].c_str(), paths[ 2 ].c_str(), paths[ 3 ].c_str() )
+                          : SetShaderClassicPipeline( paths[ 0 ].c_str(), paths[ 1 ].c_str() );
+    _defines = base_defines;
+
+    StateCache::UseProgram( _program );
+    for( unsigned int sampler_it = 0; sampler_it < _sampler_units.size(); sampler_it++ )
+    {
+      glUniform1i( glGetUniformLocation( _program, _sampler_units[ sampler_it ].first.c_str() ), _sampler_units[ sampler_it ].second );
+    }
+
+    // Linked mid frame, its first draw must not wait for the next per frame update
+    ApplyPersistentUniforms( _program );
+
+    double compile_time = std::chrono::duration< double, std::milli >( std::chrono::high_resolution_clock::now() - start ).count();
+    _permutations_compile_time += compile_time;
+
+    permutation = _permutations.insert( std::make_pair( key, _program ) ).first;
+
+    std::cout << "Shader permutation " << _stage_paths.back() << " 0x" << std::hex << key << std::dec << " compiled in " << compile_time << " ms, "
+              << _permutations.size() << " permutation(s) in " << _permutations_compile_time << " ms" << std::endl;
+  }
+
+  _program = permutation->second;
+  StateCache::UseProgram( _program );
+}
+
+void Shader::SetSamplerUnit( const char * iName,
+                             int          iUnit )
+{
+  // Current program has to be in use, permutations get it when linked
+  glUniform1i( glGetUniformLocation( _program, iName ), iUnit );
+  _sampler_units.push_back( std::make_pair( std::string( iName ), iUnit ) );
+}
+
+void Shader::SetPersistentInt( const char * iName,
+                               int          iValue )
+{
+  _persistent_ints[ iName ] = iValue;
+
+  std::vector< unsigned int > programs = LinkedPrograms();
+  for( unsigned int program_it = 0; program_it < programs.size(); program_it++ )
   {
-    glGetShaderInfoLog( tess_eval, 512, NULL, infoLog );
-    std::cout << "ERROR::SHADER::TESS CONTROL::COMPILATION_FAILED\n" << infoLog << std::endl;
+    StateCache::UseProgram( programs[ program_it ] );
+    glUniform1i( glGetUniformLocation( programs[ program_it ], iName ), iValue );
   }
+}
+
+void Shader::SetPersistentFloats( const char *  iName,
+                                  unsigned int  iCount,
+                                  const float * iValues )
+{
+  _persistent_floats[ iName ] = std::vector< float >( iValues, iValues + iCount );
 
-  // Fragment shader
-  fragment = glCreateShader( GL_FRAGMENT_SHADER );
-  if( fragment == 0 )
+  std::vector< unsigned int > programs = LinkedPrograms();
+  for( unsigned int program_it = 0; program_it < programs.size(); program_it++ )
   {
-    fprintf( stderr, "Error creating shader type %d\n", GL_FRAGMENT_SHADER );
+    StateCache::UseProgram( programs[ program_it ] );
+    GLint location = glGetUniformLocation( programs[ program_it ], iName );
+    ( iCount == 1 ) ? glUniform1f( location, iValues[ 0 ] ) : glUniform2f( location, iValues[ 0 ], iValues[ 1 ] );
   }
-  glShaderSource( fragment, 1, &fragment_shader_code, NULL );
-  glCompileShader( fragment );
-  glGetShaderiv( fragment, GL_COMPILE_STATUS, &success );
-  if( !success )
+}
+
+void Shader::DeletePermutations()
+{
+  for( std::map< unsigned int, unsigned int >::iterator permutation = _permutations.begin(); permutation != _permutations.end(); permutation++ )
+  {
+    StateCache::DeleteProgram( permutation->second );
+  }
+
+  if( _dynamic_program )
+  {
+    _program = _dynamic_program;
+  }
+
+  _permutations.clear();
+  _sampler_units.clear();
+  _persistent_ints.clear();
+  _persistent_floats.clear();
+  _permutations_compile_time = 0.0;
+  _dynamic_program           = 0;
+}
+
+std::vector< unsigned int > Shader::LinkedPrograms()
+{
+  // Program without specialized feature first, then every permutation
+  std::vector< unsigned int > programs( 1, _dynamic_program ? _dynamic_program : _program );
+  for( std::map< unsigned int, unsigned int >::iterator permutation = _permutations.begin(); permutation != _permutations.end(); permutation++ )
+  {
+    programs.push_back( permutation->second );
+  }
+
+  return programs;
+}
+
+void Shader::ApplyPersistentUniforms( unsigned int iProgram )
+{
+  // Program has to be in use
+  for( std::map< std::string, int >::iterator uniform = _persistent_ints.begin(); uniform != _persistent_ints.end(); uniform++ )
+  {
+    glUniform1i( glGetUniformLocation( iProgram, uniform->first.c_str() ), uniform->second );
+  }
+
+  for( std::map< std::string, std::vector< float > >::iterator uniform = _persistent_floats.begin(); uniform != _persistent_floats.end(); uniform++ )
+  {
+    GLint location = glGetUniformLocation( iProgram, uniform->first.c_str() );
+    ( uniform->second.size() == 1 ) ? glUniform1f( location, uniform->second[ 0 ] ) : glUniform2f( location, uniform->second[ 0 ], uniform->second[ 1 ] );
+  }
+}
+
+std::string Shader::InsertDefines( std::string iCode )
+{
+  // Defines have to come after the #version line, which must stay first
+  if( _defines.empty() )
+  {
+    return iCode;
+  }
+
+  size_t version_end = iCode.find( '\n' );
+  if( version_end == std::string::npos )
+  {
+    return iCode;
+  }
+
+  return iCode.substr( 0, version_end + 1 ) + _defines + iCode.substr( version_end + 1 );
+}
+
+std::string Shader::ProgramBinaryPath( const std::string & iSources )
+{
+  // FNV-1a over every stage sources, defines included
+  unsigned long long hash = 14695981039346656037ULL;
+  for( size_t char_it = 0; char_it < iSources.size(); char_it++ )
+  {
+    hash ^= ( unsigned char )iSources[ char_it ];
+    hash *= 1099511628211ULL;
+  }
+
+  std::stringstream path;
+  path << SHADER_CACHE_DIRECTORY << std::hex << std::setw( 16 ) << std::setfill( '0' ) << hash << ".bin";
+
+  return path.str();
+}
+
+std::string Shader::DriverKey()
+{
+  // Binaries are only valid for the driver which produced them
+  const GLubyte * vendor   = glGetString( GL_VENDOR );
+  const GLubyte * renderer = glGetString( GL_RENDERER );
+  const GLubyte * version  = glGetString( GL_VERSION );
+
+  return std::string( vendor   ? ( const char * )vendor   : "" ) + " | " +
+         std::string( renderer ? ( const char * )renderer : "" ) + " | " +
+         std::string( version  ? ( const char * )version  : "" );
+}
+
+bool Shader::LoadProgramBinary( const std::string & iPath )
+{
+  // Previous program of this shader still in the batch, checked before being replaced
+  if( !_pending_stages.empty() )
+  {
+    LinkStatusCheck();
+    _pending_shaders.erase( std::remove( _pending_shaders.begin(), _pending_shaders.end(), this ), _pending_shaders.end() );
+  }
+
+  GLint formats_count = 0;
+  glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &formats_count );
+
+  std::ifstream cache_file;
+  if( formats_count > 0 )
+  {
+    cache_file.open( iPath.c_str(), std::ios::binary );
+  }
+
+  // Header written by SaveProgramBinary, driver key line then binary format and length
+  std::string driver_key;
+  GLenum      format = 0;
+  GLint       length = 0;
+  if( cache_file.is_open() )
+  {
+    std::getline( cache_file, driver_key );
+    cache_file.read( ( char * )&format, sizeof( format ) );
+    cache_file.read( ( char * )&length, sizeof( length ) );
+  }
+
+  std::vector< char > binary;
+  if( cache_file.is_open() && cache_file.good() && driver_key == DriverKey() && length > 0 )
   {
-    glGetShaderInfoLog( fragment, 512, NULL, infoLog );
-    std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+    binary.resize( length );
+    cache_file.read( &binary[ 0 ], length );
   }
 
-  // Create shader program
+  if( binary.empty() || !cache_file.good() )
+  {
+    _programs_compiled++;
+    return false;
+  }
+
+  // Driver may still reject it, compiled from sources then
   this->_program = glCreateProgram();
-  glAttachShader( this->_program, vertex );
-  glAttachShader( this->_program, tess_control );
-  glAttachShader( this->_program, tess_eval );
-  glAttachShader( this->_program, fragment );
+  glProgramBinary( this->_program, format, &binary[ 0 ], length );
 
-  // Link shader program
-  glLinkProgram(  this->_program );
+  GLint success;
   glGetProgramiv( this->_program, GL_LINK_STATUS, &success );
   if( !success )
   {
-    glGetProgramInfoLog( this->_program, 512, NULL, infoLog );
-    std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n\n" << infoLog << std::endl;
+    StateCache::DeleteProgram( this->_program );
+    this->_program = 0;
+    _programs_compiled++;
+    return false;
+  }
+
+  _programs_loaded++;
+  return true;
+}
+
+void Shader::SaveProgramBinary( const std::string & iPath )
+{
+  GLint length = 0;
+  glGetProgramiv( this->_program, GL_PROGRAM_BINARY_LENGTH, &length );
+  if( length <= 0 )
+  {
+    return;
   }
 
-  // Validate shader program
-  glValidateProgram( this->_program );
-  glGetProgramiv( this->_program, GL_VALIDATE_STATUS, &success );
+  std::vector< char > binary( length );
+  GLenum format = 0;
+  glGetProgramBinary( this->_program, length, &length, &format, &binary[ 0 ] );
+
+  MAKE_DIRECTORY( SHADER_CACHE_DIRECTORY );
+  std::ofstream cache_file( iPath.c_str(), std::ios::binary | std::ios::trunc );
+  if( !cache_file.is_open() )
+  {
+    std::cout << "ERROR::SHADER::BINARY_CACHE_NOT_WRITTEN " << iPath << std::endl;
+    return;
+  }
+
+  cache_file << DriverKey() << '\n';
+  cache_file.write( ( const char * )&format, sizeof( format ) );
+  cache_file.write( ( const char * )&length, sizeof( length ) );
+  cache_file.write( &binary[ 0 ], length );
+}
+
+unsigned int Shader::CompileStage( GLenum              iType,
+                                   const std::string & iCode )
+{
+  const GLchar * code  = iCode.c_str();
+  unsigned int   stage = glCreateShader( iType );
+  if( stage == 0 )
+  {
+    fprintf( stderr, "Error creating shader type %d\n", iType );
+  }
+  glShaderSource( stage, 1, &code, NULL );
+  glCompileShader( stage );
+
+  return stage;
+}
+
+void Shader::LinkStages( std::vector< unsigned int > iStages,
+                         std::string                 iBinaryPath )
+{
+  this->_program = glCreateProgram();
+  for( unsigned int stage_it = 0; stage_it < iStages.size(); stage_it++ )
+  {
+    glAttachShader( this->_program, iStages[ stage_it ] );
+  }
+  glProgramParameteri( this->_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+  glLinkProgram( this->_program );
+
+  _pending_stages      = iStages;
+  _pending_binary_path = iBinaryPath;
+
+  // Status queries wait for the driver, batched programs are checked once all of them are submitted
+  if( _batch_compile )
+  {
+    _pending_shaders.push_back( this );
+    return;
+  }
+
+  LinkStatusCheck();
+}
+
+void Shader::LinkStatusCheck()
+{
+  GLint  success;
+  GLchar infoLog[ 512 ];
+  bool   tessellated = false;
+
+  for( unsigned int stage_it = 0; stage_it < _pending_stages.size(); stage_it++ )
+  {
+    GLint type;
+    glGetShaderiv( _pending_stages[ stage_it ], GL_SHADER_TYPE, &type );
+    tessellated |= ( type == GL_TESS_CONTROL_SHADER );
+
+    glGetShaderiv( _pending_stages[ stage_it ], GL_COMPILE_STATUS, &success );
+    if( !success )
+    {
+      const char * stage_name = ( type == GL_VERTEX_SHADER )          ? "VERTEX" :
+                                ( type == GL_GEOMETRY_SHADER )        ? "GEOMETRY" :
+                                ( type == GL_TESS_CONTROL_SHADER )    ? "TESS CONTROL" :
+                                ( type == GL_TESS_EVALUATION_SHADER ) ? "TESS EVALUATION" :
+                                ( type == GL_COMPUTE_SHADER )         ? "COMPUTE" : "FRAGMENT";
+      glGetShaderInfoLog( _pending_stages[ stage_it ], 512, NULL, infoLog );
+      std::cout << "ERROR::SHADER::" << stage_name << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+  }
+
+  glGetProgramiv( this->_program, GL_LINK_STATUS, &success );
   if( !success )
-  { 
+  {
     glGetProgramInfoLog( this->_program, 512, NULL, infoLog );
-    std::cout << "ERROR::SHADER::PROGRAM::VALIDATION_FAILED\n\n" << infoLog << std::endl;
+    std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+  }
+  else
+  {
+    // Validate tessellation programs
+    if( tessellated )
+    {
+      glValidateProgram( this->_program );
+      glGetProgramiv( this->_program, GL_VALIDATE_STATUS, &success );
+      if( !success )
+      { 
+        glGetProgramInfoLog( this->_program, 512, NULL, infoLog );
+        std::cout << "ERROR::SHADER::PROGRAM::VALIDATION_FAILED\n\n" << infoLog << std::endl;
+      }
+    }
+
+    SaveProgramBinary( _pending_binary_path );
   }
 
   // Free
-  glDeleteShader( vertex );
-  glDeleteShader( tess_control );
-  glDeleteShader( tess_eval );
-  glDeleteShader( fragment );
+  for( unsigned int stage_it = 0; stage_it < _pending_stages.size(); stage_it++ )
+  {
+    glDeleteShader( _pending_stages[ stage_it ] );
+  }
+  _pending_stages.clear();
+  _pending_binary_path.clear();
 }
 
+void Shader::BeginBatchCompile()
+{
+  _batch_compile = true;
+
+  // Driver compiles and links on its own threads, count left to the implementation
+  if( GLEW_KHR_parallel_shader_compile )
+  {
+    glMaxShaderCompilerThreadsKHR( 0xFFFFFFFF );
+  }
+}
+
+void Shader::EndBatchCompile()
+{
+  _batch_compile = false;
+
+  // Finished programs checked first, without the extension the status query simply waits for each one
+  while( !_pending_shaders.empty() )
+  {
+    for( unsigned int shader_it = 0; shader_it < _pending_shaders.size(); )
+    {
+      GLint completed = GL_TRUE;
+      if( GLEW_KHR_parallel_shader_compile )
+      {
+        glGetProgramiv( _pending_shaders[ shader_it ]->_program, GL_COMPLETION_STATUS_KHR, &completed );
+      }
+
+      if( completed )
+      {
+        _pending_shaders[ shader_it ]->LinkStatusCheck();
+        _pending_shaders.erase( _pending_shaders.begin() + shader_it );
+      }
+      else
+      {
+        shader_it++;
+      }
+    }
+
+    if( !_pending_shaders.empty() )
+    {
+      std::this_thread::yield();
+    }
+  }
+}
@@ -4,12 +4,19 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <map>
+#include <vector>
 
 using namespace std;
 
 #define GLEW_STATIC
 #include <GL/glew.h>
 
+#include "state_cache.hpp"
+
+// Linked programs binaries, one file per sources hash, relative to the working directory like the shaders paths
+#define SHADER_CACHE_DIRECTORY "../ShaderCache/"
+
 
 //******************************************************************************
 //**********  Class Shader  ****************************************************
@@ -34,8 +41,87 @@ class Shader
   	                                    const char * iTessellationControlPath,
   	                                    const char * iTessellationEvaluationPath,
   	                                    const char * iFragmentPath );
+
+    void SetShaderComputePipeline( const char * iComputePath );
+
+    void UsePermutation( unsigned int iSpecialized,
+                         unsigned int iValues );
+
+    void SetSamplerUnit( const char * iName,
+                         int          iUnit );
+
+    void SetPersistentInt( const char * iName,
+                           int          iValue );
+
+    void SetPersistentFloats( const char *  iName,
+                              unsigned int  iCount,
+                              const float * iValues );
+
+    void DeletePermutations();
+
+    static void BeginBatchCompile();
+
+    static void EndBatchCompile();
     
     unsigned int _program;
+
+    // Preprocessor lines ( "#define NAME VALUE\n" ) injected in every stage at the next Set*Pipeline call
+    std::string  _defines;
+
+    // Permutation features, a specialized bit i defines _permutation_features[ i ] to its value, the others stay uniforms
+    std::vector< std::string >             _permutation_features;
+    std::map< unsigned int, unsigned int > _permutations;
+    double                                 _permutations_compile_time;
+
+    // Programs of every shader loaded from the binary cache or compiled since launch
+    static unsigned int _programs_loaded;
+    static unsigned int _programs_compiled;
+
+    // Between BeginBatchCompile and EndBatchCompile, programs are submitted and their statuses checked at the end
+    static bool                   _batch_compile;
+    static std::vector< Shader * > _pending_shaders;
+
+
+  private:
+
+    std::string InsertDefines( std::string iCode );
+
+    std::string ProgramBinaryPath( const std::string & iSources );
+
+    std::string DriverKey();
+
+    bool LoadProgramBinary( const std::string & iPath );
+
+    void SaveProgramBinary( const std::string & iPath );
+
+    unsigned int CompileStage( GLenum              iType,
+                               const std::string & iCode );
+
+    void LinkStages( std::vector< unsigned int > iStages,
+                     std::string                 iBinaryPath );
+
+    void LinkStatusCheck();
+
+    std::vector< unsigned int > LinkedPrograms();
+
+    void ApplyPersistentUniforms( unsigned int iProgram );
+
+    // Stages and cache path of a linked program not checked yet
+    std::vector< unsigned int > _pending_stages;
+    std::string                 _pending_binary_path;
+
+    // Stages of the last Set*Pipeline call, rebuilt with the permutation defines
+    std::vector< std::string > _stage_paths;
+
+    // Program without specialized feature, the one Use() binds
+    unsigned int _dynamic_program;
+
+    // Samplers units applied to every permutation once linked
+    std::vector< std::pair< std::string, int > > _sampler_units;
+
+    // Uniforms kept across frames, set on every linked program and on permutations linked later
+    std::map< std::string, int >                  _persistent_ints;
+    std::map< std::string, std::vector< float > > _persistent_floats;
     
 };
 
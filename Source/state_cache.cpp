@@ -0,0 +1,369 @@
+#include "state_cache.hpp"
+
+
+//******************************************************************************
+//**********  Class StateCache  ************************************************
+//******************************************************************************
+
+bool         StateCache::_enabled             = true;
+unsigned int StateCache::_issued_calls        = 0;
+unsigned int StateCache::_skipped_calls       = 0;
+unsigned int StateCache::_frame_issued_calls  = 0;
+unsigned int StateCache::_frame_skipped_calls = 0;
+
+unsigned int StateCache::_program        = STATE_CACHE_UNKNOWN;
+unsigned int StateCache::_VAO            = STATE_CACHE_UNKNOWN;
+unsigned int StateCache::_active_unit    = STATE_CACHE_UNKNOWN;
+unsigned int StateCache::_textures[ STATE_CACHE_TEXTURE_UNITS ][ STATE_CACHE_TEXTURE_TARGETS ];
+unsigned int StateCache::_draw_FBO       = STATE_CACHE_UNKNOWN;
+unsigned int StateCache::_read_FBO       = STATE_CACHE_UNKNOWN;
+unsigned int StateCache::_capabilities[ 4 ];
+unsigned int StateCache::_cull_face      = STATE_CACHE_UNKNOWN;
+unsigned int StateCache::_depth_function = STATE_CACHE_UNKNOWN;
+unsigned int StateCache::_depth_mask     = STATE_CACHE_UNKNOWN;
+unsigned int StateCache::_blend_factors  = STATE_CACHE_UNKNOWN;
+
+void StateCache::UseProgram( unsigned int iProgram )
+{
+  // Unbinding is left out, nothing is drawn or dispatched without binding its own program first
+  if( _enabled && iProgram == 0 )
+  {
+    _skipped_calls++;
+    return;
+  }
+
+  if( !Redundant( &_program, iProgram ) )
+  {
+    glUseProgram( iProgram );
+  }
+}
+
+void StateCache::BindVertexArray( unsigned int iVAO )
+{
+  // Unbinds are kept, buffers bound afterwards must not land in the previous VAO
+  if( !Redundant( &_VAO, iVAO ) )
+  {
+    glBindVertexArray( iVAO );
+  }
+}
+
+void StateCache::ActiveTexture( GLenum iUnit )
+{
+  if( !Redundant( &_active_unit, iUnit ) )
+  {
+    glActiveTexture( iUnit );
+  }
+}
+
+void StateCache::BindTexture( GLenum       iTarget,
+                              unsigned int iTexture )
+{
+  unsigned int unit         = _active_unit - GL_TEXTURE0;
+  int          target_index = TargetIndex( iTarget );
+
+  if( _active_unit == STATE_CACHE_UNKNOWN || unit >= STATE_CACHE_TEXTURE_UNITS || target_index < 0 )
+  {
+    _issued_calls++;
+    glBindTexture( iTarget, iTexture );
+    return;
+  }
+
+  if( !Redundant( &_textures[ unit ][ target_index ], iTexture ) )
+  {
+    glBindTexture( iTarget, iTexture );
+  }
+}
+
+void StateCache::BindTextures( unsigned int         iFirstUnit,
+                               unsigned int         iCount,
+                               const unsigned int * iTextures,
+                               GLenum               iTarget )
+{
+  int target_index = TargetIndex( iTarget );
+
+  // Units range still differing from the cache, the ones around it are dropped
+  unsigned int first_changed = iCount;
+  unsigned int last_changed  = 0;
+  for( unsigned int unit_it = 0; unit_it < iCount; unit_it++ )
+  {
+    unsigned int unit = iFirstUnit + unit_it;
+    if( !_enabled || unit >= STATE_CACHE_TEXTURE_UNITS || target_index < 0 || _textures[ unit ][ target_index ] != iTextures[ unit_it ] )
+    {
+      first_changed = ( unit_it < first_changed ) ? unit_it : first_changed;
+      last_changed  = unit_it;
+    }
+  }
+
+  if( first_changed == iCount )
+  {
+    _skipped_calls += iCount;
+    return;
+  }
+
+  unsigned int changed_count = last_changed - first_changed + 1;
+  _skipped_calls += iCount - changed_count;
+
+  // One call for the whole range with multi-bind, the active unit is left as is
+  if( GLEW_ARB_multi_bind )
+  {
+    _issued_calls++;
+    glBindTextures( iFirstUnit + first_changed, changed_count, &iTextures[ first_changed ] );
+
+    for( unsigned int unit_it = first_changed; unit_it <= last_changed; unit_it++ )
+    {
+      unsigned int unit = iFirstUnit + unit_it;
+      if( unit >= STATE_CACHE_TEXTURE_UNITS || target_index < 0 )
+      {
+        continue;
+      }
+
+      // A zero name unbinds every target of the unit
+      for( unsigned int target_it = 0; target_it < STATE_CACHE_TEXTURE_TARGETS; target_it++ )
+      {
+        if( iTextures[ unit_it ] == 0 || ( int )target_it == target_index )
+        {
+          _textures[ unit ][ target_it ] = iTextures[ unit_it ];
+        }
+      }
+    }
+    return;
+  }
+
+  for( unsigned int unit_it = first_changed; unit_it <= last_changed; unit_it++ )
+  {
+    ActiveTexture( GL_TEXTURE0 + iFirstUnit + unit_it );
+    BindTexture( iTarget, iTextures[ unit_it ] );
+  }
+}
+
+void StateCache::BindFramebuffer( GLenum       iTarget,
+                                  unsigned int iFBO )
+{
+  if( iTarget == GL_DRAW_FRAMEBUFFER )
+  {
+    if( !Redundant( &_draw_FBO, iFBO ) )
+    {
+      glBindFramebuffer( iTarget, iFBO );
+    }
+    return;
+  }
+
+  if( iTarget == GL_READ_FRAMEBUFFER )
+  {
+    if( !Redundant( &_read_FBO, iFBO ) )
+    {
+      glBindFramebuffer( iTarget, iFBO );
+    }
+    return;
+  }
+
+  // Both targets at once
+  if( _enabled && _draw_FBO == iFBO && _read_FBO == iFBO )
+  {
+    _skipped_calls++;
+    return;
+  }
+
+  _issued_calls++;
+  _draw_FBO = iFBO;
+  _read_FBO = iFBO;
+  glBindFramebuffer( iTarget, iFBO );
+}
+
+void StateCache::Enable( GLenum iCapability )
+{
+  int capability_index = CapabilityIndex( iCapability );
+  if( capability_index < 0 )
+  {
+    _issued_calls++;
+    glEnable( iCapability );
+    return;
+  }
+
+  if( !Redundant( &_capabilities[ capability_index ], GL_TRUE ) )
+  {
+    glEnable( iCapability );
+  }
+}
+
+void StateCache::Disable( GLenum iCapability )
+{
+  int capability_index = CapabilityIndex( iCapability );
+  if( capability_index < 0 )
+  {
+    _issued_calls++;
+    glDisable( iCapability );
+    return;
+  }
+
+  if( !Redundant( &_capabilities[ capability_index ], GL_FALSE ) )
+  {
+    glDisable( iCapability );
+  }
+}
+
+void StateCache::CullFace( GLenum iMode )
+{
+  if( !Redundant( &_cull_face, iMode ) )
+  {
+    glCullFace( iMode );
+  }
+}
+
+void StateCache::DepthFunc( GLenum iFunction )
+{
+  if( !Redundant( &_depth_function, iFunction ) )
+  {
+    glDepthFunc( iFunction );
+  }
+}
+
+void StateCache::DepthMask( GLboolean iFlag )
+{
+  if( !Redundant( &_depth_mask, iFlag ) )
+  {
+    glDepthMask( iFlag );
+  }
+}
+
+void StateCache::BlendFunc( GLenum iSourceFactor,
+                            GLenum iDestinationFactor )
+{
+  // Both factors enums fit in 16 bits
+  if( !Redundant( &_blend_factors, ( iSourceFactor << 16 ) | iDestinationFactor ) )
+  {
+    glBlendFunc( iSourceFactor, iDestinationFactor );
+  }
+}
+
+void StateCache::DeleteProgram( unsigned int iProgram )
+{
+  // A deleted program stays current until another one is bound, its name isn't trusted anymore
+  if( _program == iProgram )
+  {
+    _program = STATE_CACHE_UNKNOWN;
+  }
+
+  glDeleteProgram( iProgram );
+}
+
+void StateCache::DeleteVertexArrays( int                  iCount,
+                                     const unsigned int * iVAOs )
+{
+  // Deleting a bound object reverts its binding to 0
+  for( int VAO_it = 0; VAO_it < iCount; VAO_it++ )
+  {
+    _VAO = ( _VAO == iVAOs[ VAO_it ] ) ? 0 : _VAO;
+  }
+
+  glDeleteVertexArrays( iCount, iVAOs );
+}
+
+void StateCache::DeleteTextures( int                  iCount,
+                                 const unsigned int * iTextures )
+{
+  for( int texture_it = 0; texture_it < iCount; texture_it++ )
+  {
+    for( unsigned int unit_it = 0; unit_it < STATE_CACHE_TEXTURE_UNITS; unit_it++ )
+    {
+      for( unsigned int target_it = 0; target_it < STATE_CACHE_TEXTURE_TARGETS; target_it++ )
+      {
+        if( _textures[ unit_it ][ target_it ] == iTextures[ texture_it ] )
+        {
+          _textures[ unit_it ][ target_it ] = 0;
+        }
+      }
+    }
+  }
+
+  glDeleteTextures( iCount, iTextures );
+}
+
+void StateCache::DeleteFramebuffers( int                  iCount,
+                                     const unsigned int * iFBOs )
+{
+  for( int FBO_it = 0; FBO_it < iCount; FBO_it++ )
+  {
+    _draw_FBO = ( _draw_FBO == iFBOs[ FBO_it ] ) ? 0 : _draw_FBO;
+    _read_FBO = ( _read_FBO == iFBOs[ FBO_it ] ) ? 0 : _read_FBO;
+  }
+
+  glDeleteFramebuffers( iCount, iFBOs );
+}
+
+void StateCache::Invalidate()
+{
+  // Nothing known, next calls are all issued
+  _program        = STATE_CACHE_UNKNOWN;
+  _VAO            = STATE_CACHE_UNKNOWN;
+  _active_unit    = STATE_CACHE_UNKNOWN;
+  _draw_FBO       = STATE_CACHE_UNKNOWN;
+  _read_FBO       = STATE_CACHE_UNKNOWN;
+  _cull_face      = STATE_CACHE_UNKNOWN;
+  _depth_function = STATE_CACHE_UNKNOWN;
+  _depth_mask     = STATE_CACHE_UNKNOWN;
+  _blend_factors  = STATE_CACHE_UNKNOWN;
+
+  for( unsigned int capability_it = 0; capability_it < 4; capability_it++ )
+  {
+    _capabilities[ capability_it ] = STATE_CACHE_UNKNOWN;
+  }
+
+  for( unsigned int unit_it = 0; unit_it < STATE_CACHE_TEXTURE_UNITS; unit_it++ )
+  {
+    for( unsigned int target_it = 0; target_it < STATE_CACHE_TEXTURE_TARGETS; target_it++ )
+    {
+      _textures[ unit_it ][ target_it ] = STATE_CACHE_UNKNOWN;
+    }
+  }
+}
+
+void StateCache::FrameEnd()
+{
+  _frame_issued_calls  = _issued_calls;
+  _frame_skipped_calls = _skipped_calls;
+  _issued_calls        = 0;
+  _skipped_calls       = 0;
+}
+
+bool StateCache::Redundant( unsigned int * ioCached,
+                            unsigned int   iValue )
+{
+  if( _enabled && *ioCached == iValue )
+  {
+    _skipped_calls++;
+    return true;
+  }
+
+  *ioCached = iValue;
+  _issued_calls++;
+  return false;
+}
+
+int StateCache::TargetIndex( GLenum iTarget )
+{
+  switch( iTarget )
+  {
+    case GL_TEXTURE_2D :             return 0;
+    case GL_TEXTURE_CUBE_MAP :       return 1;
+    case GL_TEXTURE_2D_MULTISAMPLE : return 2;
+    case GL_TEXTURE_2D_ARRAY :       return 3;
+    case GL_TEXTURE_CUBE_MAP_ARRAY : return 4;
+    case GL_TEXTURE_3D :             return 5;
+  }
+
+  return -1;
+}
+
+int StateCache::CapabilityIndex( GLenum iCapability )
+{
+  switch( iCapability )
+  {
+    case GL_BLEND :        return 0;
+    case GL_DEPTH_TEST :   return 1;
+    case GL_CULL_FACE :    return 2;
+    case GL_STENCIL_TEST : return 3;
+  }
+
+  return -1;
+}
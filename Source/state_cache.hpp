@@ -0,0 +1,114 @@
+#ifndef STATE_CACHE_H
+#define STATE_CACHE_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+using namespace std;
+
+// Tracked texture units and targets, other units or targets always reach the driver
+#define STATE_CACHE_TEXTURE_UNITS   16
+#define STATE_CACHE_TEXTURE_TARGETS 6
+
+// Not known yet, the next call is always issued
+#define STATE_CACHE_UNKNOWN 0xFFFFFFFF
+
+
+//******************************************************************************
+//**********  Class StateCache  ************************************************
+//******************************************************************************
+
+// Last values sent to the driver, the calls repeating them are dropped. Every bind and
+// fixed function state change of the renderer has to go through it to keep it exact.
+class StateCache
+{
+
+  public:
+
+
+    // StateCache functions
+    // --------------------
+
+    static void UseProgram( unsigned int iProgram );
+
+    static void BindVertexArray( unsigned int iVAO );
+
+    static void ActiveTexture( GLenum iUnit );
+
+    static void BindTexture( GLenum       iTarget,
+                             unsigned int iTexture );
+
+    static void BindTextures( unsigned int         iFirstUnit,
+                              unsigned int         iCount,
+                              const unsigned int * iTextures,
+                              GLenum               iTarget );
+
+    static void BindFramebuffer( GLenum       iTarget,
+                                 unsigned int iFBO );
+
+    static void Enable( GLenum iCapability );
+
+    static void Disable( GLenum iCapability );
+
+    static void CullFace( GLenum iMode );
+
+    static void DepthFunc( GLenum iFunction );
+
+    static void DepthMask( GLboolean iFlag );
+
+    static void BlendFunc( GLenum iSourceFactor,
+                           GLenum iDestinationFactor );
+
+    static void DeleteProgram( unsigned int iProgram );
+
+    static void DeleteVertexArrays( int                  iCount,
+                                    const unsigned int * iVAOs );
+
+    static void DeleteTextures( int                  iCount,
+                                const unsigned int * iTextures );
+
+    static void DeleteFramebuffers( int                  iCount,
+                                    const unsigned int * iFBOs );
+
+    static void Invalidate();
+
+    static void FrameEnd();
+
+
+    // StateCache class members
+    // ------------------------
+
+    // Off, every call is issued but the tracked state stays exact for when it is switched back on
+    static bool _enabled;
+
+    // Current frame counters, copied to the last frame ones by FrameEnd
+    static unsigned int _issued_calls;
+    static unsigned int _skipped_calls;
+    static unsigned int _frame_issued_calls;
+    static unsigned int _frame_skipped_calls;
+
+
+  private:
+
+    static bool Redundant( unsigned int * ioCached,
+                           unsigned int   iValue );
+
+    static int TargetIndex( GLenum iTarget );
+
+    static int CapabilityIndex( GLenum iCapability );
+
+    static unsigned int _program;
+    static unsigned int _VAO;
+    static unsigned int _active_unit;
+    static unsigned int _textures[ STATE_CACHE_TEXTURE_UNITS ][ STATE_CACHE_TEXTURE_TARGETS ];
+    static unsigned int _draw_FBO;
+    static unsigned int _read_FBO;
+    static unsigned int _capabilities[ 4 ];
+    static unsigned int _cull_face;
+    static unsigned int _depth_function;
+    static unsigned int _depth_mask;
+    static unsigned int _blend_factors;
+
+};
+
+#endif  // STATE_CACHE_H
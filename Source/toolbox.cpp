@@ -18,11 +18,42 @@ Toolbox::Toolbox( Window * iParentWindow )
 
   _hdr_image_manager = new HDRManager();  
 
+  // Chosen once, after glew init, the bind to edit path stays for older drivers
+  _direct_state_access = ( GLEW_VERSION_4_5 || GLEW_ARB_direct_state_access );
+  fprintf( stderr, "Direct state access : %s\n", _direct_state_access ? "on" : "off" );
+
   _quad_VAO     = 0;
   _quad_VBO     = 0;
 
   _cube_VAO     = 0;
   _cube_VBO     = 0;
+
+  // Shadow moments targets are created when their filtering mode is first used
+  _shadow_moments_FBO = 0;
+
+  // Post process targets are created when their feature is enabled
+  _bloom_FBO = 0;
+  for( unsigned int i = 0; i < BLOOM_MIP_COUNT; i++ )
+  {
+    _bloom_mips[ i ] = 0;
+  }
+  _post_process_FBO    = 0;
+  _post_process_output = 0;
+  _upscale_FBO         = 0;
+  _upscale_output      = 0;
+  for( unsigned int i = 0; i < 2; i++ )
+  {
+    _taa_FBO[ i ]     = 0;
+    _taa_history[ i ] = 0;
+  }
+  _motion_vectors_FBO     = 0;
+  _motion_vectors_texture = 0;
+  _temp_depth_texture     = 0;
+
+  // Window sized targets come from the frame graph pool, built before the first frame
+  _render_graph          = new RenderGraph( _direct_state_access );
+  _temp_hdr_FBO          = 0;
+  _temp_tex_color_buffer = 0;
 }
 
 void Toolbox::Quit()
@@ -30,9 +61,9 @@ void Toolbox::Quit()
   // Delete VAOs
   // -----------
   if( _quad_VAO )
-    glDeleteVertexArrays( 1, &_quad_VAO );
+    StateCache::DeleteVertexArrays( 1, &_quad_VAO );
   if( _cube_VAO )
-    glDeleteVertexArrays( 1, &_cube_VAO );  
+    StateCache::DeleteVertexArrays( 1, &_cube_VAO );  
  
 
   // Delete VBOs
@@ -42,8 +73,18 @@ void Toolbox::Quit()
   if( _cube_VBO )
     glDeleteBuffers( 1, &_cube_VBO );
  
-  if( _pingpong_FBO )
-    glDeleteFramebuffers( 1, &_pingpong_FBO );
+  if( _bloom_FBO )
+    StateCache::DeleteFramebuffers( 1, &_bloom_FBO );
+  if( _post_process_FBO )
+    StateCache::DeleteFramebuffers( 1, &_post_process_FBO );
+  if( _upscale_FBO )
+    StateCache::DeleteFramebuffers( 1, &_upscale_FBO );
+  if( _taa_FBO[ 0 ] )
+    StateCache::DeleteFramebuffers( 2, _taa_FBO );
+  if( _motion_vectors_FBO )
+    StateCache::DeleteFramebuffers( 1, &_motion_vectors_FBO );
+
+  _render_graph->Release();
 }
 
 void Toolbox::PrintFPS()
@@ -65,15 +106,40 @@ unsigned int Toolbox::LoadCubeMap( std::vector< const GLchar * > iPaths )
   unsigned int textureID;
   SDL_Surface * t = NULL;
 
+  if( _direct_state_access )
+  {
+    // Faces share the first one size, one immutable level filled face by face
+    glCreateTextures( GL_TEXTURE_CUBE_MAP, 1, &textureID );
+    for( unsigned int i = 0; i < iPaths.size(); i++ )
+    {
+      t = IMG_Load( iPaths[ i ] );
+      if( i == 0 )
+      {
+        glTextureStorage2D( textureID, 1, GL_RGB8, t->w, t->h );
+      }
+      glTextureSubImage3D( textureID, 0, 0, 0, i, t->w, t->h, 1, GL_RGB, GL_UNSIGNED_BYTE, t->pixels );
+      SDL_FreeSurface( t );
+    }
+
+    glTextureParameteri( textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+    glTextureParameteri( textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+    glTextureParameteri( textureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+    glTextureParameteri( textureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+    glTextureParameteri( textureID, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE );
+
+    return textureID;
+  }
+
   glGenTextures( 1, &textureID );
-  glActiveTexture( GL_TEXTURE0 );
+  StateCache::ActiveTexture( GL_TEXTURE0 );
 
-  glBindTexture( GL_TEXTURE_CUBE_MAP, textureID );
+  StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, textureID );
 
   for( unsigned int i = 0; i < iPaths.size(); i++ )
   {
     t = IMG_Load( iPaths[ i ] );
     glTexImage2D( GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, t->w, t->h, 0, GL_RGB, GL_UNSIGNED_BYTE, t->pixels );
+    SDL_FreeSurface( t );
   }
 
   glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
@@ -81,7 +147,7 @@ unsigned int Toolbox::LoadCubeMap( std::vector< const GLchar * > iPaths )
   glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
   glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
   glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE );
-  glBindTexture( GL_TEXTURE_CUBE_MAP, 0 );
+  StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, 0 );
 
   return textureID;
 }
@@ -228,19 +294,13 @@ void Toolbox::RenderQuad()
     };
 
     // Setup plane VAO
-    glGenVertexArrays( 1, &_quad_VAO );
-    glGenBuffers( 1, &_quad_VBO );
-    glBindVertexArray( _quad_VAO );
-    glBindBuffer( GL_ARRAY_BUFFER, _quad_VBO );
-    glBufferData( GL_ARRAY_BUFFER, sizeof( quad_vertices ), &quad_vertices, GL_STATIC_DRAW );
-    glEnableVertexAttribArray( 0 );
-    glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof( GLfloat ), ( GLvoid* )0 );
-    glEnableVertexAttribArray( 1 );
-    glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof( GLfloat ), ( GLvoid* )( 3 * sizeof( GLfloat ) ) );
+    const int quad_attributes[ 2 ] = { 3, 2 };
+    _quad_VBO = CreateStaticBuffer( sizeof( quad_vertices ), quad_vertices );
+    _quad_VAO = CreateStaticVAO( _quad_VBO, 0, 2, quad_attributes );
   }
-  glBindVertexArray( _quad_VAO );
+  StateCache::BindVertexArray( _quad_VAO );
   glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
-  glBindVertexArray( 0 );
+  StateCache::BindVertexArray( 0 );
 }
 
 void Toolbox::RenderCube()
@@ -301,40 +361,30 @@ void Toolbox::RenderCube()
       -1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f  // bottom-left        
     };
 
-    glGenVertexArrays( 1, &_cube_VAO );
-    glGenBuffers( 1, &_cube_VBO );
-    glBindBuffer( GL_ARRAY_BUFFER, _cube_VBO );
-    glBufferData( GL_ARRAY_BUFFER, sizeof( vertices ), vertices, GL_STATIC_DRAW );
-    glBindVertexArray( _cube_VAO );
-    glEnableVertexAttribArray( 0 );
-    glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof( GLfloat ), ( GLvoid* )0 );
-    glEnableVertexAttribArray( 1 );
-    glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof( GLfloat ), ( GLvoid* )( 3 * sizeof( GLfloat ) ) );
-    glEnableVertexAttribArray( 2 );
-    glVertexAttribPointer( 2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof( GLfloat ), ( GLvoid* )( 6 * sizeof( GLfloat ) ) );
-    glBindBuffer( GL_ARRAY_BUFFER, 0 );
-    glBindVertexArray( 0 );
+    const int cube_attributes[ 3 ] = { 3, 3, 2 };
+    _cube_VBO = CreateStaticBuffer( sizeof( vertices ), vertices );
+    _cube_VAO = CreateStaticVAO( _cube_VBO, 0, 3, cube_attributes );
   }
 
   // Render Cube
   // -----------
-  glBindVertexArray( _cube_VAO );
+  StateCache::BindVertexArray( _cube_VAO );
   glDrawArrays( GL_TRIANGLES, 0, 36 );
-  glBindVertexArray( 0 );
+  StateCache::BindVertexArray( 0 );
 }
 
 void Toolbox::RenderObserver()
 {
   // Set GL buffer 0
-  glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
   glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
   // Draw observer
   glViewport( 0, 0, _window->_width, _window->_height );
   _window->_scene->_observer_shader.Use();
-  glActiveTexture( GL_TEXTURE0 );
-  //glBindTexture( GL_TEXTURE_2D, _window->_scene->_g_buffer_textures[ 5 ] );
-  glBindTexture( GL_TEXTURE_2D, _temp_tex_color_buffer[ 0 ] );
+  StateCache::ActiveTexture( GL_TEXTURE0 );
+  //glBindTexture( GL_TEXTURE_2D, _window->_scene->_g_buffer_textures[ 4 ] );
+  StateCache::BindTexture( GL_TEXTURE_2D, _temp_tex_color_buffer );
   //glBindTexture( GL_TEXTURE_2D_MULTISAMPLE, temp_tex_color_buffer[ 1 ] /*final_tex_color_buffer[0]*/ /*pingpongColorbuffers[0]*/ /*tex_depth_ssr*/ );
   //glBindTexture( GL_TEXTURE_2D, _window->_scene->_pre_brdf_texture );
   
@@ -342,8 +392,108 @@ void Toolbox::RenderObserver()
   glUniform1f( glGetUniformLocation( _window->_scene->_observer_shader._program, "uCameraFar" ), _window->_scene->_camera->_far );
 
   RenderQuad();
-  glBindVertexArray( 0 );
-  glUseProgram( 0 );
+  StateCache::BindVertexArray( 0 );
+  StateCache::UseProgram( 0 );
+}
+
+int Toolbox::SizedInternalFormat( int iInternalFormat )
+{
+  // Immutable storage only takes sized formats, 8 bits per channel like the unsized uploads
+  switch( iInternalFormat )
+  {
+    case GL_RED :  return GL_R8;
+    case GL_RG :   return GL_RG8;
+    case GL_RGB :  return GL_RGB8;
+    case GL_RGBA : return GL_RGBA8;
+  }
+
+  return iInternalFormat;
+}
+
+int Toolbox::MipLevelCount( int iWidth,
+                            int iHeight )
+{
+  return ( int )floor( log2( ( float )std::max( iWidth, iHeight ) ) ) + 1;
+}
+
+unsigned int Toolbox::CreateStaticBuffer( GLsizeiptr   iSize,
+                                          const void * iData )
+{
+  unsigned int result_id;
+
+  if( _direct_state_access )
+  {
+    // No storage flags, the data can't be changed afterwards
+    glCreateBuffers( 1, &result_id );
+    glNamedBufferStorage( result_id, iSize, iData, 0 );
+    return result_id;
+  }
+
+  // Filled through the array target whatever its use, the element one belongs to the bound VAO
+  glGenBuffers( 1, &result_id );
+  glBindBuffer( GL_ARRAY_BUFFER, result_id );
+  glBufferData( GL_ARRAY_BUFFER, iSize, iData, GL_STATIC_DRAW );
+  glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+  return result_id;
+}
+
+unsigned int Toolbox::CreateStaticVAO( unsigned int iVBO,
+                                       unsigned int iIBO,
+                                       unsigned int iAttributeCount,
+                                       const int *  iAttributeSizes )
+{
+  unsigned int result_id;
+
+  // Interleaved float attributes, locations in the given order
+  int stride = 0;
+  for( unsigned int attribute_it = 0; attribute_it < iAttributeCount; attribute_it++ )
+  {
+    stride += iAttributeSizes[ attribute_it ] * sizeof( GLfloat );
+  }
+
+  if( _direct_state_access )
+  {
+    glCreateVertexArrays( 1, &result_id );
+    glVertexArrayVertexBuffer( result_id, 0, iVBO, 0, stride );
+    if( iIBO != 0 )
+    {
+      glVertexArrayElementBuffer( result_id, iIBO );
+    }
+
+    unsigned int offset = 0;
+    for( unsigned int attribute_it = 0; attribute_it < iAttributeCount; attribute_it++ )
+    {
+      glEnableVertexArrayAttrib( result_id, attribute_it );
+      glVertexArrayAttribFormat( result_id, attribute_it, iAttributeSizes[ attribute_it ], GL_FLOAT, GL_FALSE, offset );
+      glVertexArrayAttribBinding( result_id, attribute_it, 0 );
+      offset += iAttributeSizes[ attribute_it ] * sizeof( GLfloat );
+    }
+
+    return result_id;
+  }
+
+  glGenVertexArrays( 1, &result_id );
+  StateCache::BindVertexArray( result_id );
+
+  glBindBuffer( GL_ARRAY_BUFFER, iVBO );
+  if( iIBO != 0 )
+  {
+    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, iIBO );
+  }
+
+  unsigned int offset = 0;
+  for( unsigned int attribute_it = 0; attribute_it < iAttributeCount; attribute_it++ )
+  {
+    glEnableVertexAttribArray( attribute_it );
+    glVertexAttribPointer( attribute_it, iAttributeSizes[ attribute_it ], GL_FLOAT, GL_FALSE, stride, ( GLvoid* )( size_t )offset );
+    offset += iAttributeSizes[ attribute_it ] * sizeof( GLfloat );
+  }
+
+  StateCache::BindVertexArray( 0 );
+  glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+  return result_id;
 }
 
 unsigned int Toolbox::CreateTextureFromData( SDL_Surface * iImage,
@@ -355,8 +505,32 @@ unsigned int Toolbox::CreateTextureFromData( SDL_Surface * iImage,
 {
   unsigned int result_id;
 
+  if( _direct_state_access )
+  {
+    glCreateTextures( GL_TEXTURE_2D, 1, &result_id );
+    glTextureStorage2D( result_id, ( iMipmap == true ) ? MipLevelCount( iImage->w, iImage->h ) : 1, SizedInternalFormat( iInternalFormat ), iImage->w, iImage->h );
+    glTextureSubImage2D( result_id, 0, 0, 0, iImage->w, iImage->h, iFormat, GL_UNSIGNED_BYTE, iImage->pixels );
+
+    glTextureParameterf( result_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+    glTextureParameterf( result_id, GL_TEXTURE_MIN_FILTER, ( iMipmap == true ) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR );
+    glTextureParameterf( result_id, GL_TEXTURE_WRAP_S, GL_REPEAT );
+    glTextureParameterf( result_id, GL_TEXTURE_WRAP_T, GL_REPEAT );
+
+    if( iAnisotropy )
+    {
+      glTextureParameterf( result_id, GL_TEXTURE_MAX_ANISOTROPY_EXT, iAnisotropyValue );
+    }
+
+    if( iMipmap )
+    {
+      glGenerateTextureMipmap( result_id );
+    }
+
+    return result_id;
+  }
+
   glGenTextures( 1, &result_id );
-  glBindTexture( GL_TEXTURE_2D, result_id );
+  StateCache::BindTexture( GL_TEXTURE_2D, result_id );
 
   glTexImage2D( GL_TEXTURE_2D, 0, iInternalFormat, iImage->w, iImage->h, 0, iFormat, GL_UNSIGNED_BYTE, iImage->pixels );
 
@@ -375,7 +549,7 @@ unsigned int Toolbox::CreateTextureFromData( SDL_Surface * iImage,
     glGenerateMipmap( GL_TEXTURE_2D );
   }
 
-  glBindTexture( GL_TEXTURE_2D, 0 );
+  StateCache::BindTexture( GL_TEXTURE_2D, 0 );
 
   return result_id;
 }
@@ -390,8 +564,27 @@ unsigned int Toolbox::CreateEmptyTexture( int   iWidth,
 {
   unsigned int result_id;
 
+  if( _direct_state_access )
+  {
+    // Filled by rendering, storage only
+    glCreateTextures( GL_TEXTURE_2D, 1, &result_id );
+    glTextureStorage2D( result_id, ( iMipmap == true ) ? MipLevelCount( iWidth, iHeight ) : 1, SizedInternalFormat( iInternalFormat ), iWidth, iHeight );
+
+    glTextureParameteri( result_id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+    glTextureParameteri( result_id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+    glTextureParameterf( result_id, GL_TEXTURE_MIN_FILTER, ( iMipmap == true ) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR );
+    glTextureParameteri( result_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+
+    if( iAnisotropy )
+    {
+      glTextureParameterf( result_id, GL_TEXTURE_MAX_ANISOTROPY_EXT, iAnisotropyValue );
+    }
+
+    return result_id;
+  }
+
   glGenTextures( 1, &result_id );
-  glBindTexture( GL_TEXTURE_2D, result_id );
+  StateCache::BindTexture( GL_TEXTURE_2D, result_id );
 
   glTexImage2D( GL_TEXTURE_2D, 0, iInternalFormat, iWidth, iHeight, 0, iFormat, GL_FLOAT, 0 );
 
@@ -410,7 +603,7 @@ unsigned int Toolbox::CreateEmptyTexture( int   iWidth,
     glGenerateMipmap( GL_TEXTURE_2D );
   }
 
-  glBindTexture( GL_TEXTURE_2D, 0 );
+  StateCache::BindTexture( GL_TEXTURE_2D, 0 );
 
   return result_id;
 }
@@ -420,8 +613,23 @@ unsigned int Toolbox::CreateCubeMapTexture( int  iResolution,
 {
   unsigned int result_id;
 
+  if( _direct_state_access )
+  {
+    // All faces and levels allocated at once, the mips are rendered into afterwards
+    glCreateTextures( GL_TEXTURE_CUBE_MAP, 1, &result_id );
+    glTextureStorage2D( result_id, ( iMipmap == true ) ? MipLevelCount( iResolution, iResolution ) : 1, GL_RGB16F, iResolution, iResolution );
+
+    glTextureParameteri( result_id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+    glTextureParameteri( result_id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+    glTextureParameteri( result_id, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE );
+    glTextureParameteri( result_id, GL_TEXTURE_MIN_FILTER, ( iMipmap == true ) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR );
+    glTextureParameteri( result_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+
+    return result_id;
+  }
+
   glGenTextures( 1, &result_id );
-  glBindTexture( GL_TEXTURE_CUBE_MAP, result_id );
+  StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, result_id );
 
   for( unsigned int i = 0; i < 6; ++i )
   {
@@ -456,7 +664,7 @@ void Toolbox::SetFboTexture( unsigned int iTextureID,
                              int          iHeight,
                              GLenum       iAttachment )
 {
-  glBindTexture( GL_TEXTURE_2D, iTextureID );
+  StateCache::BindTexture( GL_TEXTURE_2D, iTextureID );
   glTexImage2D( GL_TEXTURE_2D, 0, iFormat, iWidth, iHeight, 0, GL_RGB, GL_FLOAT, NULL );
   glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
   glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
@@ -472,7 +680,7 @@ void Toolbox::SetFboMultiSampleTexture( unsigned int iTextureID,
                                         int          iHeight,
                                         GLenum       iAttachment )
 {
-  glBindTexture( GL_TEXTURE_2D_MULTISAMPLE, iTextureID );
+  StateCache::BindTexture( GL_TEXTURE_2D_MULTISAMPLE, iTextureID );
   glTexImage2DMultisample( GL_TEXTURE_2D_MULTISAMPLE, iSampleCount ,iFormat, iWidth, iHeight, GL_TRUE );
   glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
   glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
@@ -481,26 +689,27 @@ void Toolbox::SetFboMultiSampleTexture( unsigned int iTextureID,
   glFramebufferTexture2D( GL_FRAMEBUFFER, iAttachment, GL_TEXTURE_2D_MULTISAMPLE, iTextureID, 0 );
 }
 
-void Toolbox::LinkRbo( unsigned int iRboID,
-                       int iWidth,
-                       int iHeight )
+void Toolbox::LinkRbo( unsigned int * ioRboID,
+                       int            iWidth,
+                       int            iHeight )
 {
-  glGenRenderbuffers( 1, &iRboID );
-  glBindRenderbuffer( GL_RENDERBUFFER, iRboID );
+  // Name handed back to the caller, it is the one deleting it
+  glGenRenderbuffers( 1, ioRboID );
+  glBindRenderbuffer( GL_RENDERBUFFER, *ioRboID );
   glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT, iWidth, iHeight );
-  glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, iRboID );
+  glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, *ioRboID );
   glBindRenderbuffer( GL_RENDERBUFFER, 0 );    
 }
 
-void Toolbox::LinkMultiSampleRbo( unsigned int iRboID,
-                                  int          iSampleCount, 
-                                  int          iWidth,
-                                  int          iHeight )
+void Toolbox::LinkMultiSampleRbo( unsigned int * ioRboID,
+                                  int            iSampleCount, 
+                                  int            iWidth,
+                                  int            iHeight )
 {
-  glGenRenderbuffers( 1, &iRboID );
-  glBindRenderbuffer( GL_RENDERBUFFER, iRboID );
+  glGenRenderbuffers( 1, ioRboID );
+  glBindRenderbuffer( GL_RENDERBUFFER, *ioRboID );
   glRenderbufferStorageMultisample( GL_RENDERBUFFER, iSampleCount, GL_DEPTH24_STENCIL8, iWidth, iHeight ); 
-  glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, iRboID );
+  glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, *ioRboID );
   glBindRenderbuffer( GL_RENDERBUFFER, 0 );
 }
 
@@ -534,6 +743,8 @@ glm::mat4 Toolbox::AssimpMatrixToGlmMatrix( const aiMatrix4x4 * iAssimpMatrix )
 void Toolbox::CreatePlaneVAO( unsigned int *                iVAO,
                               unsigned int *                iVBO,
                               unsigned int *                iIBO,
+                              unsigned int *                iDepthVAO,
+                              unsigned int *                iDepthVBO,
                               std::vector< unsigned int > * iIndices,
                               unsigned int                  iSideVerticeCount,
                               float                         iUvScale )
@@ -543,6 +754,7 @@ void Toolbox::CreatePlaneVAO( unsigned int *                iVAO,
   float width_size          = 1.0;
   float height_size         = 1.0;
   std::vector< float > plane_vertices;
+  std::vector< float > plane_positions;
 
   // Create plane vertices
   for( unsigned int width_it = 0; width_it < width_count; width_it ++ )
@@ -556,6 +768,9 @@ void Toolbox::CreatePlaneVAO( unsigned int *                iVAO,
       plane_vertices.push_back( pos_x );
       plane_vertices.push_back( pos_y );
       plane_vertices.push_back( pos_z );
+      plane_positions.push_back( pos_x );
+      plane_positions.push_back( pos_y );
+      plane_positions.push_back( pos_z );
 
       // normal
       plane_vertices.push_back( 0.0f );
@@ -599,29 +814,194 @@ void Toolbox::CreatePlaneVAO( unsigned int *                iVAO,
   }
 
   // Setup plane VAO & IBO
-  glGenVertexArrays( 1, iVAO );
-  glBindVertexArray( *iVAO );
-
-  glGenBuffers( 1, iVBO );
-  glBindBuffer( GL_ARRAY_BUFFER, *iVBO );
-  glBufferData( GL_ARRAY_BUFFER, plane_vertices.size() * sizeof( GLfloat ), plane_vertices.data(), GL_STATIC_DRAW );
-
-  glGenBuffers( 1, iIBO );
-  glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, *iIBO );
-  glBufferData( GL_ELEMENT_ARRAY_BUFFER, iIndices->size() * sizeof( unsigned int ), iIndices->data(), GL_STATIC_DRAW );
-
-  glEnableVertexAttribArray( 0 );
-  glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, 14 * sizeof( GLfloat ), ( GLvoid* )0 );
-  glEnableVertexAttribArray( 1 );
-  glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, 14 * sizeof( GLfloat ), ( GLvoid* )( 3 * sizeof( GLfloat ) ) );
-  glEnableVertexAttribArray( 2 );
-  glVertexAttribPointer( 2, 2, GL_FLOAT, GL_FALSE, 14 * sizeof( GLfloat ), ( GLvoid* )( 6 * sizeof( GLfloat ) ) );
-  glEnableVertexAttribArray( 3 );
-  glVertexAttribPointer( 3, 3, GL_FLOAT, GL_FALSE, 14 * sizeof( GLfloat ), ( GLvoid* )( 8 * sizeof( GLfloat ) ) );
-  glEnableVertexAttribArray( 4 );
-  glVertexAttribPointer( 4, 3, GL_FLOAT, GL_FALSE, 14 * sizeof( GLfloat ), ( GLvoid* )( 11 * sizeof( GLfloat ) ) );
-
-  glBindVertexArray( 0 );
+  const int plane_attributes[ 5 ] = { 3, 3, 2, 3, 3 };
+  *iVBO = CreateStaticBuffer( plane_vertices.size() * sizeof( GLfloat ), plane_vertices.data() );
+  *iIBO = CreateStaticBuffer( iIndices->size() * sizeof( unsigned int ), iIndices->data() );
+  *iVAO = CreateStaticVAO( *iVBO, *iIBO, 5, plane_attributes );
+
+  // Setup position only VAO for depth passes, sharing the IBO
+  if( iDepthVAO != NULL )
+  {
+    const int depth_attributes[ 1 ] = { 3 };
+    *iDepthVBO = CreateStaticBuffer( plane_positions.size() * sizeof( GLfloat ), plane_positions.data() );
+    *iDepthVAO = CreateStaticVAO( *iDepthVBO, *iIBO, 1, depth_attributes );
+  }
+}
+
+float Toolbox::SampleHeightMap( std::vector< float > * iTexels,
+                                glm::ivec2             iSize,
+                                float                  iU,
+                                float                  iV )
+{
+  // Bilinear filtering with the GL_REPEAT wrapping of the height textures
+  float x = iU * iSize.x - 0.5f;
+  float y = iV * iSize.y - 0.5f;
+  int x0  = ( int )floor( x );
+  int y0  = ( int )floor( y );
+  float fraction_x = x - x0;
+  float fraction_y = y - y0;
+
+  int x_it[ 2 ] = { ( ( x0 % iSize.x ) + iSize.x ) % iSize.x, ( ( ( x0 + 1 ) % iSize.x ) + iSize.x ) % iSize.x };
+  int y_it[ 2 ] = { ( ( y0 % iSize.y ) + iSize.y ) % iSize.y, ( ( ( y0 + 1 ) % iSize.y ) + iSize.y ) % iSize.y };
+
+  float top    = ( *iTexels )[ y_it[ 0 ] * iSize.x + x_it[ 0 ] ] * ( 1.0f - fraction_x ) + ( *iTexels )[ y_it[ 0 ] * iSize.x + x_it[ 1 ] ] * fraction_x;
+  float bottom = ( *iTexels )[ y_it[ 1 ] * iSize.x + x_it[ 0 ] ] * ( 1.0f - fraction_x ) + ( *iTexels )[ y_it[ 1 ] * iSize.x + x_it[ 1 ] ] * fraction_x;
+
+  return top * ( 1.0f - fraction_y ) + bottom * fraction_y;
+}
+
+void Toolbox::CreateDisplacedPlaneLODs( Object *     iPlane,
+                                        unsigned int iHeightTexture,
+                                        float        iUvScale )
+{
+  // Height map read back as uploaded, the evaluation shader samples this level
+  int width;
+  int height;
+  StateCache::BindTexture( GL_TEXTURE_2D, iHeightTexture );
+  glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width );
+  glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height );
+
+  std::vector< unsigned char > texels( width * height );
+  glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+  glGetTexImage( GL_TEXTURE_2D, 0, GL_RED, GL_UNSIGNED_BYTE, texels.data() );
+  glPixelStorei( GL_PACK_ALIGNMENT, 4 );
+  StateCache::BindTexture( GL_TEXTURE_2D, 0 );
+
+  // Box filtered mips, each LOD samples the level matching its vertex spacing
+  std::vector< std::vector< float > > mips( 1, std::vector< float >( width * height ) );
+  std::vector< glm::ivec2 > mips_size( 1, glm::ivec2( width, height ) );
+  for( int texel_it = 0; texel_it < width * height; texel_it++ )
+  {
+    mips[ 0 ][ texel_it ] = texels[ texel_it ] / 255.0f;
+  }
+
+  while( mips_size.back().x > 1 || mips_size.back().y > 1 )
+  {
+    unsigned int source_it  = mips.size() - 1;
+    glm::ivec2   source_size = mips_size[ source_it ];
+    glm::ivec2   size( std::max( source_size.x / 2, 1 ), std::max( source_size.y / 2, 1 ) );
+    std::vector< float > mip( size.x * size.y );
+
+    for( int y = 0; y < size.y; y++ )
+    {
+      for( int x = 0; x < size.x; x++ )
+      {
+        int x1 = std::min( x * 2 + 1, source_size.x - 1 );
+        int y1 = std::min( y * 2 + 1, source_size.y - 1 );
+        mip[ y * size.x + x ] = ( mips[ source_it ][ ( y * 2 ) * source_size.x + x * 2 ] + mips[ source_it ][ ( y * 2 ) * source_size.x + x1 ] +
+                                  mips[ source_it ][ y1 * source_size.x + x * 2 ]        + mips[ source_it ][ y1 * source_size.x + x1 ] ) * 0.25f;
+      }
+    }
+
+    mips.push_back( mip );
+    mips_size.push_back( size );
+  }
+
+  // Same world offset as the evaluation shader, which displaces along the normalized world normal
+  glm::vec3 world_normal = glm::mat3( iPlane->_model_matrix ) * glm::vec3( 0.0, -1.0, 0.0 );
+  float displacement     = -iPlane->_displacement_factor / glm::length( world_normal );
+
+  // Chunk borders follow the coarsest LOD border, neighbouring chunks match at any LOD pair
+  unsigned int seam_segments = DISPLACEMENT_LOD_CHUNKS * ( DISPLACEMENT_LOD0_SEGMENTS >> ( DISPLACEMENT_LOD_COUNT - 1 ) );
+  unsigned int seam_mip      = std::min( ( unsigned int )std::max( floor( log2( ( iUvScale * width ) / seam_segments ) ), 0.0f ), ( unsigned int )mips.size() - 1 );
+
+  for( unsigned int chunk_it = 0; chunk_it < DISPLACEMENT_LOD_CHUNKS * DISPLACEMENT_LOD_CHUNKS; chunk_it++ )
+  {
+    unsigned int chunk_x = chunk_it / DISPLACEMENT_LOD_CHUNKS;
+    unsigned int chunk_z = chunk_it % DISPLACEMENT_LOD_CHUNKS;
+
+    for( unsigned int lod_it = 0; lod_it < DISPLACEMENT_LOD_COUNT; lod_it++ )
+    {
+      unsigned int segments       = DISPLACEMENT_LOD0_SEGMENTS >> lod_it;
+      unsigned int plane_segments = DISPLACEMENT_LOD_CHUNKS * segments;
+      unsigned int seam_ratio     = plane_segments / seam_segments;
+      unsigned int mip            = std::min( ( unsigned int )std::max( floor( log2( ( iUvScale * width ) / plane_segments ) ), 0.0f ), ( unsigned int )mips.size() - 1 );
+
+      std::vector< float > vertices;
+      std::vector< unsigned int > indices;
+
+      // Same vertices layout and attributes as CreatePlaneVAO, only the position is displaced
+      for( unsigned int x_it = 0; x_it <= segments; x_it++ )
+      {
+        for( unsigned int z_it = 0; z_it <= segments; z_it++ )
+        {
+          unsigned int plane_x = chunk_x * segments + x_it;
+          unsigned int plane_z = chunk_z * segments + z_it;
+          float s = ( float )plane_x / plane_segments;
+          float t = ( float )plane_z / plane_segments;
+          float h;
+
+          if( x_it == 0 || x_it == segments || z_it == 0 || z_it == segments )
+          {
+            // Border vertex interpolated between the two coarsest border vertices around it
+            bool         along_z  = ( x_it == 0 || x_it == segments );
+            unsigned int seam_it  = ( along_z ? plane_z : plane_x ) / seam_ratio;
+            float        fraction = ( float )( ( along_z ? plane_z : plane_x ) % seam_ratio ) / seam_ratio;
+            float        fixed    = ( float )( ( along_z ? plane_x : plane_z ) / seam_ratio ) / seam_segments;
+            float        seam0    = ( float )seam_it / seam_segments;
+            float        seam1    = ( float )std::min( seam_it + 1, seam_segments ) / seam_segments;
+
+            float h0 = along_z ? SampleHeightMap( &mips[ seam_mip ], mips_size[ seam_mip ], fixed * iUvScale, seam0 * iUvScale ) : SampleHeightMap( &mips[ seam_mip ], mips_size[ seam_mip ], seam0 * iUvScale, fixed * iUvScale );
+            float h1 = along_z ? SampleHeightMap( &mips[ seam_mip ], mips_size[ seam_mip ], fixed * iUvScale, seam1 * iUvScale ) : SampleHeightMap( &mips[ seam_mip ], mips_size[ seam_mip ], seam1 * iUvScale, fixed * iUvScale );
+            h = h0 * ( 1.0f - fraction ) + h1 * fraction;
+          }
+          else
+          {
+            h = SampleHeightMap( &mips[ mip ], mips_size[ mip ], s * iUvScale, t * iUvScale );
+          }
+
+          // position
+          vertices.push_back( s );
+          vertices.push_back( -h * displacement );
+          vertices.push_back( t );
+
+          // normal
+          vertices.push_back( 0.0f );
+          vertices.push_back( -1.0f );
+          vertices.push_back( 0.0f );
+
+          // uv
+          vertices.push_back( s * iUvScale );
+          vertices.push_back( t * iUvScale );
+
+          // tangent
+          vertices.push_back( -1.0 );
+          vertices.push_back( 0.0 );
+          vertices.push_back( 0.0 );
+
+          // bitangent
+          vertices.push_back( 0.0 );
+          vertices.push_back( 0.0 );
+          vertices.push_back( -1.0 );
+        }
+      }
+
+      // Same winding as the tessellated patches
+      for( unsigned int x_it = 0; x_it < segments; x_it++ )
+      {
+        for( unsigned int z_it = 0; z_it < segments; z_it++ )
+        {
+          unsigned int vertex_index = x_it * ( segments + 1 ) + z_it;
+
+          indices.push_back( vertex_index );
+          indices.push_back( vertex_index + segments + 1 );
+          indices.push_back( vertex_index + segments + 2 );
+          indices.push_back( vertex_index );
+          indices.push_back( vertex_index + segments + 2 );
+          indices.push_back( vertex_index + 1 );
+        }
+      }
+
+      const int plane_attributes[ 5 ] = { 3, 3, 2, 3, 3 };
+      unsigned int VBO = CreateStaticBuffer( vertices.size() * sizeof( GLfloat ), vertices.data() );
+      unsigned int IBO = CreateStaticBuffer( indices.size() * sizeof( unsigned int ), indices.data() );
+      unsigned int VAO = CreateStaticVAO( VBO, IBO, 5, plane_attributes );
+
+      iPlane->_displacement_lods_VAO.push_back( VAO );
+      iPlane->_displacement_lods_VBO.push_back( VBO );
+      iPlane->_displacement_lods_IBO.push_back( IBO );
+    }
+  }
 }
 
 unsigned int Toolbox::GenIrradianceCubeMap( unsigned int iEnvCubeMap,
@@ -643,7 +1023,7 @@ unsigned int Toolbox::GenIrradianceCubeMap( unsigned int iEnvCubeMap,
   // ---------------------------------------------------
   glGenFramebuffers( 1, &capture_FBO );
   glGenRenderbuffers( 1, &capture_RBO );
-  glBindFramebuffer( GL_FRAMEBUFFER, capture_FBO );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, capture_FBO );
   glBindRenderbuffer( GL_RENDERBUFFER, capture_RBO );
   glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, iResCubeMap, iResCubeMap );
   glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, capture_RBO );
@@ -670,11 +1050,11 @@ unsigned int Toolbox::GenIrradianceCubeMap( unsigned int iEnvCubeMap,
   glUniform1f( glGetUniformLocation( iIrradianceShader._program, "uSampleDelta" ), iIrradianceSampleDelta );
   glUniform1i( glGetUniformLocation( iIrradianceShader._program, "uEnvironmentMap" ), 0 );
 
-  glActiveTexture( GL_TEXTURE0 );
-  glBindTexture( GL_TEXTURE_CUBE_MAP, iEnvCubeMap );
+  StateCache::ActiveTexture( GL_TEXTURE0 );
+  StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, iEnvCubeMap );
   
   glViewport( 0, 0, iResCubeMap, iResCubeMap ); // don't forget to configure the viewport to the capture dimensions.
-  glBindFramebuffer( GL_FRAMEBUFFER, capture_FBO );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, capture_FBO );
   for( unsigned int i = 0; i < 6; ++i )
   {
     glUniformMatrix4fv( glGetUniformLocation( iIrradianceShader._program, "uViewMatrix" ), 1, GL_FALSE, glm::value_ptr( capture_view_matrices[ i ] ) );
@@ -682,7 +1062,11 @@ unsigned int Toolbox::GenIrradianceCubeMap( unsigned int iEnvCubeMap,
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
     RenderCube();
   }
-  glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+  // Capture targets only serve this call
+  StateCache::DeleteFramebuffers( 1, &capture_FBO );
+  glDeleteRenderbuffers( 1, &capture_RBO );
 
 
   // return computed irradiance cubemap
@@ -710,6 +1094,8 @@ unsigned int Toolbox::GenPreFilterCubeMap( unsigned int iEnvCubeMap,
   // ---------------------------------------------------
   glGenFramebuffers( 1, &capture_FBO );
   glGenRenderbuffers( 1, &capture_RBO );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, capture_FBO );
+  glBindRenderbuffer( GL_RENDERBUFFER, capture_RBO );
   glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, capture_RBO );
 
 
@@ -735,10 +1121,10 @@ unsigned int Toolbox::GenPreFilterCubeMap( unsigned int iEnvCubeMap,
   glUniform1f( glGetUniformLocation( iPrefilterShader._program, "uCubeMapRes" ), iResCubeMap );
   glUniform1ui( glGetUniformLocation( iPrefilterShader._program, "uSampleCount" ), iPrefilterSampleCount );
 
-  glActiveTexture( GL_TEXTURE0 );
-  glBindTexture( GL_TEXTURE_CUBE_MAP, iEnvCubeMap );
+  StateCache::ActiveTexture( GL_TEXTURE0 );
+  StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, iEnvCubeMap );
 
-  glBindFramebuffer( GL_FRAMEBUFFER, capture_FBO );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, capture_FBO );
 
   for( unsigned int mip = 0; mip < iPrefilterMaxMipLevel; mip++ )
   {
@@ -762,7 +1148,10 @@ unsigned int Toolbox::GenPreFilterCubeMap( unsigned int iEnvCubeMap,
       RenderCube();
     }
   }
-  glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+  StateCache::DeleteFramebuffers( 1, &capture_FBO );
+  glDeleteRenderbuffers( 1, &capture_RBO );
 
 
   return pre_filter_cubemap;
@@ -911,7 +1300,7 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
   // --------------------------------------------------------
   glGenFramebuffers( 1, &capture_FBO );
   glGenRenderbuffers( 1, &capture_RBO );
-  glBindFramebuffer( GL_FRAMEBUFFER, capture_FBO );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, capture_FBO );
   glBindRenderbuffer( GL_RENDERBUFFER, capture_RBO );
   glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, _window->_scene->_res_env_cubemap, _window->_scene->_res_env_cubemap );
   glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, capture_RBO );
@@ -919,25 +1308,10 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
 
   // Gen the output cubemap textures
   // -------------------------------
-  glGenTextures( 1, &cubemap_id );
-  glBindTexture( GL_TEXTURE_CUBE_MAP, cubemap_id );
-  for( unsigned int i = 0; i < 6; ++i )
-  {
-    glTexImage2D( GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-    0, 
-    GL_RGB16F, 
-    _window->_scene->_res_env_cubemap, 
-    _window->_scene->_res_env_cubemap, 
-    0, 
-    GL_RGB, 
-    GL_FLOAT, 
-    nullptr );
-  }
-  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE );
-  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR ); // enable pre-filter mipmap sampling (combatting visible dots artifact)
-  glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+  // Every mip level allocated up front, filled by glGenerateMipmap once the faces are rendered
+  // ( pre-filter mipmap sampling combats the visible dots artifact )
+  cubemap_id = CreateCubeMapTexture( _window->_scene->_res_env_cubemap,
+                                     true );
 
 
   // Create 6 matrix to each cube map face
@@ -957,7 +1331,7 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
   // Bind capture FBO to render into cubemap texture
   // -----------------------------------------------
   glViewport( 0, 0, _window->_scene->_res_env_cubemap, _window->_scene->_res_env_cubemap );
-  glBindFramebuffer( GL_FRAMEBUFFER, capture_FBO );
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, capture_FBO );
 
   // Use the correct shader 
   _window->_scene->_forward_pbr_shader.Use();
@@ -977,18 +1351,18 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       model_matrix = _window->_scene->_grounds_type1[ ground_it ]._model_matrix; 
      
       // Textures binding
-      glActiveTexture( GL_TEXTURE0 );
-      glBindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_grounds_type1[ ground_it ]._material_id ][ 0 ] );  
-      glActiveTexture( GL_TEXTURE1 );
-      glBindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_grounds_type1[ ground_it ]._material_id ][ 1 ] ); 
-      glActiveTexture( GL_TEXTURE2 );
-      glBindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_grounds_type1[ ground_it ]._material_id ][ 2 ] ); 
-      glActiveTexture( GL_TEXTURE3 );
-      glBindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_grounds_type1[ ground_it ]._material_id ][ 3 ] ); 
-      glActiveTexture( GL_TEXTURE4 );
-      glBindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_grounds_type1[ ground_it ]._material_id ][ 4 ] ); 
-      glActiveTexture( GL_TEXTURE5 );
-      glBindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_grounds_type1[ ground_it ]._material_id ][ 5 ] ); 
+      StateCache::ActiveTexture( GL_TEXTURE0 );
+      StateCache::BindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_grounds_type1[ ground_it ]._material_id ][ 0 ] );  
+      StateCache::ActiveTexture( GL_TEXTURE1 );
+      StateCache::BindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_grounds_type1[ ground_it ]._material_id ][ 1 ] ); 
+      StateCache::ActiveTexture( GL_TEXTURE2 );
+      StateCache::BindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_grounds_type1[ ground_it ]._material_id ][ 2 ] ); 
+      StateCache::ActiveTexture( GL_TEXTURE3 );
+      StateCache::BindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_grounds_type1[ ground_it ]._material_id ][ 3 ] ); 
+      StateCache::ActiveTexture( GL_TEXTURE4 );
+      StateCache::BindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_grounds_type1[ ground_it ]._material_id ][ 4 ] ); 
+      StateCache::ActiveTexture( GL_TEXTURE5 );
+      StateCache::BindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_grounds_type1[ ground_it ]._material_id ][ 5 ] ); 
 
       // Matrices uniforms
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( capture_projection_matrix ) );
@@ -996,18 +1370,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -1027,19 +1391,26 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uEmissive" ), _window->_scene->_grounds_type1[ ground_it ]._emissive );
       if( _window->_scene->_grounds_type1[ ground_it ]._emissive )
       {
-        glActiveTexture( GL_TEXTURE11 );
-        glBindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_grounds_type1[ ground_it ]._material_id ][ 6 ] );
+        StateCache::ActiveTexture( GL_TEXTURE11 );
+        StateCache::BindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_grounds_type1[ ground_it ]._material_id ][ 6 ] );
         glUniform1f( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uEmissiveFactor" ), _window->_scene->_grounds_type1[ ground_it ]._emissive_factor );
       }
 
       glUniform1f( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uID" ), _window->_scene->_grounds_type1[ ground_it ]._id );  
 
+      // Height mapped planes captured with their relief when baked, flat otherwise
+      if( !_window->_scene->_grounds_type1[ ground_it ]._displacement_lods_VAO.empty() )
+      {
+        _window->_scene->DisplacementLODsDraw( &_window->_scene->_grounds_type1[ ground_it ], iPosition );
+        continue;
+      }
+
       // Bind correct VAO
-      ( _window->_scene->_grounds_type1[ ground_it ]._id == 18 ) ? glBindVertexArray( _window->_scene->_ground2_VAO ) : glBindVertexArray( _window->_scene->_ground1_VAO );
+      ( _window->_scene->_grounds_type1[ ground_it ]._id == 18 ) ? StateCache::BindVertexArray( _window->_scene->_ground2_VAO ) : StateCache::BindVertexArray( _window->_scene->_ground1_VAO );
       
       glDrawElements( GL_TRIANGLES, _window->_scene->_ground1_indices.size(), GL_UNSIGNED_INT, 0 );
       
-      glBindVertexArray( 0 );
+      StateCache::BindVertexArray( 0 );
     }
 
 
@@ -1050,18 +1421,18 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       model_matrix = _window->_scene->_walls_type1[ wall_it ]._model_matrix;
 
       // Textures binding
-      glActiveTexture( GL_TEXTURE0 );
-      glBindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_walls_type1[ wall_it ]._material_id ][ 0 ] );  
-      glActiveTexture( GL_TEXTURE1 );
-      glBindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_walls_type1[ wall_it ]._material_id ][ 1 ] ); 
-      glActiveTexture( GL_TEXTURE2 );
-      glBindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_walls_type1[ wall_it ]._material_id ][ 2 ] ); 
-      glActiveTexture( GL_TEXTURE3 );
-      glBindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_walls_type1[ wall_it ]._material_id ][ 3 ] ); 
-      glActiveTexture( GL_TEXTURE4 );
-      glBindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_walls_type1[ wall_it ]._material_id ][ 4 ] ); 
-      glActiveTexture( GL_TEXTURE5 );
-      glBindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_walls_type1[ wall_it ]._material_id ][ 5 ] ); 
+      StateCache::ActiveTexture( GL_TEXTURE0 );
+      StateCache::BindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_walls_type1[ wall_it ]._material_id ][ 0 ] );  
+      StateCache::ActiveTexture( GL_TEXTURE1 );
+      StateCache::BindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_walls_type1[ wall_it ]._material_id ][ 1 ] ); 
+      StateCache::ActiveTexture( GL_TEXTURE2 );
+      StateCache::BindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_walls_type1[ wall_it ]._material_id ][ 2 ] ); 
+      StateCache::ActiveTexture( GL_TEXTURE3 );
+      StateCache::BindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_walls_type1[ wall_it ]._material_id ][ 3 ] ); 
+      StateCache::ActiveTexture( GL_TEXTURE4 );
+      StateCache::BindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_walls_type1[ wall_it ]._material_id ][ 4 ] ); 
+      StateCache::ActiveTexture( GL_TEXTURE5 );
+      StateCache::BindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_walls_type1[ wall_it ]._material_id ][ 5 ] ); 
 
       // Matrices uniforms
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uProjectionMatrix" ), 1, GL_FALSE, glm::value_ptr( capture_projection_matrix ) );
@@ -1069,18 +1440,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -1100,19 +1461,26 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uEmissive" ), _window->_scene->_walls_type1[ wall_it ]._emissive );
       if( _window->_scene->_walls_type1[ wall_it ]._emissive )
       {
-        glActiveTexture( GL_TEXTURE11 );
-        glBindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_walls_type1[ wall_it ]._material_id ][ 6 ] );
+        StateCache::ActiveTexture( GL_TEXTURE11 );
+        StateCache::BindTexture( GL_TEXTURE_2D, _window->_scene->_loaded_materials[ _window->_scene->_walls_type1[ wall_it ]._material_id ][ 6 ] );
         glUniform1f( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uEmissiveFactor" ), _window->_scene->_walls_type1[ wall_it ]._emissive_factor );
       }
       
       glUniform1f( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uID" ), _window->_scene->_walls_type1[ wall_it ]._id );  
 
+      // Height mapped planes captured with their relief when baked, flat otherwise
+      if( !_window->_scene->_walls_type1[ wall_it ]._displacement_lods_VAO.empty() )
+      {
+        _window->_scene->DisplacementLODsDraw( &_window->_scene->_walls_type1[ wall_it ], iPosition );
+        continue;
+      }
+
       // Bind correct VAO
-      ( _window->_scene->_walls_type1[ wall_it ]._id == 4 ) ? glBindVertexArray( _window->_scene->_wall2_VAO ) : glBindVertexArray( _window->_scene->_wall1_VAO );
+      ( _window->_scene->_walls_type1[ wall_it ]._id == 4 ) ? StateCache::BindVertexArray( _window->_scene->_wall2_VAO ) : StateCache::BindVertexArray( _window->_scene->_wall1_VAO );
 
       glDrawElements( GL_TRIANGLES, _window->_scene->_wall1_indices.size(), GL_UNSIGNED_INT, 0 );
 
-      glBindVertexArray( 0 );
+      StateCache::BindVertexArray( 0 );
     }
 
 
@@ -1120,8 +1488,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
     // --------------------
     if( iID != _window->_scene->_revolving_door[ 0 ]._id )
     {
-      glEnable( GL_CULL_FACE );
-      glCullFace( GL_BACK );
+      StateCache::Enable( GL_CULL_FACE );
+      StateCache::CullFace( GL_BACK );
       for( unsigned int door_it = 0; door_it < _window->_scene->_revolving_door.size(); door_it++ )
       {
         model_matrix = _window->_scene->_revolving_door[ door_it ]._model_matrix;
@@ -1132,18 +1500,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
         glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
         glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-        // Point lights uniforms
-        glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-        for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-        {
-          string temp = to_string( i );
-          glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-          glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-          glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-        }
-
-        // Bloom uniforms
-        glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+        // Point lights binding, every light without clusters for the capture views
+        _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
         // IBL uniforms
         glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -1166,7 +1524,7 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
 
         _window->_scene->_revolving_door_model->Draw( _window->_scene->_forward_pbr_shader, model_matrix );
       }
-      glDisable( GL_CULL_FACE );
+      StateCache::Disable( GL_CULL_FACE );
     }
 
 
@@ -1174,8 +1532,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
     // -----------------
     if( iID != _window->_scene->_simple_door[ 0 ]._id )
     {
-      glEnable( GL_CULL_FACE );
-      glCullFace( GL_BACK );
+      StateCache::Enable( GL_CULL_FACE );
+      StateCache::CullFace( GL_BACK );
       for( unsigned int door_it = 0; door_it < _window->_scene->_simple_door.size(); door_it++ )
       {
         model_matrix = _window->_scene->_simple_door[ door_it ]._model_matrix;
@@ -1186,18 +1544,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
         glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
         glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-        // Point lights uniforms
-        glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-        for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-        {
-          string temp = to_string( i );
-          glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-          glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-          glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-        }
-
-        // Bloom uniforms
-        glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+        // Point lights binding, every light without clusters for the capture views
+        _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
         // IBL uniforms
         glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -1220,7 +1568,7 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
 
         _window->_scene->_simple_door_model->Draw( _window->_scene->_forward_pbr_shader, model_matrix );
       }
-      glDisable( GL_CULL_FACE );
+      StateCache::Disable( GL_CULL_FACE );
     }
 
 
@@ -1228,8 +1576,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
     // -----------------
     /*if( iID == 24 || iID == 25 )
     {
-      glEnable( GL_CULL_FACE );
-      glCullFace( GL_BACK );
+      StateCache::Enable( GL_CULL_FACE );
+      StateCache::CullFace( GL_BACK );
       
       model_matrix = _window->_scene->_room1_table1._model_matrix;
 
@@ -1239,18 +1587,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -1273,15 +1611,15 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
 
       _window->_scene->_room1_table1_model->Draw( _window->_scene->_forward_pbr_shader, model_matrix );
     }
-    glDisable( GL_CULL_FACE );*/
+    StateCache::Disable( GL_CULL_FACE );*/
 
 
     // Draw bottle
     // -----------
     /*if( iID != _window->_scene->_bottle._id )
     {
-      glEnable( GL_CULL_FACE );
-      glCullFace( GL_BACK );
+      StateCache::Enable( GL_CULL_FACE );
+      StateCache::CullFace( GL_BACK );
       
       model_matrix = _window->_scene->_bottle._model_matrix;
 
@@ -1291,18 +1629,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -1325,15 +1653,15 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
 
       _window->_scene->_bottle_model->Draw( _window->_scene->_forward_pbr_shader, model_matrix );
     }
-    glDisable( GL_CULL_FACE );
+    StateCache::Disable( GL_CULL_FACE );
 
 
     // Draw ball
     // ---------
     if( iID != _window->_scene->_ball._id )
     {
-      glEnable( GL_CULL_FACE );
-      glCullFace( GL_BACK );
+      StateCache::Enable( GL_CULL_FACE );
+      StateCache::CullFace( GL_BACK );
       
       model_matrix = _window->_scene->_ball._model_matrix;
 
@@ -1343,18 +1671,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -1377,15 +1695,15 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
 
       _window->_scene->_ball_model->Draw( _window->_scene->_forward_pbr_shader, model_matrix );
     }
-    glDisable( GL_CULL_FACE );
+    StateCache::Disable( GL_CULL_FACE );
 
 
     // Draw box bag
     // ------------
     if( iID != _window->_scene->_box_bag._id )
     {
-      glEnable( GL_CULL_FACE );
-      glCullFace( GL_BACK );
+      StateCache::Enable( GL_CULL_FACE );
+      StateCache::CullFace( GL_BACK );
       
       model_matrix = _window->_scene->_box_bag._model_matrix;
 
@@ -1395,18 +1713,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -1429,15 +1737,15 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
 
       _window->_scene->_box_bag_model->Draw( _window->_scene->_forward_pbr_shader, model_matrix );
     }
-    glDisable( GL_CULL_FACE );
+    StateCache::Disable( GL_CULL_FACE );
 
 
     // Draw chest
     // ----------
     if( iID != _window->_scene->_chest._id )
     {
-      glEnable( GL_CULL_FACE );
-      glCullFace( GL_BACK );
+      StateCache::Enable( GL_CULL_FACE );
+      StateCache::CullFace( GL_BACK );
       
       model_matrix = _window->_scene->_chest._model_matrix;
 
@@ -1447,18 +1755,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -1481,15 +1779,15 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
 
       _window->_scene->_chest_model->Draw( _window->_scene->_forward_pbr_shader, model_matrix );
     }
-    glDisable( GL_CULL_FACE );
+    StateCache::Disable( GL_CULL_FACE );
 
 
     // Draw sofa
     // ---------
     if( iID != _window->_scene->_sofa._id )
     {
-      glEnable( GL_CULL_FACE );
-      glCullFace( GL_BACK );
+      StateCache::Enable( GL_CULL_FACE );
+      StateCache::CullFace( GL_BACK );
       
       model_matrix = _window->_scene->_sofa._model_matrix;
 
@@ -1499,18 +1797,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -1533,15 +1821,15 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
 
       _window->_scene->_sofa_model->Draw( _window->_scene->_forward_pbr_shader, model_matrix );
     }
-    glDisable( GL_CULL_FACE );
+    StateCache::Disable( GL_CULL_FACE );
 
 
     // Draw sack
     // ---------
     if( iID != _window->_scene->_sack._id )
     {
-      glEnable( GL_CULL_FACE );
-      glCullFace( GL_BACK );
+      StateCache::Enable( GL_CULL_FACE );
+      StateCache::CullFace( GL_BACK );
       
       model_matrix = _window->_scene->_sack._model_matrix;
 
@@ -1551,18 +1839,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -1585,15 +1863,15 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
 
       _window->_scene->_sack_model->Draw( _window->_scene->_forward_pbr_shader, model_matrix );
     }
-    glDisable( GL_CULL_FACE );
+    StateCache::Disable( GL_CULL_FACE );
 
 
     // Draw room1_table2
     // -----------------
     if( iID != _window->_scene->_room1_table2._id )
     {
-      glEnable( GL_CULL_FACE );
-      glCullFace( GL_BACK );
+      StateCache::Enable( GL_CULL_FACE );
+      StateCache::CullFace( GL_BACK );
       
       model_matrix = _window->_scene->_room1_table2._model_matrix;
 
@@ -1603,18 +1881,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -1637,15 +1905,15 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
 
       _window->_scene->_room1_table2_model->Draw( _window->_scene->_forward_pbr_shader, model_matrix );
     }
-    glDisable( GL_CULL_FACE );
+    StateCache::Disable( GL_CULL_FACE );
 
 
     // Draw _ink_bottle
     // ----------------
     if( iID != _window->_scene->_ink_bottle._id )
     {
-      glEnable( GL_CULL_FACE );
-      glCullFace( GL_BACK );
+      StateCache::Enable( GL_CULL_FACE );
+      StateCache::CullFace( GL_BACK );
       
       model_matrix = _window->_scene->_ink_bottle._model_matrix;
 
@@ -1655,18 +1923,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -1689,15 +1947,15 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
 
       _window->_scene->_ink_bottle_model->Draw( _window->_scene->_forward_pbr_shader, model_matrix );
     }
-    glDisable( GL_CULL_FACE );
+    StateCache::Disable( GL_CULL_FACE );
 
 
     // Draw _book
     // ----------
     if( iID != _window->_scene->_book._id )
     {
-      glEnable( GL_CULL_FACE );
-      glCullFace( GL_BACK );
+      StateCache::Enable( GL_CULL_FACE );
+      StateCache::CullFace( GL_BACK );
       
       model_matrix = _window->_scene->_book._model_matrix;
 
@@ -1707,18 +1965,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -1741,15 +1989,15 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
 
       _window->_scene->_book_model->Draw( _window->_scene->_forward_pbr_shader, model_matrix );
     }
-    glDisable( GL_CULL_FACE );
+    StateCache::Disable( GL_CULL_FACE );
 
 
     // Draw _radio
     // -----------
     if( iID != _window->_scene->_radio._id )
     {
-      glEnable( GL_CULL_FACE );
-      glCullFace( GL_BACK );
+      StateCache::Enable( GL_CULL_FACE );
+      StateCache::CullFace( GL_BACK );
       
       model_matrix = _window->_scene->_radio._model_matrix;
 
@@ -1759,18 +2007,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -1793,7 +2031,7 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
 
       _window->_scene->_radio_model->Draw( _window->_scene->_forward_pbr_shader, model_matrix );
     }
-    glDisable( GL_CULL_FACE );*/
+    StateCache::Disable( GL_CULL_FACE );*/
     
 
     if( iID == 11 || iID == 12 )
@@ -1810,18 +2048,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
         glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
         glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-        // Point lights uniforms
-        glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-        for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-        {
-          string temp = to_string( i );
-          glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-          glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-          glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-        }
-
-        // Bloom uniforms
-        glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+        // Point lights binding, every light without clusters for the capture views
+        _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
         // IBL uniforms
         glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -1860,18 +2088,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
         glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
         glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-        // Point lights uniforms
-        glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-        for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-        {
-          string temp = to_string( i );
-          glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-          glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-          glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-        }
-
-        // Bloom uniforms
-        glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+        // Point lights binding, every light without clusters for the capture views
+        _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
         // IBL uniforms
         glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -1910,18 +2128,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
         glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
         glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-        // Point lights uniforms
-        glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-        for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-        {
-          string temp = to_string( i );
-          glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-          glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-          glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-        }
-
-        // Bloom uniforms
-        glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+        // Point lights binding, every light without clusters for the capture views
+        _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
         // IBL uniforms
         glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -1961,18 +2169,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -2011,18 +2209,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -2061,18 +2249,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -2111,18 +2289,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -2161,18 +2329,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -2211,18 +2369,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -2261,18 +2409,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -2311,18 +2449,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -2361,18 +2489,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -2411,18 +2529,8 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
       glUniformMatrix4fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uModelMatrix"), 1, GL_FALSE, glm::value_ptr( model_matrix ) );
       glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uViewPos" ), 1, &iPosition[ 0 ] );
 
-      // Point lights uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uLightCount" ), _window->_scene->_lights.size() );
-      for( int i = 0; i < _window->_scene->_lights.size(); i++ )
-      {
-        string temp = to_string( i );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightPos[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._position[ 0 ] );
-        glUniform3fv( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightColor[" + temp + "]" ).c_str() ),1, &_window->_scene->_lights[ i ]._color[ 0 ] );
-        glUniform1f(  glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, ( "uLightIntensity[" + temp + "]" ).c_str() ), _window->_scene->_lights[ i ]._intensity * 1.5f );
-      }
-
-      // Bloom uniforms
-      glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uBloom" ), false );
+      // Point lights binding, every light without clusters for the capture views
+      _window->_scene->ForwardLightsBinding( &_window->_scene->_forward_pbr_shader, false, 1.5 );
 
       // IBL uniforms
       glUniform1i( glGetUniformLocation( _window->_scene->_forward_pbr_shader._program, "uIBL" ), false );
@@ -2451,8 +2559,12 @@ unsigned int Toolbox::GenEnvironmentCubemap( glm::vec3    iPosition,
   }
 
   // generate mipmaps from first mip face ( combatting visible dots artifact )
-  glBindTexture( GL_TEXTURE_CUBE_MAP, cubemap_id );
+  StateCache::BindTexture( GL_TEXTURE_CUBE_MAP, cubemap_id );
   glGenerateMipmap( GL_TEXTURE_CUBE_MAP ); 
+
+  StateCache::BindFramebuffer( GL_FRAMEBUFFER, 0 );
+  StateCache::DeleteFramebuffers( 1, &capture_FBO );
+  glDeleteRenderbuffers( 1, &capture_RBO );
   
   return cubemap_id;
 }
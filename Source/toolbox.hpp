@@ -3,6 +3,7 @@
 
 #include "scene.hpp"
 #include "hdr_image_manager.hpp"
+#include "render_graph.hpp"
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
@@ -68,6 +69,19 @@ class Toolbox
 
     void RenderObserver();
 
+    int SizedInternalFormat( int iInternalFormat );
+
+    int MipLevelCount( int iWidth,
+                       int iHeight );
+
+    unsigned int CreateStaticBuffer( GLsizeiptr   iSize,
+                                     const void * iData );
+
+    unsigned int CreateStaticVAO( unsigned int iVBO,
+                                  unsigned int iIBO,
+                                  unsigned int iAttributeCount,
+                                  const int *  iAttributeSizes );
+
     unsigned int CreateTextureFromData( SDL_Surface * iImage,
                                         int           iInternalFormat,
                                         int           iFormat,
@@ -99,24 +113,35 @@ class Toolbox
                                    int          iHeight,
                                    GLenum       iAttachment );
 
-    void LinkRbo( unsigned int iRboID,
-                  int          iWidth,
-                  int          iHeight );
+    void LinkRbo( unsigned int * ioRboID,
+                  int            iWidth,
+                  int            iHeight );
 
-    void LinkMultiSampleRbo( unsigned int iRboID,
-                             int          iSampleCount, 
-                             int          iWidth,
-                             int          iHeight );
+    void LinkMultiSampleRbo( unsigned int * ioRboID,
+                             int            iSampleCount, 
+                             int            iWidth,
+                             int            iHeight );
 
     glm::mat4 AssimpMatrixToGlmMatrix( const aiMatrix4x4 * iAssimpMatrix );
 
     void CreatePlaneVAO( unsigned int *                iVAO,
                          unsigned int *                iVBO,
                          unsigned int *                iIBO,
+                         unsigned int *                iDepthVAO,
+                         unsigned int *                iDepthVBO,
                          std::vector< unsigned int > * iIndices,
                          unsigned int                  iSideVerticeCount,
                          float                         iUvScale );
 
+    float SampleHeightMap( std::vector< float > * iTexels,
+                           glm::ivec2             iSize,
+                           float                  iU,
+                           float                  iV );
+
+    void CreateDisplacedPlaneLODs( Object *     iPlane,
+                                   unsigned int iHeightTexture,
+                                   float        iUvScale );
+
     unsigned int GenIrradianceCubeMap( unsigned int iEnvCubeMap,
                                        unsigned int iResCubeMap,
                                        Shader       iIrradianceShader,
@@ -146,6 +171,12 @@ class Toolbox
 
     HDRManager * _hdr_image_manager;
 
+    // Owns the window sized targets textures, the FBOs below only reference them
+    RenderGraph * _render_graph;
+
+    // GL 4.5 or ARB_direct_state_access, static resources get immutable storage without binding
+    bool _direct_state_access;
+
     // VAO a VBO
     unsigned int _quad_VAO;
     unsigned int _quad_VBO;
@@ -155,19 +186,30 @@ class Toolbox
 
     // FBOs & RBOs
     unsigned int _temp_hdr_FBO;
-    unsigned int _temp_depth_RBO;
+    unsigned int _temp_depth_texture;
 
-    unsigned int _final_hdr_FBO;
+    unsigned int _post_process_FBO;
+    unsigned int _upscale_FBO;
+    unsigned int _taa_FBO[ 2 ];
+    unsigned int _motion_vectors_FBO;
 
-    unsigned int _pingpong_FBO;
+    unsigned int _bloom_FBO;
 
     unsigned int _depth_map_FBO;
+    unsigned int _static_depth_map_FBO;
+    unsigned int _shadow_moments_FBO;
 
     // FBO's textures
-    unsigned int _pingpong_color_buffers[ 2 ];
-    unsigned int _temp_tex_color_buffer[ 2 ];
-    unsigned int _final_tex_color_buffer[ 2 ];
-    unsigned int _depth_cubemap;
+    unsigned int _bloom_mips[ BLOOM_MIP_COUNT ];
+    unsigned int _temp_tex_color_buffer;
+    unsigned int _post_process_output;
+    unsigned int _upscale_output;
+    unsigned int _taa_history[ 2 ];
+    unsigned int _motion_vectors_texture;
+    unsigned int _shadow_atlas[ SHADOW_ATLAS_TIER_COUNT ];
+    unsigned int _static_shadow_atlas[ SHADOW_ATLAS_TIER_COUNT ];
+    unsigned int _shadow_moments_atlas[ SHADOW_ATLAS_TIER_COUNT ];
+    unsigned int _shadow_moments_buffers[ 2 ];
 
 };
 
@@ -119,17 +119,20 @@ SDL_Window * Window::InitSDLWindow( int iWidth,
 
 void Window::InitGL()
 {
+  // New context, the state cache starts from nothing known
+  StateCache::Invalidate();
+
   glClearColor( 0.0f, 0.0f, 0.0f, 1.0f );
 
-  glEnable( GL_DEPTH_TEST );
-  glDepthFunc( GL_LESS ); 
+  StateCache::Enable( GL_DEPTH_TEST );
+  StateCache::DepthFunc( GL_LESS ); 
 
   // enable seamless cubemap sampling for lower mip levels in the IBL specular pre-filter map
-  glEnable( GL_TEXTURE_CUBE_MAP_SEAMLESS );  
+  StateCache::Enable( GL_TEXTURE_CUBE_MAP_SEAMLESS );  
 
   Resize();
 
-  glDisable( GL_BLEND ); 
+  StateCache::Disable( GL_BLEND ); 
   
   glLightModelf( GL_LIGHT_MODEL_TWO_SIDE, GL_TRUE );
 
@@ -203,14 +206,149 @@ void Window::ManageEvents( Camera * iCamera )
             }
             break;
 
+          case 'h' :
+            _scene->PrintRenderTargetsInfos();
+            break;
+
           case 'r' :
+            _scene->PipelineSwitch();
+            temp = ( ( _scene->_pipeline_type == DEFERRED_RENDERING ) ? "Rendering pipeline : Deferred" : "Rendering pipeline : Forward" );
+            std::cout << std::endl << temp << std::endl
+                                   << "-----------------------------" << std::endl; 
             break;
 
           case 't' :
+            _scene->PipelineBenchmarkStart();
+            break;
+
+          case 'f' :
+            _scene->ShadowFilterSwitch( ( _scene->_shadow_filter_mode + 1 ) % SHADOW_FILTER_MODE_COUNT );
+            temp = ( ( _scene->_shadow_filter_mode == SHADOW_FILTER_PCF )     ? "Shadow filtering : PCF" :
+                     ( _scene->_shadow_filter_mode == SHADOW_FILTER_POISSON ) ? "Shadow filtering : Hardware compare Poisson" : "Shadow filtering : Exponential moments" );
+            std::cout << std::endl << temp << std::endl
+                                   << "-----------------------------" << std::endl; 
+            break;
+
+          case 'g' :
+            _scene->ShadowFilterBenchmarkStart();
+            break;
+
+          case 'b' :
+            _scene->BloomBenchmark();
+            break;
+
+          case 'c' :
+            _scene->_compute_post_process = ( _scene->_compute_post_process == true ) ? false : true;
+            _scene->PostProcessTargetsUpdate();
+            temp = ( ( _scene->_compute_post_process && _scene->_compute_post_process_supported ) ? "Post process : Compute" : "Post process : Fragment" );
+            std::cout << std::endl << temp << std::endl
+                                   << "-----------------------" << std::endl; 
+            break;
+
+          case 'v' :
+            _scene->PostProcessBandwidthReport();
+            break;
+
+          case 'x' :
+            _scene->_dynamic_resolution = ( _scene->_dynamic_resolution == true ) ? false : true;
+            _scene->PostProcessTargetsUpdate();
+            _scene->DynamicResolutionScaleSet( 1.0f );
+            temp = ( ( _scene->_dynamic_resolution == true ) ? "Dynamic resolution : On" : "Dynamic resolution : Off" );
+            std::cout << std::endl << temp << std::endl
+                                   << "------------------------" << std::endl; 
+            break;
+
+          case 'j' :
+            _scene->_taa = ( _scene->_taa == true ) ? false : true;
+            _scene->PostProcessTargetsUpdate();
+            if( !_scene->_taa )
+            {
+              _scene->_camera->SetProjectionJitter( glm::vec2( 0.0 ) );
+            }
+            temp = ( ( _scene->_taa && !_scene->_multi_sample ) ? "Temporal anti-aliasing : On" : "Temporal anti-aliasing : Off" );
+            std::cout << std::endl << temp << std::endl
+                                   << std::string( temp.size(), '-' ) << std::endl; 
+            break;
+
+          case 'k' :
+            _scene->_tessellation_mode = ( _scene->_tessellation_mode + 1 ) % TESSELLATION_MODE_COUNT;
+            temp = ( _scene->_tessellation_mode == TESSELLATION_DISTANCE_BANDS ) ? "Tessellation levels : distance bands" :
+                   ( ( _scene->_tessellation_mode == TESSELLATION_SCREEN_SPACE ) ? "Tessellation levels : screen space" : "Tessellation levels : screen space with patch culling" );
+            std::cout << std::endl << temp << std::endl
+                                   << std::string( temp.size(), '-' ) << std::endl; 
+            break;
+
+          case 'u' :
+            StateCache::_enabled = ( StateCache::_enabled == true ) ? false : true;
+            temp = ( StateCache::_enabled ? "GPU state cache : On" : "GPU state cache : Off" );
+            std::cout << std::endl << temp << std::endl
+                                   << std::string( temp.size(), '-' ) << std::endl; 
+            break;
+
+          case 'o' :
+            _scene->_shader_permutations = ( _scene->_shader_permutations == true ) ? false : true;
+            temp = ( _scene->_shader_permutations ? "Forward shader permutations : On" : "Forward shader permutations : Off" );
+            std::cout << std::endl << temp << std::endl
+                                   << std::string( temp.size(), '-' ) << std::endl; 
+            break;
+
+          case 'l' :
+            {
+              // Per object switch, applied to the current room height mapped planes
+              std::vector< Object * > planes;
+              for( unsigned int ground_it = _scene->_grounds_start_it; ground_it < _scene->_grounds_end_it; ground_it++ )
+              {
+                planes.push_back( &_scene->_grounds_type1[ ground_it ] );
+              }
+              for( unsigned int wall_it = _scene->_walls_start_it; wall_it < _scene->_walls_end_it; wall_it++ )
+              {
+                planes.push_back( &_scene->_walls_type1[ wall_it ] );
+              }
+
+              unsigned int switched = 0;
+              for( unsigned int plane_it = 0; plane_it < planes.size(); plane_it++ )
+              {
+                if( !planes[ plane_it ]->_displacement_lods_VAO.empty() )
+                {
+                  planes[ plane_it ]->_baked_displacement = ( planes[ plane_it ]->_baked_displacement == true ) ? false : true;
+                  temp = ( ( planes[ plane_it ]->_baked_displacement == true ) ? "Pre-displaced LODs : On" : "Pre-displaced LODs : Off" );
+                  switched++;
+                }
+              }
+
+              if( switched == 0 )
+              {
+                temp = "Pre-displaced LODs : no height mapped plane in this room";
+              }
+              std::cout << std::endl << temp << std::endl
+                                     << std::string( temp.size(), '-' ) << std::endl; 
+            }
+            break;
+
+          case 'n' :
+            _scene->_frame_time_budget = std::max( _scene->_frame_time_budget - 1.0f, 1.0f );
+            temp = "Frame time budget : " + std::to_string( _scene->_frame_time_budget ) + " ms";
+            std::cout << std::endl << temp << std::endl
+                                   << std::string( temp.size(), '-' ) << std::endl; 
+            break;
+
+          case 'm' :
+            _scene->_frame_time_budget += 1.0f;
+            temp = "Frame time budget : " + std::to_string( _scene->_frame_time_budget ) + " ms";
+            std::cout << std::endl << temp << std::endl
+                                   << std::string( temp.size(), '-' ) << std::endl; 
+            break;
+
+          case 'p' :
+            _scene->_depth_prepass = ( _scene->_depth_prepass == true ) ? false : true;
+            temp = ( ( _scene->_depth_prepass == true ) ? "Forward depth pre-pass : On" : "Forward depth pre-pass : Off" );
+            std::cout << std::endl << temp << std::endl
+                                   << "----------------------------" << std::endl; 
             break;
        
           case SDLK_F1 :
             _scene->_bloom = ( _scene->_bloom == true ) ? false : true;
+            _scene->PostProcessTargetsUpdate();
             temp = ( ( _scene->_bloom == true ) ? "Bloom effect : On" : "Bloom effect : Off" );
             std::cout << std::endl << temp << std::endl
                                    << "--------------" << std::endl; 
@@ -248,6 +386,39 @@ void Window::ManageEvents( Camera * iCamera )
             std::cout << " _simple_door_open = " << _scene->_simple_door_open << std::endl; 
             break;
 
+          case SDLK_F8 :
+            _scene->_demo_PVS_culling = ( _scene->_demo_PVS_culling == true ) ? false : true;
+            temp = ( ( _scene->_demo_PVS_culling == true ) ? "Demo path PVS culling : On" : "Demo path PVS culling : Off" );
+            std::cout << std::endl << temp << std::endl
+                                   << "---------------------------" << std::endl; 
+            break;
+
+          case SDLK_F9 :
+            _scene->_clustered_lighting = ( _scene->_clustered_lighting == true ) ? false : true;
+            temp = ( ( _scene->_clustered_lighting == true ) ? "Clustered lighting : On" : "Clustered lighting : Off" );
+            std::cout << std::endl << temp << std::endl
+                                   << "------------------------" << std::endl; 
+            break;
+
+          case SDLK_F10 :
+            _scene->_many_lights_benchmark = ( _scene->_many_lights_benchmark == true ) ? false : true;
+            _scene->ManyLightsBenchmark( _scene->_many_lights_benchmark );
+            temp = ( ( _scene->_many_lights_benchmark == true ) ? "Many lights benchmark : On" : "Many lights benchmark : Off" );
+            std::cout << std::endl << temp << std::endl
+                                   << "---------------------------" << std::endl; 
+            break;
+
+          case SDLK_F11 :
+            _scene->_tiled_deferred_lighting = ( _scene->_tiled_deferred_lighting == true ) ? false : true;
+            temp = ( ( _scene->_tiled_deferred_lighting == true ) ? "Deferred lighting : tiled compute" : "Deferred lighting : stencil volumes" );
+            std::cout << std::endl << temp << std::endl
+                                   << "-----------------------------------" << std::endl; 
+            break;
+
+          case SDLK_F12 :
+            _scene->GBufferBandwidthBenchmark();
+            break;
+
           default:
             fprintf( stderr, "\nLa touche %s a ete pressee\n", SDL_GetKeyName( event.key.keysym.sym ) );
             break;
@@ -283,7 +454,10 @@ void Window::ManageEvents( Camera * iCamera )
             case SDL_WINDOWEVENT_RESIZED :
               SDL_GetWindowSize( _SDL_window, &_width, &_height );
               Resize();    
-              _scene->SceneDataInitialization();
+
+              // Frame graph rebuilt at the new size before the next frame, only the history is handled here
+              _scene->PostProcessTargetsUpdate();
+              _scene->DynamicResolutionScaleSet( _scene->_render_scale );
               break;
             case SDL_WINDOWEVENT_CLOSE :
               event.type = SDL_QUIT;
@@ -302,27 +476,67 @@ void Window::ManageEvents( Camera * iCamera )
 void Window::Draw() 
 { 
 
+  // Window sized targets follow the size and the enabled passes
+  _scene->FrameGraphUpdate();
+
   // Animation(s) update
   // -------------------
 
   _scene->AnimationsUpdate();
 
+  // Sub-pixel jitter of this frame projection
+  if( _scene->_taa && !_scene->_multi_sample )
+  {
+    _scene->TemporalJitterUpdate();
+  }
+
 
   // Frame drawing
   // ------------- 
   
+  // Dynamic resolution times the whole GPU frame
+  if( _scene->_dynamic_resolution )
+  {
+    _scene->DynamicResolutionFrameBegin();
+  }
+
+  // Tessellation levels follow this frame render size
+  _scene->TessellationUniformsUpdate();
+
   // Perform scene depth pass from point light perspective
   _scene->SceneDepthPass();
 
+  // Pipelines benchmark times rendering up to the final frame
+  if( _scene->_pipeline_benchmark )
+  {
+    _scene->PipelineBenchmarkFrameBegin();
+  }
+
   // Render scene
   _scene->_pipeline_type == FORWARD_RENDERING ? _scene->SceneForwardRendering() : _scene->SceneDeferredRendering();  
 
-  // Blur calculation on bloom's bright texture
-  if( _scene->_bloom )
+  // Temporal anti-aliasing resolve, read by the post process instead of the lit frame
+  if( _scene->_taa && !_scene->_multi_sample )
   {
-    _scene->BlurProcess();
-  }  
+    _scene->TemporalResolve();
+  }
 
-  // Post process calculations => final render
+  // Bloom mip chain and fused post process => final render
   _scene->PostProcess();
+
+  if( _scene->_dynamic_resolution )
+  {
+    _scene->DynamicResolutionFrameEnd();
+  }
+
+  if( _scene->_pipeline_benchmark )
+  {
+    _scene->PipelineBenchmarkFrameEnd();
+  }
+
+  // Shadow filtering benchmark reads the final frame back
+  if( _scene->_shadow_filter_benchmark )
+  {
+    _scene->ShadowFilterBenchmarkFrameEnd();
+  }
 }
\ No newline at end of file